@@ -2,11 +2,12 @@
 
 #include <memory>
 #include <vector>
+#include <string>
 
 class Base
 {
 public:
-	virtual ~Base() = 0 {}
+	virtual ~Base() = 0;
 
 	virtual bool Init() { return true; }
 
@@ -21,6 +22,8 @@ protected:
 	std::vector<std::shared_ptr<Base>>	m_referenceTable;
 };
 
+inline Base::~Base() {}
+
 template <class T>
 class SelfRefBase : public Base
 {
@@ -1,3 +1,21 @@
 #include "BaseComponent.h"
 
-std::size_t	BaseComponent::ClassHashCode = std::hash<std::string>()(TO_STRING(BaseComponent));
\ No newline at end of file
+std::size_t	BaseComponent::ClassHashCode = std::hash<std::string>()(TO_STRING(BaseComponent));
+uint32_t BaseComponent::ClassTypeIndex = BaseComponent::AcquireClassTypeIndex();
+
+// Function static, so that it's initialized before any class type index regardless of static initialization order
+static uint32_t& ClassTypeCount()
+{
+	static uint32_t classTypeCount = 0;
+	return classTypeCount;
+}
+
+uint32_t BaseComponent::AcquireClassTypeIndex()
+{
+	return ClassTypeCount()++;
+}
+
+uint32_t BaseComponent::GetClassTypeCount()
+{
+	return ClassTypeCount();
+}
\ No newline at end of file
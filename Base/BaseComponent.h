@@ -2,28 +2,56 @@
 #include "Base.h"
 #include "../common/Macros.h"
 #include <mutex>
+#include <type_traits>
 
 #define DECLARE_CLASS_RTTI(class_name)	\
 public:	\
 static std::size_t ClassHashCode;	\
+static uint32_t ClassTypeIndex;	\
 virtual bool IsSameClass(std::size_t classHashCode) const override;	\
+virtual uint32_t GetClassTypeIndex() const override { return ClassTypeIndex; }	\
+virtual void GetClassTypeIndices(std::vector<uint32_t>& typeIndices) const override;	\
+virtual uint32_t GetOverriddenPhaseMask() const override	\
+{	\
+	return AcquireOverriddenPhaseMask(&class_name::Update, &class_name::OnAnimationUpdate, &class_name::LateUpdate,	\
+		&class_name::OnPreRender, &class_name::OnRenderObject, &class_name::OnPostRender);	\
+}	\
 
 #define DEFINITE_CLASS_RTTI(class_name, base_class)	\
 std::size_t	class_name::ClassHashCode = std::hash<std::string>()(TO_STRING(class_name));	\
+uint32_t class_name::ClassTypeIndex = BaseComponent::AcquireClassTypeIndex();	\
 bool class_name::IsSameClass(std::size_t classHashCode) const	\
 {	\
 	if (class_name::ClassHashCode == classHashCode)	\
 		return true;	\
 	return base_class::IsSameClass(classHashCode);	\
+}	\
+void class_name::GetClassTypeIndices(std::vector<uint32_t>& typeIndices) const	\
+{	\
+	typeIndices.push_back(class_name::ClassTypeIndex);	\
+	base_class::GetClassTypeIndices(typeIndices);	\
 }
 
 class BaseObject;
 class PerFrameResource;
 
+// Per frame phases dispatched by BaseObject
+enum ComponentPhase
+{
+	ComponentPhaseUpdate,
+	ComponentPhaseAnimationUpdate,
+	ComponentPhaseLateUpdate,
+	ComponentPhasePreRender,
+	ComponentPhaseRenderObject,
+	ComponentPhasePostRender,
+	ComponentPhaseCount
+};
+
 class BaseComponent : public SelfRefBase<BaseComponent>
 {
 public:
 	static std::size_t	ClassHashCode;
+	static uint32_t		ClassTypeIndex;
 
 public:
 	virtual ~BaseComponent(void) {}
@@ -51,35 +79,29 @@ public:
 		return ClassHashCode == classHashCode;
 	}
 
-	template <typename T>
-	std::shared_ptr<T> GetComponent(uint32_t index = 0) const
-	{
-		return GetBaseObject()->GetComponent<T>(index);
-	}
+	// Dense index of the most derived class, used to index per type component arrays
+	virtual uint32_t GetClassTypeIndex() const { return ClassTypeIndex; }
+	// Type indices of this class and all its bases
+	virtual void GetClassTypeIndices(std::vector<uint32_t>& typeIndices) const { typeIndices.push_back(ClassTypeIndex); }
+	// Bit mask of phases overridden, components are only dispatched in these phases
+	virtual uint32_t GetOverriddenPhaseMask() const { return 0; }
+	// Components of this class are dispatched on worker threads in this phase, so they must not touch anything shared with other components
+	virtual bool IsParallelPhase(ComponentPhase phase) const { return false; }
 
-	template <typename T>
-	std::vector<std::shared_ptr<T>> GetComponents() const
-	{
-		return GetBaseObject()->GetComponents<T>();
-	}
+	static uint32_t AcquireClassTypeIndex();
+	static uint32_t GetClassTypeCount();
 
+	// Defined in BaseObject.h, where BaseObject is complete
 	template <typename T>
-	bool DelComponent(uint32_t index = 0)
-	{
-		return GetBaseObject()->DelComponent<T>(index);
-	}
-
+	std::shared_ptr<T> GetComponent(uint32_t index = 0) const;
 	template <typename T>
-	uint32_t DelComponents()
-	{
-		GetBaseObject()->DelComponents<T>();
-	}
-
+	std::vector<std::shared_ptr<T>> GetComponents() const;
 	template <typename T>
-	bool ContainComponent(const std::shared_ptr<T>& pComp) const
-	{
-		return GetBaseObject()->ContainComponent<T>();
-	}
+	bool DelComponent(uint32_t index = 0);
+	template <typename T>
+	uint32_t DelComponents();
+	template <typename T>
+	bool ContainComponent(const std::shared_ptr<T>& pComp) const;
 
 protected:
 	virtual bool Init(const std::shared_ptr<BaseComponent>& pSelf)
@@ -110,3 +132,21 @@ protected:
 	friend class BaseObject;
 };
 
+// A phase counts as overridden if its member function pointer no longer points to a member of BaseComponent
+// Pointers are taken within the class, so that non-public overrides are accessible
+template <typename PhaseFunc>
+uint32_t IsPhaseOverridden(PhaseFunc)
+{
+	return std::is_same<PhaseFunc, void (BaseComponent::*)()>::value ? 0 : 1;
+}
+
+template <typename F0, typename F1, typename F2, typename F3, typename F4, typename F5>
+uint32_t AcquireOverriddenPhaseMask(F0 update, F1 animationUpdate, F2 lateUpdate, F3 preRender, F4 renderObject, F5 postRender)
+{
+	return IsPhaseOverridden(update) << ComponentPhaseUpdate |
+		IsPhaseOverridden(animationUpdate) << ComponentPhaseAnimationUpdate |
+		IsPhaseOverridden(lateUpdate) << ComponentPhaseLateUpdate |
+		IsPhaseOverridden(preRender) << ComponentPhasePreRender |
+		IsPhaseOverridden(renderObject) << ComponentPhaseRenderObject |
+		IsPhaseOverridden(postRender) << ComponentPhasePostRender;
+}
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "BaseObject.h"
+#include "TransformHierarchy.h"
 #include "../vulkan/GlobalDeviceObjects.h"
 #include "../vulkan/FrameManager.h"
+#include "../thread/ThreadTaskQueue.hpp"
+
+uint32_t BaseObject::m_structureVersion = 0;
 
 bool BaseObject::Init(const std::shared_ptr<BaseObject>& pObj)
 {
@@ -8,9 +12,29 @@ bool BaseObject::Init(const std::shared_ptr<BaseObject>& pObj)
 		return false;
 
 	m_localScale = 1.0f;
+
+	m_pTransformHierarchy = TransformHierarchy::GetSharedInstance();
+	m_transformHandle = m_pTransformHierarchy->AllocateNode();
+	UpdateLocalTransform();
+
 	return true;
 }
 
+BaseObject::~BaseObject()
+{
+	if (!m_pTransformHierarchy)
+		return;
+
+	// Children might still be held somewhere else, they become roots
+	for (auto& pChild : m_children)
+	{
+		m_pTransformHierarchy->SetParent(pChild->m_transformHandle, TransformHierarchy::NULL_HANDLE);
+		pChild->m_pParent.reset();
+	}
+
+	m_pTransformHierarchy->FreeNode(m_transformHandle);
+}
+
 std::shared_ptr<BaseObject> BaseObject::Create()
 {
 	std::shared_ptr<BaseObject> pObj = std::make_shared<BaseObject>();
@@ -25,13 +49,18 @@ void BaseObject::AddChild(const std::shared_ptr<BaseObject>& pObj)
 		return;
 	m_children.push_back(pObj);
 	pObj->m_pParent = GetSelfSharedPtr();
+	m_pTransformHierarchy->SetParent(pObj->m_transformHandle, m_transformHandle);
+	m_structureVersion++;
 }
 
 void BaseObject::DelChild(uint32_t index)
 {
 	if (index < 0 || index >= m_children.size())
 		return;
+	m_pTransformHierarchy->SetParent(m_children[index]->m_transformHandle, TransformHierarchy::NULL_HANDLE);
+	m_children[index]->m_pParent.reset();
 	m_children.erase(m_children.begin() + index);
+	m_structureVersion++;
 }
 
 std::shared_ptr<BaseObject> BaseObject::GetChild(uint32_t index)
@@ -41,6 +70,62 @@ std::shared_ptr<BaseObject> BaseObject::GetChild(uint32_t index)
 	return m_children[index];
 }
 
+void BaseObject::AddComponentInternal(const std::shared_ptr<BaseComponent>& pComp)
+{
+	m_componentStorage.AddComponent(pComp);
+	m_structureVersion++;
+}
+
+void BaseObject::DelComponentInternal(const std::shared_ptr<BaseComponent>& pComp)
+{
+	m_componentStorage.DelComponent(pComp);
+	m_structureVersion++;
+}
+
+void BaseObject::UpdatePhaseBatches()
+{
+	if (m_phaseBatchVersion == m_structureVersion)
+		return;
+
+	// Pre-order walk, same as the order components used to be called in
+	std::vector<const ComponentStorage*> storages;
+	std::vector<BaseObject*> stack = { this };
+	while (!stack.empty())
+	{
+		BaseObject* pObject = stack.back();
+		stack.pop_back();
+
+		storages.push_back(&pObject->m_componentStorage);
+
+		for (auto iter = pObject->m_children.rbegin(); iter != pObject->m_children.rend(); iter++)
+			stack.push_back(iter->get());
+	}
+
+	m_phaseBatches.Build(storages);
+	m_phaseBatchVersion = m_structureVersion;
+}
+
+bool BaseObject::IsInSubTree(const std::shared_ptr<BaseComponent>& pComp) const
+{
+	std::shared_ptr<BaseObject> pObject = pComp->GetBaseObject();
+	if (pObject == nullptr || !pObject->m_componentStorage.ContainComponent(pComp->GetClassTypeIndex(), pComp))
+		return false;
+
+	while (pObject != nullptr && pObject.get() != this)
+		pObject = pObject->m_pParent.lock();
+	return pObject != nullptr;
+}
+
+void BaseObject::DispatchPhase(ComponentPhase phase)
+{
+	UpdatePhaseBatches();
+
+	m_phaseBatches.Dispatch(phase, m_structureVersion, [this](const std::shared_ptr<BaseComponent>& pComp)
+	{
+		return IsInSubTree(pComp);
+	}, GlobalThreadTaskQueue()->AcquireParallelRangeFunc(FrameMgr()->FrameIndex()));
+}
+
 bool BaseObject::ContainObject(const std::shared_ptr<BaseObject>& pObj) const
 {
 	for (size_t i = 0; i < m_children.size(); i++)
@@ -53,87 +138,66 @@ bool BaseObject::ContainObject(const std::shared_ptr<BaseObject>& pObj) const
 
 void BaseObject::Update()
 {
-	//update components attached to this object
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->Update();
-
-	//update all children objects with global registered components
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->Update();
+	DispatchPhase(ComponentPhaseUpdate);
 }
 
 void BaseObject::OnAnimationUpdate()
 {
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->OnAnimationUpdate();
-
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->OnAnimationUpdate();
+	DispatchPhase(ComponentPhaseAnimationUpdate);
 }
 
 void BaseObject::LateUpdate()
 {
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->LateUpdate();
-
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->LateUpdate();
+	DispatchPhase(ComponentPhaseLateUpdate);
 }
 
 void BaseObject::UpdateCachedData()
 {
-	Matrix4d cachedParentWorldTransform;
+	m_pTransformHierarchy->Update(GlobalThreadTaskQueue()->AcquireParallelRangeFunc(FrameMgr()->FrameIndex()));
+}
 
-	if (!m_pParent.expired())
-		cachedParentWorldTransform = m_pParent.lock()->m_cachedWorldTransform;
+Matrix4d BaseObject::GetCachedWorldTransform() const
+{
+	return m_pTransformHierarchy->GetCachedWorldTransform(m_transformHandle);
+}
 
-	m_cachedWorldTransform = cachedParentWorldTransform * m_localTransform;
-	m_cachedWorldPosition = (cachedParentWorldTransform * Vector4d(m_localPosition, 1.0f)).xyz();
+Vector3d BaseObject::GetCachedWorldPosition() const
+{
+	// Translation column of world transform equals parent world transform applied to local position
+	return m_pTransformHierarchy->GetCachedWorldTransform(m_transformHandle)[3].xyz();
+}
 
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->UpdateCachedData();
+bool BaseObject::IsWorldTransformChanged() const
+{
+	return m_pTransformHierarchy->IsWorldTransformChanged(m_transformHandle);
 }
 
 void BaseObject::OnPreRender()
 {
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->OnPreRender();
-
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->OnPreRender();
+	DispatchPhase(ComponentPhasePreRender);
 }
 
 void BaseObject::OnRenderObject()
 {
-	//update components attached to this object
-	//for (size_t i = 0; i < m_components.size(); i++)
-	//	FrameMgr()->AddJobToFrame(std::bind(&BaseComponent::OnRenderObject, m_components[i].get(), std::placeholders::_1));
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->OnRenderObject();
-
-	//update all children objects
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->OnRenderObject();
+	DispatchPhase(ComponentPhaseRenderObject);
 }
 
 void BaseObject::OnPostRender()
 {
-	for (size_t i = 0; i < m_components.size(); i++)
-		m_components[i]->OnPostRender();
-
-	for (size_t i = 0; i < m_children.size(); i++)
-		m_children[i]->OnPostRender();
+	DispatchPhase(ComponentPhasePostRender);
 }
 
 void BaseObject::Awake()
 {
-	std::for_each(m_components.begin(), m_components.end(), [](auto & pComp) { pComp->Awake(); });
+	auto& components = m_componentStorage.GetComponents();
+	std::for_each(components.begin(), components.end(), [](auto & pComp) { pComp->Awake(); });
 	std::for_each(m_children.begin(), m_children.end(), [](auto & pChild) { pChild->Awake(); });
 }
 
 void BaseObject::Start()
 {
-	std::for_each(m_components.begin(), m_components.end(), [](auto & pComp) { pComp->Start(); });
+	auto& components = m_componentStorage.GetComponents();
+	std::for_each(components.begin(), components.end(), [](auto & pComp) { pComp->Start(); });
 	std::for_each(m_children.begin(), m_children.end(), [](auto & pChild) { pChild->Start(); });
 }
 
@@ -154,35 +218,22 @@ void BaseObject::SetRotation(const Quaterniond& q)
 void BaseObject::UpdateLocalTransform()
 {
 	m_localTransform = Matrix4d(m_localRotationM * Matrix3d(Vector3d(m_localScale)), m_localPosition);
+	m_pTransformHierarchy->SetLocalTransform(m_transformHandle, m_localTransform, m_localRotationM);
 }
 
 Vector3d BaseObject::GetWorldPosition() const
 {
-	Matrix4d parentWorldTransform;
-
-	if (!m_pParent.expired())
-		parentWorldTransform = m_pParent.lock()->GetWorldTransform();
-
-	//get world transform
-	return (parentWorldTransform * Vector4d(m_localPosition, 1.0)).xyz();
+	return m_pTransformHierarchy->GetWorldTransform(m_transformHandle)[3].xyz();
 }
 
-Matrix4d BaseObject::GetWorldTransform() const 
-{ 
-	Matrix4d parentWorldTransform;
-	if (!m_pParent.expired())
-		parentWorldTransform = m_pParent.lock()->GetWorldTransform();
-
-	return parentWorldTransform * m_localTransform;
+Matrix4d BaseObject::GetWorldTransform() const
+{
+	return m_pTransformHierarchy->GetWorldTransform(m_transformHandle);
 }
 
 Matrix3d BaseObject::GetWorldRotationM() const
-{ 
-	Matrix3d parentWorldRotationM;
-	if (!m_pParent.expired())
-		parentWorldRotationM = m_pParent.lock()->GetWorldRotationM();
-
-	return parentWorldRotationM * m_localRotationM;
+{
+	return m_pTransformHierarchy->GetWorldRotationM(m_transformHandle);
 }
 
 Quaterniond BaseObject::GetWorldRotationQ() const
@@ -1,14 +1,21 @@
 #pragma once
 #include <vector>
 #include "BaseComponent.h"
+#include "ComponentStorage.h"
+#include "ComponentPhaseBatches.h"
 #include "../maths/Matrix.h"
 #include "../maths/Quaternion.h"
 
+class TransformHierarchy;
+
 class BaseObject : public SelfRefBase<BaseObject>
 {
 protected:
 	bool Init(const std::shared_ptr<BaseObject>& pObj);
 
+public:
+	~BaseObject();
+
 public:
 	template <typename T>
 	void AddComponent(const std::shared_ptr<T>& pComp)
@@ -16,45 +23,27 @@ public:
 		if (ContainComponent(pComp))
 			return;
 
-		m_components.push_back(pComp);
+		AddComponentInternal(pComp);
 		pComp->OnAddedToObject(GetSelfSharedPtr());
 	}
 
-	template <typename T>
-	std::vector<std::shared_ptr<BaseComponent>>::const_iterator GetComponentIter(uint32_t index) const
-	{
-		uint32_t currentIndex = 0;
-		auto iter = std::find_if(m_components.begin(), m_components.end(), [&currentIndex, index, classHashCode = T::ClassHashCode](auto & pComp)
-		{
-			return (currentIndex == index) && pComp->IsSameClass(classHashCode);
-		});
-
-		return iter;
-	}
-
 	template <typename T>
 	std::shared_ptr<T> GetComponent(uint32_t index = 0) const
 	{
-		auto iter = GetComponentIter<T>(index);
+		auto& components = m_componentStorage.GetComponents(T::ClassTypeIndex);
+		if (index >= components.size())
+			return nullptr;
 
-		if (iter != m_components.end())
-		{
-			return std::static_pointer_cast<T>(*iter);
-		}
-
-		return nullptr;
+		return std::static_pointer_cast<T>(components[index]);
 	}
 
 	template <typename T>
 	std::vector<std::shared_ptr<T>> GetComponents() const
 	{
 		std::vector<std::shared_ptr<T>> resultVector;
-		
-		for (auto & pComp : m_components)
-		{
-			if (pComp->IsSameClass(T::ClassHashCode))
-				resultVector.push_back(std::static_pointer_cast<T>(pComp));
-		}
+
+		for (auto & pComp : m_componentStorage.GetComponents(T::ClassTypeIndex))
+			resultVector.push_back(std::static_pointer_cast<T>(pComp));
 
 		return resultVector;
 	}
@@ -62,39 +51,20 @@ public:
 	template <typename T>
 	bool DelComponent(uint32_t index = 0)
 	{
-		auto iter = GetComponentIter<T>(index);
+		std::shared_ptr<T> pComp = GetComponent<T>(index);
+		if (pComp == nullptr)
+			return false;
 
-		if (iter != m_components.end())
-		{
-			m_components.erase(iter);
-			return true;
-		}
-
-		return false;
+		DelComponentInternal(pComp);
+		return true;
 	}
 
 	template <typename T>
 	uint32_t DelComponents()
 	{
 		uint32_t count = 0;
-		bool removed;
-		do
-		{
-			removed = false;
-
-			auto iter = std::find_if(m_components.begin(), m_components.end(), [classHashCode = T::ClassHashCode](auto & pComp)
-			{
-				return pComp->IsSameClass(classHashCode);
-			});
-
-			if (iter != m_components.end())
-			{
-				m_components.erase(iter);
-				removed = true;
-				count++;
-			}
-
-		} while (removed);
+		while (DelComponent<T>(0))
+			count++;
 
 		return count;
 	}
@@ -102,8 +72,7 @@ public:
 	template <typename T>
 	bool ContainComponent(const std::shared_ptr<T>& pComp) const
 	{
-		auto vec = GetComponents<T>();
-		return std::find(vec.begin(), vec.end(), pComp) != vec.end();
+		return m_componentStorage.ContainComponent(T::ClassTypeIndex, pComp);
 	}
 
 	void AddChild(const std::shared_ptr<BaseObject>& pObj);
@@ -134,6 +103,7 @@ public:
 	void Update();
 	void OnAnimationUpdate();
 	void LateUpdate();
+	// Transforms are stored in a flat hierarchy, this updates all objects at once, not just this sub tree
 	void UpdateCachedData();
 	void OnPreRender();
 	void OnRenderObject();
@@ -143,6 +113,7 @@ public:
 	virtual void Start();
 
 	Vector3d GetLocalPosition() const { return m_localPosition; }
+	Vector3d GetLocalScale() const { return m_localScale; }
 	Vector3d GetWorldPosition() const;
 
 	Matrix4d GetLocalTransform() const { return m_localTransform; }
@@ -154,8 +125,11 @@ public:
 	Quaterniond GetWorldRotationQ() const;
 
 	// These are before the stage of pre render
-	Matrix4d GetCachedWorldTransform() const { return m_cachedWorldTransform; }
-	Vector3d GetCachedWorldPosition() const { return m_cachedWorldPosition; }
+	Matrix4d GetCachedWorldTransform() const;
+	Vector3d GetCachedWorldPosition() const;
+	bool IsWorldTransformChanged() const;
+
+	uint32_t GetTransformHandle() const { return m_transformHandle; }
 
 	//creators
 	static std::shared_ptr<BaseObject> Create();
@@ -163,8 +137,17 @@ public:
 protected:
 	void UpdateLocalTransform();
 
+	void AddComponentInternal(const std::shared_ptr<BaseComponent>& pComp);
+	void DelComponentInternal(const std::shared_ptr<BaseComponent>& pComp);
+
+	// Rebuild phase batches of this sub tree if anything changed since last time
+	void UpdatePhaseBatches();
+	// Whether component is still attached to an object of this sub tree
+	bool IsInSubTree(const std::shared_ptr<BaseComponent>& pComp) const;
+	void DispatchPhase(ComponentPhase phase);
+
 protected:
-	std::vector<std::shared_ptr<BaseComponent>>		m_components;
+	ComponentStorage								m_componentStorage;
 	std::vector<std::shared_ptr<BaseObject>>		m_children;
 	std::weak_ptr<BaseObject>						m_pParent;
 
@@ -175,6 +158,44 @@ protected:
 	Matrix3d	m_localRotationM;
 	Quaterniond m_localRotationQ;
 
-	Matrix4d	m_cachedWorldTransform;
-	Vector3d	m_cachedWorldPosition;
-};
\ No newline at end of file
+	// Handle of this object within transform hierarchy, the hierarchy is held here so it outlives all objects
+	uint32_t								m_transformHandle;
+	std::shared_ptr<TransformHierarchy>		m_pTransformHierarchy;
+
+	// Only built for objects whose phases are called, usually root
+	ComponentPhaseBatches					m_phaseBatches;
+	uint32_t								m_phaseBatchVersion = 0xffffffff;
+
+	// Increased whenever a component or child is added or removed anywhere
+	static uint32_t							m_structureVersion;
+};
+
+template <typename T>
+std::shared_ptr<T> BaseComponent::GetComponent(uint32_t index) const
+{
+	return GetBaseObject()->GetComponent<T>(index);
+}
+
+template <typename T>
+std::vector<std::shared_ptr<T>> BaseComponent::GetComponents() const
+{
+	return GetBaseObject()->GetComponents<T>();
+}
+
+template <typename T>
+bool BaseComponent::DelComponent(uint32_t index)
+{
+	return GetBaseObject()->DelComponent<T>(index);
+}
+
+template <typename T>
+uint32_t BaseComponent::DelComponents()
+{
+	return GetBaseObject()->DelComponents<T>();
+}
+
+template <typename T>
+bool BaseComponent::ContainComponent(const std::shared_ptr<T>& pComp) const
+{
+	return GetBaseObject()->ContainComponent<T>(pComp);
+}
\ No newline at end of file
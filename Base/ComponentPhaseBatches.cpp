@@ -0,0 +1,108 @@
+#include "ComponentPhaseBatches.h"
+#include <algorithm>
+
+void ComponentPhaseBatches::Build(const std::vector<const ComponentStorage*>& storages)
+{
+	// Per phase and type, indices of batches of that type in ascending order
+	std::vector<std::vector<uint32_t>> typeBatchIndices[ComponentPhaseCount];
+	for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+	{
+		m_phaseBatches[phase].clear();
+		typeBatchIndices[phase].assign(BaseComponent::GetClassTypeCount(), {});
+	}
+
+	// Within an object, components are called in the order they're added, so each one goes to the first batch of its type after batch of previous one
+	// Objects with the same component order share one batch per type, a conflicting order only costs extra batches
+	for (const ComponentStorage* pStorage : storages)
+	{
+		uint32_t prevBatchIndices[ComponentPhaseCount];
+		for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+			prevBatchIndices[phase] = 0xffffffff;
+
+		for (auto& pComp : pStorage->GetComponents())
+		{
+			uint32_t typeIndex = pComp->GetClassTypeIndex();
+			uint32_t phaseMask = pComp->GetOverriddenPhaseMask();
+
+			for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+			{
+				if ((phaseMask & (1 << phase)) == 0)
+					continue;
+
+				std::vector<uint32_t>& batchIndices = typeBatchIndices[phase][typeIndex];
+				auto iter = prevBatchIndices[phase] == 0xffffffff ? batchIndices.begin() : std::upper_bound(batchIndices.begin(), batchIndices.end(), prevBatchIndices[phase]);
+
+				uint32_t batchIndex;
+				if (iter != batchIndices.end())
+					batchIndex = *iter;
+				else
+				{
+					batchIndex = (uint32_t)m_phaseBatches[phase].size();
+					batchIndices.push_back(batchIndex);
+					m_phaseBatches[phase].push_back({ typeIndex });
+				}
+
+				m_phaseBatches[phase][batchIndex].components.push_back(pComp);
+				prevBatchIndices[phase] = batchIndex;
+			}
+		}
+	}
+}
+
+void ComponentPhaseBatches::Dispatch(ComponentPhase phase, const uint32_t& structureVersion, const ComponentFilterFunc& isAttached, const ParallelRangeFunc& parallelFor) const
+{
+	// Components added within a phase are called from next phase on
+	// Batches hold references, so removed ones stay valid, and they're skipped once anything changed structure
+	uint32_t startVersion = structureVersion;
+	for (auto& batch : m_phaseBatches[phase])
+	{
+		// Once structure changed, batch is checked one by one on this thread instead
+		if (parallelFor && batch.components.size() > 1 && batch.components[0]->IsParallelPhase(phase) && startVersion == structureVersion)
+		{
+			parallelFor((uint32_t)batch.components.size(), 1, [&batch, phase](uint32_t startIndex, uint32_t endIndex)
+			{
+				for (uint32_t i = startIndex; i < endIndex; i++)
+					Dispatch(batch.components[i].get(), phase);
+			});
+
+			// Parallel phases must not touch anything shared, including hierarchy
+			ASSERTION(startVersion == structureVersion);
+			continue;
+		}
+
+		for (auto& pComp : batch.components)
+		{
+			if (startVersion != structureVersion && !isAttached(pComp))
+				continue;
+			Dispatch(pComp.get(), phase);
+		}
+	}
+}
+
+void ComponentPhaseBatches::Dispatch(BaseComponent* pComp, ComponentPhase phase)
+{
+	switch (phase)
+	{
+	case ComponentPhaseUpdate:
+		pComp->Update();
+		break;
+	case ComponentPhaseAnimationUpdate:
+		pComp->OnAnimationUpdate();
+		break;
+	case ComponentPhaseLateUpdate:
+		pComp->LateUpdate();
+		break;
+	case ComponentPhasePreRender:
+		pComp->OnPreRender();
+		break;
+	case ComponentPhaseRenderObject:
+		pComp->OnRenderObject();
+		break;
+	case ComponentPhasePostRender:
+		pComp->OnPostRender();
+		break;
+	default:
+		ASSERTION(false);
+		break;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include "BaseComponent.h"
+#include "ComponentStorage.h"
+#include "../thread/ParallelRange.hpp"
+
+// Components of a sub tree, grouped per phase into batches of the same type, so that a phase makes the same virtual call over a run of components
+// Batches run in order, so does each component of an object relative to its siblings, order between components of different objects is not kept
+class ComponentPhaseBatches
+{
+public:
+	typedef struct _ComponentBatch
+	{
+		uint32_t									typeIndex;
+		std::vector<std::shared_ptr<BaseComponent>>	components;
+	}ComponentBatch;
+
+	// Whether a batched component is still attached, only asked once structure changed within a phase
+	typedef std::function<bool(const std::shared_ptr<BaseComponent>& pComp)> ComponentFilterFunc;
+
+public:
+	// Storages of objects in pre-order, the order components used to be called in
+	void Build(const std::vector<const ComponentStorage*>& storages);
+
+	// "structureVersion" is increased whenever a component or object is added or removed, it's read again after each batch
+	// Batches of types that are parallel in this phase go through "parallelFor" if there's one, others run on this thread
+	void Dispatch(ComponentPhase phase, const uint32_t& structureVersion, const ComponentFilterFunc& isAttached, const ParallelRangeFunc& parallelFor = nullptr) const;
+	static void Dispatch(BaseComponent* pComp, ComponentPhase phase);
+
+	const std::vector<ComponentBatch>& GetBatches(ComponentPhase phase) const { return m_phaseBatches[phase]; }
+
+protected:
+	std::vector<ComponentBatch>	m_phaseBatches[ComponentPhaseCount];
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "ComponentStorage.h"
+#include <algorithm>
+
+void ComponentStorage::AddComponent(const std::shared_ptr<BaseComponent>& pComp)
+{
+	m_components.push_back(pComp);
+
+	if (m_componentsByType.size() < BaseComponent::GetClassTypeCount())
+		m_componentsByType.resize(BaseComponent::GetClassTypeCount());
+
+	std::vector<uint32_t> typeIndices;
+	pComp->GetClassTypeIndices(typeIndices);
+	for (uint32_t typeIndex : typeIndices)
+		m_componentsByType[typeIndex].push_back(pComp);
+}
+
+void ComponentStorage::DelComponent(const std::shared_ptr<BaseComponent>& pComp)
+{
+	std::vector<uint32_t> typeIndices;
+	pComp->GetClassTypeIndices(typeIndices);
+	for (uint32_t typeIndex : typeIndices)
+	{
+		auto& components = m_componentsByType[typeIndex];
+		components.erase(std::find(components.begin(), components.end(), pComp));
+	}
+
+	m_components.erase(std::find(m_components.begin(), m_components.end(), pComp));
+}
+
+const std::vector<std::shared_ptr<BaseComponent>>& ComponentStorage::GetComponents(uint32_t typeIndex) const
+{
+	static const std::vector<std::shared_ptr<BaseComponent>> emptyComponents;
+	if (typeIndex >= m_componentsByType.size())
+		return emptyComponents;
+	return m_componentsByType[typeIndex];
+}
+
+bool ComponentStorage::ContainComponent(uint32_t typeIndex, const std::shared_ptr<BaseComponent>& pComp) const
+{
+	auto& components = GetComponents(typeIndex);
+	return std::find(components.begin(), components.end(), pComp) != components.end();
+}
\ No newline at end of file
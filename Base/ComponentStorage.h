@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "BaseComponent.h"
+
+// Components of an object, in the order they're added, and indexed by class type
+// A component is in the array of its own class and all its bases, so looking up a base class finds derived ones too
+class ComponentStorage
+{
+public:
+	void AddComponent(const std::shared_ptr<BaseComponent>& pComp);
+	void DelComponent(const std::shared_ptr<BaseComponent>& pComp);
+
+	const std::vector<std::shared_ptr<BaseComponent>>& GetComponents() const { return m_components; }
+	// Empty if there's no component of this type
+	const std::vector<std::shared_ptr<BaseComponent>>& GetComponents(uint32_t typeIndex) const;
+	bool ContainComponent(uint32_t typeIndex, const std::shared_ptr<BaseComponent>& pComp) const;
+
+protected:
+	std::vector<std::shared_ptr<BaseComponent>>					m_components;
+	std::vector<std::vector<std::shared_ptr<BaseComponent>>>	m_componentsByType;
+};
\ No newline at end of file
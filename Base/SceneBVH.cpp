@@ -0,0 +1,693 @@
+#include "SceneBVH.h"
+#include "../common/Macros.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+const double SceneBVH::REBUILD_CHANGE_RATIO = 0.25;
+const double SceneBVH::REBUILD_COST_RATIO = 1.5;
+
+bool SceneBVH::Init()
+{
+	return true;
+}
+
+double SceneBVH::AcquireArea(const Vector3d& boxMin, const Vector3d& boxMax)
+{
+	// Half of surface area, the constant doesn't matter for comparison
+	Vector3d size = boxMax - boxMin;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+void SceneBVH::MergeBox(const Vector3d& minA, const Vector3d& maxA, const Vector3d& minB, const Vector3d& maxB, Vector3d& boxMin, Vector3d& boxMax)
+{
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		boxMin[i] = minA[i] < minB[i] ? minA[i] : minB[i];
+		boxMax[i] = maxA[i] > maxB[i] ? maxA[i] : maxB[i];
+	}
+}
+
+uint32_t SceneBVH::AllocateNode()
+{
+	uint32_t nodeIndex;
+	if (!m_freeNodes.empty())
+	{
+		nodeIndex = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		nodeIndex = (uint32_t)m_nodes.size();
+		m_nodes.push_back({});
+	}
+
+	m_nodes[nodeIndex] = { Vector3d(), Vector3d(), NULL_INDEX, NULL_INDEX, NULL_INDEX, NULL_INDEX };
+	return nodeIndex;
+}
+
+void SceneBVH::FreeNode(uint32_t nodeIndex)
+{
+	m_freeNodes.push_back(nodeIndex);
+}
+
+void SceneBVH::Update(const BoxStream& boxes, const uint8_t* pValid, uint32_t objectCount)
+{
+	// Objects beyond stream are gone
+	for (uint32_t i = objectCount; i < (uint32_t)m_objectLeaves.size(); i++)
+	{
+		if (m_objectLeaves[i] != NULL_INDEX)
+			Remove(i);
+	}
+
+	// Applying lots of insertions and removals one by one is slower and gives a worse tree than building it again
+	uint32_t changeCount = 0;
+	for (uint32_t i = 0; i < objectCount; i++)
+		changeCount += (pValid[i] != 0) != Contain(i) ? 1 : 0;
+
+	bool rebuild = changeCount > 0 && changeCount + m_changesSinceRebuild > m_leafCount * REBUILD_CHANGE_RATIO;
+	if (rebuild)
+	{
+		m_objectLeaves.resize(objectCount, (uint32_t)NULL_INDEX);
+		m_objectBoxMin.resize(objectCount);
+		m_objectBoxMax.resize(objectCount);
+	}
+
+	// Removals and moves go first, so that insertions see refitted boxes
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		Vector3d extent = { boxes.pExtentX[i], boxes.pExtentY[i], boxes.pExtentZ[i] };
+		Vector3d center = { boxes.pCenterX[i], boxes.pCenterY[i], boxes.pCenterZ[i] };
+
+		if (rebuild)
+		{
+			// Any valid index marks object to be built into tree
+			m_objectLeaves[i] = pValid[i] ? 0 : NULL_INDEX;
+			m_objectBoxMin[i] = center - extent;
+			m_objectBoxMax[i] = center + extent;
+			continue;
+		}
+
+		if (!Contain(i))
+			continue;
+
+		if (!pValid[i])
+		{
+			Remove(i);
+			continue;
+		}
+
+		Vector3d boxMin = center - extent;
+		Vector3d boxMax = center + extent;
+		if (boxMin != m_objectBoxMin[i] || boxMax != m_objectBoxMax[i])
+			Move(i, boxMin, boxMax);
+	}
+
+	if (rebuild)
+	{
+		Rebuild();
+		return;
+	}
+
+	Refit();
+
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		if (!pValid[i] || Contain(i))
+			continue;
+
+		Vector3d extent = { boxes.pExtentX[i], boxes.pExtentY[i], boxes.pExtentZ[i] };
+		Vector3d center = { boxes.pCenterX[i], boxes.pCenterY[i], boxes.pCenterZ[i] };
+		Insert(i, center - extent, center + extent);
+	}
+
+	// Refitting moved objects doesn't change topology, so tree gradually gets worse as objects move apart
+	m_updatesSinceCostCheck++;
+	if (m_updatesSinceCostCheck >= COST_CHECK_INTERVAL)
+	{
+		m_updatesSinceCostCheck = 0;
+		if (AcquireSAHCost() > m_rebuiltSAHCost * REBUILD_COST_RATIO)
+			Rebuild();
+	}
+}
+
+void SceneBVH::Insert(uint32_t objectIndex, const Vector3d& boxMin, const Vector3d& boxMax)
+{
+	if (objectIndex >= (uint32_t)m_objectLeaves.size())
+	{
+		m_objectLeaves.resize(objectIndex + 1, (uint32_t)NULL_INDEX);
+		m_objectBoxMin.resize(objectIndex + 1);
+		m_objectBoxMax.resize(objectIndex + 1);
+	}
+
+	ASSERTION(m_objectLeaves[objectIndex] == NULL_INDEX);
+
+	uint32_t leaf = AllocateNode();
+	m_nodes[leaf].boxMin = boxMin;
+	m_nodes[leaf].boxMax = boxMax;
+	m_nodes[leaf].objectIndex = objectIndex;
+
+	m_objectLeaves[objectIndex] = leaf;
+	m_objectBoxMin[objectIndex] = boxMin;
+	m_objectBoxMax[objectIndex] = boxMax;
+
+	m_leafCount++;
+	m_changesSinceRebuild++;
+
+	if (m_root == NULL_INDEX)
+	{
+		m_root = leaf;
+		return;
+	}
+
+	// Descend to sibling with least surface area cost, a new parent costs its area, and every ancestor grows by the new box
+	uint32_t sibling = m_root;
+	Vector3d mergedMin, mergedMax;
+	while (!IsLeaf(sibling))
+	{
+		const BVHNode& node = m_nodes[sibling];
+
+		MergeBox(node.boxMin, node.boxMax, boxMin, boxMax, mergedMin, mergedMax);
+		double area = AcquireArea(node.boxMin, node.boxMax);
+		double mergedArea = AcquireArea(mergedMin, mergedMax);
+
+		double cost = 2.0 * mergedArea;
+		double inheritanceCost = 2.0 * (mergedArea - area);
+
+		double childCosts[2];
+		uint32_t children[2] = { node.left, node.right };
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			const BVHNode& child = m_nodes[children[i]];
+			MergeBox(child.boxMin, child.boxMax, boxMin, boxMax, mergedMin, mergedMax);
+
+			if (IsLeaf(children[i]))
+				childCosts[i] = AcquireArea(mergedMin, mergedMax) + inheritanceCost;
+			else
+				childCosts[i] = AcquireArea(mergedMin, mergedMax) - AcquireArea(child.boxMin, child.boxMax) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	uint32_t oldParent = m_nodes[sibling].parent;
+	uint32_t newParent = AllocateNode();
+
+	BVHNode& parentNode = m_nodes[newParent];
+	MergeBox(m_nodes[sibling].boxMin, m_nodes[sibling].boxMax, boxMin, boxMax, parentNode.boxMin, parentNode.boxMax);
+	parentNode.parent = oldParent;
+	parentNode.left = sibling;
+	parentNode.right = leaf;
+
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_INDEX)
+	{
+		m_root = newParent;
+		return;
+	}
+
+	if (m_nodes[oldParent].left == sibling)
+		m_nodes[oldParent].left = newParent;
+	else
+		m_nodes[oldParent].right = newParent;
+
+	RefitAncestors(oldParent);
+}
+
+void SceneBVH::Remove(uint32_t objectIndex)
+{
+	uint32_t leaf = m_objectLeaves[objectIndex];
+	ASSERTION(leaf != NULL_INDEX);
+
+	m_objectLeaves[objectIndex] = NULL_INDEX;
+	m_leafCount--;
+	m_changesSinceRebuild++;
+
+	if (leaf == m_root)
+	{
+		m_root = NULL_INDEX;
+		FreeNode(leaf);
+		return;
+	}
+
+	// Sibling takes place of parent
+	uint32_t parent = m_nodes[leaf].parent;
+	uint32_t grandParent = m_nodes[parent].parent;
+	uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+	m_nodes[sibling].parent = grandParent;
+	if (grandParent == NULL_INDEX)
+		m_root = sibling;
+	else
+	{
+		if (m_nodes[grandParent].left == parent)
+			m_nodes[grandParent].left = sibling;
+		else
+			m_nodes[grandParent].right = sibling;
+
+		RefitAncestors(grandParent);
+	}
+
+	FreeNode(parent);
+	FreeNode(leaf);
+}
+
+void SceneBVH::Move(uint32_t objectIndex, const Vector3d& boxMin, const Vector3d& boxMax)
+{
+	uint32_t leaf = m_objectLeaves[objectIndex];
+	ASSERTION(leaf != NULL_INDEX);
+
+	m_objectBoxMin[objectIndex] = boxMin;
+	m_objectBoxMax[objectIndex] = boxMax;
+	m_nodes[leaf].boxMin = boxMin;
+	m_nodes[leaf].boxMax = boxMax;
+
+	m_movedObjects.push_back(objectIndex);
+}
+
+void SceneBVH::Refit()
+{
+	for (uint32_t objectIndex : m_movedObjects)
+	{
+		// Object might be removed after it's moved
+		uint32_t leaf = m_objectLeaves[objectIndex];
+		if (leaf != NULL_INDEX && m_nodes[leaf].parent != NULL_INDEX)
+			RefitAncestors(m_nodes[leaf].parent);
+	}
+	m_movedObjects.clear();
+}
+
+void SceneBVH::RefitAncestors(uint32_t nodeIndex)
+{
+	while (nodeIndex != NULL_INDEX)
+	{
+		BVHNode& node = m_nodes[nodeIndex];
+
+		Vector3d boxMin, boxMax;
+		MergeBox(m_nodes[node.left].boxMin, m_nodes[node.left].boxMax, m_nodes[node.right].boxMin, m_nodes[node.right].boxMax, boxMin, boxMax);
+
+		// Ancestors already enclose an unchanged box
+		if (boxMin == node.boxMin && boxMax == node.boxMax)
+			return;
+
+		node.boxMin = boxMin;
+		node.boxMax = boxMax;
+		nodeIndex = node.parent;
+	}
+}
+
+void SceneBVH::Rebuild()
+{
+	m_nodes.clear();
+	m_freeNodes.clear();
+	m_movedObjects.clear();
+	m_root = NULL_INDEX;
+
+	m_buildObjects.clear();
+	m_buildCentroids.resize(m_objectLeaves.size());
+	for (uint32_t i = 0; i < (uint32_t)m_objectLeaves.size(); i++)
+	{
+		if (m_objectLeaves[i] == NULL_INDEX)
+			continue;
+
+		m_buildObjects.push_back(i);
+		m_buildCentroids[i] = (m_objectBoxMin[i] + m_objectBoxMax[i]) * 0.5;
+	}
+
+	m_leafCount = (uint32_t)m_buildObjects.size();
+	m_changesSinceRebuild = 0;
+	m_updatesSinceCostCheck = 0;
+	m_rebuildCount++;
+
+	if (m_leafCount == 0)
+	{
+		m_rebuiltSAHCost = 0;
+		return;
+	}
+
+	m_nodes.reserve(m_leafCount * 2 - 1);
+	m_root = AllocateNode();
+
+	std::vector<BuildTask> tasks = { { m_root, 0, m_leafCount } };
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+		BuildNode(task, tasks);
+	}
+
+	m_rebuiltSAHCost = AcquireSAHCost();
+}
+
+void SceneBVH::BuildNode(const BuildTask& task, std::vector<BuildTask>& tasks)
+{
+	Vector3d boxMin = m_objectBoxMin[m_buildObjects[task.begin]];
+	Vector3d boxMax = m_objectBoxMax[m_buildObjects[task.begin]];
+	Vector3d centroidMin = m_buildCentroids[m_buildObjects[task.begin]];
+	Vector3d centroidMax = centroidMin;
+
+	for (uint32_t i = task.begin + 1; i < task.end; i++)
+	{
+		uint32_t objectIndex = m_buildObjects[i];
+		MergeBox(boxMin, boxMax, m_objectBoxMin[objectIndex], m_objectBoxMax[objectIndex], boxMin, boxMax);
+		MergeBox(centroidMin, centroidMax, m_buildCentroids[objectIndex], m_buildCentroids[objectIndex], centroidMin, centroidMax);
+	}
+
+	m_nodes[task.nodeIndex].boxMin = boxMin;
+	m_nodes[task.nodeIndex].boxMax = boxMax;
+
+	if (task.end - task.begin == 1)
+	{
+		uint32_t objectIndex = m_buildObjects[task.begin];
+		m_nodes[task.nodeIndex].objectIndex = objectIndex;
+		m_objectLeaves[objectIndex] = task.nodeIndex;
+		return;
+	}
+
+	// Split along longest axis of centroids
+	Vector3d centroidSize = centroidMax - centroidMin;
+	uint32_t axis = centroidSize.x > centroidSize.y ? 0 : 1;
+	axis = centroidSize[axis] > centroidSize.z ? axis : 2;
+
+	uint32_t mid = (task.begin + task.end) / 2;
+	if (centroidSize[axis] > 0.0)
+	{
+		double binScale = SAH_BIN_COUNT / centroidSize[axis];
+		double axisMin = centroidMin[axis];
+		auto acquireBin = [this, binScale, axisMin, axis](uint32_t objectIndex)
+		{
+			uint32_t bin = (uint32_t)((m_buildCentroids[objectIndex][axis] - axisMin) * binScale);
+			return bin < SAH_BIN_COUNT ? bin : SAH_BIN_COUNT - 1;
+		};
+
+		uint32_t binCounts[SAH_BIN_COUNT] = {};
+		Vector3d binMin[SAH_BIN_COUNT], binMax[SAH_BIN_COUNT];
+		for (uint32_t i = task.begin; i < task.end; i++)
+		{
+			uint32_t objectIndex = m_buildObjects[i];
+			uint32_t bin = acquireBin(objectIndex);
+
+			if (binCounts[bin] == 0)
+			{
+				binMin[bin] = m_objectBoxMin[objectIndex];
+				binMax[bin] = m_objectBoxMax[objectIndex];
+			}
+			else
+				MergeBox(binMin[bin], binMax[bin], m_objectBoxMin[objectIndex], m_objectBoxMax[objectIndex], binMin[bin], binMax[bin]);
+			binCounts[bin]++;
+		}
+
+		// Cost of objects on the right of each split, swept from last bin
+		double rightCosts[SAH_BIN_COUNT];
+		uint32_t count = 0;
+		Vector3d sweepMin, sweepMax;
+		for (uint32_t i = SAH_BIN_COUNT - 1; i > 0; i--)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (count == 0)
+				{
+					sweepMin = binMin[i];
+					sweepMax = binMax[i];
+				}
+				else
+					MergeBox(sweepMin, sweepMax, binMin[i], binMax[i], sweepMin, sweepMax);
+				count += binCounts[i];
+			}
+			rightCosts[i] = count == 0 ? 0.0 : AcquireArea(sweepMin, sweepMax) * count;
+		}
+
+		// Split i puts bins [0, i] to the left
+		uint32_t bestSplit = 0;
+		double bestCost = 0.0;
+		count = 0;
+		for (uint32_t i = 0; i < SAH_BIN_COUNT - 1; i++)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (count == 0)
+				{
+					sweepMin = binMin[i];
+					sweepMax = binMax[i];
+				}
+				else
+					MergeBox(sweepMin, sweepMax, binMin[i], binMax[i], sweepMin, sweepMax);
+				count += binCounts[i];
+			}
+
+			double cost = (count == 0 ? 0.0 : AcquireArea(sweepMin, sweepMax) * count) + rightCosts[i + 1];
+			if (i == 0 || cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = i;
+			}
+		}
+
+		// First and last bins are never empty, so both sides get objects
+		mid = (uint32_t)(std::partition(m_buildObjects.begin() + task.begin, m_buildObjects.begin() + task.end,
+			[&acquireBin, bestSplit](uint32_t objectIndex) { return acquireBin(objectIndex) <= bestSplit; }) - m_buildObjects.begin());
+	}
+
+	uint32_t left = AllocateNode();
+	uint32_t right = AllocateNode();
+
+	m_nodes[task.nodeIndex].left = left;
+	m_nodes[task.nodeIndex].right = right;
+	m_nodes[left].parent = task.nodeIndex;
+	m_nodes[right].parent = task.nodeIndex;
+
+	tasks.push_back({ left, task.begin, mid });
+	tasks.push_back({ right, mid, task.end });
+}
+
+double SceneBVH::AcquireSAHCost() const
+{
+	if (m_root == NULL_INDEX || IsLeaf(m_root))
+		return 0.0;
+
+	double rootArea = AcquireArea(m_nodes[m_root].boxMin, m_nodes[m_root].boxMax);
+	if (rootArea <= 0.0)
+		return 0.0;
+
+	double areaSum = 0.0;
+	std::vector<uint32_t> stack = { m_root };
+	while (!stack.empty())
+	{
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+
+		if (IsLeaf(nodeIndex))
+			continue;
+
+		areaSum += AcquireArea(m_nodes[nodeIndex].boxMin, m_nodes[nodeIndex].boxMax);
+		stack.push_back(m_nodes[nodeIndex].left);
+		stack.push_back(m_nodes[nodeIndex].right);
+	}
+
+	return areaSum / rootArea;
+}
+
+bool SceneBVH::TestBox(const BVHNode& node, const Planed* pPlanes, uint32_t& planeMask)
+{
+	Vector3d center = (node.boxMin + node.boxMax) * 0.5;
+	Vector3d extent = (node.boxMax - node.boxMin) * 0.5;
+
+	for (uint32_t i = 0; i < 32 && (planeMask >> i) != 0; i++)
+	{
+		if ((planeMask & (1 << i)) == 0)
+			continue;
+
+		const Planed& plane = pPlanes[i];
+		double t = plane.normal.x * center.x + plane.normal.y * center.y + plane.normal.z * center.z - plane.D;
+		double r = std::fabs(plane.normal.x) * extent.x + std::fabs(plane.normal.y) * extent.y + std::fabs(plane.normal.z) * extent.z;
+
+		if (t + r < 0.0)
+			return false;
+
+		// Children are inside of this plane as well
+		if (t - r >= 0.0)
+			planeMask &= ~(1 << i);
+	}
+
+	return true;
+}
+
+void SceneBVH::QueryFrustum(const Planed* pPlanes, uint32_t planeCount, std::vector<uint32_t>& objectIndices) const
+{
+	ASSERTION(planeCount <= 32);
+
+	if (m_root == NULL_INDEX)
+		return;
+
+	std::vector<CullTask> stack = { { m_root, planeCount == 32 ? 0xffffffff : (1u << planeCount) - 1 } };
+	while (!stack.empty())
+	{
+		CullTask task = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = m_nodes[task.nodeIndex];
+		if (!TestBox(node, pPlanes, task.planeMask))
+			continue;
+
+		if (IsLeaf(task.nodeIndex))
+		{
+			objectIndices.push_back(node.objectIndex);
+			continue;
+		}
+
+		stack.push_back({ node.left, task.planeMask });
+		stack.push_back({ node.right, task.planeMask });
+	}
+}
+
+void SceneBVH::QuerySphere(const Vector3d& center, double radius, std::vector<uint32_t>& objectIndices) const
+{
+	if (m_root == NULL_INDEX)
+		return;
+
+	std::vector<uint32_t> stack = { m_root };
+	while (!stack.empty())
+	{
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = m_nodes[nodeIndex];
+
+		// Squared distance from sphere center to box
+		double distance = 0.0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			double d = center[i] < node.boxMin[i] ? node.boxMin[i] - center[i] : (center[i] > node.boxMax[i] ? center[i] - node.boxMax[i] : 0.0);
+			distance += d * d;
+		}
+
+		if (distance > radius * radius)
+			continue;
+
+		if (IsLeaf(nodeIndex))
+		{
+			objectIndices.push_back(node.objectIndex);
+			continue;
+		}
+
+		stack.push_back(node.left);
+		stack.push_back(node.right);
+	}
+}
+
+void SceneBVH::QueryRay(const Vector3d& origin, const Vector3d& direction, double maxDistance, std::vector<uint32_t>& objectIndices) const
+{
+	if (m_root == NULL_INDEX)
+		return;
+
+	// Zero components give infinities, which slab test handles
+	Vector3d inverseDirection = { 1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z };
+
+	std::vector<uint32_t> stack = { m_root };
+	while (!stack.empty())
+	{
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = m_nodes[nodeIndex];
+
+		// Distance along ray is in units of direction length
+		double tNear = 0.0;
+		double tFar = maxDistance;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			double t0 = (node.boxMin[i] - origin[i]) * inverseDirection[i];
+			double t1 = (node.boxMax[i] - origin[i]) * inverseDirection[i];
+			tNear = std::fmax(tNear, std::fmin(t0, t1));
+			tFar = std::fmin(tFar, std::fmax(t0, t1));
+		}
+
+		if (tNear > tFar)
+			continue;
+
+		if (IsLeaf(nodeIndex))
+		{
+			objectIndices.push_back(node.objectIndex);
+			continue;
+		}
+
+		stack.push_back(node.left);
+		stack.push_back(node.right);
+	}
+}
+
+void SceneBVH::CullSubtree(const CullTask& rootTask, const Planed* pPlanes, uint8_t* pVisible) const
+{
+	std::vector<CullTask> stack = { rootTask };
+	while (!stack.empty())
+	{
+		CullTask task = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = m_nodes[task.nodeIndex];
+		if (!TestBox(node, pPlanes, task.planeMask))
+			continue;
+
+		if (IsLeaf(task.nodeIndex))
+		{
+			pVisible[node.objectIndex] = 1;
+			continue;
+		}
+
+		stack.push_back({ node.left, task.planeMask });
+		stack.push_back({ node.right, task.planeMask });
+	}
+}
+
+void SceneBVH::CullFrustum(const Planed* pPlanes, uint32_t planeCount, uint8_t* pVisible, uint32_t objectCount, const ParallelRangeFunc& parallelFor) const
+{
+	ASSERTION(planeCount <= 32);
+
+	memset(pVisible, 0, objectCount);
+
+	if (m_root == NULL_INDEX)
+		return;
+
+	CullTask rootTask = { m_root, planeCount == 32 ? 0xffffffff : (1u << planeCount) - 1 };
+	if (!parallelFor || m_leafCount < PARALLEL_CULLING_THRESHOLD)
+	{
+		CullSubtree(rootTask, pPlanes, pVisible);
+		return;
+	}
+
+	// Expand top of tree breadth first, until there are enough subtrees to keep workers busy
+	std::vector<CullTask> pendingTasks = { rootTask };
+	std::vector<CullTask> subtreeTasks;
+	uint32_t head = 0;
+	while (head < (uint32_t)pendingTasks.size() && (uint32_t)(pendingTasks.size() - head + subtreeTasks.size()) < PARALLEL_SUBTREE_COUNT)
+	{
+		CullTask task = pendingTasks[head++];
+
+		const BVHNode& node = m_nodes[task.nodeIndex];
+		if (!TestBox(node, pPlanes, task.planeMask))
+			continue;
+
+		// Nothing left to test within a subtree fully inside
+		if (IsLeaf(task.nodeIndex) || task.planeMask == 0)
+		{
+			subtreeTasks.push_back(task);
+			continue;
+		}
+
+		pendingTasks.push_back({ node.left, task.planeMask });
+		pendingTasks.push_back({ node.right, task.planeMask });
+	}
+	subtreeTasks.insert(subtreeTasks.end(), pendingTasks.begin() + head, pendingTasks.end());
+
+	// Subtrees have disjoint leaves, so workers write different objects
+	parallelFor((uint32_t)subtreeTasks.size(), 1, [this, &subtreeTasks, pPlanes, pVisible](uint32_t startIndex, uint32_t endIndex)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+			CullSubtree(subtreeTasks[i], pPlanes, pVisible);
+	});
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include "../common/Singleton.h"
+#include "../Maths/Matrix.h"
+#include "../Maths/Plane.h"
+#include "../Maths/SIMDCull.h"
+#include "../thread/ParallelRange.hpp"
+
+// Dynamic bounding volume hierarchy over world bounding boxes of scene objects, one object per leaf
+// Objects are identified by their index in world box stream, i.e. the culling index of VisibilityCuller
+// Tree is built top down with binned surface area heuristic, moved objects are refitted, and objects are inserted or removed incrementally
+// Once incremental changes make tree noticeably worse than a fresh build, it's rebuilt
+class SceneBVH : public Singleton<SceneBVH>
+{
+public:
+	static const uint32_t NULL_INDEX = 0xffffffff;
+
+protected:
+	typedef struct _BVHNode
+	{
+		Vector3d	boxMin;
+		Vector3d	boxMax;
+		uint32_t	parent;
+		uint32_t	left;			// NULL_INDEX if it's a leaf
+		uint32_t	right;
+		uint32_t	objectIndex;	// NULL_INDEX if it's not a leaf
+	}BVHNode;
+
+	typedef struct _BuildTask
+	{
+		uint32_t	nodeIndex;
+		uint32_t	begin;
+		uint32_t	end;
+	}BuildTask;
+
+	typedef struct _CullTask
+	{
+		uint32_t	nodeIndex;
+		uint32_t	planeMask;		// Planes node isn't known to be fully inside of
+	}CullTask;
+
+public:
+	bool Init();
+
+public:
+	// Sync tree with world boxes, objects whose pValid is 0 are kept out of tree
+	void Update(const BoxStream& boxes, const uint8_t* pValid, uint32_t objectCount);
+
+	void Insert(uint32_t objectIndex, const Vector3d& boxMin, const Vector3d& boxMax);
+	void Remove(uint32_t objectIndex);
+	// Moved leaves are refitted at next Refit
+	void Move(uint32_t objectIndex, const Vector3d& boxMin, const Vector3d& boxMax);
+	void Refit();
+	void Rebuild();
+
+	// Indices of objects whose box intersects query volume are appended to objectIndices
+	// Planes point inwards
+	void QueryFrustum(const Planed* pPlanes, uint32_t planeCount, std::vector<uint32_t>& objectIndices) const;
+	void QuerySphere(const Vector3d& center, double radius, std::vector<uint32_t>& objectIndices) const;
+	void QueryRay(const Vector3d& origin, const Vector3d& direction, double maxDistance, std::vector<uint32_t>& objectIndices) const;
+
+	// Hierarchical frustum culling, pVisible[i] is set to 1 if object i is in tree and its box isn't outside of any plane
+	// Subtrees are culled through parallelFor if it's given
+	void CullFrustum(const Planed* pPlanes, uint32_t planeCount, uint8_t* pVisible, uint32_t objectCount, const ParallelRangeFunc& parallelFor = nullptr) const;
+
+	bool Contain(uint32_t objectIndex) const { return objectIndex < m_objectLeaves.size() && m_objectLeaves[objectIndex] != NULL_INDEX; }
+	uint32_t GetLeafCount() const { return m_leafCount; }
+	uint32_t GetNodeCount() const { return (uint32_t)(m_nodes.size() - m_freeNodes.size()); }
+	uint32_t GetRebuildCount() const { return m_rebuildCount; }
+	// Sum of internal node surface areas relative to root
+	double AcquireSAHCost() const;
+
+protected:
+	uint32_t AllocateNode();
+	void FreeNode(uint32_t nodeIndex);
+	bool IsLeaf(uint32_t nodeIndex) const { return m_nodes[nodeIndex].left == NULL_INDEX; }
+
+	// Recalculate boxes of ancestors, stops once a box doesn't change
+	void RefitAncestors(uint32_t nodeIndex);
+	void BuildNode(const BuildTask& task, std::vector<BuildTask>& tasks);
+
+	// Returns false if box is outside of a plane, and clears bits of planes box is fully inside of
+	static bool TestBox(const BVHNode& node, const Planed* pPlanes, uint32_t& planeMask);
+	void CullSubtree(const CullTask& task, const Planed* pPlanes, uint8_t* pVisible) const;
+
+	static double AcquireArea(const Vector3d& boxMin, const Vector3d& boxMax);
+	static void MergeBox(const Vector3d& minA, const Vector3d& maxA, const Vector3d& minB, const Vector3d& maxB, Vector3d& boxMin, Vector3d& boxMax);
+
+protected:
+	std::vector<BVHNode>	m_nodes;
+	std::vector<uint32_t>	m_freeNodes;
+	uint32_t				m_root = NULL_INDEX;
+	uint32_t				m_leafCount = 0;
+
+	// Indexed by object index
+	std::vector<uint32_t>	m_objectLeaves;
+	std::vector<Vector3d>	m_objectBoxMin;
+	std::vector<Vector3d>	m_objectBoxMax;
+
+	std::vector<uint32_t>	m_movedObjects;
+	std::vector<uint32_t>	m_buildObjects;
+	std::vector<Vector3d>	m_buildCentroids;
+
+	uint32_t				m_changesSinceRebuild = 0;
+	uint32_t				m_updatesSinceCostCheck = 0;
+	double					m_rebuiltSAHCost = 0;
+	uint32_t				m_rebuildCount = 0;
+
+	static const uint32_t SAH_BIN_COUNT = 16;
+	// Tree is rebuilt if objects inserted or removed since last rebuild exceed this ratio of leaves
+	static const double REBUILD_CHANGE_RATIO;
+	// Or if cost grows beyond this ratio of a fresh build, which is checked every few updates
+	static const double REBUILD_COST_RATIO;
+	static const uint32_t COST_CHECK_INTERVAL = 32;
+	// Culling is split into at least this many subtrees for workers
+	static const uint32_t PARALLEL_SUBTREE_COUNT = 64;
+	static const uint32_t PARALLEL_CULLING_THRESHOLD = 1024;
+};
\ No newline at end of file
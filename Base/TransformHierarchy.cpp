@@ -0,0 +1,243 @@
+#include "TransformHierarchy.h"
+#include "../Maths/SIMDMatrix.h"
+#include <string.h>
+
+// Bound to const references by vector functions, so it needs a definition
+const uint32_t TransformHierarchy::NULL_HANDLE;
+
+uint32_t TransformHierarchy::AllocateNode()
+{
+	uint32_t handle;
+	if (m_freeHandles.empty())
+	{
+		handle = (uint32_t)m_handleSlots.size();
+		m_handleSlots.push_back(NULL_HANDLE);
+		m_handleParents.push_back(NULL_HANDLE);
+	}
+	else
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+
+	// New node goes to the end as a root, it's moved to its level at next update
+	m_handleSlots[handle] = (uint32_t)m_slotHandles.size();
+	m_handleParents[handle] = NULL_HANDLE;
+
+	m_localTransforms.push_back(Matrix4d());
+	m_localRotations.push_back(Matrix3d());
+	m_worldTransforms.push_back(Matrix4d());
+	m_worldRotations.push_back(Matrix3d());
+	m_parentSlots.push_back(NULL_HANDLE);
+	m_localDirty.push_back(1);
+	m_worldChanged.push_back(0);
+	m_slotHandles.push_back(handle);
+
+	m_isOrderDirty = true;
+	m_hasPendingChanges = true;
+
+	return handle;
+}
+
+void TransformHierarchy::FreeNode(uint32_t handle)
+{
+	// Slot is dropped at next rebuild, children should have been detached by now
+	m_slotHandles[m_handleSlots[handle]] = NULL_HANDLE;
+	m_handleSlots[handle] = NULL_HANDLE;
+	m_handleParents[handle] = NULL_HANDLE;
+	m_freeHandles.push_back(handle);
+
+	m_isOrderDirty = true;
+}
+
+void TransformHierarchy::SetParent(uint32_t handle, uint32_t parentHandle)
+{
+	m_handleParents[handle] = parentHandle;
+	m_localDirty[m_handleSlots[handle]] = 1;
+
+	m_isOrderDirty = true;
+	m_hasPendingChanges = true;
+}
+
+void TransformHierarchy::SetLocalTransform(uint32_t handle, const Matrix4d& localTransform, const Matrix3d& localRotationM)
+{
+	uint32_t slot = m_handleSlots[handle];
+	m_localTransforms[slot] = localTransform;
+	m_localRotations[slot] = localRotationM;
+	m_localDirty[slot] = 1;
+
+	m_hasPendingChanges = true;
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+	uint32_t handleCount = (uint32_t)m_handleSlots.size();
+
+	// Depth of each node, unknown ancestors are pushed to a stack instead of recursion
+	std::vector<uint32_t> depths(handleCount, NULL_HANDLE);
+	std::vector<uint32_t> stack;
+	uint32_t levelCount = 0;
+	for (uint32_t handle = 0; handle < handleCount; handle++)
+	{
+		if (m_handleSlots[handle] == NULL_HANDLE || depths[handle] != NULL_HANDLE)
+			continue;
+
+		uint32_t current = handle;
+		while (current != NULL_HANDLE && depths[current] == NULL_HANDLE)
+		{
+			stack.push_back(current);
+			current = m_handleParents[current];
+		}
+
+		uint32_t depth = current == NULL_HANDLE ? 0 : depths[current] + 1;
+		while (!stack.empty())
+		{
+			depths[stack.back()] = depth++;
+			stack.pop_back();
+		}
+
+		levelCount = depth > levelCount ? depth : levelCount;
+	}
+
+	// Counting sort by depth, relative order within a level is kept
+	m_levelOffsets.assign(levelCount + 1, 0);
+	for (uint32_t handle = 0; handle < handleCount; handle++)
+	{
+		if (m_handleSlots[handle] != NULL_HANDLE)
+			m_levelOffsets[depths[handle] + 1]++;
+	}
+	for (uint32_t i = 1; i < m_levelOffsets.size(); i++)
+		m_levelOffsets[i] += m_levelOffsets[i - 1];
+
+	uint32_t nodeCount = m_levelOffsets.back();
+	std::vector<uint32_t> levelCursors(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+
+	std::vector<Matrix4d> localTransforms(nodeCount);
+	std::vector<Matrix3d> localRotations(nodeCount);
+	std::vector<Matrix4d> worldTransforms(nodeCount);
+	std::vector<Matrix3d> worldRotations(nodeCount);
+	std::vector<uint8_t> localDirty(nodeCount);
+	std::vector<uint8_t> worldChanged(nodeCount);
+	std::vector<uint32_t> slotHandles(nodeCount);
+
+	for (uint32_t slot = 0; slot < m_slotHandles.size(); slot++)
+	{
+		uint32_t handle = m_slotHandles[slot];
+		if (handle == NULL_HANDLE)
+			continue;
+
+		uint32_t newSlot = levelCursors[depths[handle]]++;
+		localTransforms[newSlot] = m_localTransforms[slot];
+		localRotations[newSlot] = m_localRotations[slot];
+		worldTransforms[newSlot] = m_worldTransforms[slot];
+		worldRotations[newSlot] = m_worldRotations[slot];
+		localDirty[newSlot] = m_localDirty[slot];
+		worldChanged[newSlot] = m_worldChanged[slot];
+		slotHandles[newSlot] = handle;
+
+		m_handleSlots[handle] = newSlot;
+	}
+
+	m_parentSlots.resize(nodeCount);
+	for (uint32_t slot = 0; slot < nodeCount; slot++)
+	{
+		uint32_t parentHandle = m_handleParents[slotHandles[slot]];
+		m_parentSlots[slot] = parentHandle == NULL_HANDLE ? NULL_HANDLE : m_handleSlots[parentHandle];
+	}
+
+	m_localTransforms.swap(localTransforms);
+	m_localRotations.swap(localRotations);
+	m_worldTransforms.swap(worldTransforms);
+	m_worldRotations.swap(worldRotations);
+	m_localDirty.swap(localDirty);
+	m_worldChanged.swap(worldChanged);
+	m_slotHandles.swap(slotHandles);
+
+	m_isOrderDirty = false;
+}
+
+void TransformHierarchy::Update(const ParallelRangeFunc& parallelFor)
+{
+	if (m_isOrderDirty)
+		RebuildOrder();
+
+	if (!m_hasPendingChanges)
+	{
+		// Nothing changed this time, only reset flags of last update
+		if (m_hasChangedNodes)
+			memset(m_worldChanged.data(), 0, m_worldChanged.size());
+		m_hasChangedNodes = false;
+		return;
+	}
+
+	// Parents are all done before their level starts
+	for (uint32_t level = 0; level + 1 < m_levelOffsets.size(); level++)
+	{
+		uint32_t startSlot = m_levelOffsets[level];
+		uint32_t endSlot = m_levelOffsets[level + 1];
+
+		if (!parallelFor || endSlot - startSlot < PARALLEL_UPDATE_THRESHOLD)
+		{
+			UpdateRange(startSlot, endSlot);
+			continue;
+		}
+
+		parallelFor(endSlot - startSlot, PARALLEL_UPDATE_GRAIN_SIZE, [this, startSlot](uint32_t startIndex, uint32_t endIndex)
+		{
+			UpdateRange(startSlot + startIndex, startSlot + endIndex);
+		});
+	}
+
+	m_hasPendingChanges = false;
+	m_hasChangedNodes = true;
+}
+
+void TransformHierarchy::UpdateRange(uint32_t startSlot, uint32_t endSlot)
+{
+	for (uint32_t slot = startSlot; slot < endSlot; slot++)
+	{
+		uint32_t parentSlot = m_parentSlots[slot];
+		uint8_t changed = m_localDirty[slot] | (parentSlot == NULL_HANDLE ? 0 : m_worldChanged[parentSlot]);
+
+		m_localDirty[slot] = 0;
+		m_worldChanged[slot] = changed;
+
+		if (!changed)
+			continue;
+
+		if (parentSlot == NULL_HANDLE)
+		{
+			m_worldTransforms[slot] = m_localTransforms[slot];
+			m_worldRotations[slot] = m_localRotations[slot];
+		}
+		else
+		{
+			MultiplyMatrix4x4(m_worldTransforms[parentSlot], m_localTransforms[slot], m_worldTransforms[slot]);
+			m_worldRotations[slot] = m_worldRotations[parentSlot] * m_localRotations[slot];
+		}
+	}
+}
+
+Matrix4d TransformHierarchy::GetWorldTransform(uint32_t handle) const
+{
+	if (!m_hasPendingChanges && !m_isOrderDirty)
+		return GetCachedWorldTransform(handle);
+
+	Matrix4d worldTransform = m_localTransforms[m_handleSlots[handle]];
+	for (uint32_t parent = m_handleParents[handle]; parent != NULL_HANDLE; parent = m_handleParents[parent])
+		worldTransform = m_localTransforms[m_handleSlots[parent]] * worldTransform;
+
+	return worldTransform;
+}
+
+Matrix3d TransformHierarchy::GetWorldRotationM(uint32_t handle) const
+{
+	if (!m_hasPendingChanges && !m_isOrderDirty)
+		return GetCachedWorldRotationM(handle);
+
+	Matrix3d worldRotation = m_localRotations[m_handleSlots[handle]];
+	for (uint32_t parent = m_handleParents[handle]; parent != NULL_HANDLE; parent = m_handleParents[parent])
+		worldRotation = m_localRotations[m_handleSlots[parent]] * worldRotation;
+
+	return worldRotation;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "../common/Singleton.h"
+#include "../Maths/Matrix.h"
+#include "../thread/ParallelRange.hpp"
+
+// Flat transform storage of all objects, BaseObject keeps a handle into it
+// Nodes are sorted by depth so that parents always come before children, world transforms are updated in one linear pass
+// Nodes of the same depth don't depend on each other, so a large level is split into jobs
+// Only nodes whose local transform or any ancestor changed are recalculated
+class TransformHierarchy : public Singleton<TransformHierarchy>
+{
+public:
+	static const uint32_t NULL_HANDLE = 0xffffffff;
+
+public:
+	uint32_t AllocateNode();
+	void FreeNode(uint32_t handle);
+	void SetParent(uint32_t handle, uint32_t parentHandle);
+	void SetLocalTransform(uint32_t handle, const Matrix4d& localTransform, const Matrix3d& localRotationM);
+
+	// Recalculate world transforms of changed nodes, large levels are split through parallelFor if it's given
+	void Update(const ParallelRangeFunc& parallelFor = nullptr);
+
+	// Results of last update
+	const Matrix4d& GetCachedWorldTransform(uint32_t handle) const { return m_worldTransforms[m_handleSlots[handle]]; }
+	const Matrix3d& GetCachedWorldRotationM(uint32_t handle) const { return m_worldRotations[m_handleSlots[handle]]; }
+	bool IsWorldTransformChanged(uint32_t handle) const { return m_worldChanged[m_handleSlots[handle]] != 0; }
+
+	// Up to date results, they're the cached ones if nothing changed since last update, otherwise parents are walked through
+	Matrix4d GetWorldTransform(uint32_t handle) const;
+	Matrix3d GetWorldRotationM(uint32_t handle) const;
+
+	uint32_t GetNodeCount() const { return (uint32_t)(m_handleSlots.size() - m_freeHandles.size()); }
+
+protected:
+	// Sort nodes by depth, and drop freed nodes
+	void RebuildOrder();
+	void UpdateRange(uint32_t startSlot, uint32_t endSlot);
+
+protected:
+	// Indexed by slot, in depth order
+	std::vector<Matrix4d>	m_localTransforms;
+	std::vector<Matrix3d>	m_localRotations;
+	std::vector<Matrix4d>	m_worldTransforms;
+	std::vector<Matrix3d>	m_worldRotations;
+	std::vector<uint32_t>	m_parentSlots;
+	std::vector<uint8_t>	m_localDirty;
+	std::vector<uint8_t>	m_worldChanged;
+	std::vector<uint32_t>	m_slotHandles;
+
+	// Slots from m_levelOffsets[i] to m_levelOffsets[i + 1] are nodes of depth i
+	std::vector<uint32_t>	m_levelOffsets;
+
+	// Indexed by handle, handles stay valid while slots are reordered
+	std::vector<uint32_t>	m_handleSlots;
+	std::vector<uint32_t>	m_handleParents;
+	std::vector<uint32_t>	m_freeHandles;
+
+	bool					m_isOrderDirty = false;
+	bool					m_hasPendingChanges = false;
+	bool					m_hasChangedNodes = false;
+
+	// Levels with fewer nodes are updated on calling thread
+	static const uint32_t PARALLEL_UPDATE_THRESHOLD = 2048;
+	static const uint32_t PARALLEL_UPDATE_GRAIN_SIZE = 512;
+};
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "Vector.h"
 #include "Quaternion.h"
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 template <typename T>
 Matrix3x3<T>::Matrix3x3()
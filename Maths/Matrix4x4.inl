@@ -3,6 +3,7 @@
 #include "Vector.h"
 #include "Matrix3x3.inl"
 #include <algorithm>
+#include <limits>
 
 template <typename T>
 Matrix4x4<T>::Matrix4x4()
@@ -258,7 +259,7 @@ template <typename T>
 const Matrix4x4<T> Matrix4x4<T>::operator - (const Matrix4x4<T>& m) const
 {
 	Matrix4x4<T> ret = *this;
-	ret -= s;
+	ret -= m;
 	return ret;
 }
 
@@ -4,6 +4,8 @@
 #include "Plane.h"
 #include "Quaternion.h"
 #include "Matrix3x3.h"
+#include <stdint.h>
+#include <cmath>
 #include "Matrix4x4.h"
 
 template <typename T>
@@ -314,9 +314,9 @@ T Quaternion<T>::Dot(const Quaternion<T>& q)
 template<typename T>
 Quaternion<T>& Quaternion<T>::Conjugate()
 {
-	ret.x = -ret.x;
-	ret.y = -ret.y;
-	ret.z = -ret.z;
+	x = -x;
+	y = -y;
+	z = -z;
 
 	return *this;
 }
@@ -0,0 +1,272 @@
+#include "SIMDCull.h"
+#include <stdint.h>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_CULL_AVX
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_CULL_SSE2
+#endif
+
+#if defined(SIMD_CULL_AVX)
+// Bit i is set if corner i is not at positive side of plane, NaN counts as outside just like scalar test
+static int PlaneTestMask(const Plane<double>& plane, __m256d px, __m256d py, __m256d pz)
+{
+	__m256d t = _mm256_mul_pd(_mm256_set1_pd(plane.normal.x), px);
+	t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_set1_pd(plane.normal.y), py));
+	t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_set1_pd(plane.normal.z), pz));
+	t = _mm256_sub_pd(t, _mm256_set1_pd(plane.D));
+	return _mm256_movemask_pd(_mm256_cmp_pd(t, _mm256_setzero_pd(), _CMP_NGT_UQ));
+}
+#elif defined(SIMD_CULL_SSE2)
+// Two corners per register
+static int PlaneTestMask(const Plane<double>& plane, __m128d px, __m128d py, __m128d pz)
+{
+	__m128d t = _mm_mul_pd(_mm_set1_pd(plane.normal.x), px);
+	t = _mm_add_pd(t, _mm_mul_pd(_mm_set1_pd(plane.normal.y), py));
+	t = _mm_add_pd(t, _mm_mul_pd(_mm_set1_pd(plane.normal.z), pz));
+	t = _mm_sub_pd(t, _mm_set1_pd(plane.D));
+	return _mm_movemask_pd(_mm_cmpngt_pd(t, _mm_setzero_pd()));
+}
+#endif
+
+FrustumTestResult FrustumTestPatch(const PyramidFrustumd& frustum, const Vector3d* pCorners, double height)
+{
+#if defined(SIMD_CULL_AVX)
+	// Corners in structure of arrays, one corner per lane
+	__m256d px = _mm256_set_pd(pCorners[3].x, pCorners[2].x, pCorners[1].x, pCorners[0].x);
+	__m256d py = _mm256_set_pd(pCorners[3].y, pCorners[2].y, pCorners[1].y, pCorners[0].y);
+	__m256d pz = _mm256_set_pd(pCorners[3].z, pCorners[2].z, pCorners[1].z, pCorners[0].z);
+
+	__m256d h = _mm256_set1_pd(height);
+	__m256d ex = _mm256_mul_pd(px, h);
+	__m256d ey = _mm256_mul_pd(py, h);
+	__m256d ez = _mm256_mul_pd(pz, h);
+
+	FrustumTestResult result = FrustumTestInside;
+	for (uint32_t i = 0; i < PyramidFrustumd::FrustumFace_COUNT; i++)
+	{
+		int outsideMask = PlaneTestMask(frustum.planes[i], px, py, pz);
+		if (outsideMask == 0xf)
+		{
+			if (PlaneTestMask(frustum.planes[i], ex, ey, ez) == 0xf)
+				return FrustumTestOutside;
+			result = FrustumTestIntersect;
+		}
+		else if (outsideMask != 0)
+			result = FrustumTestIntersect;
+	}
+
+	return result;
+#elif defined(SIMD_CULL_SSE2)
+	__m128d pxl = _mm_set_pd(pCorners[1].x, pCorners[0].x), pxh = _mm_set_pd(pCorners[3].x, pCorners[2].x);
+	__m128d pyl = _mm_set_pd(pCorners[1].y, pCorners[0].y), pyh = _mm_set_pd(pCorners[3].y, pCorners[2].y);
+	__m128d pzl = _mm_set_pd(pCorners[1].z, pCorners[0].z), pzh = _mm_set_pd(pCorners[3].z, pCorners[2].z);
+
+	__m128d h = _mm_set1_pd(height);
+	__m128d exl = _mm_mul_pd(pxl, h), exh = _mm_mul_pd(pxh, h);
+	__m128d eyl = _mm_mul_pd(pyl, h), eyh = _mm_mul_pd(pyh, h);
+	__m128d ezl = _mm_mul_pd(pzl, h), ezh = _mm_mul_pd(pzh, h);
+
+	FrustumTestResult result = FrustumTestInside;
+	for (uint32_t i = 0; i < PyramidFrustumd::FrustumFace_COUNT; i++)
+	{
+		int outsideMask = PlaneTestMask(frustum.planes[i], pxl, pyl, pzl) | (PlaneTestMask(frustum.planes[i], pxh, pyh, pzh) << 2);
+		if (outsideMask == 0xf)
+		{
+			int extrudedOutsideMask = PlaneTestMask(frustum.planes[i], exl, eyl, ezl) | (PlaneTestMask(frustum.planes[i], exh, eyh, ezh) << 2);
+			if (extrudedOutsideMask == 0xf)
+				return FrustumTestOutside;
+			result = FrustumTestIntersect;
+		}
+		else if (outsideMask != 0)
+			result = FrustumTestIntersect;
+	}
+
+	return result;
+#else
+	return FrustumTestPatchScalar(frustum, pCorners, height);
+#endif
+}
+
+bool HorizonCullPatch(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, const Vector3d& cameraPosition)
+{
+#if defined(SIMD_CULL_AVX) || defined(SIMD_CULL_SSE2)
+	// A corner p on sphere is visible if it's in front of horizon, i.e. p * (p - camera) < 0
+	int visibleMask;
+#if defined(SIMD_CULL_AVX)
+	__m256d px = _mm256_set_pd(d.x, c.x, b.x, a.x);
+	__m256d py = _mm256_set_pd(d.y, c.y, b.y, a.y);
+	__m256d pz = _mm256_set_pd(d.z, c.z, b.z, a.z);
+
+	__m256d t = _mm256_mul_pd(px, _mm256_sub_pd(px, _mm256_set1_pd(cameraPosition.x)));
+	t = _mm256_add_pd(t, _mm256_mul_pd(py, _mm256_sub_pd(py, _mm256_set1_pd(cameraPosition.y))));
+	t = _mm256_add_pd(t, _mm256_mul_pd(pz, _mm256_sub_pd(pz, _mm256_set1_pd(cameraPosition.z))));
+	visibleMask = _mm256_movemask_pd(_mm256_cmp_pd(t, _mm256_setzero_pd(), _CMP_LT_OQ));
+#else
+	__m128d cx = _mm_set1_pd(cameraPosition.x), cy = _mm_set1_pd(cameraPosition.y), cz = _mm_set1_pd(cameraPosition.z);
+
+	__m128d pxl = _mm_set_pd(b.x, a.x), pxh = _mm_set_pd(d.x, c.x);
+	__m128d pyl = _mm_set_pd(b.y, a.y), pyh = _mm_set_pd(d.y, c.y);
+	__m128d pzl = _mm_set_pd(b.z, a.z), pzh = _mm_set_pd(d.z, c.z);
+
+	__m128d tl = _mm_mul_pd(pxl, _mm_sub_pd(pxl, cx));
+	tl = _mm_add_pd(tl, _mm_mul_pd(pyl, _mm_sub_pd(pyl, cy)));
+	tl = _mm_add_pd(tl, _mm_mul_pd(pzl, _mm_sub_pd(pzl, cz)));
+
+	__m128d th = _mm_mul_pd(pxh, _mm_sub_pd(pxh, cx));
+	th = _mm_add_pd(th, _mm_mul_pd(pyh, _mm_sub_pd(pyh, cy)));
+	th = _mm_add_pd(th, _mm_mul_pd(pzh, _mm_sub_pd(pzh, cz)));
+
+	visibleMask = _mm_movemask_pd(_mm_cmplt_pd(tl, _mm_setzero_pd())) | (_mm_movemask_pd(_mm_cmplt_pd(th, _mm_setzero_pd())) << 2);
+#endif
+	if (visibleMask != 0)
+		return false;
+
+	// Corners are all beyond horizon, patch is culled only if both triangles face away as well
+	if (((c - b) ^ (a - b)) * (a - cameraPosition) < 0.0)
+		return false;
+
+	if (((d - b) ^ (c - b)) * (d - cameraPosition) < 0.0)
+		return false;
+
+	return true;
+#else
+	return HorizonCullPatchScalar(a, b, c, d, cameraPosition);
+#endif
+}
+
+void FrustumTestBoxes(const Planed* pPlanes, uint32_t planeCount, const BoxStream& boxes, uint32_t startIndex, uint32_t endIndex, uint8_t* pVisible)
+{
+	uint32_t i = startIndex;
+
+#if defined(SIMD_CULL_AVX) || defined(SIMD_CULL_SSE2)
+	// Box is outside of a plane if distance of its center plus projected radius is below 0, i.e. n * c - D + |n| * e < 0
+#if defined(SIMD_CULL_AVX)
+	const uint32_t laneCount = 4;
+	__m256d signMask = _mm256_set1_pd(-0.0);
+	for (; i + laneCount <= endIndex; i += laneCount)
+	{
+		__m256d cx = _mm256_loadu_pd(boxes.pCenterX + i), cy = _mm256_loadu_pd(boxes.pCenterY + i), cz = _mm256_loadu_pd(boxes.pCenterZ + i);
+		__m256d ex = _mm256_loadu_pd(boxes.pExtentX + i), ey = _mm256_loadu_pd(boxes.pExtentY + i), ez = _mm256_loadu_pd(boxes.pExtentZ + i);
+
+		int outsideMask = 0;
+		for (uint32_t j = 0; j < planeCount && outsideMask != 0xf; j++)
+		{
+			__m256d nx = _mm256_set1_pd(pPlanes[j].normal.x), ny = _mm256_set1_pd(pPlanes[j].normal.y), nz = _mm256_set1_pd(pPlanes[j].normal.z);
+
+			__m256d t = _mm256_mul_pd(nx, cx);
+			t = _mm256_add_pd(t, _mm256_mul_pd(ny, cy));
+			t = _mm256_add_pd(t, _mm256_mul_pd(nz, cz));
+			t = _mm256_sub_pd(t, _mm256_set1_pd(pPlanes[j].D));
+
+			__m256d r = _mm256_mul_pd(_mm256_andnot_pd(signMask, nx), ex);
+			r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_andnot_pd(signMask, ny), ey));
+			r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_andnot_pd(signMask, nz), ez));
+
+			outsideMask |= _mm256_movemask_pd(_mm256_cmp_pd(_mm256_add_pd(t, r), _mm256_setzero_pd(), _CMP_LT_OQ));
+		}
+
+		for (uint32_t k = 0; k < laneCount; k++)
+			pVisible[i + k] = (outsideMask >> k) & 1 ? 0 : 1;
+	}
+#else
+	const uint32_t laneCount = 2;
+	__m128d signMask = _mm_set1_pd(-0.0);
+	for (; i + laneCount <= endIndex; i += laneCount)
+	{
+		__m128d cx = _mm_loadu_pd(boxes.pCenterX + i), cy = _mm_loadu_pd(boxes.pCenterY + i), cz = _mm_loadu_pd(boxes.pCenterZ + i);
+		__m128d ex = _mm_loadu_pd(boxes.pExtentX + i), ey = _mm_loadu_pd(boxes.pExtentY + i), ez = _mm_loadu_pd(boxes.pExtentZ + i);
+
+		int outsideMask = 0;
+		for (uint32_t j = 0; j < planeCount && outsideMask != 0x3; j++)
+		{
+			__m128d nx = _mm_set1_pd(pPlanes[j].normal.x), ny = _mm_set1_pd(pPlanes[j].normal.y), nz = _mm_set1_pd(pPlanes[j].normal.z);
+
+			__m128d t = _mm_mul_pd(nx, cx);
+			t = _mm_add_pd(t, _mm_mul_pd(ny, cy));
+			t = _mm_add_pd(t, _mm_mul_pd(nz, cz));
+			t = _mm_sub_pd(t, _mm_set1_pd(pPlanes[j].D));
+
+			__m128d r = _mm_mul_pd(_mm_andnot_pd(signMask, nx), ex);
+			r = _mm_add_pd(r, _mm_mul_pd(_mm_andnot_pd(signMask, ny), ey));
+			r = _mm_add_pd(r, _mm_mul_pd(_mm_andnot_pd(signMask, nz), ez));
+
+			outsideMask |= _mm_movemask_pd(_mm_cmplt_pd(_mm_add_pd(t, r), _mm_setzero_pd()));
+		}
+
+		for (uint32_t k = 0; k < laneCount; k++)
+			pVisible[i + k] = (outsideMask >> k) & 1 ? 0 : 1;
+	}
+#endif
+#endif
+
+	// Remainder
+	FrustumTestBoxesScalar(pPlanes, planeCount, boxes, i, endIndex, pVisible);
+}
+
+FrustumTestResult FrustumTestPatchScalar(const PyramidFrustumd& frustum, const Vector3d* pCorners, double height)
+{
+	FrustumTestResult result = FrustumTestInside;
+	for (uint32_t i = 0; i < PyramidFrustumd::FrustumFace_COUNT; i++)
+	{
+		uint32_t outsideCount = 0;
+		for (uint32_t j = 0; j < 4; j++)
+			outsideCount += frustum.planes[i].PlaneTest(pCorners[j]) > 0 ? 0 : 1;
+
+		if (outsideCount == 4)
+		{
+			for (uint32_t j = 0; j < 4; j++)
+				outsideCount += frustum.planes[i].PlaneTest(pCorners[j] * height) > 0 ? 0 : 1;
+
+			if (outsideCount == 8)
+				return FrustumTestOutside;
+			else
+				result = FrustumTestIntersect;
+		}
+		else if (outsideCount > 0)
+			result = FrustumTestIntersect;
+	}
+
+	return result;
+}
+
+bool HorizonCullPatchScalar(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, const Vector3d& cameraPosition)
+{
+	if (((c - b) ^ (a - b)) * (a - cameraPosition) < 0.0)
+		return false;
+
+	if (a * (a - cameraPosition) < 0.0
+		|| b * (b - cameraPosition) < 0.0
+		|| c * (c - cameraPosition) < 0.0)
+		return false;
+
+	if (((d - b) ^ (c - b)) * (d - cameraPosition) < 0.0)
+		return false;
+
+	if (d * (d - cameraPosition) < 0.0)
+		return false;
+
+	return true;
+}
+
+void FrustumTestBoxesScalar(const Planed* pPlanes, uint32_t planeCount, const BoxStream& boxes, uint32_t startIndex, uint32_t endIndex, uint8_t* pVisible)
+{
+	for (uint32_t i = startIndex; i < endIndex; i++)
+	{
+		pVisible[i] = 1;
+		for (uint32_t j = 0; j < planeCount; j++)
+		{
+			const Planed& plane = pPlanes[j];
+			double t = plane.normal.x * boxes.pCenterX[i] + plane.normal.y * boxes.pCenterY[i] + plane.normal.z * boxes.pCenterZ[i] - plane.D;
+			double r = std::fabs(plane.normal.x) * boxes.pExtentX[i] + std::fabs(plane.normal.y) * boxes.pExtentY[i] + std::fabs(plane.normal.z) * boxes.pExtentZ[i];
+			if (t + r < 0.0)
+			{
+				pVisible[i] = 0;
+				break;
+			}
+		}
+	}
+}
\ No newline at end of file
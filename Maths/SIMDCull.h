@@ -0,0 +1,48 @@
+#pragma once
+#include "Matrix.h"
+#include "Plane.h"
+#include "PyramidFrustum.h"
+
+// Culling kernels for planet patches, AVX is used if compiled with it, SSE2 otherwise, scalar if neither is available
+// All corners of a patch are evaluated together, arithmetic follows Plane and Vector3 operators in the same order without fused multiply-add,
+// so decisions are exactly the same as scalar tests
+
+enum FrustumTestResult
+{
+	FrustumTestInside,		// All points are inside of every plane
+	FrustumTestIntersect,	// Some points are outside of some plane
+	FrustumTestOutside,		// Corners and extruded corners are all outside of one plane
+	FrustumTestResultCount
+};
+
+// Test 4 corners of a patch and the same corners extruded by height against frustum planes
+FrustumTestResult FrustumTestPatch(const PyramidFrustumd& frustum, const Vector3d* pCorners, double height);
+
+// Assume a patch is arranged like this, with corners on sphere surface
+// c--------d
+// | \      |
+// |   \    |
+// |     \  |
+// a--------b
+// Returns true if both triangle abc and cbd face away from camera, and all corners are beyond horizon seen from camera
+bool HorizonCullPatch(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, const Vector3d& cameraPosition);
+
+// Axis aligned boxes in structure of arrays, each box is given by its center and half extents
+typedef struct _BoxStream
+{
+	const double*	pCenterX;
+	const double*	pCenterY;
+	const double*	pCenterZ;
+	const double*	pExtentX;
+	const double*	pExtentY;
+	const double*	pExtentZ;
+}BoxStream;
+
+// Test boxes within [startIndex, endIndex) against planes pointing inwards
+// pVisible[i] is set to 0 if box i is entirely at negative side of any plane, 1 otherwise
+void FrustumTestBoxes(const Planed* pPlanes, uint32_t planeCount, const BoxStream& boxes, uint32_t startIndex, uint32_t endIndex, uint8_t* pVisible);
+
+// Scalar references of the kernels above
+FrustumTestResult FrustumTestPatchScalar(const PyramidFrustumd& frustum, const Vector3d* pCorners, double height);
+bool HorizonCullPatchScalar(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, const Vector3d& cameraPosition);
+void FrustumTestBoxesScalar(const Planed* pPlanes, uint32_t planeCount, const BoxStream& boxes, uint32_t startIndex, uint32_t endIndex, uint8_t* pVisible);
\ No newline at end of file
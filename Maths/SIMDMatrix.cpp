@@ -0,0 +1,94 @@
+#include "SIMDMatrix.h"
+#include <stdint.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_MATRIX_AVX
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_MATRIX_SSE2
+#endif
+
+void MultiplyMatrix4x4(const Matrix4d& a, const Matrix4d& b, Matrix4d& out)
+{
+	const double* pA = &a.c00;
+	const double* pB = &b.c00;
+	double* pOut = &out.c00;
+
+#if defined(SIMD_MATRIX_AVX)
+	// One column per register, all columns of "a" are loaded first in case "out" is "a"
+	__m256d a0 = _mm256_loadu_pd(pA);
+	__m256d a1 = _mm256_loadu_pd(pA + 4);
+	__m256d a2 = _mm256_loadu_pd(pA + 8);
+	__m256d a3 = _mm256_loadu_pd(pA + 12);
+
+	// Column i of result only reads column i of "b", so it's fine if "out" is "b"
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		__m256d r = _mm256_mul_pd(a0, _mm256_broadcast_sd(pB + i * 4));
+		r = _mm256_add_pd(r, _mm256_mul_pd(a1, _mm256_broadcast_sd(pB + i * 4 + 1)));
+		r = _mm256_add_pd(r, _mm256_mul_pd(a2, _mm256_broadcast_sd(pB + i * 4 + 2)));
+		r = _mm256_add_pd(r, _mm256_mul_pd(a3, _mm256_broadcast_sd(pB + i * 4 + 3)));
+		_mm256_storeu_pd(pOut + i * 4, r);
+	}
+#elif defined(SIMD_MATRIX_SSE2)
+	// Half a column per register
+	__m128d a0l = _mm_loadu_pd(pA),			a0h = _mm_loadu_pd(pA + 2);
+	__m128d a1l = _mm_loadu_pd(pA + 4),		a1h = _mm_loadu_pd(pA + 6);
+	__m128d a2l = _mm_loadu_pd(pA + 8),		a2h = _mm_loadu_pd(pA + 10);
+	__m128d a3l = _mm_loadu_pd(pA + 12),	a3h = _mm_loadu_pd(pA + 14);
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		__m128d b0 = _mm_set1_pd(pB[i * 4]);
+		__m128d b1 = _mm_set1_pd(pB[i * 4 + 1]);
+		__m128d b2 = _mm_set1_pd(pB[i * 4 + 2]);
+		__m128d b3 = _mm_set1_pd(pB[i * 4 + 3]);
+
+		__m128d rl = _mm_mul_pd(a0l, b0);
+		rl = _mm_add_pd(rl, _mm_mul_pd(a1l, b1));
+		rl = _mm_add_pd(rl, _mm_mul_pd(a2l, b2));
+		rl = _mm_add_pd(rl, _mm_mul_pd(a3l, b3));
+
+		__m128d rh = _mm_mul_pd(a0h, b0);
+		rh = _mm_add_pd(rh, _mm_mul_pd(a1h, b1));
+		rh = _mm_add_pd(rh, _mm_mul_pd(a2h, b2));
+		rh = _mm_add_pd(rh, _mm_mul_pd(a3h, b3));
+
+		_mm_storeu_pd(pOut + i * 4, rl);
+		_mm_storeu_pd(pOut + i * 4 + 2, rh);
+	}
+#else
+	MultiplyMatrix4x4Scalar(a, b, out);
+#endif
+}
+
+void ConvertMatrix4x4(const Matrix4d& in, Matrix4f& out)
+{
+	const double* pIn = &in.c00;
+	float* pOut = &out.c00;
+
+#if defined(SIMD_MATRIX_AVX)
+	for (uint32_t i = 0; i < 4; i++)
+		_mm_storeu_ps(pOut + i * 4, _mm256_cvtpd_ps(_mm256_loadu_pd(pIn + i * 4)));
+#elif defined(SIMD_MATRIX_SSE2)
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		__m128 l = _mm_cvtpd_ps(_mm_loadu_pd(pIn + i * 4));
+		__m128 h = _mm_cvtpd_ps(_mm_loadu_pd(pIn + i * 4 + 2));
+		_mm_storeu_ps(pOut + i * 4, _mm_movelh_ps(l, h));
+	}
+#else
+	ConvertMatrix4x4Scalar(in, out);
+#endif
+}
+
+void MultiplyMatrix4x4Scalar(const Matrix4d& a, const Matrix4d& b, Matrix4d& out)
+{
+	out = a * b;
+}
+
+void ConvertMatrix4x4Scalar(const Matrix4d& in, Matrix4f& out)
+{
+	out = in.SinglePrecision();
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include "Matrix.h"
+
+// Matrix kernels for hot batched paths, AVX is used if compiled with it, SSE2 otherwise, scalar if neither is available
+// Products are summed in the same order as Matrix4x4 operators without fused multiply-add, so results match them
+// Output could be the same object as input
+
+// out = a * b
+void MultiplyMatrix4x4(const Matrix4d& a, const Matrix4d& b, Matrix4d& out);
+// out = (float)in
+void ConvertMatrix4x4(const Matrix4d& in, Matrix4f& out);
+
+// Scalar references of the kernels above
+void MultiplyMatrix4x4Scalar(const Matrix4d& a, const Matrix4d& b, Matrix4d& out);
+void ConvertMatrix4x4Scalar(const Matrix4d& in, Matrix4f& out);
\ No newline at end of file
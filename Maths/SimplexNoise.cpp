@@ -0,0 +1,264 @@
+#include "SimplexNoise.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_NOISE_SSE2
+#endif
+
+static const float F3 = 1.0f / 3.0f;
+static const float G3 = 1.0f / 6.0f;
+
+static const float GRADIENTS[12][3] =
+{
+	{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+	{ 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+	{ 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 },
+};
+
+static int FastFloor(float x)
+{
+	int i = (int)x;
+	return (float)i > x ? i - 1 : i;
+}
+
+SimplexNoise::SimplexNoise(uint32_t seed)
+{
+	uint8_t permutation[256];
+	for (uint32_t i = 0; i < 256; i++)
+		permutation[i] = (uint8_t)i;
+
+	// Fisher-Yates shuffle with xorshift, so that table only depends on seed
+	uint32_t state = seed * 2654435761u + 1;
+	for (uint32_t i = 255; i > 0; i--)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		uint32_t j = state % (i + 1);
+		uint8_t temp = permutation[i];
+		permutation[i] = permutation[j];
+		permutation[j] = temp;
+	}
+
+	for (uint32_t i = 0; i < 512; i++)
+	{
+		m_permutation[i] = permutation[i & 255];
+		m_permutationMod12[i] = m_permutation[i] % 12;
+	}
+}
+
+float SimplexNoise::Noise(float x, float y, float z) const
+{
+	// Skew input space to find simplex cell
+	float s = (x + y + z) * F3;
+	int i = FastFloor(x + s);
+	int j = FastFloor(y + s);
+	int k = FastFloor(z + s);
+
+	float t = (float)(i + j + k) * G3;
+	float x0 = x - ((float)i - t);
+	float y0 = y - ((float)j - t);
+	float z0 = z - ((float)k - t);
+
+	// Offsets of second and third corner, decided by rank of x0, y0 and z0
+	bool xy = x0 >= y0;
+	bool yz = y0 >= z0;
+	bool xz = x0 >= z0;
+
+	int i1 = xy && xz ? 1 : 0;
+	int j1 = !xy && yz ? 1 : 0;
+	int k1 = !xz && !yz ? 1 : 0;
+	int i2 = xy || xz ? 1 : 0;
+	int j2 = !xy || yz ? 1 : 0;
+	int k2 = !(xz && yz) ? 1 : 0;
+
+	float corners[4][3] =
+	{
+		{ x0, y0, z0 },
+		{ x0 - (float)i1 + G3, y0 - (float)j1 + G3, z0 - (float)k1 + G3 },
+		{ x0 - (float)i2 + 2.0f * G3, y0 - (float)j2 + 2.0f * G3, z0 - (float)k2 + 2.0f * G3 },
+		{ x0 - 1.0f + 3.0f * G3, y0 - 1.0f + 3.0f * G3, z0 - 1.0f + 3.0f * G3 },
+	};
+
+	uint32_t gradients[4] =
+	{
+		AcquireGradientIndex(i, j, k),
+		AcquireGradientIndex(i + i1, j + j1, k + k1),
+		AcquireGradientIndex(i + i2, j + j2, k + k2),
+		AcquireGradientIndex(i + 1, j + 1, k + 1),
+	};
+
+	float n = 0.0f;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		float tc = 0.6f - corners[c][0] * corners[c][0] - corners[c][1] * corners[c][1] - corners[c][2] * corners[c][2];
+		float dot = GRADIENTS[gradients[c]][0] * corners[c][0] + GRADIENTS[gradients[c]][1] * corners[c][1] + GRADIENTS[gradients[c]][2] * corners[c][2];
+		tc = tc < 0.0f ? 0.0f : tc;
+		tc *= tc;
+		n += tc * tc * dot;
+	}
+
+	return 32.0f * n;
+}
+
+float SimplexNoise::FBM(float x, float y, float z, uint32_t octaves, float lacunarity, float gain) const
+{
+	float value = 0.0f;
+	float frequency = 1.0f;
+	float amplitude = 1.0f;
+	for (uint32_t i = 0; i < octaves; i++)
+	{
+		value += amplitude * Noise(x * frequency, y * frequency, z * frequency);
+		frequency *= lacunarity;
+		amplitude *= gain;
+	}
+	return value;
+}
+
+#if defined(SIMD_NOISE_SSE2)
+static __m128i FastFloor(__m128 x)
+{
+	__m128i i = _mm_cvttps_epi32(x);
+	// Mask is -1 where truncation rounded up
+	return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), x)));
+}
+
+// Contribution of one corner for 4 points
+static __m128 CornerContribution(__m128 x, __m128 y, __m128 z, const uint32_t* pGradients)
+{
+	__m128 gx = _mm_set_ps(GRADIENTS[pGradients[3]][0], GRADIENTS[pGradients[2]][0], GRADIENTS[pGradients[1]][0], GRADIENTS[pGradients[0]][0]);
+	__m128 gy = _mm_set_ps(GRADIENTS[pGradients[3]][1], GRADIENTS[pGradients[2]][1], GRADIENTS[pGradients[1]][1], GRADIENTS[pGradients[0]][1]);
+	__m128 gz = _mm_set_ps(GRADIENTS[pGradients[3]][2], GRADIENTS[pGradients[2]][2], GRADIENTS[pGradients[1]][2], GRADIENTS[pGradients[0]][2]);
+
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.6f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+	__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, x), _mm_mul_ps(gy, y)), _mm_mul_ps(gz, z));
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	return _mm_mul_ps(_mm_mul_ps(t, t), dot);
+}
+#endif
+
+void SimplexNoise::Noise(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count) const
+{
+#if defined(SIMD_NOISE_SSE2)
+	uint32_t batchEnd = count / 4 * 4;
+	for (uint32_t b = 0; b < batchEnd; b += 4)
+	{
+		__m128 x = _mm_loadu_ps(pX + b);
+		__m128 y = _mm_loadu_ps(pY + b);
+		__m128 z = _mm_loadu_ps(pZ + b);
+
+		__m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), _mm_set1_ps(F3));
+		__m128i i = FastFloor(_mm_add_ps(x, s));
+		__m128i j = FastFloor(_mm_add_ps(y, s));
+		__m128i k = FastFloor(_mm_add_ps(z, s));
+
+		__m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), _mm_set1_ps(G3));
+		__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+		__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+		__m128 z0 = _mm_sub_ps(z, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+		__m128 xy = _mm_cmpge_ps(x0, y0);
+		__m128 yz = _mm_cmpge_ps(y0, z0);
+		__m128 xz = _mm_cmpge_ps(x0, z0);
+
+		// Masks to 0 or 1
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 i1 = _mm_and_ps(_mm_and_ps(xy, xz), one);
+		__m128 j1 = _mm_and_ps(_mm_andnot_ps(xy, yz), one);
+		__m128 k1 = _mm_andnot_ps(_mm_or_ps(xz, yz), one);
+		__m128 i2 = _mm_and_ps(_mm_or_ps(xy, xz), one);
+		__m128 j2 = _mm_andnot_ps(_mm_andnot_ps(yz, xy), one);
+		__m128 k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), one);
+
+		__m128 g1 = _mm_set1_ps(G3);
+		__m128 g2 = _mm_set1_ps(2.0f * G3);
+		__m128 g3 = _mm_set1_ps(3.0f * G3);
+
+		__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), g1), y1 = _mm_add_ps(_mm_sub_ps(y0, j1), g1), z1 = _mm_add_ps(_mm_sub_ps(z0, k1), g1);
+		__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, i2), g2), y2 = _mm_add_ps(_mm_sub_ps(y0, j2), g2), z2 = _mm_add_ps(_mm_sub_ps(z0, k2), g2);
+		__m128 x3 = _mm_add_ps(_mm_sub_ps(x0, one), g3), y3 = _mm_add_ps(_mm_sub_ps(y0, one), g3), z3 = _mm_add_ps(_mm_sub_ps(z0, one), g3);
+
+		// Permutation lookups can't be vectorized without gather, so they're done per lane
+		int iv[4], jv[4], kv[4];
+		float i1v[4], j1v[4], k1v[4], i2v[4], j2v[4], k2v[4];
+		_mm_storeu_si128((__m128i*)iv, i);
+		_mm_storeu_si128((__m128i*)jv, j);
+		_mm_storeu_si128((__m128i*)kv, k);
+		_mm_storeu_ps(i1v, i1); _mm_storeu_ps(j1v, j1); _mm_storeu_ps(k1v, k1);
+		_mm_storeu_ps(i2v, i2); _mm_storeu_ps(j2v, j2); _mm_storeu_ps(k2v, k2);
+
+		uint32_t gradients[4][4];
+		for (uint32_t l = 0; l < 4; l++)
+		{
+			gradients[0][l] = AcquireGradientIndex(iv[l], jv[l], kv[l]);
+			gradients[1][l] = AcquireGradientIndex(iv[l] + (int)i1v[l], jv[l] + (int)j1v[l], kv[l] + (int)k1v[l]);
+			gradients[2][l] = AcquireGradientIndex(iv[l] + (int)i2v[l], jv[l] + (int)j2v[l], kv[l] + (int)k2v[l]);
+			gradients[3][l] = AcquireGradientIndex(iv[l] + 1, jv[l] + 1, kv[l] + 1);
+		}
+
+		__m128 n = CornerContribution(x0, y0, z0, gradients[0]);
+		n = _mm_add_ps(n, CornerContribution(x1, y1, z1, gradients[1]));
+		n = _mm_add_ps(n, CornerContribution(x2, y2, z2, gradients[2]));
+		n = _mm_add_ps(n, CornerContribution(x3, y3, z3, gradients[3]));
+
+		_mm_storeu_ps(pOut + b, _mm_mul_ps(_mm_set1_ps(32.0f), n));
+	}
+
+	// Remainder
+	NoiseScalar(pX + batchEnd, pY + batchEnd, pZ + batchEnd, pOut + batchEnd, count - batchEnd);
+#else
+	NoiseScalar(pX, pY, pZ, pOut, count);
+#endif
+}
+
+void SimplexNoise::FBM(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count, uint32_t octaves, float lacunarity, float gain) const
+{
+#if defined(SIMD_NOISE_SSE2)
+	const uint32_t BATCH_SIZE = 64;
+	float x[BATCH_SIZE], y[BATCH_SIZE], z[BATCH_SIZE], noise[BATCH_SIZE];
+
+	for (uint32_t b = 0; b < count; b += BATCH_SIZE)
+	{
+		uint32_t batchCount = count - b < BATCH_SIZE ? count - b : BATCH_SIZE;
+
+		for (uint32_t i = 0; i < batchCount; i++)
+			pOut[b + i] = 0.0f;
+
+		float frequency = 1.0f;
+		float amplitude = 1.0f;
+		for (uint32_t o = 0; o < octaves; o++)
+		{
+			for (uint32_t i = 0; i < batchCount; i++)
+			{
+				x[i] = pX[b + i] * frequency;
+				y[i] = pY[b + i] * frequency;
+				z[i] = pZ[b + i] * frequency;
+			}
+
+			Noise(x, y, z, noise, batchCount);
+
+			for (uint32_t i = 0; i < batchCount; i++)
+				pOut[b + i] += amplitude * noise[i];
+
+			frequency *= lacunarity;
+			amplitude *= gain;
+		}
+	}
+#else
+	FBMScalar(pX, pY, pZ, pOut, count, octaves, lacunarity, gain);
+#endif
+}
+
+void SimplexNoise::NoiseScalar(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count) const
+{
+	for (uint32_t i = 0; i < count; i++)
+		pOut[i] = Noise(pX[i], pY[i], pZ[i]);
+}
+
+void SimplexNoise::FBMScalar(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count, uint32_t octaves, float lacunarity, float gain) const
+{
+	for (uint32_t i = 0; i < count; i++)
+		pOut[i] = FBM(pX[i], pY[i], pZ[i], octaves, lacunarity, gain);
+}
\ No newline at end of file
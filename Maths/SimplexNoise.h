@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+// 3D simplex noise with a seeded permutation table, the same seed gives the same values on every machine and thread
+// Batched functions process 4 points at a time with SSE2 if available, arithmetic is in the same order as scalar ones, so results are identical
+class SimplexNoise
+{
+public:
+	SimplexNoise(uint32_t seed = 0);
+
+public:
+	// Noise within [-1, 1]
+	float Noise(float x, float y, float z) const;
+	// Fractal brownian motion, each octave multiplies frequency by lacunarity and amplitude by gain
+	float FBM(float x, float y, float z, uint32_t octaves, float lacunarity, float gain) const;
+
+	void Noise(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count) const;
+	void FBM(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count, uint32_t octaves, float lacunarity, float gain) const;
+
+	// Scalar references of batched functions above
+	void NoiseScalar(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count) const;
+	void FBMScalar(const float* pX, const float* pY, const float* pZ, float* pOut, uint32_t count, uint32_t octaves, float lacunarity, float gain) const;
+
+protected:
+	// Gradient index of a simplex corner
+	uint32_t AcquireGradientIndex(int i, int j, int k) const { return m_permutationMod12[(i & 255) + m_permutation[(j & 255) + m_permutation[k & 255]]]; }
+
+protected:
+	uint8_t		m_permutation[512];
+	uint8_t		m_permutationMod12[512];
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "Vector4.h"
 #include <algorithm>
+#include <cmath>
 #include "Vector3.inl"
 
 template <typename T>
@@ -0,0 +1,100 @@
+#include "AnimationPoseEvaluator.h"
+#include "../Maths/SIMDMatrix.h"
+
+void AnimationPoseEvaluator::SampleClip(const SkeletonAnimation* pAnimation, const PoseSkeleton& skeleton, AnimationClipState& clip, AnimationPose& pose)
+{
+	const std::vector<uint32_t>& trackIndices = skeleton.trackIndices[clip.animationIndex];
+	float time = (float)clip.playedTime;
+	uint32_t nodeCount = (uint32_t)skeleton.parentIndices.size();
+
+	pose.rotations.resize(nodeCount);
+	pose.translations.resize(nodeCount);
+	pose.scales.resize(nodeCount);
+
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		pose.rotations[i] = skeleton.bindPose.rotations[i];
+		pose.translations[i] = skeleton.bindPose.translations[i];
+		pose.scales[i] = skeleton.bindPose.scales[i];
+
+		if (trackIndices[i] != SkeletonAnimation::NULL_TRACK)
+			pAnimation->SampleTrack(clip.animationIndex, trackIndices[i], time, clip.cursors[trackIndices[i]], pose.rotations[i], pose.translations[i], pose.scales[i]);
+	}
+}
+
+// Normalized lerp along the shorter arc
+static Quaterniond BlendRotation(const Quaterniond& from, const Quaterniond& to, double factor)
+{
+	double toFactor = Quaterniond::Dot(from, to) < 0 ? -factor : factor;
+
+	Quaterniond rotation
+	(
+		from.x * (1.0 - factor) + to.x * toFactor,
+		from.y * (1.0 - factor) + to.y * toFactor,
+		from.z * (1.0 - factor) + to.z * toFactor,
+		from.w * (1.0 - factor) + to.w * toFactor
+	);
+
+	return rotation.Normalize();
+}
+
+void AnimationPoseEvaluator::BlendPose(const AnimationPose& src, double weight, const std::vector<double>& mask, AnimationPose& dst)
+{
+	for (uint32_t i = 0; i < (uint32_t)dst.rotations.size(); i++)
+	{
+		double factor = mask.empty() ? weight : weight * mask[i];
+		factor = factor > 1.0 ? 1.0 : factor;
+		if (factor <= 0)
+			continue;
+
+		dst.rotations[i] = BlendRotation(dst.rotations[i], src.rotations[i], factor);
+		dst.translations[i] = dst.translations[i] * (1.0 - factor) + src.translations[i] * factor;
+		dst.scales[i] = dst.scales[i] * (1.0 - factor) + src.scales[i] * factor;
+	}
+}
+
+void AnimationPoseEvaluator::AddPose(const AnimationPose& src, const AnimationPose& reference, double weight, const std::vector<double>& mask, AnimationPose& dst)
+{
+	for (uint32_t i = 0; i < (uint32_t)dst.rotations.size(); i++)
+	{
+		double factor = mask.empty() ? weight : weight * mask[i];
+		if (factor <= 0)
+			continue;
+
+		// Difference from reference, applied in local space of current result
+		Quaterniond deltaRotation = reference.rotations[i].GetConjugate() * src.rotations[i];
+		dst.rotations[i] *= BlendRotation(Quaterniond(), deltaRotation, factor > 1.0 ? 1.0 : factor);
+		dst.rotations[i].Normalize();
+		dst.translations[i] += (src.translations[i] - reference.translations[i]) * factor;
+
+		// Scale is multiplied by its ratio to reference, components scaled to zero by reference are left alone
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			if (reference.scales[i][j] != 0)
+				dst.scales[i][j] *= 1.0 + (src.scales[i][j] / reference.scales[i][j] - 1.0) * factor;
+		}
+	}
+}
+
+void AnimationPoseEvaluator::BuildSkinningTransforms(const PoseSkeleton& skeleton, const AnimationPose& pose, std::vector<Matrix4d>& modelPoses, DualQuaterniond* pBoneDQs)
+{
+	uint32_t nodeCount = (uint32_t)skeleton.parentIndices.size();
+	modelPoses.resize(nodeCount);
+
+	// Model space starts from root node, so no inverse of its world transform is needed
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		uint32_t parentIndex = skeleton.parentIndices[i];
+		if (parentIndex == NULL_INDEX)
+			modelPoses[i] = Matrix4d();
+		else
+			MultiplyMatrix4x4(modelPoses[parentIndex], Matrix4d(pose.rotations[i].Matrix() * Matrix3d(pose.scales[i]), pose.translations[i]), modelPoses[i]);
+	}
+
+	Matrix4d transform;
+	for (uint32_t i = 0; i < (uint32_t)skeleton.boneNodeIndices.size(); i++)
+	{
+		MultiplyMatrix4x4(modelPoses[skeleton.boneNodeIndices[i]], skeleton.boneOffsets[i], transform);
+		pBoneDQs[i] = DualQuaterniond(transform.RotationMatrix(), transform.TranslationVector());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../Maths/Matrix.h"
+#include "../Maths/DualQuaternion.h"
+#include "SkeletonAnimation.h"
+
+// Local transforms of all pose nodes
+typedef struct _AnimationPose
+{
+	std::vector<Quaterniond>	rotations;
+	std::vector<Vector3d>		translations;
+	std::vector<Vector3d>		scales;
+}AnimationPose;
+
+typedef struct _AnimationClipState
+{
+	uint32_t							animationIndex = 0xffffffff;
+	double								playedTime = 0;
+	std::vector<AnimationTrackCursor>	cursors;		// Indexed by track index of this clip
+}AnimationClipState;
+
+// Skeleton sub tree flattened for pose evaluation, parents come before children
+typedef struct _PoseSkeleton
+{
+	std::vector<uint32_t>				parentIndices;		// Root node's parent is NULL_INDEX, its model transform is identity
+	std::vector<std::vector<uint32_t>>	trackIndices;		// Per clip, track index of each node, NULL_TRACK if node isn't animated by it
+	std::vector<uint32_t>				boneNodeIndices;	// Nodes that are bones, in order of skinning transforms
+	std::vector<Matrix4d>				boneOffsets;		// Per bone, from model space to bone space
+	AnimationPose						bindPose;
+}PoseSkeleton;
+
+// Pose job kernels, they only touch data passed in, so that poses of different skeletons could be evaluated in parallel
+class AnimationPoseEvaluator
+{
+public:
+	static const uint32_t NULL_INDEX = 0xffffffff;
+
+	// Nodes without a track in this clip keep bind pose
+	static void SampleClip(const SkeletonAnimation* pAnimation, const PoseSkeleton& skeleton, AnimationClipState& clip, AnimationPose& pose);
+	// Blend src into dst by weight, scaled by mask if it's not empty
+	static void BlendPose(const AnimationPose& src, double weight, const std::vector<double>& mask, AnimationPose& dst);
+	// Add difference between src and reference to dst by weight, scaled by mask if it's not empty, scale difference is a ratio
+	static void AddPose(const AnimationPose& src, const AnimationPose& reference, double weight, const std::vector<double>& mask, AnimationPose& dst);
+	// Model space transforms of all nodes, relative to root node, and skinning transforms of all bones
+	static void BuildSkinningTransforms(const PoseSkeleton& skeleton, const AnimationPose& pose, std::vector<Matrix4d>& modelPoses, DualQuaterniond* pBoneDQs);
+};
\ No newline at end of file
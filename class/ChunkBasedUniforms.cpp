@@ -8,25 +8,23 @@
 
 bool ChunkBasedUniforms::Init(const std::shared_ptr<ChunkBasedUniforms>& pSelf, uint32_t numBytes)
 {
-	if (!UniformDataStorage::Init(pSelf, numBytes * MAXIMUM_OBJECTS, PerFrameDataStorage::ShaderStorage))
+	if (!UniformDataStorage::Init(pSelf, numBytes * INITIAL_CHUNK_CAPACITY, PerFrameDataStorage::ShaderStorage))
 		return false;
 
 	m_perChunkBytes = numBytes;
 
-	m_freeChunks.push_back({ 0, MAXIMUM_OBJECTS });
+	m_chunkCapacity = INITIAL_CHUNK_CAPACITY;
+	m_dirtyChunkFlags.resize(m_chunkCapacity, false);
+	m_pChunkAllocator = std::make_shared<TLSFAllocator>(m_chunkCapacity);
+	m_chunkAllocationHandles.resize(m_chunkCapacity, TLSFAllocator::NULL_BLOCK);
+	OnChunkCapacityChanged(m_chunkCapacity);
+
 	return true;
 }
 
 uint32_t ChunkBasedUniforms::AllocatePerObjectChunk()
 {
-	ASSERTION(m_freeChunks.size() != 0);
-
-	uint32_t index = m_freeChunks[0].first++;
-	if (m_freeChunks[0].first > m_freeChunks[0].second)
-		m_freeChunks.erase(m_freeChunks.begin());
-
-	// To remind you when chunks are all in use(you'll have to increase the pool, statically or dynamically)
-	ASSERTION(m_freeChunks.size() != 0);
+	uint32_t index = AllocateChunks(1);
 
 	OnChunkAllocated(index, 1);
 
@@ -35,98 +33,86 @@ uint32_t ChunkBasedUniforms::AllocatePerObjectChunk()
 
 uint32_t ChunkBasedUniforms::AllocateConsecutiveChunks(uint32_t chunkSize)
 {
-	ASSERTION(m_freeChunks.size() != 0);
-	for (auto iter = m_freeChunks.begin(); iter != m_freeChunks.end(); iter++)
-	{
-		uint32_t freeChunkSize = iter->second - iter->first;
-		if (freeChunkSize >= chunkSize)
-		{
-			uint32_t offsetChunkIndex = iter->first;
-
-			if (freeChunkSize == chunkSize)
-				m_freeChunks.erase(iter);
-			else
-				iter->first += chunkSize;
-
-			ASSERTION(m_freeChunks.size() != 0);
+	uint32_t offsetChunkIndex = AllocateChunks(chunkSize);
 
-			OnChunkAllocated(offsetChunkIndex, chunkSize);
+	OnChunkAllocated(offsetChunkIndex, chunkSize);
 
-			return offsetChunkIndex;
-		}
-	}
-
-	ASSERTION(false);
-	return -1;
+	return offsetChunkIndex;
 }
 
-void ChunkBasedUniforms::FreePreObjectChunk(uint32_t index, uint32_t start, uint32_t end)
+void ChunkBasedUniforms::FreePreObjectChunk(uint32_t index)
 {
-	uint32_t midChunkIndex = (start + end) / 2;
-
-	std::pair<bool, bool> val;
-	val = std::make_pair<bool, bool>(index <= m_freeChunks[midChunkIndex].first, index >= m_freeChunks[midChunkIndex].first);
+	FreeChunks(index, 1);
+}
 
-	int32_t left, right;
+void ChunkBasedUniforms::FreeConsecutiveChunks(uint32_t index, uint32_t chunkSize)
+{
+	FreeChunks(index, chunkSize);
+}
 
-	// If index is already freed
-	if (val.first && val.second)
-		return;
-	else if (val.first)
-	{
-		left = midChunkIndex - 1;
-		right = midChunkIndex;
-	}
-	else
+uint32_t ChunkBasedUniforms::AllocateChunks(uint32_t chunkCount)
+{
+	uint32_t index;
+	uint32_t handle = m_pChunkAllocator->Allocate(chunkCount, 1, index);
+	while (handle == TLSFAllocator::NULL_BLOCK)
 	{
-		left = midChunkIndex;
-		right = midChunkIndex + 1;
+		// Trailing free chunks are merged with grown ones, doubling a few times always makes room
+		EnsureChunkCapacity(m_chunkCapacity + 1);
+		handle = m_pChunkAllocator->Allocate(chunkCount, 1, index);
 	}
 
-	if ((left < 0 || right == m_freeChunks.size()) ||
-		(index > m_freeChunks[left].second) ||
-		(index < m_freeChunks[right].first))
-		InsertIntoFreeChunk(index, midChunkIndex);
-	else
-	{
-		if (right == midChunkIndex)
-			FreePreObjectChunk(index, start, midChunkIndex);
-		else
-			FreePreObjectChunk(index, midChunkIndex, end);
-	}
+	m_chunkAllocationHandles[index] = handle;
+	m_allocatedChunkCount += chunkCount;
+
+	return index;
 }
 
-void ChunkBasedUniforms::InsertIntoFreeChunk(uint32_t index, uint32_t chunkIndex)
+void ChunkBasedUniforms::FreeChunks(uint32_t index, uint32_t chunkCount)
 {
-	if (index < m_freeChunks[chunkIndex].first)
-	{
-		if (index == m_freeChunks[chunkIndex].first - 1)
-			m_freeChunks[chunkIndex].first--;
-		else
-			m_freeChunks.insert(m_freeChunks.begin() + chunkIndex, { index, index });
-	}
-	else if (index > m_freeChunks[chunkIndex].second)
-	{
-		if (index == m_freeChunks[chunkIndex].second + 1)
-			m_freeChunks[chunkIndex].second++;
-		else
-			m_freeChunks.insert(m_freeChunks.begin() + chunkIndex + 1, { index, index });
-	}
+	ASSERTION(index < m_chunkCapacity && m_chunkAllocationHandles[index] != TLSFAllocator::NULL_BLOCK);
+	// Allocator never hands out empty ranges, a range of 0 chunks takes 1
+	ASSERTION(m_pChunkAllocator->GetAllocationSize(m_chunkAllocationHandles[index]) == (chunkCount == 0 ? 1 : chunkCount));
 
+	m_pChunkAllocator->Free(m_chunkAllocationHandles[index]);
+	m_chunkAllocationHandles[index] = TLSFAllocator::NULL_BLOCK;
+	m_allocatedChunkCount -= chunkCount;
 }
 
-void ChunkBasedUniforms::FreePreObjectChunk(uint32_t index)
+void ChunkBasedUniforms::EnsureChunkCapacity(uint32_t chunkCount)
 {
-	FreePreObjectChunk(index, 0, (uint32_t)m_freeChunks.size() - 1);
+	if (chunkCount <= m_chunkCapacity)
+		return;
+
+	uint32_t chunkCapacity = m_chunkCapacity;
+	while (chunkCapacity < chunkCount)
+		chunkCapacity *= 2;
+
+	m_pChunkAllocator->Grow(chunkCapacity - m_chunkCapacity);
+	m_chunkAllocationHandles.resize(chunkCapacity, TLSFAllocator::NULL_BLOCK);
+
+	m_chunkCapacity = chunkCapacity;
+	m_dirtyChunkFlags.resize(m_chunkCapacity, false);
+	OnChunkCapacityChanged(m_chunkCapacity);
+
+	// Buffer reallocation is deferred to next sync, so it's safe to grow in the middle of a frame
+	ResizeBuffer(m_chunkCapacity * m_perChunkBytes);
 }
 
 void ChunkBasedUniforms::UpdateUniformDataInternal()
 {
+	UpdateDirtyChunksInternal(m_dirtyChunks);
+
 	for (auto index : m_dirtyChunks)
+		m_dirtyChunkFlags[index] = false;
+	m_dirtyChunks.clear();
+}
+
+void ChunkBasedUniforms::UpdateDirtyChunksInternal(const std::vector<uint32_t>& dirtyChunks)
+{
+	for (auto index : dirtyChunks)
 	{
 		UpdateDirtyChunkInternal(index);
 	}
-	m_dirtyChunks.clear();
 }
 
 void ChunkBasedUniforms::SetDirtyInternal()
@@ -135,9 +121,31 @@ void ChunkBasedUniforms::SetDirtyInternal()
 
 void ChunkBasedUniforms::SetChunkDirty(uint32_t index)
 {
+	ASSERTION(index < m_chunkCapacity);
+
+	// Already dirty, its range is recorded for all frames and not uploaded to any of them yet
+	if (m_dirtyChunkFlags[index])
+		return;
+
+	m_dirtyChunkFlags[index] = true;
 	m_dirtyChunks.push_back(index);
 
-	UniformDataStorage::SetDirty();
+	// Only bytes of this chunk are uploaded
+	UniformDataStorage::SetDirty(index * m_perChunkBytes, m_perChunkBytes);
 }
 
+void ChunkBasedUniforms::SetChunksDirty(uint32_t index, uint32_t count)
+{
+	ASSERTION(index + count <= m_chunkCapacity);
+
+	for (uint32_t i = index; i < index + count; i++)
+	{
+		if (m_dirtyChunkFlags[i])
+			continue;
+
+		m_dirtyChunkFlags[i] = true;
+		m_dirtyChunks.push_back(i);
+	}
 
+	UniformDataStorage::SetDirty(index * m_perChunkBytes, count * m_perChunkBytes);
+}
\ No newline at end of file
@@ -2,34 +2,61 @@
 
 #include "../Maths/Matrix.h"
 #include "UniformDataStorage.h"
+#include "../common/TLSFAllocator.h"
 
+// Chunk indices are handed to shaders, so a chunk never moves once allocated
+// When chunks run out, capacity is doubled and buffer is reallocated(see PerFrameDataStorage::ResizeBuffer)
+// Chunk ranges are sub-allocated by a TLSF allocator counting in chunks, so freed ranges are split and merged with their neighbors
 class ChunkBasedUniforms : public UniformDataStorage
 {
 
 protected:
-	static const uint32_t MAXIMUM_OBJECTS = 256;
+	// Chunk capacity at creation
+	static const uint32_t INITIAL_CHUNK_CAPACITY = 256;
 
 public:
 	virtual uint32_t AllocatePerObjectChunk();
 	virtual uint32_t AllocateConsecutiveChunks(uint32_t chunkSize);
 	virtual void FreePreObjectChunk(uint32_t index);
+	virtual void FreeConsecutiveChunks(uint32_t index, uint32_t chunkSize);
+
+	uint32_t GetChunkCapacity() const { return m_chunkCapacity; }
+	uint32_t GetAllocatedChunkCount() const { return m_allocatedChunkCount; }
 
 protected:
 	bool Init(const std::shared_ptr<ChunkBasedUniforms>& pSelf, uint32_t numBytes);
 
-	void InsertIntoFreeChunk(uint32_t index, uint32_t chunkIndex);
-	void FreePreObjectChunk(uint32_t index, uint32_t start, uint32_t end);
+	// Grow capacity to hold at least "chunkCount" chunks, for storages indexed directly rather than through allocation
+	void EnsureChunkCapacity(uint32_t chunkCount);
+	// Capacity grows until a range of "chunkCount" chunks fits
+	uint32_t AllocateChunks(uint32_t chunkCount);
+	void FreeChunks(uint32_t index, uint32_t chunkCount);
 
 	void UpdateUniformDataInternal() override;
 	void SetDirtyInternal() override;
 
 	virtual void UpdateDirtyChunkInternal(uint32_t index) = 0;
+	// Update all dirty chunks at once, override it to batch the work
+	virtual void UpdateDirtyChunksInternal(const std::vector<uint32_t>& dirtyChunks);
 	virtual void SetChunkDirty(uint32_t index);
+	// Consecutive chunks are recorded as one dirty range
+	void SetChunksDirty(uint32_t index, uint32_t count);
 
 	virtual void OnChunkAllocated(uint32_t index, uint32_t size) {}
+	// Host side chunk data should be resized here, existing chunks have to keep their content
+	virtual void OnChunkCapacityChanged(uint32_t chunkCapacity) = 0;
 
 protected:
-	std::vector<std::pair<uint32_t, uint32_t>>	m_freeChunks;
 	uint32_t									m_perChunkBytes;
+	uint32_t									m_chunkCapacity = 0;
+	uint32_t									m_allocatedChunkCount = 0;
+
+	// Range of allocator is always the same as chunk capacity
+	std::shared_ptr<TLSFAllocator>				m_pChunkAllocator;
+	// Allocator handle of a range, indexed by its first chunk, NULL_BLOCK if no range starts there
+	std::vector<uint32_t>						m_chunkAllocationHandles;
+
+	// Chunks to be updated at next sync, each chunk appears only once
 	std::vector<uint32_t>						m_dirtyChunks;
+	std::vector<bool>							m_dirtyChunkFlags;
 };
\ No newline at end of file
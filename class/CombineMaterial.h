@@ -19,7 +19,6 @@ protected:
 	void CustomizePoolSize(std::vector<uint32_t>& counts) override;
 
 	void CustomizeCommandBuffer(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0) override;
-	void AttachResourceBarriers(const std::shared_ptr<CommandBuffer>& pCmdBuffer, uint32_t pingpong = 0) override;
 
 public:
 	static std::shared_ptr<CombineMaterial> CreateDefaultMaterial();
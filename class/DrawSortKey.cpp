@@ -0,0 +1,70 @@
+#include "DrawSortKey.h"
+#include <cmath>
+
+uint64_t DrawSortKey::Encode(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t depthBucket, uint32_t mesh)
+{
+	uint64_t key = (uint64_t)(pass & ((1 << PASS_BITS) - 1));
+	key = (key << PIPELINE_BITS) | (pipeline & ((1 << PIPELINE_BITS) - 1));
+	key = (key << DESCRIPTOR_SET_BITS) | (descriptorSet & ((1 << DESCRIPTOR_SET_BITS) - 1));
+	key = (key << DEPTH_BITS) | (depthBucket & ((1 << DEPTH_BITS) - 1));
+	key = (key << MESH_BITS) | (mesh & ((1 << MESH_BITS) - 1));
+	return key;
+}
+
+uint32_t DrawSortKey::DepthBucket(double viewDepth)
+{
+	if (viewDepth <= 0.0)
+		return 0;
+
+	double bucket = std::log2(1.0 + viewDepth) * DEPTH_BUCKETS_PER_OCTAVE;
+	uint32_t maxBucket = (1 << DEPTH_BITS) - 1;
+	return bucket >= maxBucket ? maxBucket : (uint32_t)bucket;
+}
+
+void DrawSortKey::RadixSort(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch)
+{
+	uint32_t count = (uint32_t)keys.size();
+
+	order.resize(count);
+	scratch.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		order[i] = i;
+
+	if (count < 2)
+		return;
+
+	// Histograms of all 8 bytes are gathered in a single pass over keys
+	uint32_t histograms[8][256] = {};
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i];
+		for (uint32_t byte = 0; byte < 8; byte++)
+			histograms[byte][(key >> (byte * 8)) & 0xff]++;
+	}
+
+	for (uint32_t byte = 0; byte < 8; byte++)
+	{
+		uint32_t* pHistogram = histograms[byte];
+		uint32_t shift = byte * 8;
+
+		// Every key has the same value of this byte
+		if (pHistogram[(keys[0] >> shift) & 0xff] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; digit++)
+		{
+			uint32_t digitCount = pHistogram[digit];
+			pHistogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t index = order[i];
+			scratch[pHistogram[(keys[index] >> shift) & 0xff]++] = index;
+		}
+
+		order.swap(scratch);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// 64 bit key of a draw packet, sorting by it puts packets sharing the same state into consecutive runs
+// From most significant bits: pass(4) | pipeline(12) | descriptor set(8) | depth bucket(16) | mesh(24)
+// Depth goes before mesh, as meshes share vertex and index buffers and switching between them within a multi draw costs nothing
+class DrawSortKey
+{
+public:
+	static const uint32_t PASS_BITS = 4;
+	static const uint32_t PIPELINE_BITS = 12;
+	static const uint32_t DESCRIPTOR_SET_BITS = 8;
+	static const uint32_t DEPTH_BITS = 16;
+	static const uint32_t MESH_BITS = 24;
+
+	// Buckets grow with distance, 16 buckets per octave keep nearby objects in order without reordering on every small move
+	static const uint32_t DEPTH_BUCKETS_PER_OCTAVE = 16;
+
+public:
+	static uint64_t Encode(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t depthBucket, uint32_t mesh);
+	// View space distance to bucket, objects behind camera go to the nearest bucket
+	static uint32_t DepthBucket(double viewDepth);
+
+	// Stable LSD radix sort of "keys", "order" gets indices of keys in ascending order
+	// Passes of bytes that are identical for all keys are skipped, so constant fields cost nothing
+	static void RadixSort(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch);
+};
\ No newline at end of file
@@ -114,6 +114,25 @@ std::shared_ptr<FrameBuffer> FrameBufferDiction::GetPingPongFrameBuffer(FrameBuf
 		return m_frameBuffers[type][0][frameIndex];
 }
 
+void FrameBufferDiction::AliasColorTarget(FrameBufferType type, uint32_t colorTarget, FrameBufferType aliasedType, uint32_t aliasedColorTarget)
+{
+	ASSERTION(type != aliasedType);
+
+	m_aliasedColorTargets[{ type, colorTarget }] = { aliasedType, aliasedColorTarget };
+	m_frameBuffers[type][0] = CreateFrameBuffer(type);
+}
+
+std::shared_ptr<Image> FrameBufferDiction::CreateColorTarget(FrameBufferType type, uint32_t colorTarget, uint32_t frameIndex, const Vector2ui& size, VkFormat format)
+{
+	auto iter = m_aliasedColorTargets.find({ type, colorTarget });
+	if (iter == m_aliasedColorTargets.end())
+		return Image::CreateOffscreenTexture2D(GetDevice(), size, format);
+
+	// Memory manager falls back to a separate allocation if it doesn't fit
+	std::shared_ptr<Image> pAliasedImage = m_frameBuffers[iter->second.first][0][frameIndex]->GetColorTarget(iter->second.second);
+	return Image::CreateAliasedOffscreenTexture2D(GetDevice(), pAliasedImage, size, format);
+}
+
 FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateGBufferFrameBuffer(uint32_t layer)
 {
 	Vector2ui size =
@@ -153,7 +172,7 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateMotionTileMaxFram
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pColorTarget = Image::CreateOffscreenTexture2D(GetDevice(), size, OFFSCREEN_MOTION_TILE_FORMAT);
+		std::shared_ptr<Image> pColorTarget = CreateColorTarget(FrameBufferType_MotionTileMax, 0, i, size, OFFSCREEN_MOTION_TILE_FORMAT);
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), { pColorTarget }, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionTileMax)->GetRenderPass()));
 	}
 
@@ -172,7 +191,7 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateMotionNeighborMax
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pColorTarget = Image::CreateOffscreenTexture2D(GetDevice(), size, OFFSCREEN_MOTION_TILE_FORMAT);
+		std::shared_ptr<Image> pColorTarget = CreateColorTarget(FrameBufferType_MotionNeighborMax, 0, i, size, OFFSCREEN_MOTION_TILE_FORMAT);
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), { pColorTarget }, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionNeighborMax)->GetRenderPass()));
 	}
 
@@ -207,8 +226,8 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateSSAOSSRFrameBuffe
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pSSAO = Image::CreateOffscreenTexture2D(GetDevice(), size, SSAO_FORMAT);
-		std::shared_ptr<Image> pSSR = Image::CreateOffscreenTexture2D(GetDevice(), size, SSR_FORMAT);
+		std::shared_ptr<Image> pSSAO = CreateColorTarget(FrameBufferType_SSAOSSR, 0, i, size, SSAO_FORMAT);
+		std::shared_ptr<Image> pSSR = CreateColorTarget(FrameBufferType_SSAOSSR, 1, i, size, SSR_FORMAT);
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), { pSSAO, pSSR }, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOSSR)->GetRenderPass()));
 	}
 
@@ -227,7 +246,7 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateSSAOBlurFrameBuff
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pColorTarget = Image::CreateOffscreenTexture2D(GetDevice(), size, SSAO_FORMAT);
+		std::shared_ptr<Image> pColorTarget = CreateColorTarget(FrameBufferType_SSAOBlurV, 0, i, size, SSAO_FORMAT);
 
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), pColorTarget, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurV)->GetRenderPass()));
 	}
@@ -247,7 +266,7 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateSSAOBlurFrameBuff
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pColorTarget = Image::CreateOffscreenTexture2D(GetDevice(), size, SSAO_FORMAT);
+		std::shared_ptr<Image> pColorTarget = CreateColorTarget(FrameBufferType_SSAOBlurH, 0, i, size, SSAO_FORMAT);
 
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), pColorTarget, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurH)->GetRenderPass()));
 	}
@@ -268,8 +287,8 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateShadingFrameBuffe
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pShadingResult = Image::CreateOffscreenTexture2D(GetDevice(), size, OFFSCREEN_HDR_COLOR_FORMAT);
-		std::shared_ptr<Image> pSSResult = Image::CreateOffscreenTexture2D(GetDevice(), size, OFFSCREEN_HDR_COLOR_FORMAT);
+		std::shared_ptr<Image> pShadingResult = CreateColorTarget(FrameBufferType_Shading, 0, i, size, OFFSCREEN_HDR_COLOR_FORMAT);
+		std::shared_ptr<Image> pSSResult = CreateColorTarget(FrameBufferType_Shading, 1, i, size, OFFSCREEN_HDR_COLOR_FORMAT);
 		std::shared_ptr<Image> pDepthStencilBuffer = m_frameBuffers[FrameBufferType_GBuffer][0][i]->GetDepthStencilTarget();
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), { pShadingResult, pSSResult }, pDepthStencilBuffer, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->GetRenderPass()));
 	}
@@ -396,7 +415,7 @@ FrameBufferDiction::FrameBufferCombo FrameBufferDiction::CreateCombineResultFram
 
 	for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 	{
-		std::shared_ptr<Image> pColorTarget = Image::CreateOffscreenTexture2D(GetDevice(), size, OFFSCREEN_HDR_COLOR_FORMAT);
+		std::shared_ptr<Image> pColorTarget = CreateColorTarget(FrameBufferType_CombineResult, 0, i, size, OFFSCREEN_HDR_COLOR_FORMAT);
 		frameBuffers.push_back(FrameBuffer::Create(GetDevice(), { pColorTarget }, nullptr, RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassCombine)->GetRenderPass()));
 	}
 
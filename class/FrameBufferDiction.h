@@ -2,10 +2,12 @@
 
 #include "../common/Singleton.h"
 #include "../vulkan/RenderPass.h"
+#include "../Maths/Vector.h"
 #include <map>
 
 class FrameBuffer;
 class Texture2D;
+class Image;
 
 class FrameBufferDiction : public Singleton<FrameBufferDiction>
 {
@@ -109,11 +111,19 @@ public:
 	FrameBufferCombo CreateForwardEnvGenOffScreenFrameBuffer(uint32_t layer = 0);
 	FrameBufferCombo CreateForwardScreenFrameBuffer(uint32_t layer = 0);
 
+	// Recreate frame buffers of a type, so that one of its color targets shares memory with another frame buffer's color target
+	// Their lifetimes within a frame must not overlap, only first layer is supported
+	void AliasColorTarget(FrameBufferType type, uint32_t colorTarget, FrameBufferType aliasedType, uint32_t aliasedColorTarget);
+
+protected:
+	std::shared_ptr<Image> CreateColorTarget(FrameBufferType type, uint32_t colorTarget, uint32_t frameIndex, const Vector2ui& size, VkFormat format);
+
 protected:
 	// Since you can't render to a specific mip layer of a frame buffer
 	// I'll have to create multiple frame buffers as layers
 	// But, most of frame buffers contain 1 layer
 	std::vector<std::vector<FrameBufferCombo>>					m_frameBuffers;
 	std::vector<std::vector<std::shared_ptr<Texture2D>>>		m_temporalTexture;
+	std::map<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t>>	m_aliasedColorTargets;
 	static VkFormat												m_GBufferFormatTable[GBufferCount];
 };
\ No newline at end of file
@@ -834,6 +834,12 @@ std::shared_ptr<PerBoneUniforms> PerBoneUniforms::Create()
 	return nullptr;
 }
 
+void PerBoneUniforms::OnChunkCapacityChanged(uint32_t chunkCapacity)
+{
+	m_boneData.resize(chunkCapacity);
+	m_singlePrecisionBoneData.resize(chunkCapacity);
+}
+
 void PerBoneUniforms::SetBoneOffsetTransform(uint32_t chunkIndex, const DualQuaterniond& offsetDQ)
 {
 	m_boneData[chunkIndex].prevBoneOffsetDQ = m_boneData[chunkIndex].currBoneOffsetDQ;
@@ -841,6 +847,19 @@ void PerBoneUniforms::SetBoneOffsetTransform(uint32_t chunkIndex, const DualQuat
 	SetChunkDirty(chunkIndex);
 }
 
+void PerBoneUniforms::SetBoneOffsetTransforms(const uint32_t* pChunkIndices, const DualQuaterniond* pOffsetDQs, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		m_boneData[pChunkIndices[i]].prevBoneOffsetDQ = m_boneData[pChunkIndices[i]].currBoneOffsetDQ;
+		m_boneData[pChunkIndices[i]].currBoneOffsetDQ = pOffsetDQs[i];
+	}
+
+	std::unique_lock<std::mutex> lock(m_dirtyChunkMutex);
+	for (uint32_t i = 0; i < count; i++)
+		SetChunkDirty(pChunkIndices[i]);
+}
+
 DualQuaterniond PerBoneUniforms::GetBoneOffsetTransform(uint32_t chunkIndex) const
 {
 	return m_boneData[chunkIndex].currBoneOffsetDQ;
@@ -6,6 +6,7 @@
 #include "../common/Macros.h"
 #include <unordered_map>
 #include <string>
+#include <mutex>
 
 class DescriptorSetLayout;
 class DescriptorSet;
@@ -424,16 +425,24 @@ protected:
 	void SetBoneOffsetTransform(uint32_t chunkIndex, const DualQuaterniond& offsetDQ);
 	DualQuaterniond GetBoneOffsetTransform(uint32_t chunkIndex) const;
 
+	// Set a whole pose at once, pose jobs of different animation instances could call it at the same time as long as their chunks don't overlap
+	void SetBoneOffsetTransforms(const uint32_t* pChunkIndices, const DualQuaterniond* pOffsetDQs, uint32_t count);
+
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_singlePrecisionBoneData[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_singlePrecisionBoneData); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_singlePrecisionBoneData.size() * sizeof(BoneData<float>)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override;
 
 protected:
-	BoneData<double>	m_boneData[MAXIMUM_OBJECTS];
-	BoneData<float>		m_singlePrecisionBoneData[MAXIMUM_OBJECTS];
+	std::vector<BoneData<double>>	m_boneData;
+	std::vector<BoneData<float>>	m_singlePrecisionBoneData;
+
+	// Dirty chunk bookkeeping is shared, while bone data of different chunks isn't
+	std::mutex						m_dirtyChunkMutex;
 
 	friend class BoneIndirectUniform;
+	friend class SkeletonAnimationInstance;
 };
 
 class Mesh;
@@ -482,10 +491,11 @@ public:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_boneChunkIndex[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_boneChunkIndex); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_boneChunkIndex.size() * sizeof(uint32_t)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_boneChunkIndex.resize(chunkCapacity); }
 
 protected:
-	uint32_t									m_boneChunkIndex[MAXIMUM_OBJECTS];
+	std::vector<uint32_t>						m_boneChunkIndex;
 	// index stands for instance chunk index of a set of bones
 	std::unordered_map<uint32_t, BoneIndexLookupTable>	m_boneIndexLookupTables;
 
@@ -520,10 +530,11 @@ protected:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_meshData[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_meshData); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_meshData.size() * sizeof(MeshData)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_meshData.resize(chunkCapacity); }
 
 protected:
-	MeshData	m_meshData[MAXIMUM_OBJECTS];
+	std::vector<MeshData>	m_meshData;
 
 	friend class Mesh;
 };
@@ -552,10 +563,11 @@ protected:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_animationData[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_animationData); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_animationData.size() * sizeof(AnimationData)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_animationData.resize(chunkCapacity); }
 
 protected:
-	AnimationData	m_animationData[MAXIMUM_OBJECTS];
+	std::vector<AnimationData>	m_animationData;
 
 	friend class SkeletonAnimationInstance;
 };
\ No newline at end of file
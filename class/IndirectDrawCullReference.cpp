@@ -0,0 +1,132 @@
+#include "IndirectDrawCullReference.h"
+#include <cmath>
+
+void IndirectDrawCullReference::Cull(const CullingInput& input, PerMaterialIndirectVariables* pObjectDataIndices, CullingOutput& output)
+{
+	output.cmds.clear();
+	output.indirectOffsets.clear();
+	output.drawCount = 0;
+
+	for (uint32_t i = 0; i < input.drawCount; i++)
+	{
+		const IndirectDrawVariables& draw = input.pDraws[i];
+
+		uint32_t visibleCount = 0;
+		for (uint32_t j = 0; j < draw.instanceRecordCount; j++)
+		{
+			PerMaterialIndirectVariables instance = pObjectDataIndices[draw.instanceOffset + j];
+			if (IsVisible(input, instance.perObjectIndex))
+				pObjectDataIndices[draw.cullingOffset + visibleCount++] = instance;
+		}
+
+		if (visibleCount == 0)
+			continue;
+
+		uint32_t outDrawID = output.drawCount++;
+		if (outDrawID >= input.maxDrawCount)
+			continue;
+
+		DrawIndexedIndirectCommand cmd;
+		cmd.indexCount = draw.indexCount;
+		cmd.instanceCount = draw.instanceCount == 0 ? visibleCount : draw.instanceCount;
+		cmd.firstIndex = draw.firstIndex;
+		cmd.vertexOffset = draw.vertexOffset;
+		cmd.firstInstance = draw.firstInstance;
+		output.cmds.push_back(cmd);
+
+		IndirectOffset indirectOffset;
+		indirectOffset.offset = draw.cullingOffset;
+		output.indirectOffsets.push_back(indirectOffset);
+	}
+}
+
+bool IndirectDrawCullReference::IsVisible(const CullingInput& input, uint32_t perObjectIndex)
+{
+	const PerObjectBoundsVariables& bounds = input.pObjectBounds[perObjectIndex];
+	if (bounds.center.w == 0.0f)
+		return true;
+
+	const Matrix4f& MVP = input.pObjectVariables[perObjectIndex].MVP;
+
+	// Planes that all corners are outside of
+	uint32_t outsideMask = 63;
+	bool crossNearPlane = false;
+	Vector3f ndcMin = { 1e30f, 1e30f, 1e30f };
+	Vector3f ndcMax = { -1e30f, -1e30f, -1e30f };
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		Vector4f corner =
+		{
+			bounds.center.x + bounds.extent.x * ((i & 1) != 0 ? 1.0f : -1.0f),
+			bounds.center.y + bounds.extent.y * ((i & 2) != 0 ? 1.0f : -1.0f),
+			bounds.center.z + bounds.extent.z * ((i & 4) != 0 ? 1.0f : -1.0f),
+			1.0f
+		};
+		Vector4f clip = MVP * corner;
+
+		uint32_t outside = 0;
+		if (clip.x < -clip.w) outside |= 1;
+		if (clip.x > clip.w) outside |= 2;
+		if (clip.y < -clip.w) outside |= 4;
+		if (clip.y > clip.w) outside |= 8;
+		if (clip.z < 0.0f) outside |= 16;
+		if (clip.z > clip.w) outside |= 32;
+		outsideMask &= outside;
+
+		if (clip.w <= 0.0f)
+			crossNearPlane = true;
+		else
+		{
+			Vector3f ndc = { clip.x / clip.w, clip.y / clip.w, clip.z / clip.w };
+			ndcMin = { ndc.x < ndcMin.x ? ndc.x : ndcMin.x, ndc.y < ndcMin.y ? ndc.y : ndcMin.y, ndc.z < ndcMin.z ? ndc.z : ndcMin.z };
+			ndcMax = { ndc.x > ndcMax.x ? ndc.x : ndcMax.x, ndc.y > ndcMax.y ? ndc.y : ndcMax.y, ndc.z > ndcMax.z ? ndc.z : ndcMax.z };
+		}
+	}
+
+	if (outsideMask != 0)
+		return false;
+
+	// Box crossing near plane doesn't have a valid screen footprint
+	if (crossNearPlane)
+		return true;
+
+	return !IsOccluded(input, ndcMin, ndcMax);
+}
+
+bool IndirectDrawCullReference::IsOccluded(const CullingInput& input, const Vector3f& ndcMin, const Vector3f& ndcMax)
+{
+	auto saturate = [](float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); };
+
+	// Vulkan NDC y points down, the same as texture coordinate
+	Vector2f uvMin = { saturate(ndcMin.x * 0.5f + 0.5f), saturate(ndcMin.y * 0.5f + 0.5f) };
+	Vector2f uvMax = { saturate(ndcMax.x * 0.5f + 0.5f), saturate(ndcMax.y * 0.5f + 0.5f) };
+	Vector2f footprint = { (uvMax.x - uvMin.x) * input.hiZSize.x, (uvMax.y - uvMin.y) * input.hiZSize.y };
+
+	// Pick the level where footprint is no larger than a texel, so 4 texels cover it
+	float larger = footprint.x > footprint.y ? footprint.x : footprint.y;
+	int32_t level = (int32_t)std::ceil(std::log2(larger > 1.0f ? larger : 1.0f));
+	if (level >= (int32_t)input.hiZLevels.size())
+		return false;
+
+	int32_t levelWidth = (int32_t)(input.hiZSize.x >> level);
+	int32_t levelHeight = (int32_t)(input.hiZSize.y >> level);
+	levelWidth = levelWidth < 1 ? 1 : levelWidth;
+	levelHeight = levelHeight < 1 ? 1 : levelHeight;
+
+	int32_t minX = (int32_t)(uvMin.x * levelWidth), minY = (int32_t)(uvMin.y * levelHeight);
+	int32_t maxX = (int32_t)(uvMax.x * levelWidth), maxY = (int32_t)(uvMax.y * levelHeight);
+	minX = minX < levelWidth - 1 ? minX : levelWidth - 1;
+	minY = minY < levelHeight - 1 ? minY : levelHeight - 1;
+	maxX = maxX < levelWidth - 1 ? maxX : levelWidth - 1;
+	maxY = maxY < levelHeight - 1 ? maxY : levelHeight - 1;
+
+	const float* pLevel = input.hiZLevels[level];
+	float occluderDepth = pLevel[minY * levelWidth + minX];
+	float depths[] = { pLevel[minY * levelWidth + maxX], pLevel[maxY * levelWidth + minX], pLevel[maxY * levelWidth + maxX] };
+	for (float depth : depths)
+		occluderDepth = depth < occluderDepth ? depth : occluderDepth;
+
+	// Reversed z, the nearest point of box is farther than every occluder
+	return ndcMax.z < occluderDepth;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../Maths/Matrix.h"
+#include "PerObjectVariables.h"
+#include "PerObjectBoundsVariables.h"
+#include "PerMaterialIndirectVariables.h"
+#include <vector>
+
+// Frustum and Hi-Z occlusion culling of indirect draws, with visible instances compacted behind each draw
+// It's the reference a GPU culling pass has to match, inputs and outputs are laid out as GPU buffers would be, and it doesn't need a device
+class IndirectDrawCullReference
+{
+public:
+	// Same layout as "VkDrawIndexedIndirectCommand"
+	typedef struct _DrawIndexedIndirectCommand
+	{
+		uint32_t	indexCount;
+		uint32_t	instanceCount;
+		uint32_t	firstIndex;
+		int32_t		vertexOffset;
+		uint32_t	firstInstance;
+	}DrawIndexedIndirectCommand;
+
+	// Everything a culling pass reads, laid out exactly as in GPU buffers
+	typedef struct _CullingInput
+	{
+		const IndirectDrawVariables*		pDraws;
+		uint32_t							drawCount;
+		const PerObjectBoundsVariables*		pObjectBounds;
+		const PerObjectVariablesf*			pObjectVariables;
+
+		// Hi-Z levels from the finest one, each of them is tightly packed
+		std::vector<const float*>			hiZLevels;
+		Vector2ui							hiZSize;
+
+		uint32_t							maxDrawCount;
+	}CullingInput;
+
+	typedef struct _CullingOutput
+	{
+		std::vector<DrawIndexedIndirectCommand>	cmds;
+		std::vector<IndirectOffset>				indirectOffsets;
+		// Count of visible draws, could be larger than count of commands if it exceeds max draw count
+		uint32_t								drawCount;
+	}CullingOutput;
+
+public:
+	// Draws are output in order, while order of draws and of instances within a draw is arbitrary on GPU
+	static void Cull(const CullingInput& input, PerMaterialIndirectVariables* pObjectDataIndices, CullingOutput& output);
+	static bool IsVisible(const CullingInput& input, uint32_t perObjectIndex);
+	static bool IsOccluded(const CullingInput& input, const Vector3f& ndcMin, const Vector3f& ndcMax);
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <mutex>
+#include <algorithm>
 #include "Material.h"
 #include "../vulkan/CommandBuffer.h"
 #include "../vulkan/PerFrameResource.h"
@@ -177,17 +178,16 @@ void Material::GeneralInit
 
 	CustomizePoolSize(counts);
 
-	std::vector<VkDescriptorPoolSize> descPoolSize;
 	for (uint32_t i = 0; i < counts.size(); i++)
 	{
 		if (counts[i] != 0)
-			descPoolSize.push_back({ (VkDescriptorType)i, counts[i] });
+			m_descriptorPoolSizes.push_back({ (VkDescriptorType)i, counts[i] });
 	}
 
 	VkDescriptorPoolCreateInfo descPoolInfo = {};
 	descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descPoolInfo.pPoolSizes = descPoolSize.data();
-	descPoolInfo.poolSizeCount = (uint32_t)descPoolSize.size();
+	descPoolInfo.pPoolSizes = m_descriptorPoolSizes.data();
+	descPoolInfo.poolSizeCount = (uint32_t)m_descriptorPoolSizes.size();
 	descPoolInfo.maxSets = 1 + GetSwapChain()->GetSwapChainImageCount();
 
 	m_pDescriptorPool = DescriptorPool::Create(GetDevice(), descPoolInfo);
@@ -196,29 +196,79 @@ void Material::GeneralInit
 	m_descriptorSets = UniformData::GetInstance()->GetDescriptorSets();
 	m_descriptorSets.push_back(m_pUniformStorageDescriptorSet);
 
-	// Setup cached frame offsets
-	m_cachedFrameOffsets = UniformData::GetInstance()->GetCachedFrameOffsets();
+	// Setup cached frame offsets and descriptor set, compute material doesn't have material uniforms
+	UpdateCachedFrameOffsets();
+	UpdateUniformStorageDescriptorSet();
 
-	if (isCompute)
-		return;
+	m_uniformBufferVersion = AcquireUniformBufferVersion();
+}
+
+void Material::UpdateCachedFrameOffsets()
+{
+	m_cachedFrameOffsets = UniformData::GetInstance()->GetCachedFrameOffsets();
 
 	for (uint32_t frameIndex = 0; frameIndex < GetSwapChain()->GetSwapChainImageCount(); frameIndex++)
 	{
-		std::vector<uint32_t> offsets;
-		for (uint32_t i = 0; i < MaterialUniformStorageTypeCount; i++)
+		for (uint32_t i = 0; i < m_materialUniforms.size(); i++)
 		{
 			m_cachedFrameOffsets[frameIndex].push_back(m_materialUniforms[i]->GetFrameOffset() * frameIndex);
 		}
 	}
+}
 
-	// Setup descriptor set
+void Material::UpdateUniformStorageDescriptorSet()
+{
 	uint32_t bindingIndex = 0;
-	for (uint32_t i = 0; i < MaterialUniformStorageTypeCount; i++)
+	for (uint32_t i = 0; i < m_materialUniforms.size(); i++)
 	{
 		bindingIndex = m_materialUniforms[i]->SetupDescriptorSet(m_pUniformStorageDescriptorSet, bindingIndex);
 	}
 }
 
+void Material::ReallocateUniformStorageDescriptorSet()
+{
+	// Frames in flight still use current descriptor set, updating it in place is illegal
+	// So a fresh set inherits all descriptors, including images written by sub classes, then storage buffers are written again
+	std::shared_ptr<DescriptorSet> pOldDescriptorSet = m_pUniformStorageDescriptorSet;
+
+	VkDescriptorPoolCreateInfo descPoolInfo = {};
+	descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descPoolInfo.pPoolSizes = m_descriptorPoolSizes.data();
+	descPoolInfo.poolSizeCount = (uint32_t)m_descriptorPoolSizes.size();
+	descPoolInfo.maxSets = 1;
+
+	m_pDescriptorPool = DescriptorPool::Create(GetDevice(), descPoolInfo);
+	m_pUniformStorageDescriptorSet = m_pDescriptorPool->AllocateDescriptorSet(m_pDescriptorSetLayout);
+	m_pUniformStorageDescriptorSet->CopyDescriptors(pOldDescriptorSet);
+	UpdateUniformStorageDescriptorSet();
+
+	// Uniform data might have replaced its sets too
+	m_descriptorSets = UniformData::GetInstance()->GetDescriptorSets();
+	m_descriptorSets.push_back(m_pUniformStorageDescriptorSet);
+
+	FrameMgr()->RetireResource(pOldDescriptorSet);
+}
+
+void Material::SyncUniformBufferVersion()
+{
+	// Uniform storages might have reallocated their buffers as they grow
+	uint32_t bufferVersion = AcquireUniformBufferVersion();
+	if (bufferVersion != m_uniformBufferVersion)
+	{
+		UpdateCachedFrameOffsets();
+		ReallocateUniformStorageDescriptorSet();
+		m_uniformBufferVersion = bufferVersion;
+	}
+}
+
+uint32_t Material::AcquireUniformBufferVersion() const
+{
+	uint32_t bufferVersion = UniformData::GetInstance()->GetBufferVersion();
+	for (auto & var : m_materialUniforms)
+		bufferVersion += var->GetBufferVersion();
+	return bufferVersion;
+}
+
 bool Material::Init
 (
 	const std::shared_ptr<Material>& pSelf,
@@ -270,13 +320,16 @@ bool Material::Init
 	{
 		for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 		{
-			m_indirectBuffers.push_back(SharedIndirectBuffer::Create(GetDevice(), sizeof(VkDrawIndirectCommand) * MAX_INDIRECT_COUNT));
+			m_indirectBuffers.push_back(SharedIndirectBuffer::Create(GetDevice(), sizeof(VkDrawIndexedIndirectCommand) * MAX_INDIRECT_COUNT));
 		}
 
 		for (uint32_t i = 0; i < GetSwapChain()->GetSwapChainImageCount(); i++)
 		{
 			m_indirectCmdCountBuffers.push_back(SharedIndirectBuffer::Create(GetDevice(), sizeof(uint32_t)));
 		}
+
+		// Nothing's uploaded yet, make sure count is written at first sync of each frame
+		m_uploadedDrawCounts.resize(m_indirectCmdCountBuffers.size(), (uint32_t)NULL_RECORD);
 	}
 
 	m_vertexFormat = vertexFormat;
@@ -412,42 +465,13 @@ uint32_t Material::GetUniformBufferSize() const
 void Material::SyncBufferData()
 {
 	if (m_indirectBuffers.size() > 0)
-	{
-		uint32_t drawID = 0;
-		uint32_t offset = 0;
-		VkDrawIndexedIndirectCommand cmd;
-
-		// Contruct indirect buffer for current frame
-		for each(auto& meshRenderData in m_cachedMeshRenderData)
-		{
-			// Prepare mesh indirect data
-			meshRenderData.pMesh->PrepareIndirectCmd(cmd);
-			cmd.instanceCount = meshRenderData.instanceCount;
-			cmd.firstInstance = meshRenderData.instanceDataOffset;
-			m_indirectBuffers[FrameMgr()->FrameIndex()]->SetIndirectCmd(drawID, cmd);
-
-			// Prepare indirect offset
-			m_pPerMaterialIndirectOffset->SetIndirectOffset(drawID, offset);
-
-			// Prepare indirect indices for all data
-			for (uint32_t instanceCount = 0; instanceCount < meshRenderData.indirectIndices.size(); instanceCount++)
-			{
-				m_pPerMaterialIndirectUniforms->SetPerObjectIndex(offset, meshRenderData.indirectIndices[instanceCount].perObjectIndex);
-				m_pPerMaterialIndirectUniforms->SetPerMaterialIndex(offset, meshRenderData.indirectIndices[instanceCount].perMaterialIndex);
-				m_pPerMaterialIndirectUniforms->SetPerMeshIndex(offset, meshRenderData.indirectIndices[instanceCount].perMeshIndex);
-				m_pPerMaterialIndirectUniforms->SetUtilityIndex(offset, meshRenderData.indirectIndices[instanceCount].utilityIndex);
-				offset++;
-			}
-
-			drawID++;
-		}
-
-		m_indirectCmdCountBuffers[FrameMgr()->FrameIndex()]->SetIndirectCmdCount((uint32_t)m_cachedMeshRenderData.size());
-	}
+		SyncIndirectData();
 
 	for (auto & var : m_materialUniforms)
 		if (var != nullptr)
 			var->SyncBufferData();
+
+	SyncUniformBufferVersion();
 }
 
 void Material::BindPipeline(const std::shared_ptr<CommandBuffer>& pCmdBuffer)
@@ -457,6 +481,8 @@ void Material::BindPipeline(const std::shared_ptr<CommandBuffer>& pCmdBuffer)
 
 void Material::BindDescriptorSet(const std::shared_ptr<CommandBuffer>& pCmdBuffer)
 {
+	// Recording may happen before this material syncs, it must never bind retired descriptor sets
+	SyncUniformBufferVersion();
 	pCmdBuffer->BindDescriptorSets(m_pPipeline->GetPipelineBindingPoint(), GetPipelineLayout(), m_descriptorSets, m_cachedFrameOffsets[FrameMgr()->FrameIndex()]);
 }
 
@@ -479,39 +505,428 @@ void Material::InsertIntoRenderQueue(const std::shared_ptr<Mesh>& pMesh, uint32_
 {
 	ASSERTION(instanceCount > 0);
 
-	auto iter = m_perFrameMeshRefTable.find(pMesh);
+	if (m_indirectBuffers.size() == 0)
+		return;
 
 	// Instance count greater than 1 means manually instanced rendering
 	bool manualInstance = instanceCount > 1;
+	PerMaterialIndirectVariables indices = { perObjectIndex, perMaterialIndex, perMeshIndex, utilityIndex };
+
+	if (perObjectIndex >= m_objectInstanceTable.size())
+		m_objectInstanceTable.resize(perObjectIndex + 1, (uint32_t)NULL_RECORD);
+
+	// Camera looks down -z in view space
+	float depth = (float)-UniformData::GetInstance()->GetPerObjectUniforms()->GetMVMatrix(perObjectIndex).w2;
 
-	// If a mesh is not yet added to ref table of current frame
-	if (iter == m_perFrameMeshRefTable.end() || manualInstance)
+	// Find a record of this renderer that's not inserted yet in this frame
+	uint32_t instance = m_objectInstanceTable[perObjectIndex];
+	while (instance != NULL_RECORD && m_instanceRecords[instance].frameStamp == m_frameStamp)
+		instance = m_instanceRecords[instance].nextInstance;
+
+	if (instance == NULL_RECORD)
+		instance = AllocateInstanceRecord(perObjectIndex);
+	else
+	{
+		// Renderer moved to another draw, e.g. its mesh or instancing changed
+		uint32_t drawIndex = m_instanceRecords[instance].drawIndex;
+		const DrawRecord& draw = m_drawRecords[drawIndex];
+		const VkDrawIndexedIndirectCommand& cmd = m_indirectCmds[drawIndex];
+		if (draw.pMesh != pMesh || draw.manualInstance != manualInstance || (manualInstance && (cmd.instanceCount != instanceCount || cmd.firstInstance != startInstance)))
+			RemoveInstanceFromDraw(instance);
+	}
+
+	InstanceRecord& record = m_instanceRecords[instance];
+	record.frameStamp = m_frameStamp;
+
+	if (record.drawIndex == NULL_RECORD)
 	{
-		// First all the info into cached mesh render data
-		m_cachedMeshRenderData.push_back
-		(
+		record.indices = indices;
+
+		// Auto instanced draws are shared by all renderers of the same mesh
+		uint32_t drawIndex = NULL_RECORD;
+		if (!manualInstance)
+		{
+			auto iter = m_autoInstanceDrawTable.find(pMesh.get());
+			if (iter != m_autoInstanceDrawTable.end())
+				drawIndex = iter->second;
+		}
+
+		if (drawIndex == NULL_RECORD)
+			drawIndex = CreateDrawRecord(pMesh, manualInstance, instanceCount, startInstance);
+
+		AddInstanceToDraw(instance, drawIndex);
+		UpdateDrawDepth(drawIndex, depth);
+		return;
+	}
+
+	// Same draw as last frame, only indices could change
+	if (memcmp(&record.indices, &indices, sizeof(PerMaterialIndirectVariables)) != 0)
+	{
+		record.indices = indices;
+		SetInstanceSlotDirty(m_drawRecords[record.drawIndex].instanceOffset + record.slot);
+	}
+
+	UpdateDrawDepth(record.drawIndex, depth);
+}
+
+void Material::UpdateDrawDepth(uint32_t drawIndex, float depth)
+{
+	// Nearest instance decides where its draw goes in front to back order
+	DrawRecord& draw = m_drawRecords[drawIndex];
+	if (draw.depthStamp != m_frameStamp || depth < draw.nearestDepth)
+		draw.nearestDepth = depth;
+	draw.depthStamp = m_frameStamp;
+}
+
+uint32_t Material::AllocateInstanceRecord(uint32_t perObjectIndex)
+{
+	uint32_t instance;
+	if (!m_freeInstanceRecords.empty())
+	{
+		instance = m_freeInstanceRecords.back();
+		m_freeInstanceRecords.pop_back();
+	}
+	else
+	{
+		instance = (uint32_t)m_instanceRecords.size();
+		m_instanceRecords.push_back({});
+	}
+
+	InstanceRecord& record = m_instanceRecords[instance];
+	record.drawIndex = NULL_RECORD;
+	record.slot = 0;
+	record.frameStamp = 0;
+
+	// Link to the head of renderer's records
+	record.nextInstance = m_objectInstanceTable[perObjectIndex];
+	m_objectInstanceTable[perObjectIndex] = instance;
+
+	return instance;
+}
+
+void Material::FreeInstanceRecord(uint32_t instance)
+{
+	ASSERTION(m_instanceRecords[instance].drawIndex == NULL_RECORD);
+
+	// Unlink from renderer's records
+	uint32_t* pLink = &m_objectInstanceTable[m_instanceRecords[instance].indices.perObjectIndex];
+	while (*pLink != instance)
+		pLink = &m_instanceRecords[*pLink].nextInstance;
+	*pLink = m_instanceRecords[instance].nextInstance;
+
+	m_instanceRecords[instance].frameStamp = 0;
+	m_freeInstanceRecords.push_back(instance);
+}
+
+uint32_t Material::CreateDrawRecord(const std::shared_ptr<Mesh>& pMesh, bool manualInstance, uint32_t instanceCount, uint32_t startInstance)
+{
+	ASSERTION(m_drawRecords.size() < MAX_INDIRECT_COUNT);
+
+	uint32_t drawIndex = (uint32_t)m_drawRecords.size();
+
+	DrawRecord draw;
+	draw.pMesh = pMesh;
+	draw.manualInstance = manualInstance;
+	draw.instanceCount = 0;
+	draw.instanceCapacity = 1;
+	draw.instanceOffset = m_pPerMaterialIndirectUniforms->AllocateConsecutiveChunks(draw.instanceCapacity);
+	draw.nearestDepth = 0;
+	draw.depthStamp = 0;
+	m_drawRecords.push_back(draw);
+
+	// Mesh data doesn't move within shared buffers, so command is prepared only once
+	VkDrawIndexedIndirectCommand cmd;
+	pMesh->PrepareIndirectCmd(cmd);
+	cmd.instanceCount = manualInstance ? instanceCount : 0;
+	cmd.firstInstance = startInstance;
+	m_indirectCmds.push_back(cmd);
+
+	m_drawDirtyFrames.push_back(0);
+	SetDrawDirty(drawIndex);
+	m_pPerMaterialIndirectOffset->SetIndirectOffset(drawIndex, draw.instanceOffset);
+
+	if (m_slotInstanceTable.size() < m_pPerMaterialIndirectUniforms->GetChunkCapacity())
+		m_slotInstanceTable.resize(m_pPerMaterialIndirectUniforms->GetChunkCapacity(), (uint32_t)NULL_RECORD);
+
+	if (!manualInstance)
+		m_autoInstanceDrawTable[pMesh.get()] = drawIndex;
+
+	return drawIndex;
+}
+
+void Material::RemoveDrawRecord(uint32_t drawIndex)
+{
+	DrawRecord& draw = m_drawRecords[drawIndex];
+	ASSERTION(draw.instanceCount == 0);
+
+	m_pPerMaterialIndirectUniforms->FreeConsecutiveChunks(draw.instanceOffset, draw.instanceCapacity);
+	if (!draw.manualInstance)
+		m_autoInstanceDrawTable.erase(draw.pMesh.get());
+
+	// Fill the hole with the last draw, so that draws stay packed for indirect count
+	uint32_t lastDraw = (uint32_t)m_drawRecords.size() - 1;
+	if (drawIndex != lastDraw)
+	{
+		m_drawRecords[drawIndex] = m_drawRecords[lastDraw];
+		m_indirectCmds[drawIndex] = m_indirectCmds[lastDraw];
+
+		const DrawRecord& movedDraw = m_drawRecords[drawIndex];
+		for (uint32_t i = 0; i < movedDraw.instanceCount; i++)
+			m_instanceRecords[m_slotInstanceTable[movedDraw.instanceOffset + i]].drawIndex = drawIndex;
+
+		if (!movedDraw.manualInstance)
+			m_autoInstanceDrawTable[movedDraw.pMesh.get()] = drawIndex;
+
+		m_pPerMaterialIndirectOffset->SetIndirectOffset(drawIndex, movedDraw.instanceOffset);
+		SetDrawDirty(drawIndex);
+	}
+
+	// Dirty list entries beyond draw count are dropped at sync
+	m_drawRecords.pop_back();
+	m_indirectCmds.pop_back();
+	m_drawDirtyFrames.pop_back();
+}
+
+void Material::GrowDrawInstanceCapacity(uint32_t drawIndex)
+{
+	DrawRecord& draw = m_drawRecords[drawIndex];
+
+	uint32_t instanceCapacity = draw.instanceCapacity * 2;
+	uint32_t instanceOffset = m_pPerMaterialIndirectUniforms->AllocateConsecutiveChunks(instanceCapacity);
+
+	if (m_slotInstanceTable.size() < m_pPerMaterialIndirectUniforms->GetChunkCapacity())
+		m_slotInstanceTable.resize(m_pPerMaterialIndirectUniforms->GetChunkCapacity(), (uint32_t)NULL_RECORD);
+
+	// Slots are relative to draw, so instance records don't change, only their data is written to new place
+	for (uint32_t i = 0; i < draw.instanceCount; i++)
+	{
+		m_slotInstanceTable[instanceOffset + i] = m_slotInstanceTable[draw.instanceOffset + i];
+		m_slotInstanceTable[draw.instanceOffset + i] = NULL_RECORD;
+		SetInstanceSlotDirty(instanceOffset + i);
+	}
+
+	m_pPerMaterialIndirectUniforms->FreeConsecutiveChunks(draw.instanceOffset, draw.instanceCapacity);
+
+	draw.instanceOffset = instanceOffset;
+	draw.instanceCapacity = instanceCapacity;
+	m_pPerMaterialIndirectOffset->SetIndirectOffset(drawIndex, instanceOffset);
+}
+
+void Material::AddInstanceToDraw(uint32_t instance, uint32_t drawIndex)
+{
+	if (m_drawRecords[drawIndex].instanceCount == m_drawRecords[drawIndex].instanceCapacity)
+		GrowDrawInstanceCapacity(drawIndex);
+
+	DrawRecord& draw = m_drawRecords[drawIndex];
+	InstanceRecord& record = m_instanceRecords[instance];
+
+	record.drawIndex = drawIndex;
+	record.slot = draw.instanceCount++;
+	m_slotInstanceTable[draw.instanceOffset + record.slot] = instance;
+	SetInstanceSlotDirty(draw.instanceOffset + record.slot);
+
+	// Instance count of manually instanced draw comes from renderer
+	if (!draw.manualInstance)
+	{
+		m_indirectCmds[drawIndex].instanceCount = draw.instanceCount;
+		SetDrawDirty(drawIndex);
+	}
+}
+
+void Material::RemoveInstanceFromDraw(uint32_t instance)
+{
+	InstanceRecord& record = m_instanceRecords[instance];
+	uint32_t drawIndex = record.drawIndex;
+	DrawRecord& draw = m_drawRecords[drawIndex];
+
+	// Fill the hole with the last instance of draw
+	uint32_t lastSlot = draw.instanceCount - 1;
+	if (record.slot != lastSlot)
+	{
+		uint32_t movedInstance = m_slotInstanceTable[draw.instanceOffset + lastSlot];
+		m_instanceRecords[movedInstance].slot = record.slot;
+		m_slotInstanceTable[draw.instanceOffset + record.slot] = movedInstance;
+		SetInstanceSlotDirty(draw.instanceOffset + record.slot);
+	}
+	m_slotInstanceTable[draw.instanceOffset + lastSlot] = NULL_RECORD;
+
+	draw.instanceCount--;
+	record.drawIndex = NULL_RECORD;
+
+	if (draw.instanceCount == 0)
+		RemoveDrawRecord(drawIndex);
+	else if (!draw.manualInstance)
+	{
+		m_indirectCmds[drawIndex].instanceCount = draw.instanceCount;
+		SetDrawDirty(drawIndex);
+	}
+}
+
+void Material::SetDrawDirty(uint32_t drawIndex)
+{
+	// Every frame has its own indirect buffer, and each of them has to catch up
+	if (m_drawDirtyFrames[drawIndex] == 0)
+		m_dirtyDraws.push_back(drawIndex);
+	m_drawDirtyFrames[drawIndex] = (1 << (uint32_t)m_indirectBuffers.size()) - 1;
+}
+
+void Material::SetInstanceSlotDirty(uint32_t slot)
+{
+	// Duplicates are removed at sync
+	m_dirtyInstanceSlots.push_back(slot);
+}
+
+void Material::SyncIndirectData()
+{
+	// Renderers not inserted this frame are gone, e.g. culled or destroyed
+	for (uint32_t instance = 0; instance < (uint32_t)m_instanceRecords.size(); instance++)
+	{
+		if (m_instanceRecords[instance].frameStamp == 0 || m_instanceRecords[instance].frameStamp == m_frameStamp)
+			continue;
+
+		if (m_instanceRecords[instance].drawIndex != NULL_RECORD)
+			RemoveInstanceFromDraw(instance);
+		FreeInstanceRecord(instance);
+	}
+
+	SortDraws();
+
+	// Write changed slots in consecutive runs, per material uniforms sync them to every frame
+	if (!m_dirtyInstanceSlots.empty())
+	{
+		std::sort(m_dirtyInstanceSlots.begin(), m_dirtyInstanceSlots.end());
+
+		std::vector<PerMaterialIndirectVariables> runData;
+		uint32_t runStart = 0;
+		for (uint32_t i = 0; i <= (uint32_t)m_dirtyInstanceSlots.size(); i++)
+		{
+			bool endOfList = i == (uint32_t)m_dirtyInstanceSlots.size();
+			uint32_t slot = endOfList ? 0 : m_dirtyInstanceSlots[i];
+
+			// Duplicated slot
+			if (!endOfList && !runData.empty() && slot == runStart + runData.size() - 1)
+				continue;
+
+			// Slot is freed after it's marked dirty, nothing to write
+			bool used = !endOfList && m_slotInstanceTable[slot] != NULL_RECORD;
+
+			if (!runData.empty() && (!used || slot != runStart + runData.size()))
 			{
-				pMesh,
-				instanceCount,
-				startInstance,
-				std::vector<PerMaterialIndirectVariables>(1, {perObjectIndex, perMaterialIndex, perMeshIndex, utilityIndex })
+				m_pPerMaterialIndirectUniforms->SetIndirectVariables(runStart, &runData[0], (uint32_t)runData.size());
+				runData.clear();
 			}
-		);
 
-		// Then add mesh to ref table, as well as its index in render data table
-		// Ref table is only updated when auto instanced rendering is enabled
-		// Or there's no need to search this mesh and add it to instance count
-		// NOTE: Only add to ref table if it's not manual instanced rendering
-		if (!manualInstance)
-			m_perFrameMeshRefTable[pMesh] = (uint32_t)m_cachedMeshRenderData.size() - 1;
+			if (!used)
+				continue;
+
+			if (runData.empty())
+				runStart = slot;
+			runData.push_back(m_instanceRecords[m_slotInstanceTable[slot]].indices);
+		}
+
+		m_dirtyInstanceSlots.clear();
+	}
+
+	uint32_t frameIndex = FrameMgr()->FrameIndex();
+	uint32_t frameBit = 1 << frameIndex;
+	uint32_t drawCount = (uint32_t)m_drawRecords.size();
+
+	// Write changed commands of this frame in consecutive runs, draws still dirty for other frames stay in list
+	std::sort(m_dirtyDraws.begin(), m_dirtyDraws.end());
+	m_dirtyDraws.erase(std::unique(m_dirtyDraws.begin(), m_dirtyDraws.end()), m_dirtyDraws.end());
+
+	uint32_t runStart = 0;
+	uint32_t runCount = 0;
+	uint32_t keptCount = 0;
+	for (uint32_t i = 0; i < (uint32_t)m_dirtyDraws.size(); i++)
+	{
+		uint32_t drawIndex = m_dirtyDraws[i];
+		if (drawIndex >= drawCount)
+			continue;
+
+		if ((m_drawDirtyFrames[drawIndex] & frameBit) != 0)
+		{
+			if (runCount > 0 && drawIndex != runStart + runCount)
+			{
+				m_indirectBuffers[frameIndex]->SetIndirectCmds(runStart, &m_indirectCmds[runStart], runCount);
+				runCount = 0;
+			}
 
+			if (runCount == 0)
+				runStart = drawIndex;
+			runCount++;
+
+			m_drawDirtyFrames[drawIndex] &= ~frameBit;
+		}
+
+		if (m_drawDirtyFrames[drawIndex] != 0)
+			m_dirtyDraws[keptCount++] = drawIndex;
+	}
+	m_dirtyDraws.resize(keptCount);
+
+	if (runCount > 0)
+		m_indirectBuffers[frameIndex]->SetIndirectCmds(runStart, &m_indirectCmds[runStart], runCount);
+
+	if (m_uploadedDrawCounts[frameIndex] != drawCount)
+	{
+		m_indirectCmdCountBuffers[frameIndex]->SetIndirectCmdCount(drawCount);
+		m_uploadedDrawCounts[frameIndex] = drawCount;
+	}
+
+	// Zero marks a free record
+	if (++m_frameStamp == 0)
+		m_frameStamp = 1;
+}
+
+void Material::SortDraws()
+{
+	uint32_t drawCount = (uint32_t)m_drawRecords.size();
+	if (drawCount < 2)
+		return;
+
+	m_drawSortKeys.resize(drawCount);
+	for (uint32_t i = 0; i < drawCount; i++)
+	{
+		const DrawRecord& draw = m_drawRecords[i];
+		m_drawSortKeys[i] = m_drawSortPrefix | DrawSortKey::Encode(0, 0, 0, DrawSortKey::DepthBucket(draw.nearestDepth), draw.pMesh->GetMeshChunkIndex());
+	}
+
+	DrawSortKey::RadixSort(m_drawSortKeys, m_drawSortOrder, m_drawSortScratch);
+
+	// Sort is stable, draws of equal keys stay where they are, so order only changes when keys cross each other
+	uint32_t firstMoved = 0;
+	while (firstMoved < drawCount && m_drawSortOrder[firstMoved] == firstMoved)
+		firstMoved++;
+
+	if (firstMoved == drawCount)
 		return;
+
+	std::vector<DrawRecord> sortedDraws(drawCount - firstMoved);
+	std::vector<VkDrawIndexedIndirectCommand> sortedCmds(drawCount - firstMoved);
+	for (uint32_t i = firstMoved; i < drawCount; i++)
+	{
+		sortedDraws[i - firstMoved] = m_drawRecords[m_drawSortOrder[i]];
+		sortedCmds[i - firstMoved] = m_indirectCmds[m_drawSortOrder[i]];
 	}
 
-	// If a mesh is already recorded, add instance count by 1
-	auto& renderData = m_cachedMeshRenderData[iter->second];
-	renderData.instanceCount += 1;
-	renderData.indirectIndices.push_back({ perObjectIndex, perMaterialIndex, perMeshIndex, utilityIndex });
+	for (uint32_t i = firstMoved; i < drawCount; i++)
+	{
+		m_drawRecords[i] = sortedDraws[i - firstMoved];
+		m_indirectCmds[i] = sortedCmds[i - firstMoved];
+
+		if (m_drawSortOrder[i] == i)
+			continue;
+
+		const DrawRecord& draw = m_drawRecords[i];
+		for (uint32_t j = 0; j < draw.instanceCount; j++)
+			m_instanceRecords[m_slotInstanceTable[draw.instanceOffset + j]].drawIndex = i;
+
+		if (!draw.manualInstance)
+			m_autoInstanceDrawTable[draw.pMesh.get()] = i;
+
+		m_pPerMaterialIndirectOffset->SetIndirectOffset(i, draw.instanceOffset);
+		SetDrawDirty(i);
+	}
 }
 
 void Material::BeforeRenderPass(const std::shared_ptr<CommandBuffer>& pCmdBuf, uint32_t pingpong)
@@ -567,7 +982,10 @@ void Material::DrawIndirect(const std::shared_ptr<CommandBuffer>& pCmdBuf, const
 	if (m_indirectBuffers.size() == 0)
 		return;
 
-	std::shared_ptr<CommandBuffer> pSecondaryCmd = MainThreadPerFrameRes()->AllocatePersistantSecondaryCommandBuffer();
+	if (ExecuteRecordedCommandBuffer(pCmdBuf, pFrameBuffer, pingpong))
+		return;
+
+	std::shared_ptr<CommandBuffer> pSecondaryCmd = AllocateSecondaryCommandBuffer();
 
 	pSecondaryCmd->StartSecondaryRecording(m_pRenderPass->GetRenderPass(), m_pPipeline->GetSubpassIndex(), pFrameBuffer);
 
@@ -577,12 +995,15 @@ void Material::DrawIndirect(const std::shared_ptr<CommandBuffer>& pCmdBuf, const
 
 	pSecondaryCmd->EndSecondaryRecording();
 
-	pCmdBuf->Execute({ pSecondaryCmd });
+	ExecuteSecondaryCommandBuffer(pCmdBuf, pSecondaryCmd, pFrameBuffer, pingpong);
 }
 
 void Material::DrawScreenQuad(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong, bool overrideVP)
 {
-	std::shared_ptr<CommandBuffer> pSecondaryCmd = MainThreadPerFrameRes()->AllocatePersistantSecondaryCommandBuffer();
+	if (ExecuteRecordedCommandBuffer(pCmdBuf, pFrameBuffer, pingpong))
+		return;
+
+	std::shared_ptr<CommandBuffer> pSecondaryCmd = AllocateSecondaryCommandBuffer();
 
 	pSecondaryCmd->StartSecondaryRecording(m_pRenderPass->GetRenderPass(), m_pPipeline->GetSubpassIndex(), pFrameBuffer);
 
@@ -592,7 +1013,56 @@ void Material::DrawScreenQuad(const std::shared_ptr<CommandBuffer>& pCmdBuf, con
 
 	pSecondaryCmd->EndSecondaryRecording();
 
-	pCmdBuf->Execute({ pSecondaryCmd });
+	ExecuteSecondaryCommandBuffer(pCmdBuf, pSecondaryCmd, pFrameBuffer, pingpong);
+}
+
+void Material::RecordDraw(const std::shared_ptr<PerFrameResource>& pPerFrameRes, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong, bool overrideVP)
+{
+	m_pRecordingPerFrameRes = pPerFrameRes;
+	Draw(nullptr, pFrameBuffer, pingpong, overrideVP);
+	m_pRecordingPerFrameRes = nullptr;
+}
+
+void Material::RecordDrawScreenQuad(const std::shared_ptr<PerFrameResource>& pPerFrameRes, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong, bool overrideVP)
+{
+	m_pRecordingPerFrameRes = pPerFrameRes;
+	DrawScreenQuad(nullptr, pFrameBuffer, pingpong, overrideVP);
+	m_pRecordingPerFrameRes = nullptr;
+}
+
+std::shared_ptr<CommandBuffer> Material::AllocateSecondaryCommandBuffer() const
+{
+	// Command pool of a per frame resource is only used by its owner thread
+	if (m_pRecordingPerFrameRes != nullptr)
+		return m_pRecordingPerFrameRes->AllocatePersistantSecondaryCommandBuffer();
+
+	return MainThreadPerFrameRes()->AllocatePersistantSecondaryCommandBuffer();
+}
+
+bool Material::ExecuteRecordedCommandBuffer(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong)
+{
+	if (m_pRecordingPerFrameRes != nullptr)
+		return false;
+
+	for (auto& recorded : m_recordedCmdBuffers)
+	{
+		if (recorded.isExecuted || recorded.pFrameBuffer != pFrameBuffer || recorded.pingpong != pingpong)
+			continue;
+
+		pCmdBuf->Execute({ recorded.pCmdBuffer });
+		recorded.isExecuted = true;
+		return true;
+	}
+	return false;
+}
+
+void Material::ExecuteSecondaryCommandBuffer(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<CommandBuffer>& pSecondaryCmd, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong)
+{
+	// Recorded ahead, it's executed by a later draw call to the same frame buffer
+	if (m_pRecordingPerFrameRes != nullptr)
+		m_recordedCmdBuffers.push_back({ pSecondaryCmd, pFrameBuffer, pingpong, false });
+	else
+		pCmdBuf->Execute({ pSecondaryCmd });
 }
 
 void Material::Dispatch(const std::shared_ptr<CommandBuffer>& pCmdBuf, uint32_t pingpong)
@@ -609,9 +1079,10 @@ void Material::OnFrameEnd()
 {
 	//m_indirectIndex = 0;
 
-	// Clear tables that are used to construct indirect buffer of current frame
-	m_perFrameMeshRefTable.clear();
-	m_cachedMeshRenderData.clear();
+	// Command buffers recorded ahead are referenced by primary command buffer now, none of them should be left behind
+	for (auto& recorded : m_recordedCmdBuffers)
+		ASSERTION(recorded.isExecuted);
+	m_recordedCmdBuffers.clear();
 }
 
 void Material::SetPerObjectIndex(uint32_t indirectIndex, uint32_t perObjectIndex)
@@ -9,6 +9,7 @@
 #include "../common/Enums.h"
 #include "../Maths/Vector3.h"
 #include "PerMaterialIndirectUniforms.h"
+#include "DrawSortKey.h"
 
 #include "../vulkan/Buffer.h"
 
@@ -27,6 +28,7 @@ class Image;
 class SharedIndirectBuffer;
 class FrameBuffer;
 class RenderPassBase;
+class PerFrameResource;
 
 // More to add
 enum MaterialVariableType
@@ -118,6 +120,11 @@ public:
 	virtual void DrawIndirect(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0, bool overrideVP = false);
 	virtual void DrawScreenQuad(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0, bool overrideVP = false);
 
+	// Record secondary command buffers of Draw/DrawScreenQuad ahead, with per frame resource of the recording thread
+	// Later Draw/DrawScreenQuad calls of this frame to the same frame buffer execute recorded ones in the same order, instead of recording them
+	void RecordDraw(const std::shared_ptr<PerFrameResource>& pPerFrameRes, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0, bool overrideVP = false);
+	void RecordDrawScreenQuad(const std::shared_ptr<PerFrameResource>& pPerFrameRes, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0, bool overrideVP = false);
+
 	virtual void Dispatch(const std::shared_ptr<CommandBuffer>& pCmdBuf, uint32_t pingpong = 0);
 	virtual void AfterRenderPass(const std::shared_ptr<CommandBuffer>& pCmdBuf, uint32_t pingpong = 0);
 
@@ -134,6 +141,11 @@ protected:
 	virtual void PrepareCommandBuffer(const std::shared_ptr<CommandBuffer>& pSecondaryCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, bool isCompute, uint32_t pingpong = 0, bool overrideVP = false);
 	virtual void CustomizeCommandBuffer(const std::shared_ptr<CommandBuffer>& pSecondaryCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong = 0) {}
 
+	std::shared_ptr<CommandBuffer> AllocateSecondaryCommandBuffer() const;
+	// Recorded command buffers are matched by frame buffer and pingpong, so that passes drawing the same material don't take each other's
+	bool ExecuteRecordedCommandBuffer(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong);
+	void ExecuteSecondaryCommandBuffer(const std::shared_ptr<CommandBuffer>& pCmdBuf, const std::shared_ptr<CommandBuffer>& pSecondaryCmd, const std::shared_ptr<FrameBuffer>& pFrameBuffer, uint32_t pingpong);
+
 protected:
 	void GeneralInit
 	(
@@ -182,16 +194,53 @@ protected:
 	virtual void CustomizePoolSize(std::vector<uint32_t>& counts) {}
 
 	static uint32_t GetByteSize(std::vector<UniformVar>& UBOLayout);
+	void UpdateCachedFrameOffsets();
+	void UpdateUniformStorageDescriptorSet();
+	void ReallocateUniformStorageDescriptorSet();
+	void SyncUniformBufferVersion();
+	uint32_t AcquireUniformBufferVersion() const;
 	void InsertIntoRenderQueue(const std::shared_ptr<Mesh>& pMesh, uint32_t perObjectIndex, uint32_t perMaterialIndex, uint32_t perMeshIndex, uint32_t utilityIndex, uint32_t instanceCount, uint32_t startInstance);
 
+	uint32_t AllocateInstanceRecord(uint32_t perObjectIndex);
+	void FreeInstanceRecord(uint32_t instance);
+	uint32_t CreateDrawRecord(const std::shared_ptr<Mesh>& pMesh, bool manualInstance, uint32_t instanceCount, uint32_t startInstance);
+	void RemoveDrawRecord(uint32_t drawIndex);
+	void GrowDrawInstanceCapacity(uint32_t drawIndex);
+	void AddInstanceToDraw(uint32_t instance, uint32_t drawIndex);
+	void RemoveInstanceFromDraw(uint32_t instance);
+	void SetDrawDirty(uint32_t drawIndex);
+	void SetInstanceSlotDirty(uint32_t slot);
+	// Remove instances that aren't inserted this frame, then write changed ranges to indirect buffers
+	void SyncIndirectData();
+	void UpdateDrawDepth(uint32_t drawIndex, float depth);
+	// Reorder draws by sort key, only draws that change place are written again
+	void SortDraws();
+
 protected:
-	typedef struct _MeshRenderData
+	static const uint32_t NULL_RECORD = 0xffffffff;
+
+	// A draw lives across frames as long as it has instances
+	// Its instances are consecutive in "PerMaterialIndirectVariables", starting from "instanceOffset"
+	typedef struct _DrawRecord
 	{
-		std::shared_ptr<Mesh>						pMesh;
-		uint32_t									instanceCount;
-		uint32_t									instanceDataOffset;
-		std::vector<PerMaterialIndirectVariables>	indirectIndices;
-	}MeshRenderData;
+		std::shared_ptr<Mesh>	pMesh;
+		bool					manualInstance;
+		uint32_t				instanceCount;
+		uint32_t				instanceOffset;
+		uint32_t				instanceCapacity;
+		float					nearestDepth;	// View space depth of the nearest instance inserted in "depthStamp" frame
+		uint32_t				depthStamp;
+	}DrawRecord;
+
+	// A (mesh, renderer) pair in render queue, renderer is identified by its per object chunk index
+	typedef struct _InstanceRecord
+	{
+		PerMaterialIndirectVariables	indices;
+		uint32_t						drawIndex;		// NULL_RECORD if record is free
+		uint32_t						slot;			// Index among instances of its draw
+		uint32_t						frameStamp;		// Stamp of the last frame it's inserted
+		uint32_t						nextInstance;	// Next record of the same renderer, if it's inserted more than once
+	}InstanceRecord;
 
 	std::shared_ptr<RenderPassBase>						m_pRenderPass;
 
@@ -201,21 +250,45 @@ protected:
 	std::shared_ptr<DescriptorSetLayout>				m_pDescriptorSetLayout;
 	std::shared_ptr<DescriptorSet>						m_pUniformStorageDescriptorSet;
 	std::shared_ptr<DescriptorPool>						m_pDescriptorPool;
+	std::vector<VkDescriptorPoolSize>					m_descriptorPoolSizes;
 	std::vector<std::shared_ptr<DescriptorSet>>			m_descriptorSets;	// Including descriptor sets from uniform data, and "m_pDescriptorSet" of this class
 
 	std::vector<UniformVarList>							m_materialVariableLayout;
 
 	std::vector<std::shared_ptr<UniformDataStorage>>	m_materialUniforms;
 	std::vector<std::vector<uint32_t>>					m_cachedFrameOffsets;
+	uint32_t											m_uniformBufferVersion = 0;
 
 	std::shared_ptr<PerMaterialIndirectOffsetUniforms>	m_pPerMaterialIndirectOffset;
 	std::shared_ptr<PerMaterialIndirectUniforms>		m_pPerMaterialIndirectUniforms;
 	std::shared_ptr<PerMaterialUniforms>				m_pPerMaterialUniforms;
 
-	// key: mesh, value: mesh index at "m_cachedMeshRenderData"
-	std::unordered_map<std::shared_ptr<Mesh>, uint32_t>	m_perFrameMeshRefTable;
-
-	std::vector<MeshRenderData>							m_cachedMeshRenderData;
+	std::vector<DrawRecord>								m_drawRecords;
+	// Host copy of indirect commands, index matches "m_drawRecords"
+	std::vector<VkDrawIndexedIndirectCommand>			m_indirectCmds;
+	// Per draw, mask of frames whose indirect buffer doesn't have its latest command yet
+	std::vector<uint32_t>								m_drawDirtyFrames;
+	std::vector<uint32_t>								m_dirtyDraws;
+	// Per frame, draw count in indirect count buffer
+	std::vector<uint32_t>								m_uploadedDrawCounts;
+
+	std::vector<InstanceRecord>							m_instanceRecords;
+	std::vector<uint32_t>								m_freeInstanceRecords;
+	// Key: per object chunk index, value: first instance record of that renderer
+	std::vector<uint32_t>								m_objectInstanceTable;
+	// Key: slot in "PerMaterialIndirectVariables", value: instance record
+	std::vector<uint32_t>								m_slotInstanceTable;
+	// Slots changed since last sync, coalesced into ranges before they're written
+	std::vector<uint32_t>								m_dirtyInstanceSlots;
+	// Key: mesh, value: auto instanced draw of that mesh, only looked up when a new instance comes in
+	std::unordered_map<Mesh*, uint32_t>					m_autoInstanceDrawTable;
+	uint32_t											m_frameStamp = 1;
+
+	// Pass, pipeline and descriptor set fields of sort keys, plus scratch of per frame sort
+	uint64_t											m_drawSortPrefix = 0;
+	std::vector<uint64_t>								m_drawSortKeys;
+	std::vector<uint32_t>								m_drawSortOrder;
+	std::vector<uint32_t>								m_drawSortScratch;
 
 	bool												m_isScreenMaterial;
 
@@ -229,5 +302,16 @@ protected:
 
 	Vector3ui											m_computeGroupSize;
 
+	// Per frame resource of the thread recording ahead, nullptr if recording happens at draw time
+	std::shared_ptr<PerFrameResource>					m_pRecordingPerFrameRes;
+	typedef struct _RecordedCmdBuffer
+	{
+		std::shared_ptr<CommandBuffer>	pCmdBuffer;
+		std::shared_ptr<FrameBuffer>	pFrameBuffer;
+		uint32_t						pingpong;
+		bool							isExecuted;
+	}RecordedCmdBuffer;
+	std::vector<RecordedCmdBuffer>						m_recordedCmdBuffers;
+
 	friend class MaterialInstance;
 };
\ No newline at end of file
@@ -31,6 +31,28 @@ bool Mesh::Init
 	m_pIndexBuffer = SharedIndexBuffer::Create(GetDevice(), indicesCount * GetIndexBytes(indexType), indexType);
 	m_pIndexBuffer->UpdateByteStream(pIndices, 0, indicesCount * GetIndexBytes(indexType));
 
+	// Position is always the first attribute of a vertex
+	if ((vertexFormat & (1 << VAFPosition)) && m_verticesCount > 0)
+	{
+		const float* pPosition = (const float*)pVertices;
+		Vector3d minPosition = { pPosition[0], pPosition[1], pPosition[2] };
+		Vector3d maxPosition = minPosition;
+
+		for (uint32_t i = 1; i < m_verticesCount; i++)
+		{
+			pPosition = (const float*)((const uint8_t*)pVertices + i * m_vertexBytes);
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				minPosition[j] = pPosition[j] < minPosition[j] ? pPosition[j] : minPosition[j];
+				maxPosition[j] = pPosition[j] > maxPosition[j] ? pPosition[j] : maxPosition[j];
+			}
+		}
+
+		m_boundingBoxCenter = (minPosition + maxPosition) * 0.5;
+		m_boundingBoxExtent = (maxPosition - minPosition) * 0.5;
+		m_hasBoundingBox = true;
+	}
+
 	return true;
 }
 
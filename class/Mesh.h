@@ -34,6 +34,11 @@ public:
 	uint32_t GetBoneCount() const { return m_boneCount; }
 	void PrepareIndirectCmd(VkDrawIndexedIndirectCommand& cmd);
 
+	// Local space axis aligned bounding box, computed from vertex positions
+	bool HasBoundingBox() const { return m_hasBoundingBox; }
+	Vector3d GetBoundingBoxCenter() const { return m_boundingBoxCenter; }
+	Vector3d GetBoundingBoxExtent() const { return m_boundingBoxExtent; }
+
 protected:
 	bool Init
 	(
@@ -50,5 +55,8 @@ protected:
 	uint32_t							m_indicesCount;
 	uint32_t							m_meshChunkIndex = -1;
 	uint32_t							m_meshBoneChunkIndexOffset;
-	uint32_t							m_boneCount;
+	uint32_t							m_boneCount = 0;
+	bool								m_hasBoundingBox = false;
+	Vector3d							m_boundingBoxCenter;
+	Vector3d							m_boundingBoxExtent;	// Half size
 };
\ No newline at end of file
@@ -32,6 +32,11 @@ void PerFrameBuffer::SetDirty()
 	PerFrameDataStorage::SetDirty();
 }
 
+void PerFrameBuffer::SetDirty(uint32_t offset, uint32_t numBytes)
+{
+	PerFrameDataStorage::SetDirty(offset, numBytes);
+}
+
 PerFrameData::PerFrameDataKey::~PerFrameDataKey()
 {
 	m_pPerFrameData->DeallocateBuffer(key);
@@ -23,6 +23,8 @@ public:
 	const void* AcquireDataPtr() const { return m_pData; }
 	uint32_t AcquireDataSize() const override { return GetFrameOffset(); }
 	void SetDirty();
+	// Only this range is uploaded to each frame
+	void SetDirty(uint32_t offset, uint32_t numBytes);
 
 private:
 	void*	m_pData;
@@ -1,9 +1,14 @@
 #include "../vulkan/SwapChain.h"
 #include "../vulkan/GlobalDeviceObjects.h"
+#include "../vulkan/FrameManager.h"
 #include "../vulkan/UniformBuffer.h"
 #include "../vulkan/ShaderStorageBuffer.h"
 #include "../vulkan/StreamingBuffer.h"
 #include "PerFrameDataStorage.h"
+#include <algorithm>
+
+uint32_t PerFrameDataStorage::m_uploadedBytes = 0;
+uint32_t PerFrameDataStorage::m_reallocationCount = 0;
 
 bool PerFrameDataStorage::Init(const std::shared_ptr<PerFrameDataStorage>& pSelf, uint32_t numBytes, StorageType storageType)
 {
@@ -12,12 +17,22 @@ bool PerFrameDataStorage::Init(const std::shared_ptr<PerFrameDataStorage>& pSelf
 
 	m_pendingSync.resize(GetSwapChain()->GetSwapChainImageCount(), true);
 	m_pendingSyncCount = 0;
+	m_dirtyRanges.resize(GetSwapChain()->GetSwapChainImageCount());
+	m_fullSyncRequired.resize(GetSwapChain()->GetSwapChainImageCount(), false);
+
+	m_storageType = storageType;
+	CreateBuffer(numBytes);
+
+	return true;
+}
 
+void PerFrameDataStorage::CreateBuffer(uint32_t numBytes)
+{
 	uint32_t minAlign = (uint32_t)GetPhysicalDevice()->GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
 	m_frameOffset = numBytes / minAlign * minAlign + (numBytes % minAlign > 0 ? minAlign : 0);
 	uint32_t totalUniformBytes = m_frameOffset * GetSwapChain()->GetSwapChainImageCount();
 
-	switch (storageType)
+	switch (m_storageType)
 	{
 	case Uniform:
 		m_pBuffer = UniformBuffer::Create(GetDevice(), totalUniformBytes);
@@ -34,11 +49,36 @@ bool PerFrameDataStorage::Init(const std::shared_ptr<PerFrameDataStorage>& pSelf
 		break;
 	}
 
-	return true;
+	ASSERTION(m_pBuffer != nullptr);
+}
+
+void PerFrameDataStorage::ResizeBuffer(uint32_t numBytes)
+{
+	if (numBytes > m_pendingResizeBytes)
+		m_pendingResizeBytes = numBytes;
+}
+
+void PerFrameDataStorage::ReallocateBuffer()
+{
+	// Frames in flight may still read old buffer, it's released once they're all done on GPU
+	// Descriptor sets referencing it are replaced rather than updated in place, see "GetBufferVersion"
+	FrameMgr()->RetireResource(m_pBuffer);
+	m_pBuffer = nullptr;
+
+	CreateBuffer(m_pendingResizeBytes);
+	m_pendingResizeBytes = 0;
+	m_bufferVersion++;
+	m_reallocationCount++;
+
+	// New buffer has nothing inside, upload all frames again
+	SetDirty();
 }
 
 void PerFrameDataStorage::SyncBufferData()
 {
+	if (m_pendingResizeBytes > 0)
+		ReallocateBuffer();
+
 	if (m_pendingSyncCount == 0)
 		return;
 
@@ -55,13 +95,87 @@ void PerFrameDataStorage::SyncBufferDataInternal()
 	if (m_pendingSync[currentFrameIndex])
 		return;
 
-	GetBuffer()->UpdateByteStream(AcquireDataPtr(), currentFrameIndex * GetFrameOffset(), AcquireDataSize());
+	const uint8_t* pData = (const uint8_t*)AcquireDataPtr();
+	uint32_t dataSize = AcquireDataSize();
+	uint32_t frameBase = currentFrameIndex * GetFrameOffset();
+
+	std::vector<DirtyRange>& ranges = m_dirtyRanges[currentFrameIndex];
+
+	if (m_fullSyncRequired[currentFrameIndex])
+	{
+		GetBuffer()->UpdateByteStream(pData, frameBase, dataSize);
+		m_uploadedBytes += dataSize;
+	}
+	else if (ranges.size() > 0)
+	{
+		// Sort and merge overlapped or adjacent ranges in place
+		std::sort(ranges.begin(), ranges.end(), [](const DirtyRange& a, const DirtyRange& b) { return a.offset < b.offset; });
+
+		uint32_t mergedCount = 0;
+		for (uint32_t i = 1; i < ranges.size(); i++)
+		{
+			DirtyRange& merged = ranges[mergedCount];
+			uint32_t mergedEnd = merged.offset + merged.numBytes;
+			if (ranges[i].offset <= mergedEnd)
+			{
+				uint32_t end = ranges[i].offset + ranges[i].numBytes;
+				merged.numBytes = (end > mergedEnd ? end : mergedEnd) - merged.offset;
+			}
+			else
+				ranges[++mergedCount] = ranges[i];
+		}
+		ranges.resize(mergedCount + 1);
+
+		for (auto& range : ranges)
+		{
+			if (range.offset >= dataSize)
+				continue;
+
+			uint32_t numBytes = range.offset + range.numBytes > dataSize ? dataSize - range.offset : range.numBytes;
+			GetBuffer()->UpdateByteStream(pData + range.offset, frameBase + range.offset, numBytes);
+			m_uploadedBytes += numBytes;
+		}
+	}
+
+	ranges.clear();
+	m_fullSyncRequired[currentFrameIndex] = false;
 
 	m_pendingSync[currentFrameIndex] = true;
 	m_pendingSyncCount--;
 }
 
 void PerFrameDataStorage::SetDirty()
+{
+	for (uint32_t i = 0; i < m_pendingSync.size(); i++)
+	{
+		m_fullSyncRequired[i] = true;
+		m_dirtyRanges[i].clear();
+	}
+
+	MarkFramesPendingSync();
+}
+
+void PerFrameDataStorage::SetDirty(uint32_t offset, uint32_t numBytes)
+{
+	for (uint32_t i = 0; i < m_pendingSync.size(); i++)
+	{
+		if (m_fullSyncRequired[i])
+			continue;
+
+		if (m_dirtyRanges[i].size() >= MAX_DIRTY_RANGES_PER_FRAME)
+		{
+			m_fullSyncRequired[i] = true;
+			m_dirtyRanges[i].clear();
+			continue;
+		}
+
+		m_dirtyRanges[i].push_back({ offset, numBytes });
+	}
+
+	MarkFramesPendingSync();
+}
+
+void PerFrameDataStorage::MarkFramesPendingSync()
 {
 	m_pendingSyncCount = (uint32_t)m_pendingSync.size();
 	for (uint32_t i = 0; i < m_pendingSyncCount; i++)
@@ -11,6 +11,12 @@ enum MaterialVariableType;
 
 class PerFrameDataStorage : public SelfRefBase<PerFrameDataStorage>
 {
+	typedef struct _DirtyRange
+	{
+		uint32_t	offset;
+		uint32_t	numBytes;
+	}DirtyRange;
+
 public:
 	enum StorageType
 	{
@@ -32,6 +38,14 @@ public:
 	uint32_t GetFrameOffset() const { return m_frameOffset; }
 	void SyncBufferData();
 	std::shared_ptr<BufferBase> GetBuffer() const;
+	// Increased each time buffer is reallocated, descriptor sets and frame offsets referencing it should be updated then
+	uint32_t GetBufferVersion() const { return m_bufferVersion; }
+
+	// Bytes uploaded by all storages since last reset, to see how much dirty range tracking saves
+	static uint32_t GetUploadedBytes() { return m_uploadedBytes; }
+	static void ResetUploadedBytes() { m_uploadedBytes = 0; }
+	// Increased each time any storage reallocates, command buffers recorded with old buffers should be recorded again
+	static uint32_t GetReallocationCount() { return m_reallocationCount; }
 
 protected:
 	virtual void UpdateUniformDataInternal() = 0;
@@ -39,7 +53,16 @@ protected:
 	virtual void SetDirtyInternal() = 0;
 	virtual const void* AcquireDataPtr() const = 0;
 	virtual uint32_t AcquireDataSize() const = 0;
+	// Whole data is uploaded to each frame
 	void SetDirty();
+	// Only dirty ranges are uploaded to each frame, they're merged before upload
+	void SetDirty(uint32_t offset, uint32_t numBytes);
+	void MarkFramesPendingSync();
+
+	// Reallocate buffer with new per frame bytes, it's deferred to next "SyncBufferData"
+	void ResizeBuffer(uint32_t numBytes);
+	void CreateBuffer(uint32_t numBytes);
+	void ReallocateBuffer();
 
 protected:
 	std::shared_ptr<BufferBase>	m_pBuffer;
@@ -47,4 +70,17 @@ protected:
 	std::vector<bool>			m_pendingSync;
 	uint32_t					m_pendingSyncCount;
 	uint32_t					m_frameOffset;
+	uint32_t					m_pendingResizeBytes = 0;
+	uint32_t					m_bufferVersion = 0;
+
+	// Per frame in flight, ranges of data not yet uploaded to that frame's region
+	std::vector<std::vector<DirtyRange>>	m_dirtyRanges;
+	// Per frame in flight, whether whole data needs uploading, dirty ranges are ignored then
+	std::vector<bool>			m_fullSyncRequired;
+
+	static uint32_t				m_uploadedBytes;
+	static uint32_t				m_reallocationCount;
+
+	// Too many ranges of a frame is handled as a full sync, to bound memory and sorting cost
+	static const uint32_t		MAX_DIRTY_RANGES_PER_FRAME = 4096;
 };
\ No newline at end of file
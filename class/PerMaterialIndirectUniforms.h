@@ -2,27 +2,10 @@
 
 #include "../Maths/Matrix.h"
 #include "ChunkBasedUniforms.h"
+#include "PerMaterialIndirectVariables.h"
 
 class DescriptorSet;
 
-// You can't directly map "gl_drawID" to the array "PerMaterialIndirectVariables" one by one,
-// as there could be more than 1 instance for a mesh, and they all share the same "gl_drawID"
-// Considering the fact described above, offset is added here serving as another indirect so that 
-// one could get a correct index of "PerMaterialIndirectVariables" with "DrawIDOffset[gl_drawID] + gl_instanceID"
-typedef struct _IndirectOffset
-{
-	uint32_t offset = 0;
-}IndirectOffset;
-
-// Variables that could indirect to specific data in shader
-typedef struct _PerMaterialIndirectVariables
-{
-	uint32_t perObjectIndex = 0;
-	uint32_t perMaterialIndex = 0;
-	uint32_t perMeshIndex = 0;
-	uint32_t utilityIndex = 0;
-}PerMaterialIndirectVariables;
-
 class PerMaterialIndirectOffsetUniforms : public ChunkBasedUniforms
 {
 public:
@@ -30,7 +13,7 @@ public:
 	static std::shared_ptr<PerMaterialIndirectOffsetUniforms> Create();
 
 public:
-	void SetIndirectOffset(uint32_t drawID, uint32_t indirectOffset) { m_indirectOffsets[drawID].offset = indirectOffset; SetChunkDirty(drawID); }
+	void SetIndirectOffset(uint32_t drawID, uint32_t indirectOffset) { EnsureChunkCapacity(drawID + 1); m_indirectOffsets[drawID].offset = indirectOffset; SetChunkDirty(drawID); }
 	uint32_t GetIndirectOffset(uint32_t drawID) const { return m_indirectOffsets[drawID].offset; }
 
 	std::vector<UniformVarList> PrepareUniformVarList() const override;
@@ -39,10 +22,11 @@ public:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_indirectOffsets[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_indirectOffsets); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_indirectOffsets.size() * sizeof(IndirectOffset)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_indirectOffsets.resize(chunkCapacity); }
 
 protected:
-	IndirectOffset	m_indirectOffsets[MAXIMUM_OBJECTS];
+	std::vector<IndirectOffset>	m_indirectOffsets;
 };
 
 
@@ -53,14 +37,16 @@ public:
 	static std::shared_ptr<PerMaterialIndirectUniforms> Create();
 
 public:
-	void SetPerObjectIndex(uint32_t indirectIndex, uint32_t perObjectIndex) { m_perMaterialIndirectIndex[indirectIndex].perObjectIndex = perObjectIndex; SetChunkDirty(indirectIndex); }
+	void SetPerObjectIndex(uint32_t indirectIndex, uint32_t perObjectIndex) { EnsureChunkCapacity(indirectIndex + 1); m_perMaterialIndirectIndex[indirectIndex].perObjectIndex = perObjectIndex; SetChunkDirty(indirectIndex); }
 	uint32_t GetPerObjectIndex(uint32_t indirectIndex) const { return m_perMaterialIndirectIndex[indirectIndex].perObjectIndex; }
-	void SetPerMaterialIndex(uint32_t indirectIndex, uint32_t perMaterialIndex) { m_perMaterialIndirectIndex[indirectIndex].perMaterialIndex = perMaterialIndex; SetChunkDirty(indirectIndex); }
+	void SetPerMaterialIndex(uint32_t indirectIndex, uint32_t perMaterialIndex) { EnsureChunkCapacity(indirectIndex + 1); m_perMaterialIndirectIndex[indirectIndex].perMaterialIndex = perMaterialIndex; SetChunkDirty(indirectIndex); }
 	uint32_t GetPerMaterialIndex(uint32_t indirectIndex) const { return m_perMaterialIndirectIndex[indirectIndex].perMaterialIndex; }
-	void SetPerMeshIndex(uint32_t indirectIndex, uint32_t perMeshIndex) { m_perMaterialIndirectIndex[indirectIndex].perMeshIndex = perMeshIndex; SetChunkDirty(indirectIndex); }
+	void SetPerMeshIndex(uint32_t indirectIndex, uint32_t perMeshIndex) { EnsureChunkCapacity(indirectIndex + 1); m_perMaterialIndirectIndex[indirectIndex].perMeshIndex = perMeshIndex; SetChunkDirty(indirectIndex); }
 	uint32_t GetPerMeshIndex(uint32_t indirectIndex) const { return m_perMaterialIndirectIndex[indirectIndex].perMeshIndex; }
-	void SetUtilityIndex(uint32_t indirectIndex, uint32_t utilityIndex) { m_perMaterialIndirectIndex[indirectIndex].utilityIndex = utilityIndex; SetChunkDirty(indirectIndex); }
+	void SetUtilityIndex(uint32_t indirectIndex, uint32_t utilityIndex) { EnsureChunkCapacity(indirectIndex + 1); m_perMaterialIndirectIndex[indirectIndex].utilityIndex = utilityIndex; SetChunkDirty(indirectIndex); }
 	uint32_t GetPerAnimationindex(uint32_t indirectIndex) const { return m_perMaterialIndirectIndex[indirectIndex].utilityIndex; }
+	// Write "count" consecutive entries at once, they're synced as a single range
+	void SetIndirectVariables(uint32_t indirectIndex, const PerMaterialIndirectVariables* pVariables, uint32_t count) { EnsureChunkCapacity(indirectIndex + count); memcpy(&m_perMaterialIndirectIndex[indirectIndex], pVariables, count * sizeof(PerMaterialIndirectVariables)); SetChunksDirty(indirectIndex, count); }
 
 	std::vector<UniformVarList> PrepareUniformVarList() const override;
 	uint32_t SetupDescriptorSet(const std::shared_ptr<DescriptorSet>& pDescriptorSet, uint32_t bindingIndex) const override;
@@ -68,8 +54,9 @@ public:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_perMaterialIndirectIndex[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_perMaterialIndirectIndex); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_perMaterialIndirectIndex.size() * sizeof(PerMaterialIndirectVariables)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_perMaterialIndirectIndex.resize(chunkCapacity); }
 
 protected:
-	PerMaterialIndirectVariables	m_perMaterialIndirectIndex[MAXIMUM_OBJECTS];
+	std::vector<PerMaterialIndirectVariables>	m_perMaterialIndirectIndex;
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// You can't directly map "gl_drawID" to the array "PerMaterialIndirectVariables" one by one,
+// as there could be more than 1 instance for a mesh, and they all share the same "gl_drawID"
+// Considering the fact described above, offset is added here serving as another indirect so that 
+// one could get a correct index of "PerMaterialIndirectVariables" with "DrawIDOffset[gl_drawID] + gl_instanceID"
+typedef struct _IndirectOffset
+{
+	uint32_t offset = 0;
+}IndirectOffset;
+
+// Variables that could indirect to specific data in shader
+typedef struct _PerMaterialIndirectVariables
+{
+	uint32_t perObjectIndex = 0;
+	uint32_t perMaterialIndex = 0;
+	uint32_t perMeshIndex = 0;
+	uint32_t utilityIndex = 0;
+}PerMaterialIndirectVariables;
+
+// Source of a draw that's culled and compacted(see IndirectDrawCullReference), which then writes the actual indirect command and offset
+// Instances are read from "instanceOffset", visible ones are written to "cullingOffset", where the draw actually reads them
+// Zero instance count means automatic instancing, instance count is decided by how many instances are visible
+typedef struct _IndirectDrawVariables
+{
+	// Same layout as "VkDrawIndexedIndirectCommand"
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+
+	uint32_t instanceOffset = 0;
+	uint32_t instanceRecordCount = 0;
+	uint32_t cullingOffset = 0;
+}IndirectDrawVariables;
\ No newline at end of file
@@ -13,17 +13,9 @@ bool PerMaterialUniforms::Init(const std::shared_ptr<PerMaterialUniforms>& pSelf
 	if (!ChunkBasedUniforms::Init(pSelf, numBytes))
 		return false;
 
-	m_pData = new uint8_t[GetFrameOffset()];
-	memset(m_pData, 0, GetFrameOffset());
-
 	return true;
 }
 
-PerMaterialUniforms::~PerMaterialUniforms()
-{
-	delete [] m_pData;
-}
-
 std::shared_ptr<PerMaterialUniforms> PerMaterialUniforms::Create(uint32_t numBytes)
 {
 	std::shared_ptr<PerMaterialUniforms> pPerMaterialUniforms = std::make_shared<PerMaterialUniforms>();
@@ -10,7 +10,6 @@ class PerMaterialUniforms : public ChunkBasedUniforms
 {
 public:
 	static std::shared_ptr<PerMaterialUniforms> Create(uint32_t numBytes);
-	~PerMaterialUniforms();
 
 public:
 	std::vector<UniformVarList> PrepareUniformVarList() const override { return {}; }
@@ -19,13 +18,13 @@ public:
 	template <typename T>
 	void SetParameter(uint32_t parameterChunkIndex, uint32_t parameterOffset, T val)
 	{
-		// m_pData : GetFrameOffset()            GetFrameOffset()            GetFrameOffset()
+		// m_data  : GetFrameOffset()            GetFrameOffset()            GetFrameOffset()
 		//           =======================     =======================     =======================
 		//                                            |
 		//                              chunkIndex * m_perMaterialInstanceBytes
 		//                                               |
 		//                                              offset
-		memcpy_s(m_pData + parameterChunkIndex * m_perChunkBytes + parameterOffset, sizeof(val), &val, sizeof(val));
+		memcpy_s(m_data.data() + parameterChunkIndex * m_perChunkBytes + parameterOffset, sizeof(val), &val, sizeof(val));
 		SetChunkDirty(parameterChunkIndex);
 	}
 
@@ -34,7 +33,7 @@ public:
 	{
 		//return m_pMaterial->GetParameter(bindingIndex, parameterIndex);
 		T ret;
-		memcpy_s(&ret, sizeof(ret), m_pData + parameterChunkIndex * m_perChunkBytes + parameterOffset, sizeof(T));
+		memcpy_s(&ret, sizeof(ret), m_data.data() + parameterChunkIndex * m_perChunkBytes + parameterOffset, sizeof(T));
 		return ret;
 	}
 
@@ -42,9 +41,10 @@ protected:
 	bool Init(const std::shared_ptr<PerMaterialUniforms>& pSelf, uint32_t numBytes);
 
 	void UpdateDirtyChunkInternal(uint32_t index) override;
-	const void* AcquireDataPtr() const override { return m_pData; }
-	uint32_t AcquireDataSize() const override { return GetFrameOffset(); }
+	const void* AcquireDataPtr() const override { return m_data.data(); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)m_data.size(); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override { m_data.resize(chunkCapacity * m_perChunkBytes, 0); }
 
 protected:
-	uint8_t*	m_pData;
+	std::vector<uint8_t>	m_data;
 };
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../Maths/Matrix.h"
+
+// Object space bounding box of a renderer, indexed by its per object chunk index, the same one "PerObjectUniforms" uses
+// "w" of center is 1 if the box could be culled, boxes of skinned or manually instanced renderers don't bound what's drawn
+typedef struct _PerObjectBoundsVariables
+{
+	Vector4f center;
+	Vector4f extent;
+}PerObjectBoundsVariables;
\ No newline at end of file
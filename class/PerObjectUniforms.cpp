@@ -4,6 +4,9 @@
 #include "../vulkan/Buffer.h"
 #include "../vulkan/DescriptorSet.h"
 #include "../vulkan/ShaderStorageBuffer.h"
+#include "../vulkan/FrameManager.h"
+#include "../thread/ThreadTaskQueue.hpp"
+#include "../Maths/SIMDMatrix.h"
 #include "UniformData.h"
 #include "Material.h"
 
@@ -30,32 +33,58 @@ void PerObjectUniforms::SetModelMatrix(uint32_t index, const Matrix4d& modelMatr
 	SetChunkDirty(index);
 }
 
+void PerObjectUniforms::OnChunkCapacityChanged(uint32_t chunkCapacity)
+{
+	m_perObjectVariables.resize(chunkCapacity);
+	m_singlePrecisionPerObjectVariables.resize(chunkCapacity);
+}
+
 void PerObjectUniforms::UpdateDirtyChunkInternal(uint32_t index)
 {
-	m_perObjectVariables[index].MVP = UniformData::GetInstance()->GetGlobalUniforms()->GetProjectionMatrix();
-	m_perObjectVariables[index].prevMVP = m_perObjectVariables[index].MVP;
-	m_perObjectVariables[index].MV_Rotation_P = m_perObjectVariables[index].MVP;
-	m_perObjectVariables[index].prevMV_Rotation_P = m_perObjectVariables[index].MVP;
+	UpdatePerObjectVariables(UniformData::GetInstance()->GetGlobalUniforms()->GetProjectionMatrix(), index);
+}
 
+void PerObjectUniforms::UpdateDirtyChunksInternal(const std::vector<uint32_t>& dirtyChunks)
+{
+	Matrix4d projection = UniformData::GetInstance()->GetGlobalUniforms()->GetProjectionMatrix();
 
-	m_perObjectVariables[index].MVP *= m_perObjectVariables[index].MV;
-	m_perObjectVariables[index].prevMVP *= m_perObjectVariables[index].prevMV;
+	if (dirtyChunks.size() < PARALLEL_UPDATE_THRESHOLD)
+	{
+		for (auto index : dirtyChunks)
+			UpdatePerObjectVariables(projection, index);
+		return;
+	}
+
+	// Dirty chunks are unique, so each chunk is written by only one job
+	GlobalThreadTaskQueue()->ParallelFor((uint32_t)dirtyChunks.size(), PARALLEL_UPDATE_GRAIN_SIZE, [this, &projection, &dirtyChunks](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>& pPerFrameRes)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+			UpdatePerObjectVariables(projection, dirtyChunks[i]);
+	}, FrameMgr()->FrameIndex());
+}
+
+void PerObjectUniforms::UpdatePerObjectVariables(const Matrix4d& projection, uint32_t index)
+{
+	PerObjectVariablesd& variables = m_perObjectVariables[index];
+	PerObjectVariablesf& singlePrecisionVariables = m_singlePrecisionPerObjectVariables[index];
 
+	MultiplyMatrix4x4(projection, variables.MV, variables.MVP);
+	MultiplyMatrix4x4(projection, variables.prevMV, variables.prevMVP);
 
-	Matrix4d temp = m_perObjectVariables[index].MV;
+	Matrix4d temp = variables.MV;
 	temp.c30 = temp.c31 = temp.c32 = 0;
-	m_perObjectVariables[index].MV_Rotation_P *= temp;
+	MultiplyMatrix4x4(projection, temp, variables.MV_Rotation_P);
 
-	temp = m_perObjectVariables[index].prevMV;
+	temp = variables.prevMV;
 	temp.c30 = temp.c31 = temp.c32 = 0;
-	m_perObjectVariables[index].prevMV_Rotation_P *= temp;
-
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], MV);
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], MVP);
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], MV_Rotation_P);
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], prevMV);
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], prevMVP);
-	CONVERT2SINGLE(m_perObjectVariables[index], m_singlePrecisionPerObjectVariables[index], prevMV_Rotation_P);
+	MultiplyMatrix4x4(projection, temp, variables.prevMV_Rotation_P);
+
+	ConvertMatrix4x4(variables.MV, singlePrecisionVariables.MV);
+	ConvertMatrix4x4(variables.MVP, singlePrecisionVariables.MVP);
+	ConvertMatrix4x4(variables.MV_Rotation_P, singlePrecisionVariables.MV_Rotation_P);
+	ConvertMatrix4x4(variables.prevMV, singlePrecisionVariables.prevMV);
+	ConvertMatrix4x4(variables.prevMVP, singlePrecisionVariables.prevMVP);
+	ConvertMatrix4x4(variables.prevMV_Rotation_P, singlePrecisionVariables.prevMV_Rotation_P);
 }
 
 std::vector<UniformVarList> PerObjectUniforms::PrepareUniformVarList() const
@@ -2,25 +2,10 @@
 
 #include "../Maths/Matrix.h"
 #include "ChunkBasedUniforms.h"
+#include "PerObjectVariables.h"
 
 class DescriptorSet;
 
-template <typename T>
-class PerObjectVariables
-{
-public:
-	Matrix4x4<T> MV;
-	Matrix4x4<T> MVP;			// projection * view * model
-	Matrix4x4<T> MV_Rotation_P;	// Model view only has rotation, no translation
-
-	Matrix4x4<T> prevMV;
-	Matrix4x4<T> prevMVP;
-	Matrix4x4<T> prevMV_Rotation_P;
-};
-
-typedef PerObjectVariables<float> PerObjectVariablesf;
-typedef PerObjectVariables<double> PerObjectVariablesd;
-
 class PerObjectUniforms : public ChunkBasedUniforms
 {
 protected:
@@ -39,12 +24,17 @@ public:
 
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
+	void UpdateDirtyChunksInternal(const std::vector<uint32_t>& dirtyChunks) override;
+	void UpdatePerObjectVariables(const Matrix4d& projection, uint32_t index);
 	const void* AcquireDataPtr() const override { return &m_singlePrecisionPerObjectVariables[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_singlePrecisionPerObjectVariables); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_singlePrecisionPerObjectVariables.size() * sizeof(PerObjectVariablesf)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override;
 
 protected:
-	PerObjectVariablesd		m_perObjectVariables[MAXIMUM_OBJECTS];
-	PerObjectVariablesf		m_singlePrecisionPerObjectVariables[MAXIMUM_OBJECTS];
+	std::vector<PerObjectVariablesd>	m_perObjectVariables;
+	std::vector<PerObjectVariablesf>	m_singlePrecisionPerObjectVariables;
 
-	std::vector<uint32_t>	m_dirtyChunks;
+	// Dirty chunks are split into jobs only if there're enough of them
+	static const uint32_t PARALLEL_UPDATE_THRESHOLD = 512;
+	static const uint32_t PARALLEL_UPDATE_GRAIN_SIZE = 128;
 };
\ No newline at end of file
@@ -28,6 +28,12 @@ std::shared_ptr<PerPlanetUniforms> PerPlanetUniforms::Create()
 	return nullptr;
 }
 
+void PerPlanetUniforms::OnChunkCapacityChanged(uint32_t chunkCapacity)
+{
+	m_perPlanetVariables.resize(chunkCapacity);
+	m_singlePrecisionPerPlanetVariables.resize(chunkCapacity);
+}
+
 void PerPlanetUniforms::SetPlanetRadius(uint32_t index, double radius)
 {
 	m_perPlanetVariables[index].PlanetDescriptor0.x = radius;
@@ -97,7 +97,8 @@ public:
 protected:
 	void UpdateDirtyChunkInternal(uint32_t index) override;
 	const void* AcquireDataPtr() const override { return &m_singlePrecisionPerPlanetVariables[0]; }
-	uint32_t AcquireDataSize() const override { return sizeof(m_singlePrecisionPerPlanetVariables); }
+	uint32_t AcquireDataSize() const override { return (uint32_t)(m_singlePrecisionPerPlanetVariables.size() * sizeof(PerPlanetVariablesf)); }
+	void OnChunkCapacityChanged(uint32_t chunkCapacity) override;
 
 protected:
 	static void PreComputeAtmosphereData(const std::wstring& shaderPath, const Vector3ui& groupSize, const std::vector<std::shared_ptr<Image>>& textures, const std::vector<uint8_t>& data, uint32_t chunkIndex);
@@ -105,8 +106,8 @@ protected:
 	static void AttachBarriersAfterPrecompute(const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<std::shared_ptr<Image>>& textures, uint32_t chunkIndex);
 
 protected:
-	PerPlanetVariablesd		m_perPlanetVariables[MAXIMUM_OBJECTS];
-	PerPlanetVariablesf		m_singlePrecisionPerPlanetVariables[MAXIMUM_OBJECTS];
+	std::vector<PerPlanetVariablesd>	m_perPlanetVariables;
+	std::vector<PerPlanetVariablesf>	m_singlePrecisionPerPlanetVariables;
 
 	std::vector<uint32_t>	m_dirtyChunks;
 };
\ No newline at end of file
@@ -6,24 +6,31 @@ bool PlanetGeoDataManager::Init()
 	if (!Singleton<PlanetGeoDataManager>::Init())
 		return false;
 
-	// FIXME: Magic number
-	m_pBufferKey = PerFrameData::GetInstance()->AllocateBuffer(4 * 1024 * 1024);
+	m_pBufferKey = PerFrameData::GetInstance()->AllocateBuffer(PLANET_GEO_DATA_BYTES);
 
 	FrameEventManager::GetInstance()->Register(m_pInstance);
 
 	return m_pBufferKey != nullptr;
 }
 
-void* PlanetGeoDataManager::AcquireDataPtr(uint32_t& offsetInBytes) const
+bool PlanetGeoDataManager::AllocateRegion(uint32_t numBytes, uint32_t& offsetInBytes)
 {
-	offsetInBytes = m_updatedSize;
-	return (uint8_t*)PerFrameData::GetInstance()->GetPerFrameBuffer(m_pBufferKey)->DataPtr() + m_updatedSize;
+	if (m_allocatedSize + numBytes > PLANET_GEO_DATA_BYTES)
+		return false;
+
+	offsetInBytes = m_allocatedSize;
+	m_allocatedSize += numBytes;
+	return true;
+}
+
+void* PlanetGeoDataManager::GetDataPtr(uint32_t offsetInBytes) const
+{
+	return (uint8_t*)PerFrameData::GetInstance()->GetPerFrameBuffer(m_pBufferKey)->DataPtr() + offsetInBytes;
 }
 
-void PlanetGeoDataManager::FinishDataUpdate(uint32_t size)
+void PlanetGeoDataManager::SetDirty(uint32_t offsetInBytes, uint32_t numBytes)
 {
-	m_updatedSize += size;
-	PerFrameData::GetInstance()->GetPerFrameBuffer(m_pBufferKey)->SetDirty();
+	PerFrameData::GetInstance()->GetPerFrameBuffer(m_pBufferKey)->SetDirty(offsetInBytes, numBytes);
 }
 
 std::shared_ptr<PerFrameBuffer> PlanetGeoDataManager::GetPerFrameBuffer() const
@@ -38,5 +45,5 @@ void PlanetGeoDataManager::OnFrameBegin()
 
 void PlanetGeoDataManager::OnFrameEnd()
 {
-	m_updatedSize = 0;
+
 }
\ No newline at end of file
@@ -4,14 +4,19 @@
 #include "FrameEventListener.h"
 #include "PerFrameData.h"
 
+// FIXME: Magic number
+static const uint32_t PLANET_GEO_DATA_BYTES = 4 * 1024 * 1024;
+
 class PlanetGeoDataManager : public Singleton<PlanetGeoDataManager>, public IFrameEventListener
 {
 public:
 	bool Init();
 
 public:
-	void* AcquireDataPtr(uint32_t& offsetInBytes) const;
-	void FinishDataUpdate(uint32_t size);
+	// Reserve a persistent range of buffer, data inside stays across frames and is only uploaded where it's set dirty
+	bool AllocateRegion(uint32_t numBytes, uint32_t& offsetInBytes);
+	void* GetDataPtr(uint32_t offsetInBytes) const;
+	void SetDirty(uint32_t offsetInBytes, uint32_t numBytes);
 
 	std::shared_ptr<PerFrameBuffer> GetPerFrameBuffer() const;
 
@@ -21,5 +26,5 @@ public:
 
 private:
 	std::shared_ptr<PerFrameData::PerFrameDataKey>	m_pBufferKey;
-	uint32_t										m_updatedSize = 0;
+	uint32_t										m_allocatedSize = 0;
 };
\ No newline at end of file
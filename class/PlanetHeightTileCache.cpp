@@ -0,0 +1,187 @@
+#include "PlanetHeightTileCache.h"
+
+const float PlanetHeightTileCache::FBM_FREQUENCY = 2.0f;
+const float PlanetHeightTileCache::FBM_LACUNARITY = 2.0f;
+const float PlanetHeightTileCache::FBM_GAIN = 0.5f;
+
+bool PlanetHeightTileCache::Init(const std::shared_ptr<PlanetHeightTileCache>& pSelf, uint32_t seed, float heightScale, uint32_t maxCachedBytes)
+{
+	if (!SelfRefBase<PlanetHeightTileCache>::Init(pSelf))
+		return false;
+
+	m_noise = SimplexNoise(seed);
+	m_heightScale = heightScale;
+	m_maxCachedBytes = maxCachedBytes;
+
+	// Threads only use this object, which waits for them before it's gone, so no shared pointer is held
+	for (uint32_t i = 0; i < GENERATOR_THREAD_COUNT; i++)
+		m_generators.push_back(std::thread([this]() { GenerateLoop(); }));
+
+	return true;
+}
+
+PlanetHeightTileCache::~PlanetHeightTileCache()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_isExiting = true;
+	}
+	m_requestCondition.notify_all();
+
+	for (auto& generator : m_generators)
+		generator.join();
+}
+
+std::shared_ptr<PlanetHeightTileCache> PlanetHeightTileCache::Create(uint32_t seed, float heightScale, uint32_t maxCachedBytes)
+{
+	std::shared_ptr<PlanetHeightTileCache> pCache = std::make_shared<PlanetHeightTileCache>();
+	if (pCache.get() && pCache->Init(pCache, seed, heightScale, maxCachedBytes))
+		return pCache;
+	return nullptr;
+}
+
+std::shared_ptr<PlanetHeightTile> PlanetHeightTileCache::AcquireTile(uint64_t tileKey)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto iter = m_cacheEntries.find(tileKey);
+	if (iter == m_cacheEntries.end())
+		return nullptr;
+
+	m_lruList.splice(m_lruList.begin(), m_lruList, iter->second.lruIter);
+	return iter->second.pTile;
+}
+
+void PlanetHeightTileCache::RequestTile(uint64_t tileKey, const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_pendingTiles.size() >= MAX_PENDING_TILES)
+			return;
+
+		if (m_cacheEntries.find(tileKey) != m_cacheEntries.end() || m_pendingTiles.find(tileKey) != m_pendingTiles.end())
+			return;
+
+		m_pendingTiles.insert(tileKey);
+		m_requests.push_back({ tileKey, a, b, c, d });
+	}
+
+	m_requestCondition.notify_one();
+}
+
+void PlanetHeightTileCache::GenerateLoop()
+{
+	while (true)
+	{
+		TileRequest request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_requestCondition.wait(lock, [this]() { return m_isExiting || !m_requests.empty(); });
+
+			if (m_isExiting)
+				return;
+
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		// Only bounds are used, so height grid isn't worth caching
+		std::shared_ptr<PlanetHeightTile> pTile = GenerateTile(request.a, request.b, request.c, request.d);
+		std::vector<float>().swap(pTile->heights);
+		InsertTile(request.tileKey, pTile);
+	}
+}
+
+std::shared_ptr<PlanetHeightTile> PlanetHeightTileCache::GenerateTile(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) const
+{
+	const uint32_t sampleCount = TILE_RESOLUTION * TILE_RESOLUTION;
+
+	std::vector<float> x(sampleCount), y(sampleCount), z(sampleCount);
+	for (uint32_t row = 0; row < TILE_RESOLUTION; row++)
+	{
+		double v = row / (double)(TILE_RESOLUTION - 1);
+		for (uint32_t column = 0; column < TILE_RESOLUTION; column++)
+		{
+			double u = column / (double)(TILE_RESOLUTION - 1);
+
+			// Bilinear on cube face, then projected onto unit sphere
+			Vector3d position = (a * (1.0 - u) + b * u) * (1.0 - v) + (c * (1.0 - u) + d * u) * v;
+			position.Normalize();
+			position *= FBM_FREQUENCY;
+
+			x[row * TILE_RESOLUTION + column] = (float)position.x;
+			y[row * TILE_RESOLUTION + column] = (float)position.y;
+			z[row * TILE_RESOLUTION + column] = (float)position.z;
+		}
+	}
+
+	std::shared_ptr<PlanetHeightTile> pTile = std::make_shared<PlanetHeightTile>();
+	pTile->heights.resize(sampleCount);
+	m_noise.FBM(x.data(), y.data(), z.data(), pTile->heights.data(), sampleCount, FBM_OCTAVES, FBM_LACUNARITY, FBM_GAIN);
+
+	// Sum of octave amplitudes, to map fbm into [-1, 1]
+	float amplitudeSum = 0.0f;
+	float amplitude = 1.0f;
+	for (uint32_t i = 0; i < FBM_OCTAVES; i++)
+	{
+		amplitudeSum += amplitude;
+		amplitude *= FBM_GAIN;
+	}
+
+	float scale = m_heightScale / amplitudeSum;
+	pTile->minHeight = pTile->maxHeight = pTile->heights[0] * scale;
+	for (auto& height : pTile->heights)
+	{
+		height *= scale;
+		pTile->minHeight = height < pTile->minHeight ? height : pTile->minHeight;
+		pTile->maxHeight = height > pTile->maxHeight ? height : pTile->maxHeight;
+	}
+
+	return pTile;
+}
+
+void PlanetHeightTileCache::InsertTile(uint64_t tileKey, const std::shared_ptr<PlanetHeightTile>& pTile)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_pendingTiles.erase(tileKey);
+	m_generatedTileCount++;
+
+	m_lruList.push_front(tileKey);
+	m_cacheEntries[tileKey] = { pTile, m_lruList.begin() };
+	m_cachedBytes += GetTileBytes(pTile);
+
+	// Evict least recently used tiles, quad tree nodes only copy bounds of a tile, so nothing references them
+	while (m_cachedBytes > m_maxCachedBytes && m_lruList.size() > 1)
+	{
+		auto iter = m_cacheEntries.find(m_lruList.back());
+		m_cachedBytes -= GetTileBytes(iter->second.pTile);
+		m_cacheEntries.erase(iter);
+		m_lruList.pop_back();
+	}
+}
+
+uint32_t PlanetHeightTileCache::GetCachedBytes() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_cachedBytes;
+}
+
+uint32_t PlanetHeightTileCache::GetCachedTileCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return (uint32_t)m_cacheEntries.size();
+}
+
+uint32_t PlanetHeightTileCache::GetGeneratedTileCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_generatedTileCount;
+}
+
+uint32_t PlanetHeightTileCache::GetPendingTileCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return (uint32_t)m_pendingTiles.size();
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../Maths/Matrix.h"
+#include "../Maths/SimplexNoise.h"
+#include "../Base/Base.h"
+#include <list>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
+// Heights of a quad tree node, sampled on a grid over the node
+// Planet is still rendered as a perfect sphere by vertex shader, heights only widen culling bounds of quad tree nodes
+typedef struct _PlanetHeightTile
+{
+	std::vector<float>	heights;	// Relative to planet radius, TILE_RESOLUTION x TILE_RESOLUTION, row by row from corner a, empty for cached tiles
+	float				minHeight;
+	float				maxHeight;
+}PlanetHeightTile;
+
+// Procedural terrain heights of a planet, tiles are generated by background threads and kept in a memory bounded LRU cache
+// Background threads are its own rather than job system's, since frame jobs are waited for every frame while a tile may take longer
+// Tile content only depends on seed and tile corners, so it's the same whenever and wherever it's generated
+// Cached tiles are bounds only, their height grid is dropped once min and max are known, since nothing renders it
+class PlanetHeightTileCache : public SelfRefBase<PlanetHeightTileCache>
+{
+	typedef struct _CacheEntry
+	{
+		std::shared_ptr<PlanetHeightTile>	pTile;
+		std::list<uint64_t>::iterator		lruIter;
+	}CacheEntry;
+
+	typedef struct _TileRequest
+	{
+		uint64_t	tileKey;
+		Vector3d	a;
+		Vector3d	b;
+		Vector3d	c;
+		Vector3d	d;
+	}TileRequest;
+
+public:
+	static const uint32_t TILE_RESOLUTION = 17;
+
+protected:
+	bool Init(const std::shared_ptr<PlanetHeightTileCache>& pSelf, uint32_t seed, float heightScale, uint32_t maxCachedBytes);
+
+public:
+	static std::shared_ptr<PlanetHeightTileCache> Create(uint32_t seed, float heightScale, uint32_t maxCachedBytes);
+
+	// Requests not started yet are dropped, tiles being generated are waited for
+	~PlanetHeightTileCache();
+
+public:
+	// Returns nullptr if tile isn't generated yet, a hit makes tile most recently used
+	std::shared_ptr<PlanetHeightTile> AcquireTile(uint64_t tileKey);
+	// Generate tile on a background thread if it's neither cached nor pending, request is dropped if too many are pending
+	// Cached tile only has bounds, its height grid is empty
+	void RequestTile(uint64_t tileKey, const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d);
+	// Generate tile on calling thread, vertices are on unit cube arranged the same as quad tree node
+	std::shared_ptr<PlanetHeightTile> GenerateTile(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) const;
+
+	// Heights are within [-heightScale, heightScale]
+	float GetHeightScale() const { return m_heightScale; }
+	uint32_t GetCachedBytes() const;
+	uint32_t GetCachedTileCount() const;
+	uint32_t GetGeneratedTileCount() const;
+	uint32_t GetPendingTileCount() const;
+
+protected:
+	void InsertTile(uint64_t tileKey, const std::shared_ptr<PlanetHeightTile>& pTile);
+	void GenerateLoop();
+	static uint32_t GetTileBytes(const std::shared_ptr<PlanetHeightTile>& pTile) { return (uint32_t)(sizeof(PlanetHeightTile) + pTile->heights.size() * sizeof(float)); }
+
+protected:
+	SimplexNoise										m_noise;
+	float												m_heightScale;
+	uint32_t											m_maxCachedBytes;
+
+	// Guards everything below, getters are called while background threads insert tiles
+	mutable std::mutex									m_mutex;
+	std::unordered_map<uint64_t, CacheEntry>			m_cacheEntries;
+	std::list<uint64_t>									m_lruList;			// Most recently used first
+	std::unordered_set<uint64_t>						m_pendingTiles;		// Requested or being generated
+	uint32_t											m_cachedBytes = 0;
+	uint32_t											m_generatedTileCount = 0;
+
+	std::deque<TileRequest>								m_requests;
+	std::condition_variable								m_requestCondition;
+	std::vector<std::thread>							m_generators;
+	bool												m_isExiting = false;
+
+	static const uint32_t MAX_PENDING_TILES = 32;
+	static const uint32_t GENERATOR_THREAD_COUNT = 2;
+
+	// Noise parameters, base frequency is on unit sphere
+	static const uint32_t FBM_OCTAVES = 10;
+	static const float FBM_FREQUENCY;
+	static const float FBM_LACUNARITY;
+	static const float FBM_GAIN;
+};
\ No newline at end of file
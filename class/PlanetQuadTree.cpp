@@ -0,0 +1,482 @@
+#include "PlanetQuadTree.h"
+#include "PlanetHeightTileCache.h"
+#include "../Maths/SIMDCull.h"
+#include <string.h>
+
+const double PlanetQuadTree::TILE_PREFETCH_DISTANCE_FACTOR = 2.0;
+
+std::shared_ptr<PlanetQuadTree> PlanetQuadTree::Create(double planetRadius, const Vector3d* pCubeVertices, const uint32_t* pCubeIndices, const std::vector<double>& distanceLUT, uint32_t maxLODLevel,
+	float terrainHeightScale, const std::shared_ptr<PlanetHeightTileCache>& pHeightTileCache, Triangle* pPatchData, uint32_t maxPatchCount, PatchDirtyFunc patchDirtyFunc)
+{
+	std::shared_ptr<PlanetQuadTree> pQuadTree = std::make_shared<PlanetQuadTree>();
+	if (pQuadTree.get() && pQuadTree->Init(pQuadTree, planetRadius, pCubeVertices, pCubeIndices, distanceLUT, maxLODLevel, terrainHeightScale, pHeightTileCache, pPatchData, maxPatchCount, patchDirtyFunc))
+		return pQuadTree;
+	return nullptr;
+}
+
+bool PlanetQuadTree::Init(const std::shared_ptr<PlanetQuadTree>& pSelf, double planetRadius, const Vector3d* pCubeVertices, const uint32_t* pCubeIndices, const std::vector<double>& distanceLUT, uint32_t maxLODLevel,
+	float terrainHeightScale, const std::shared_ptr<PlanetHeightTileCache>& pHeightTileCache, Triangle* pPatchData, uint32_t maxPatchCount, PatchDirtyFunc patchDirtyFunc)
+{
+	if (!SelfRefBase<PlanetQuadTree>::Init(pSelf))
+		return false;
+
+	// Nodes of every level up to max one look up distance to divide
+	if (distanceLUT.size() < maxLODLevel)
+		return false;
+
+	m_planetRadius = planetRadius;
+	m_distanceLUT = distanceLUT;
+	m_maxLODLevel = maxLODLevel;
+	m_terrainHeightScale = terrainHeightScale;
+	m_pHeightTileCache = pHeightTileCache;
+	m_pPatchData = pPatchData;
+	m_maxPatchCount = maxPatchCount;
+	m_patchDirtyFunc = patchDirtyFunc;
+
+	Vector3d a = pCubeVertices[pCubeIndices[1]];
+	Vector3d b = pCubeVertices[pCubeIndices[2]];
+	Vector3d center = (a + b) / 2.0;
+	center.Normalize();
+
+	double cosin_a_center = a * center;
+
+	// cosin_a_center = r / h, r = 1(local length)
+	double height_level_0 = 1 / cosin_a_center;
+
+	m_heightLUT.push_back(height_level_0);
+	for (uint32_t i = 1; i < maxLODLevel + 1; i++)
+	{
+		// Next level vertices
+		Vector3d A = center.Normal();
+		Vector3d B = b;
+
+		center = (A + B) * 0.5;
+		center.Normalize();
+
+		double cosin_A_center = A * center;
+		double height = 1 / cosin_A_center;
+		m_heightLUT.push_back(height);
+
+		a = A;
+		b = B;
+	}
+
+	// Roots of quad tree, one for each cube face
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		m_quadTreeNodes.push_back(
+		{
+			pCubeVertices[pCubeIndices[i * 6 + 0]],	// a
+			pCubeVertices[pCubeIndices[i * 6 + 1]],	// b
+			pCubeVertices[pCubeIndices[i * 6 + 2]],	// c
+			pCubeVertices[pCubeIndices[i * 6 + 5]],	// d
+			0,
+			NULL_INDEX,
+			NULL_INDEX,
+			NULL_INDEX,
+			true,
+			8ull + i,	// Leading bit and cube face
+			-m_terrainHeightScale,
+			m_terrainHeightScale,
+			false
+		});
+	}
+
+	return true;
+}
+
+bool PlanetQuadTree::FrustumCull(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2, const Vector3d& p3, double height) const
+{
+	const Vector3d corners[4] = { p0, p1, p2, p3 };
+	return FrustumTestPatch(m_cameraFrustum, corners, height) == FrustumTestOutside;
+}
+
+// Quad is arranged as abc, cbd, see HorizonCullPatch
+bool PlanetQuadTree::BackFaceCull(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) const
+{
+	return HorizonCullPatch(a, b, c, d, m_lockedCameraPosition);
+}
+
+PlanetQuadTree::NodeEvaluation PlanetQuadTree::EvaluateQuad(const QuadTreeNode& node) const
+{
+	NodeEvaluation evaluation = { NodeDecision::CULL, false };
+
+	Vector3d realSizeA = node.a;
+	Vector3d realSizeB = node.b;
+	Vector3d realSizeC = node.c;
+	Vector3d realSizeD = node.d;
+
+	realSizeA.Normalize();
+	realSizeB.Normalize();
+	realSizeC.Normalize();
+	realSizeD.Normalize();
+
+	realSizeA *= m_planetRadius;
+	realSizeB *= m_planetRadius;
+	realSizeC *= m_planetRadius;
+	realSizeD *= m_planetRadius;
+
+	// Terrain bounds are from lowest terrain to highest terrain plus patch bulge, and always enclose sphere surface that's rendered
+	double innerScale = 1.0 + (node.minHeight < 0.0f ? node.minHeight : 0.0f);
+	double outerScale = 1.0 + (node.maxHeight > 0.0f ? node.maxHeight : 0.0f);
+
+	// Parent's cull state isn't kept, since it's outdated once camera moves, so every node is tested
+	if (FrustumCull(realSizeA * innerScale, realSizeB * innerScale, realSizeC * innerScale, realSizeD * innerScale, m_heightLUT[node.level] * outerScale / innerScale))
+		return evaluation;
+
+	if (BackFaceCull(realSizeA, realSizeB, realSizeC, realSizeD))
+		return evaluation;
+
+	double distA = (realSizeA - m_lockedCameraPosition).Length();
+	double distB = (realSizeB - m_lockedCameraPosition).Length();
+	double distC = (realSizeC - m_lockedCameraPosition).Length();
+	double distD = (realSizeD - m_lockedCameraPosition).Length();
+
+	double minDist = std::fmin(std::fmin(std::fmin(distA, distB), distC), distD);
+
+	if (node.level == m_maxLODLevel || m_distanceLUT[node.level] <= minDist)
+	{
+		evaluation.decision = NodeDecision::DRAW;
+		// Tiles of children are ready before camera gets close enough to divide
+		evaluation.prefetchChildren = node.level < m_maxLODLevel && node.level < HEIGHT_TILE_MAX_LEVEL
+			&& m_distanceLUT[node.level] * TILE_PREFETCH_DISTANCE_FACTOR > minDist;
+		return evaluation;
+	}
+
+	evaluation.decision = NodeDecision::DIVIDE;
+	return evaluation;
+}
+
+void PlanetQuadTree::EvaluateNodes(const std::vector<uint32_t>& nodes, std::vector<NodeEvaluation>& evaluations, const ParallelRangeFunc& parallelFor) const
+{
+	evaluations.resize(nodes.size());
+
+	if (!parallelFor || nodes.size() < PARALLEL_EVALUATION_THRESHOLD)
+	{
+		for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+			evaluations[i] = EvaluateQuad(m_quadTreeNodes[nodes[i]]);
+		return;
+	}
+
+	parallelFor((uint32_t)nodes.size(), PARALLEL_EVALUATION_GRAIN_SIZE, [this, &nodes, &evaluations](uint32_t startIndex, uint32_t endIndex)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+			evaluations[i] = EvaluateQuad(m_quadTreeNodes[nodes[i]]);
+	});
+}
+
+void PlanetQuadTree::WritePatch(const QuadTreeNode& node, Triangle* pTriangles) const
+{
+	Vector3d realSizeA = node.a;
+	Vector3d realSizeB = node.b;
+	Vector3d realSizeC = node.c;
+	Vector3d realSizeD = node.d;
+
+	realSizeA.Normalize();
+	realSizeB.Normalize();
+	realSizeC.Normalize();
+	realSizeD.Normalize();
+
+	realSizeA *= m_planetRadius;
+	realSizeB *= m_planetRadius;
+	realSizeC *= m_planetRadius;
+	realSizeD *= m_planetRadius;
+
+	// Locked camera position equals to this one unless camera info update is toggled off
+	Vector3d camera_relative_a = realSizeA - m_cameraPosition;
+	Vector3d camera_relative_b = realSizeB - m_cameraPosition;
+	Vector3d camera_relative_c = realSizeC - m_cameraPosition;
+	Vector3d camera_relative_d = realSizeD - m_cameraPosition;
+
+	// Triangle abc
+	pTriangles[0].p = camera_relative_c.SinglePrecision();
+	pTriangles[0].edge0 = camera_relative_a.SinglePrecision();
+	pTriangles[0].edge1 = camera_relative_b.SinglePrecision();
+
+	pTriangles[0].edge0 -= pTriangles[0].p;
+	pTriangles[0].edge1 -= pTriangles[0].p;
+
+	// Level + 1 to avoid zero
+	pTriangles[0].level = (float)node.level + 1.0f;
+
+	// Triangle cbd
+	pTriangles[1].p = camera_relative_b.SinglePrecision();
+	pTriangles[1].edge0 = camera_relative_d.SinglePrecision();
+	pTriangles[1].edge1 = camera_relative_c.SinglePrecision();
+
+	pTriangles[1].edge0 -= pTriangles[1].p;
+	pTriangles[1].edge1 -= pTriangles[1].p;
+
+	// Minus gives a sign whether to reverse morphing in vertex shader
+	pTriangles[1].level = ((float)node.level + 1.0f) * -1.0f;
+}
+
+void PlanetQuadTree::SplitNode(uint32_t nodeIndex)
+{
+	HideNode(nodeIndex);
+
+	uint32_t firstChild;
+	if (!m_freeChildGroups.empty())
+	{
+		firstChild = m_freeChildGroups.back();
+		m_freeChildGroups.pop_back();
+	}
+	else
+	{
+		firstChild = (uint32_t)m_quadTreeNodes.size();
+		m_quadTreeNodes.resize(m_quadTreeNodes.size() + 4);
+	}
+
+	m_quadTreeNodes[nodeIndex].firstChild = firstChild;
+
+	for (uint32_t i = 0; i < 4; i++)
+		InitChildNode(nodeIndex, i, m_quadTreeNodes[firstChild + i]);
+
+	m_LODStatistics.splitCount++;
+}
+
+void PlanetQuadTree::InitChildNode(uint32_t parentIndex, uint32_t childIndex, QuadTreeNode& child) const
+{
+	const QuadTreeNode& node = m_quadTreeNodes[parentIndex];
+
+	Vector3d ab = node.a;
+	Vector3d ac = node.a;
+	Vector3d bd = node.b;
+	Vector3d cd = node.c;
+
+	ab += node.b;
+	ab *= 0.5f;
+
+	ac += node.c;
+	ac *= 0.5f;
+
+	bd += node.d;
+	bd *= 0.5f;
+
+	cd += node.d;
+	cd *= 0.5f;
+
+	Vector3d center = ab;
+	center += cd;
+	center *= 0.5f;
+
+	switch (childIndex)
+	{
+	case 0: child = { node.a, ab, ac, center }; break;
+	case 1: child = { ab, node.b, center, bd }; break;
+	case 2: child = { ac, center, node.c, cd }; break;
+	default: child = { center, bd, cd, node.d }; break;
+	}
+
+	child.level = node.level + 1;
+	child.parent = parentIndex;
+	child.firstChild = NULL_INDEX;
+	child.patchSlot = NULL_INDEX;
+	child.isAlive = true;
+	child.tileKey = (node.tileKey << 2) | childIndex;
+
+	// Parent bounds enclose child terrain until child's own tile is ready
+	child.minHeight = node.minHeight;
+	child.maxHeight = node.maxHeight;
+	child.hasTileHeights = false;
+}
+
+void PlanetQuadTree::UpdateNodeHeights(const std::vector<uint32_t>& nodes)
+{
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	{
+		QuadTreeNode& node = m_quadTreeNodes[nodes[i]];
+		if (m_pHeightTileCache == nullptr || node.hasTileHeights || node.level > HEIGHT_TILE_MAX_LEVEL)
+			continue;
+
+		std::shared_ptr<PlanetHeightTile> pTile = m_pHeightTileCache->AcquireTile(node.tileKey);
+		if (pTile == nullptr)
+		{
+			m_pHeightTileCache->RequestTile(node.tileKey, node.a, node.b, node.c, node.d);
+			m_hasPendingTileHeights = true;
+			continue;
+		}
+
+		node.minHeight = pTile->minHeight;
+		node.maxHeight = pTile->maxHeight;
+		node.hasTileHeights = true;
+	}
+}
+
+void PlanetQuadTree::MergeNode(uint32_t nodeIndex)
+{
+	uint32_t firstChild = m_quadTreeNodes[nodeIndex].firstChild;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		// Depth is bounded by max LOD level
+		if (m_quadTreeNodes[firstChild + i].firstChild != NULL_INDEX)
+			MergeNode(firstChild + i);
+
+		HideNode(firstChild + i);
+		m_quadTreeNodes[firstChild + i].isAlive = false;
+	}
+
+	m_freeChildGroups.push_back(firstChild);
+	m_quadTreeNodes[nodeIndex].firstChild = NULL_INDEX;
+
+	m_LODStatistics.mergeCount++;
+}
+
+void PlanetQuadTree::DrawNode(uint32_t nodeIndex)
+{
+	QuadTreeNode& node = m_quadTreeNodes[nodeIndex];
+	if (node.patchSlot != NULL_INDEX)
+		return;
+
+	// Out of slots, node is simply not drawn
+	if (m_patchSlotNodes.size() >= m_maxPatchCount)
+		return;
+
+	node.patchSlot = (uint32_t)m_patchSlotNodes.size();
+	m_patchSlotNodes.push_back(nodeIndex);
+
+	if (!m_rewriteAllPatches)
+		WritePatch(node, m_pPatchData + node.patchSlot * 2);
+	SetPatchSlotDirty(node.patchSlot);
+}
+
+void PlanetQuadTree::HideNode(uint32_t nodeIndex)
+{
+	uint32_t patchSlot = m_quadTreeNodes[nodeIndex].patchSlot;
+	if (patchSlot == NULL_INDEX)
+		return;
+
+	// Move last patch into this slot to keep slots compact
+	uint32_t lastSlot = (uint32_t)m_patchSlotNodes.size() - 1;
+	if (patchSlot != lastSlot)
+	{
+		uint32_t movedNode = m_patchSlotNodes[lastSlot];
+		m_patchSlotNodes[patchSlot] = movedNode;
+		m_quadTreeNodes[movedNode].patchSlot = patchSlot;
+
+		memcpy(m_pPatchData + patchSlot * 2, m_pPatchData + lastSlot * 2, PATCH_BYTES);
+		SetPatchSlotDirty(patchSlot);
+	}
+
+	m_patchSlotNodes.pop_back();
+	m_quadTreeNodes[nodeIndex].patchSlot = NULL_INDEX;
+}
+
+void PlanetQuadTree::SetPatchSlotDirty(uint32_t patchSlot)
+{
+	// All patches are uploaded at once later
+	if (m_rewriteAllPatches)
+		return;
+
+	if (m_patchDirtyFunc)
+		m_patchDirtyFunc(patchSlot * PATCH_BYTES, PATCH_BYTES);
+	m_LODStatistics.uploadedBytes += PATCH_BYTES;
+}
+
+void PlanetQuadTree::UpdateNodes(const ParallelRangeFunc& parallelFor)
+{
+	// Tree is walked level by level from cube faces, nodes of a level are evaluated together
+	m_pendingNodes.clear();
+	m_hasPendingTileHeights = false;
+	for (uint32_t i = 0; i < 6; i++)
+		m_pendingNodes.push_back(i);
+
+	while (!m_pendingNodes.empty())
+	{
+		UpdateNodeHeights(m_pendingNodes);
+
+		EvaluateNodes(m_pendingNodes, m_nodeEvaluations, parallelFor);
+		m_LODStatistics.evaluatedNodeCount += (uint32_t)m_pendingNodes.size();
+
+		// Only nodes whose decision changed are touched: leaves to divide, parents to stop dividing, and patches shown or culled
+		m_nextPendingNodes.clear();
+		for (uint32_t i = 0; i < (uint32_t)m_pendingNodes.size(); i++)
+		{
+			uint32_t nodeIndex = m_pendingNodes[i];
+			bool isLeaf = m_quadTreeNodes[nodeIndex].firstChild == NULL_INDEX;
+
+			if (m_nodeEvaluations[i].decision == NodeDecision::DIVIDE)
+			{
+				if (isLeaf)
+					SplitNode(nodeIndex);
+
+				for (uint32_t j = 0; j < 4; j++)
+					m_nextPendingNodes.push_back(m_quadTreeNodes[nodeIndex].firstChild + j);
+
+				continue;
+			}
+
+			if (!isLeaf)
+				MergeNode(nodeIndex);
+
+			if (m_nodeEvaluations[i].decision == NodeDecision::DRAW)
+				DrawNode(nodeIndex);
+			else
+				HideNode(nodeIndex);
+
+			if (m_nodeEvaluations[i].prefetchChildren && m_pHeightTileCache != nullptr)
+			{
+				QuadTreeNode child;
+				for (uint32_t j = 0; j < 4; j++)
+				{
+					InitChildNode(nodeIndex, j, child);
+					if (m_pHeightTileCache->AcquireTile(child.tileKey) == nullptr)
+						m_pHeightTileCache->RequestTile(child.tileKey, child.a, child.b, child.c, child.d);
+				}
+			}
+		}
+
+		m_pendingNodes.swap(m_nextPendingNodes);
+	}
+}
+
+static bool IsSameFrustum(const PyramidFrustumd& a, const PyramidFrustumd& b)
+{
+	for (uint32_t i = 0; i < PyramidFrustumd::FrustumFace_COUNT; i++)
+	{
+		if (a.planes[i].normal != b.planes[i].normal || a.planes[i].D != b.planes[i].D)
+			return false;
+	}
+	return true;
+}
+
+void PlanetQuadTree::Update(const Vector3d& cameraPosition, const Vector3d& lockedCameraPosition, const PyramidFrustumd& lockedCameraFrustum, const ParallelRangeFunc& parallelFor)
+{
+	m_LODStatistics = {};
+
+	// Patches are stored relative to camera, once it moves none of them is valid
+	m_rewriteAllPatches = !m_isEvaluated || m_cameraPosition != cameraPosition;
+	m_cameraPosition = cameraPosition;
+
+	// Quad tree stays the same if camera used for culling and LOD doesn't change, and no node is waiting for its height tile
+	if (!m_isEvaluated
+		|| m_hasPendingTileHeights
+		|| m_lockedCameraPosition != lockedCameraPosition
+		|| !IsSameFrustum(m_cameraFrustum, lockedCameraFrustum))
+	{
+		m_lockedCameraPosition = lockedCameraPosition;
+		m_cameraFrustum = lockedCameraFrustum;
+
+		UpdateNodes(parallelFor);
+		m_isEvaluated = true;
+	}
+
+	uint32_t patchCount = (uint32_t)m_patchSlotNodes.size();
+	if (!m_rewriteAllPatches || patchCount == 0)
+		return;
+
+	auto writePatches = [this](uint32_t startIndex, uint32_t endIndex)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+			WritePatch(m_quadTreeNodes[m_patchSlotNodes[i]], m_pPatchData + i * 2);
+	};
+
+	if (!parallelFor || patchCount < PARALLEL_EVALUATION_THRESHOLD)
+		writePatches(0, patchCount);
+	else
+		parallelFor(patchCount, PARALLEL_EVALUATION_GRAIN_SIZE, writePatches);
+
+	if (m_patchDirtyFunc)
+		m_patchDirtyFunc(0, patchCount * PATCH_BYTES);
+	m_LODStatistics.uploadedBytes += patchCount * PATCH_BYTES;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "../Maths/Matrix.h"
+#include "../Maths/PyramidFrustum.h"
+#include "../Base/Base.h"
+#include "../thread/ParallelRange.hpp"
+#include <functional>
+
+class PlanetHeightTileCache;
+
+// LOD quad tree of a planet, kept across frames, and its patches written into a compact buffer
+// It only knows planet local space, so that it's usable and measurable without a device
+class PlanetQuadTree : public SelfRefBase<PlanetQuadTree>
+{
+public:
+	typedef struct _Triangle
+	{
+		// A triangle consists of a vertex, and 2 edge vectors: edge0 and edge1
+		Vector3f	p;
+		Vector3f	edge0;
+		Vector3f	edge1;
+		float		level;	// the sign of this variable gives morphing direction
+	}Triangle;
+
+	// Quad tree changes of last update
+	typedef struct _LODStatistics
+	{
+		uint32_t	evaluatedNodeCount;
+		uint32_t	splitCount;
+		uint32_t	mergeCount;
+		uint32_t	uploadedBytes;		// Bytes of patches set dirty
+	}LODStatistics;
+
+	// Called with byte offset from start of patch data, and byte count of patches changed
+	typedef std::function<void(uint32_t offset, uint32_t numBytes)> PatchDirtyFunc;
+
+	static const uint32_t PATCH_BYTES = sizeof(Triangle) * 2;
+
+protected:
+	// What to do with a node of quad tree
+	enum class NodeDecision
+	{
+		CULL,			// Neither the node nor its children are visible
+		DRAW,			// Node is drawn as a patch
+		DIVIDE			// Node is divided into 4 children
+	};
+
+	// Node of persistent quad tree, vertices are on unit cube
+	// Children of a node are allocated as 4 consecutive nodes
+	typedef struct _QuadTreeNode
+	{
+		Vector3d	a;
+		Vector3d	b;
+		Vector3d	c;
+		Vector3d	d;
+		uint32_t	level;
+		uint32_t	parent;
+		uint32_t	firstChild;		// NULL_INDEX if it's a leaf
+		uint32_t	patchSlot;		// Slot of 2 triangles in patch data, NULL_INDEX if it's not drawn
+		bool		isAlive;
+		uint64_t	tileKey;		// Leading 1 bit, 3 bits of cube face, then 2 bits of child index per level
+		float		minHeight;		// Terrain height bounds relative to planet radius, inherited from parent until its own tile is ready
+		float		maxHeight;
+		bool		hasTileHeights;
+	}QuadTreeNode;
+
+	typedef struct _NodeEvaluation
+	{
+		NodeDecision	decision;
+		bool			prefetchChildren;	// Node is drawn but close to be divided, so height tiles of its children are requested
+	}NodeEvaluation;
+
+protected:
+	bool Init(const std::shared_ptr<PlanetQuadTree>& pSelf, double planetRadius, const Vector3d* pCubeVertices, const uint32_t* pCubeIndices, const std::vector<double>& distanceLUT, uint32_t maxLODLevel,
+		float terrainHeightScale, const std::shared_ptr<PlanetHeightTileCache>& pHeightTileCache, Triangle* pPatchData, uint32_t maxPatchCount, PatchDirtyFunc patchDirtyFunc);
+
+public:
+	// Cube is laid out as SceneGenerator::GenerateCube, distanceLUT gives distance to divide a node of each level
+	// Height tile cache is optional, without it every node is bounded by whole terrain height range
+	static std::shared_ptr<PlanetQuadTree> Create(double planetRadius, const Vector3d* pCubeVertices, const uint32_t* pCubeIndices, const std::vector<double>& distanceLUT, uint32_t maxLODLevel,
+		float terrainHeightScale, const std::shared_ptr<PlanetHeightTileCache>& pHeightTileCache, Triangle* pPatchData, uint32_t maxPatchCount, PatchDirtyFunc patchDirtyFunc);
+
+public:
+	// Everything is in planet local space
+	// Culling and LOD use locked camera, patches are written relative to camera position, they're the same unless camera info is locked for debugging
+	// Nodes are evaluated through parallelFor if it's given
+	void Update(const Vector3d& cameraPosition, const Vector3d& lockedCameraPosition, const PyramidFrustumd& lockedCameraFrustum, const ParallelRangeFunc& parallelFor = nullptr);
+
+	const LODStatistics& GetLODStatistics() const { return m_LODStatistics; }
+	uint32_t GetPatchCount() const { return (uint32_t)m_patchSlotNodes.size(); }
+
+protected:
+	// Functions below only read member data, so that nodes could be evaluated on multiple threads
+	// True if corners and extruded corners are all outside of one frustum plane
+	bool FrustumCull(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2, const Vector3d& p3, double height) const;
+	// True if patch faces away from camera and is beyond horizon
+	bool BackFaceCull(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) const;
+
+	NodeEvaluation EvaluateQuad(const QuadTreeNode& node) const;
+	void EvaluateNodes(const std::vector<uint32_t>& nodes, std::vector<NodeEvaluation>& evaluations, const ParallelRangeFunc& parallelFor) const;
+	// Write 2 triangles of a node relative to camera
+	void WritePatch(const QuadTreeNode& node, Triangle* pTriangles) const;
+
+	// Re-evaluate nodes of quad tree, then split and merge only where decision changed
+	void UpdateNodes(const ParallelRangeFunc& parallelFor);
+	void SplitNode(uint32_t nodeIndex);
+	void InitChildNode(uint32_t parentIndex, uint32_t childIndex, QuadTreeNode& child) const;
+	// Take height bounds from cached tiles, and request tiles not generated yet
+	void UpdateNodeHeights(const std::vector<uint32_t>& nodes);
+	// Release all descendants of a node
+	void MergeNode(uint32_t nodeIndex);
+
+	// Patch slots are kept compact, so that they could be drawn as a single instance range
+	void DrawNode(uint32_t nodeIndex);
+	void HideNode(uint32_t nodeIndex);
+	void SetPatchSlotDirty(uint32_t patchSlot);
+
+protected:
+	double							m_planetRadius = 1;
+	std::vector<double>				m_heightLUT;
+	std::vector<double>				m_distanceLUT;
+	uint32_t						m_maxLODLevel = 0;
+	float							m_terrainHeightScale = 0;
+
+	std::shared_ptr<PlanetHeightTileCache>	m_pHeightTileCache;
+
+	Triangle*						m_pPatchData = nullptr;
+	uint32_t						m_maxPatchCount = 0;
+	PatchDirtyFunc					m_patchDirtyFunc;
+
+	// Quad tree, 6 cube faces are the first 6 nodes
+	std::vector<QuadTreeNode>		m_quadTreeNodes;
+	std::vector<uint32_t>			m_freeChildGroups;
+
+	// Node of each patch slot, slots are uploaded only when they're changed
+	std::vector<uint32_t>			m_patchSlotNodes;
+
+	// Utility lists, to avoid frequent construction and destruction every frame
+	std::vector<uint32_t>			m_pendingNodes;
+	std::vector<uint32_t>			m_nextPendingNodes;
+	std::vector<NodeEvaluation>		m_nodeEvaluations;
+
+	// Camera info quad tree and patches are built with, nothing is done if it doesn't change
+	bool							m_isEvaluated = false;
+	bool							m_hasPendingTileHeights = false;
+	PyramidFrustumd					m_cameraFrustum;
+	Vector3d						m_cameraPosition;
+	Vector3d						m_lockedCameraPosition;
+	// Patches are relative to camera, so all of them are rewritten once camera moves
+	bool							m_rewriteAllPatches = false;
+
+	LODStatistics					m_LODStatistics = {};
+
+	static const uint32_t NULL_INDEX = 0xffffffff;
+	// Node lists smaller than this are evaluated on calling thread
+	static const uint32_t PARALLEL_EVALUATION_THRESHOLD = 256;
+	static const uint32_t PARALLEL_EVALUATION_GRAIN_SIZE = 128;
+
+	// Deeper nodes use height bounds of their ancestor at this level
+	static const uint32_t HEIGHT_TILE_MAX_LEVEL = 16;
+	// Children tiles are requested if camera is within this times the distance to divide a node
+	static const double TILE_PREFETCH_DISTANCE_FACTOR;
+};
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include "RenderGraph.h"
+#include "../common/Macros.h"
+#include <algorithm>
+#include <sstream>
+
+bool RenderGraph::Init(const std::shared_ptr<RenderGraph>& pSelf)
+{
+	if (!SelfRefBase<RenderGraph>::Init(pSelf))
+		return false;
+
+	return true;
+}
+
+std::shared_ptr<RenderGraph> RenderGraph::Create()
+{
+	std::shared_ptr<RenderGraph> pRenderGraph = std::make_shared<RenderGraph>();
+	if (pRenderGraph.get() && pRenderGraph->Init(pRenderGraph))
+		return pRenderGraph;
+	return nullptr;
+}
+
+uint32_t RenderGraph::AddResource(const ResourceDesc& desc)
+{
+	m_resources.push_back({ desc, NULL_INDEX, NULL_INDEX, NULL_INDEX });
+	m_compiled = false;
+	return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t RenderGraph::AddPass(const std::string& name, PassFunc func)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.func = func;
+	m_passes.push_back(pass);
+	m_compiled = false;
+	return (uint32_t)m_passes.size() - 1;
+}
+
+RenderGraph::ResourceAccess& RenderGraph::AcquireAccess(uint32_t pass, uint32_t resource, ResourceUsage usage)
+{
+	ASSERTION(pass < m_passes.size() && resource < m_resources.size());
+
+	m_compiled = false;
+
+	for (auto& access : m_passes[pass].accesses)
+	{
+		if (access.resource == resource)
+			return access;
+	}
+
+	m_passes[pass].accesses.push_back({ resource, usage, false, false });
+	return m_passes[pass].accesses.back();
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, ResourceUsage usage)
+{
+	ResourceAccess& access = AcquireAccess(pass, resource, usage);
+	access.read = true;
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, ResourceUsage usage)
+{
+	// Written usage wins if a resource is also read by the same pass, it's loaded as an attachment
+	ResourceAccess& access = AcquireAccess(pass, resource, usage);
+	access.usage = usage;
+	access.write = true;
+}
+
+bool RenderGraph::Compile()
+{
+	m_compiled = false;
+	m_schedule.clear();
+	m_aliasSlots.clear();
+
+	// Transient resources carry nothing into a frame, so reading one before it's written is a declaration error
+	std::vector<bool> written(m_resources.size(), false);
+	for (auto& pass : m_passes)
+	{
+		for (auto& access : pass.accesses)
+		{
+			if (access.read && !written[access.resource] && m_resources[access.resource].desc.transient)
+				return false;
+		}
+
+		for (auto& access : pass.accesses)
+		{
+			if (access.write)
+				written[access.resource] = true;
+		}
+	}
+
+	CullPasses();
+
+	for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+	{
+		if (!m_passes[i].culled)
+			m_schedule.push_back(i);
+	}
+
+	ComputeLifetimes();
+	AssignAliasSlots();
+	ComputeBarriers();
+
+	m_compiled = true;
+	return true;
+}
+
+void RenderGraph::CullPasses()
+{
+	std::vector<bool> needed(m_resources.size(), false);
+	for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+		needed[i] = m_resources[i].desc.output;
+
+	// Walk backwards, a pass survives if it has side effect or writes something needed later
+	for (int32_t i = (int32_t)m_passes.size() - 1; i >= 0; i--)
+	{
+		Pass& pass = m_passes[i];
+
+		bool alive = pass.sideEffect;
+		for (auto& access : pass.accesses)
+			alive = alive || (access.write && needed[access.resource]);
+
+		pass.culled = !alive;
+		if (!alive)
+			continue;
+
+		// A plain write replaces previous content, earlier writers are only needed if someone reads in between
+		for (auto& access : pass.accesses)
+		{
+			if (access.write && !access.read)
+				needed[access.resource] = false;
+		}
+
+		for (auto& access : pass.accesses)
+		{
+			if (access.read)
+				needed[access.resource] = true;
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (auto& resource : m_resources)
+	{
+		resource.firstPass = NULL_INDEX;
+		resource.lastPass = NULL_INDEX;
+		resource.aliasSlot = NULL_INDEX;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)m_schedule.size(); i++)
+	{
+		for (auto& access : m_passes[m_schedule[i]].accesses)
+		{
+			Resource& resource = m_resources[access.resource];
+			if (resource.firstPass == NULL_INDEX)
+				resource.firstPass = i;
+			resource.lastPass = i;
+		}
+	}
+}
+
+void RenderGraph::AssignAliasSlots()
+{
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+	{
+		if (m_resources[i].desc.transient && m_resources[i].firstPass != NULL_INDEX)
+			transients.push_back(i);
+	}
+
+	std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_resources[a].firstPass < m_resources[b].firstPass;
+	});
+
+	for (uint32_t resourceIndex : transients)
+	{
+		Resource& resource = m_resources[resourceIndex];
+
+		// Among slots free before this resource starts, prefer the smallest that already fits,
+		// otherwise grow the largest one, which never costs more than a new slot
+		uint32_t bestSlot = NULL_INDEX;
+		for (uint32_t i = 0; i < (uint32_t)m_aliasSlots.size(); i++)
+		{
+			const AliasSlot& slot = m_aliasSlots[i];
+			if (slot.depthStencil != resource.desc.depthStencil)
+				continue;
+
+			if (m_resources[slot.resources.back()].lastPass >= resource.firstPass)
+				continue;
+
+			if (bestSlot == NULL_INDEX)
+			{
+				bestSlot = i;
+				continue;
+			}
+
+			uint32_t bestSize = m_aliasSlots[bestSlot].sizeInBytes;
+			bool fits = slot.sizeInBytes >= resource.desc.sizeInBytes;
+			bool bestFits = bestSize >= resource.desc.sizeInBytes;
+
+			if ((fits && (!bestFits || slot.sizeInBytes < bestSize)) || (!fits && !bestFits && slot.sizeInBytes > bestSize))
+				bestSlot = i;
+		}
+
+		if (bestSlot == NULL_INDEX)
+		{
+			m_aliasSlots.push_back({ 0, resource.desc.depthStencil, {} });
+			bestSlot = (uint32_t)m_aliasSlots.size() - 1;
+		}
+
+		AliasSlot& slot = m_aliasSlots[bestSlot];
+		slot.resources.push_back(resourceIndex);
+		slot.sizeInBytes = slot.sizeInBytes > resource.desc.sizeInBytes ? slot.sizeInBytes : resource.desc.sizeInBytes;
+		resource.aliasSlot = bestSlot;
+	}
+}
+
+void RenderGraph::ComputeBarriers()
+{
+	// Usages since last write, read usages are needed for write after read, visible ones already waited for last write
+	typedef struct _ResourceState
+	{
+		uint32_t	writeUsages;
+		uint32_t	readUsages;
+		uint32_t	visibleUsages;
+	}ResourceState;
+
+	std::vector<ResourceState> states(m_resources.size());
+	for (uint32_t i = 0; i < (uint32_t)m_resources.size(); i++)
+	{
+		const ResourceDesc& desc = m_resources[i].desc;
+		uint32_t initialUsages = desc.initialUsage == ResourceUsageNone ? 0 : (1 << desc.initialUsage);
+		states[i] = { desc.initialWrite ? initialUsages : 0, desc.initialWrite ? 0 : initialUsages, 0 };
+	}
+
+	for (auto& pass : m_passes)
+		pass.barriers.clear();
+
+	for (uint32_t i = 0; i < (uint32_t)m_schedule.size(); i++)
+	{
+		Pass& pass = m_passes[m_schedule[i]];
+
+		for (auto& access : pass.accesses)
+		{
+			const Resource& resource = m_resources[access.resource];
+			ResourceState& state = states[access.resource];
+			uint32_t usage = 1 << access.usage;
+
+			bool aliased = resource.aliasSlot != NULL_INDEX && m_aliasSlots[resource.aliasSlot].resources.size() > 1;
+			if (aliased && resource.firstPass == i)
+			{
+				// Wait for previous owner of the memory to finish, its content is discarded
+				const std::vector<uint32_t>& slotResources = m_aliasSlots[resource.aliasSlot].resources;
+				uint32_t slotIndex = (uint32_t)(std::find(slotResources.begin(), slotResources.end(), access.resource) - slotResources.begin());
+
+				Barrier barrier = { access.resource, 0, false, usage, access.write, true };
+				if (slotIndex > 0)
+				{
+					const ResourceState& prevState = states[slotResources[slotIndex - 1]];
+					barrier.srcWrite = prevState.readUsages == 0;
+					barrier.srcUsages = barrier.srcWrite ? prevState.writeUsages : prevState.readUsages;
+				}
+				pass.barriers.push_back(barrier);
+
+				state = { access.write ? usage : 0, access.write ? 0 : usage, 0 };
+				continue;
+			}
+
+			if (access.write)
+			{
+				// Write after read only needs execution dependency, write after write needs memory dependency too
+				if (state.readUsages != 0)
+					pass.barriers.push_back({ access.resource, state.readUsages, false, usage, true, false });
+				else if (state.writeUsages != 0)
+					pass.barriers.push_back({ access.resource, state.writeUsages, true, usage, true, false });
+
+				state = { usage, 0, 0 };
+			}
+			else
+			{
+				// Read after read needs nothing, unless this usage never waited for last write
+				if (state.writeUsages != 0 && (state.visibleUsages & usage) == 0)
+				{
+					pass.barriers.push_back({ access.resource, state.writeUsages, true, usage, false, false });
+					state.visibleUsages |= usage;
+				}
+
+				state.readUsages |= usage;
+			}
+		}
+	}
+}
+
+uint32_t RenderGraph::GetBarrierCount() const
+{
+	uint32_t count = 0;
+	for (auto& pass : m_passes)
+		count += (uint32_t)pass.barriers.size();
+	return count;
+}
+
+uint32_t RenderGraph::GetTransientBytes() const
+{
+	uint32_t bytes = 0;
+	for (auto& resource : m_resources)
+	{
+		if (resource.aliasSlot != NULL_INDEX)
+			bytes += resource.desc.sizeInBytes;
+	}
+	return bytes;
+}
+
+uint32_t RenderGraph::GetAliasedTransientBytes() const
+{
+	uint32_t bytes = 0;
+	for (auto& slot : m_aliasSlots)
+		bytes += slot.sizeInBytes;
+	return bytes;
+}
+
+const char* RenderGraph::GetUsageName(ResourceUsage usage)
+{
+	switch (usage)
+	{
+	case ResourceUsageNone:				return "none";
+	case ResourceUsageColorAttachment:	return "color attachment";
+	case ResourceUsageDepthAttachment:	return "depth attachment";
+	case ResourceUsageSampled:			return "sampled";
+	default:							return "unknown";
+	}
+}
+
+static std::string GetUsageMaskName(uint32_t usages)
+{
+	std::string name;
+	for (uint32_t i = 0; i < RenderGraph::ResourceUsageCount; i++)
+	{
+		if ((usages & (1 << i)) == 0)
+			continue;
+
+		if (!name.empty())
+			name += " | ";
+		name += RenderGraph::GetUsageName((RenderGraph::ResourceUsage)i);
+	}
+	return name.empty() ? RenderGraph::GetUsageName(RenderGraph::ResourceUsageNone) : name;
+}
+
+std::string RenderGraph::Dump() const
+{
+	std::stringstream ss;
+
+	if (!m_compiled)
+	{
+		ss << "Render graph isn't compiled\n";
+		return ss.str();
+	}
+
+	ss << "Render graph: " << m_schedule.size() << " of " << m_passes.size() << " passes scheduled, "
+		<< m_resources.size() << " resources, " << GetBarrierCount() << " barriers\n";
+
+	uint32_t schedulePos = 0;
+	for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+	{
+		const Pass& pass = m_passes[i];
+		if (pass.culled)
+		{
+			ss << "  [culled] " << pass.name << "\n";
+			continue;
+		}
+
+		ss << "  [" << schedulePos++ << "] " << pass.name << "\n";
+
+		for (auto& barrier : pass.barriers)
+		{
+			ss << "      barrier " << m_resources[barrier.resource].desc.name << ": "
+				<< GetUsageMaskName(barrier.srcUsages) << (barrier.srcUsages == 0 ? "" : (barrier.srcWrite ? " write" : " read"))
+				<< " -> " << GetUsageMaskName(barrier.dstUsages) << (barrier.dstWrite ? " write" : " read")
+				<< (barrier.discard ? ", discard" : "") << "\n";
+		}
+
+		for (auto& access : pass.accesses)
+		{
+			ss << "      " << (access.read ? (access.write ? "read/write " : "read ") : "write ")
+				<< m_resources[access.resource].desc.name << " (" << GetUsageName(access.usage) << ")\n";
+		}
+	}
+
+	ss << "Resources:\n";
+	for (auto& resource : m_resources)
+	{
+		ss << "  " << resource.desc.name << " " << resource.desc.width << "x" << resource.desc.height
+			<< (resource.desc.transient ? ", transient" : "") << (resource.desc.output ? ", output" : "");
+
+		if (resource.firstPass == NULL_INDEX)
+			ss << ", unused";
+		else
+			ss << ", passes [" << resource.firstPass << ", " << resource.lastPass << "]";
+
+		if (resource.aliasSlot != NULL_INDEX)
+			ss << ", slot " << resource.aliasSlot;
+
+		ss << "\n";
+	}
+
+	ss << "Transient memory: " << GetTransientBytes() / 1024 << " KB in "
+		<< m_aliasSlots.size() << " slots taking " << GetAliasedTransientBytes() / 1024 << " KB\n";
+
+	return ss.str();
+}
\ No newline at end of file
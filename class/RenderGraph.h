@@ -0,0 +1,175 @@
+#pragma once
+
+#include "../Base/Base.h"
+#include <functional>
+#include <string>
+
+class CommandBuffer;
+class PerFrameResource;
+
+// Declarative description of a frame: passes declare which resources they read and write,
+// compilation derives pass culling, resource lifetimes, barriers and transient memory aliasing
+// Compilation only works on declarations, it doesn't need a device, execution and recording are in RenderGraphExecution.cpp
+class RenderGraph : public SelfRefBase<RenderGraph>
+{
+public:
+	static const uint32_t NULL_INDEX = 0xffffffff;
+
+	enum ResourceUsage
+	{
+		ResourceUsageNone,
+		ResourceUsageColorAttachment,
+		ResourceUsageDepthAttachment,
+		ResourceUsageSampled,
+		ResourceUsageCount
+	};
+
+	typedef struct _ResourceDesc
+	{
+		std::string		name;
+		uint32_t		width = 0;
+		uint32_t		height = 0;
+		uint32_t		sizeInBytes = 0;
+		bool			depthStencil = false;
+		// Produced and consumed within a frame, could share memory with other transient resources
+		bool			transient = false;
+		// Consumed outside of graph, e.g. presented or read by next frame, keeps its producers alive
+		bool			output = false;
+		// How resource is accessed before graph starts, a write here makes the first read wait for it
+		ResourceUsage	initialUsage = ResourceUsageNone;
+		bool			initialWrite = false;
+	}ResourceDesc;
+
+	// Execution and memory dependency before a pass, usages are masks of (1 << ResourceUsage)
+	typedef struct _Barrier
+	{
+		uint32_t		resource;
+		uint32_t		srcUsages;
+		bool			srcWrite;
+		uint32_t		dstUsages;
+		bool			dstWrite;
+		// Memory is shared with other transient resources, previous content is undefined
+		bool			discard;
+	}Barrier;
+
+	typedef std::function<void(const std::shared_ptr<CommandBuffer>&, uint32_t)> PassFunc;
+	typedef std::function<void(const std::shared_ptr<CommandBuffer>&, const std::vector<Barrier>&, uint32_t)> BarrierFunc;
+	// Records secondary command buffers with per frame resource of the recording thread, ahead of pass function
+	typedef std::function<void(const std::shared_ptr<PerFrameResource>&, uint32_t)> RecordFunc;
+
+protected:
+	typedef struct _ResourceAccess
+	{
+		uint32_t		resource;
+		ResourceUsage	usage;
+		bool			read;
+		bool			write;
+	}ResourceAccess;
+
+	typedef struct _Pass
+	{
+		std::string					name;
+		PassFunc					func;
+		std::vector<ResourceAccess>	accesses;
+		bool						sideEffect;
+		bool						culled;
+		std::vector<Barrier>		barriers;
+		std::vector<RecordFunc>		recordFuncs;
+		double						recordTime;
+	}Pass;
+
+	typedef struct _Resource
+	{
+		ResourceDesc	desc;
+		uint32_t		firstPass;
+		uint32_t		lastPass;
+		uint32_t		aliasSlot;
+	}Resource;
+
+	typedef struct _AliasSlot
+	{
+		uint32_t				sizeInBytes;
+		bool					depthStencil;
+		std::vector<uint32_t>	resources;
+	}AliasSlot;
+
+protected:
+	bool Init(const std::shared_ptr<RenderGraph>& pSelf);
+
+public:
+	static std::shared_ptr<RenderGraph> Create();
+
+public:
+	uint32_t AddResource(const ResourceDesc& desc);
+	uint32_t AddPass(const std::string& name, PassFunc func = nullptr);
+	// A pass could both read and write a resource, e.g. an attachment that's loaded then blended
+	void Read(uint32_t pass, uint32_t resource, ResourceUsage usage = ResourceUsageSampled);
+	void Write(uint32_t pass, uint32_t resource, ResourceUsage usage = ResourceUsageColorAttachment);
+	// Pass with side effect is never culled even if no one consumes what it writes
+	void SetSideEffect(uint32_t pass, bool sideEffect = true) { m_passes[pass].sideEffect = sideEffect; m_compiled = false; }
+	void SetPassFunc(uint32_t pass, PassFunc func) { m_passes[pass].func = func; }
+	void SetBarrierFunc(BarrierFunc func) { m_barrierFunc = func; }
+	// Each record function is a job of its own, so a pass with several draw batches is recorded by several workers
+	void AddRecordFunc(uint32_t pass, RecordFunc func) { m_passes[pass].recordFuncs.push_back(func); }
+	// Record functions run on worker threads, or on the thread calling Execute if disabled
+	void SetParallelRecording(bool parallel) { m_parallelRecording = parallel; }
+	bool IsParallelRecording() const { return m_parallelRecording; }
+
+	// Passes run in declaration order, so every read must refer to a write declared earlier, or to a non-transient resource
+	bool Compile();
+	// Run record functions of scheduled passes, then attach compiled barriers and run each pass function in schedule order
+	void Execute(const std::shared_ptr<CommandBuffer>& pCmdBuffer, uint32_t pingpong = 0);
+	// Human readable schedule, including culled passes, barriers, lifetimes and aliasing
+	std::string Dump() const;
+
+	bool IsCompiled() const { return m_compiled; }
+	uint32_t GetPassCount() const { return (uint32_t)m_passes.size(); }
+	uint32_t GetResourceCount() const { return (uint32_t)m_resources.size(); }
+	const std::string& GetPassName(uint32_t pass) const { return m_passes[pass].name; }
+	const ResourceDesc& GetResourceDesc(uint32_t resource) const { return m_resources[resource].desc; }
+	bool IsPassCulled(uint32_t pass) const { return m_passes[pass].culled; }
+	const std::vector<uint32_t>& GetSchedule() const { return m_schedule; }
+	const std::vector<Barrier>& GetPassBarriers(uint32_t pass) const { return m_passes[pass].barriers; }
+	uint32_t GetBarrierCount() const;
+	// Indices within schedule, NULL_INDEX if resource isn't used by any scheduled pass
+	void GetResourceLifetime(uint32_t resource, uint32_t& firstPass, uint32_t& lastPass) const { firstPass = m_resources[resource].firstPass; lastPass = m_resources[resource].lastPass; }
+	// NULL_INDEX if resource isn't transient or isn't used
+	uint32_t GetAliasSlot(uint32_t resource) const { return m_resources[resource].aliasSlot; }
+	uint32_t GetAliasSlotCount() const { return (uint32_t)m_aliasSlots.size(); }
+	// Resources sharing a slot, ordered by their first use
+	const std::vector<uint32_t>& GetAliasSlotResources(uint32_t slot) const { return m_aliasSlots[slot].resources; }
+	uint32_t GetAliasSlotSize(uint32_t slot) const { return m_aliasSlots[slot].sizeInBytes; }
+	uint32_t GetTransientBytes() const;
+	uint32_t GetAliasedTransientBytes() const;
+
+	// Timings of last Execute in milliseconds
+	// Pass record time sums up its record functions, serial time sums up all of them, which is the cost without workers
+	double GetPassRecordTime(uint32_t pass) const { return m_passes[pass].recordTime; }
+	double GetRecordTime() const { return m_recordTime; }
+	double GetSerialRecordTime() const { return m_serialRecordTime; }
+	double GetExecuteTime() const { return m_executeTime; }
+	std::string DumpRecordTimes() const;
+
+	static const char* GetUsageName(ResourceUsage usage);
+
+protected:
+	ResourceAccess& AcquireAccess(uint32_t pass, uint32_t resource, ResourceUsage usage);
+	void CullPasses();
+	void ComputeLifetimes();
+	void ComputeBarriers();
+	void AssignAliasSlots();
+	void RecordPasses(uint32_t pingpong);
+
+protected:
+	std::vector<Pass>		m_passes;
+	std::vector<Resource>	m_resources;
+	std::vector<uint32_t>	m_schedule;
+	std::vector<AliasSlot>	m_aliasSlots;
+	BarrierFunc				m_barrierFunc;
+	bool					m_compiled = false;
+
+	bool					m_parallelRecording = true;
+	double					m_recordTime = 0;
+	double					m_serialRecordTime = 0;
+	double					m_executeTime = 0;
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "RenderGraph.h"
+#include "../common/Macros.h"
+#include "../vulkan/GlobalDeviceObjects.h"
+#include "../vulkan/FrameManager.h"
+#include "../thread/ThreadTaskQueue.hpp"
+#include <sstream>
+#include <chrono>
+
+// Execution and recording of a compiled render graph, kept apart from compilation since they need device and worker threads
+
+void RenderGraph::Execute(const std::shared_ptr<CommandBuffer>& pCmdBuffer, uint32_t pingpong)
+{
+	ASSERTION(m_compiled);
+
+	RecordPasses(pingpong);
+
+	// Primary command buffer is recorded on this thread only, recorded secondary ones are joined here in schedule order
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t passIndex : m_schedule)
+	{
+		const Pass& pass = m_passes[passIndex];
+
+		if (!pass.barriers.empty() && m_barrierFunc != nullptr)
+			m_barrierFunc(pCmdBuffer, pass.barriers, pingpong);
+
+		if (pass.func != nullptr)
+			pass.func(pCmdBuffer, pingpong);
+	}
+
+	m_executeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void RenderGraph::RecordPasses(uint32_t pingpong)
+{
+	// Flatten record functions of scheduled passes, key: pass, value: record function index
+	std::vector<std::pair<uint32_t, uint32_t>> records;
+	for (uint32_t passIndex : m_schedule)
+	{
+		m_passes[passIndex].recordTime = 0;
+		for (uint32_t i = 0; i < (uint32_t)m_passes[passIndex].recordFuncs.size(); i++)
+			records.push_back({ passIndex, i });
+	}
+
+	m_recordTime = 0;
+	m_serialRecordTime = 0;
+
+	if (records.empty())
+		return;
+
+	// Each record writes its own slot, so no lock is needed
+	std::vector<double> recordTimes(records.size(), 0);
+
+	auto recordRange = [this, &records, &recordTimes, pingpong](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>& pPerFrameRes)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+			m_passes[records[i].first].recordFuncs[records[i].second](pPerFrameRes, pingpong);
+			recordTimes[i] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+	};
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	if (m_parallelRecording)
+		GlobalThreadTaskQueue()->ParallelFor((uint32_t)records.size(), 1, recordRange, FrameMgr()->FrameIndex());
+	else
+		recordRange(0, (uint32_t)records.size(), MainThreadPerFrameRes());
+
+	m_recordTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	for (uint32_t i = 0; i < (uint32_t)records.size(); i++)
+	{
+		m_passes[records[i].first].recordTime += recordTimes[i];
+		m_serialRecordTime += recordTimes[i];
+	}
+}
+
+std::string RenderGraph::DumpRecordTimes() const
+{
+	std::stringstream ss;
+
+	ss << "Render graph recording: " << m_recordTime << " ms" << (m_parallelRecording ? " on workers" : " on calling thread")
+		<< ", " << m_serialRecordTime << " ms serial";
+	if (m_recordTime > 0)
+		ss << " (" << m_serialRecordTime / m_recordTime << "x)";
+	ss << ", primary " << m_executeTime << " ms\n";
+
+	for (uint32_t passIndex : m_schedule)
+	{
+		if (m_passes[passIndex].recordFuncs.empty())
+			continue;
+
+		ss << "  " << m_passes[passIndex].name << ": " << m_passes[passIndex].recordTime << " ms, "
+			<< m_passes[passIndex].recordFuncs.size() << " records\n";
+	}
+
+	return ss.str();
+}
\ No newline at end of file
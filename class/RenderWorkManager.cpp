@@ -51,6 +51,10 @@ bool RenderWorkManager::Init()
 	if (!Singleton<RenderWorkManager>::Init())
 		return false;
 
+	// Transient targets are aliased before materials bind them
+	BuildRenderGraph();
+	AliasTransientTargets();
+
 	m_materials.resize(MaterialEnumCount);
 	for (uint32_t i = 0; i < MaterialEnumCount; i++)
 	{
@@ -130,6 +134,15 @@ bool RenderWorkManager::Init()
 		}
 	}
 
+	// Every material is a single pipeline with shared descriptor sets, so its draws form one multi draw range
+	// Sort keys only order draws within it front to back, state fields keep keys of different materials apart
+	for (uint32_t i = 0; i < MaterialEnumCount; i++)
+	{
+		RenderState renderState = (i == Shadow || i == SkinnedShadow) ? ShadowMapGen : Scene;
+		for (uint32_t j = 0; j < (uint32_t)m_materials[i].materialSet.size(); j++)
+			m_materials[i].materialSet[j]->SetDrawSortState(renderState, i, j);
+	}
+
 	return true;
 }
 
@@ -188,135 +201,482 @@ void RenderWorkManager::SyncMaterialData()
 
 void RenderWorkManager::Draw(const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
 {
-	GetMaterial(PBRGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(PBRSkinnedGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(PBRPlanetGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(BackgroundMotion)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer));
-	GetMaterial(PBRGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
-	GetMaterial(PBRSkinnedGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
-	GetMaterial(PBRPlanetGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->NextSubpass(pDrawCmdBuffer);
-	GetMaterial(BackgroundMotion)->DrawScreenQuad(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer));
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(BackgroundMotion)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(PBRPlanetGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(PBRSkinnedGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(PBRGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(MotionTileMax)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionTileMax)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionTileMax));
-	GetMaterial(MotionTileMax)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionTileMax), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionTileMax)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(MotionTileMax)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(MotionNeighborMax)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionNeighborMax)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionNeighborMax));
-	GetMaterial(MotionNeighborMax)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionNeighborMax), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionNeighborMax)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(MotionNeighborMax)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(Shadow)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(SkinnedShadow)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShadowMap)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap));
-	GetMaterial(Shadow)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap), pingpong);
-	GetMaterial(SkinnedShadow)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShadowMap)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(SkinnedShadow)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(Shadow)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(SSAO)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOSSR)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOSSR));
-	GetMaterial(SSAO)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOSSR), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOSSR)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(SSAO)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(SSAOBlurV)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurV)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurV));
-	GetMaterial(SSAOBlurV)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurV), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurV)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(SSAOBlurV)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(SSAOBlurH)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurH)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurH));
-	GetMaterial(SSAOBlurH)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurH), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurH)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(SSAOBlurH)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(DeferredShading)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(SkyBox)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading));
-	GetMaterial(DeferredShading)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->NextSubpass(pDrawCmdBuffer);
-	GetMaterial(SkyBox)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(SkyBox)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-	GetMaterial(DeferredShading)->AfterRenderPass(pDrawCmdBuffer, pingpong);
-
-
-	GetMaterial(TemporalResolve, pingpong)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassTemporalResolve)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(FrameBufferDiction::FrameBufferType_TemporalResolve, (FrameMgr()->FrameIndex() + 1) % GetSwapChain()->GetSwapChainImageCount(), (pingpong + 1) % 2));
-	GetMaterial(TemporalResolve, pingpong)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(FrameBufferDiction::FrameBufferType_TemporalResolve, (FrameMgr()->FrameIndex() + 1) % GetSwapChain()->GetSwapChainImageCount(), (pingpong + 1) % 2));
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassTemporalResolve)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(TemporalResolve, pingpong)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	m_pRenderGraph->Execute(pDrawCmdBuffer, pingpong);
+}
+
+uint32_t RenderWorkManager::AddRenderGraphImage(const std::string& name, const RenderGraphImage& image, bool transient, bool output)
+{
+	m_renderGraphImages.push_back(image);
+
+	// Describe resource by the target it currently refers to
+	std::shared_ptr<Image> pImage = AcquireRenderGraphImage((uint32_t)m_renderGraphImages.size() - 1, 0);
+
+	RenderGraph::ResourceDesc desc = {};
+	desc.name = name;
+	desc.width = pImage->GetImageInfo().extent.width;
+	desc.height = pImage->GetImageInfo().extent.height;
+	desc.sizeInBytes = (uint32_t)pImage->GetMemoryReqirments().size;
+	desc.depthStencil = image.colorTarget == DEPTH_STENCIL_TARGET;
+	desc.transient = transient;
+	desc.output = output;
+
+	// History is written by previous frame, while current result was read as history by previous frame
+	if (image.temporal)
+	{
+		desc.initialUsage = image.pingpongOffset == 0 ? RenderGraph::ResourceUsageColorAttachment : RenderGraph::ResourceUsageSampled;
+		desc.initialWrite = image.pingpongOffset == 0;
+	}
+
+	uint32_t resource = m_pRenderGraph->AddResource(desc);
+	ASSERTION(resource == m_renderGraphImages.size() - 1);
+	return resource;
+}
+
+std::shared_ptr<Image> RenderWorkManager::AcquireRenderGraphImage(uint32_t resource, uint32_t pingpong) const
+{
+	const RenderGraphImage& image = m_renderGraphImages[resource];
+
+	std::shared_ptr<FrameBuffer> pFrameBuffer;
+	if (image.temporal)
+		pFrameBuffer = FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(image.frameBufferType, (pingpong + image.pingpongOffset) % 2);
+	else
+		pFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffers(image.frameBufferType, image.layer)[FrameMgr()->FrameIndex()];
+
+	if (image.colorTarget == DEPTH_STENCIL_TARGET)
+		return pFrameBuffer->GetDepthStencilTarget();
+	return pFrameBuffer->GetColorTarget(image.colorTarget);
+}
+
+void RenderWorkManager::BuildRenderGraph()
+{
+	m_pRenderGraph = RenderGraph::Create();
+	m_renderGraphImages.clear();
+
+	typedef FrameBufferDiction FBD;
+
+	std::vector<uint32_t> gbuffers(FBD::GBufferCount);
+	gbuffers[FBD::GBuffer0] = AddRenderGraphImage("GBuffer0", { FBD::FrameBufferType_GBuffer, 0, FBD::GBuffer0 }, false);
+	gbuffers[FBD::GBuffer1] = AddRenderGraphImage("GBuffer1", { FBD::FrameBufferType_GBuffer, 0, FBD::GBuffer1 }, false);
+	gbuffers[FBD::GBuffer2] = AddRenderGraphImage("GBuffer2", { FBD::FrameBufferType_GBuffer, 0, FBD::GBuffer2 }, false);
+	gbuffers[FBD::MotionVector] = AddRenderGraphImage("MotionVector", { FBD::FrameBufferType_GBuffer, 0, FBD::MotionVector }, false);
+	uint32_t depth = AddRenderGraphImage("GBufferDepth", { FBD::FrameBufferType_GBuffer, 0, DEPTH_STENCIL_TARGET }, false);
+
+	uint32_t motionTileMax = AddRenderGraphImage("MotionTileMax", { FBD::FrameBufferType_MotionTileMax, 0, 0 }, true);
+	uint32_t motionNeighborMax = AddRenderGraphImage("MotionNeighborMax", { FBD::FrameBufferType_MotionNeighborMax, 0, 0 }, false);
+	uint32_t shadowMap = AddRenderGraphImage("ShadowMap", { FBD::FrameBufferType_ShadowMap, 0, DEPTH_STENCIL_TARGET }, false);
+	uint32_t ssao = AddRenderGraphImage("SSAO", { FBD::FrameBufferType_SSAOSSR, 0, 0 }, true);
+	uint32_t ssrInfo = AddRenderGraphImage("SSRInfo", { FBD::FrameBufferType_SSAOSSR, 0, 1 }, false);
+	uint32_t ssaoBlurV = AddRenderGraphImage("SSAOBlurV", { FBD::FrameBufferType_SSAOBlurV, 0, 0 }, true);
+	uint32_t ssaoBlurH = AddRenderGraphImage("SSAOBlurH", { FBD::FrameBufferType_SSAOBlurH, 0, 0 }, true);
+	uint32_t shadingResult = AddRenderGraphImage("ShadingResult", { FBD::FrameBufferType_Shading, 0, 0 }, false);
+	uint32_t ssrResult = AddRenderGraphImage("SSRResult", { FBD::FrameBufferType_Shading, 0, 1 }, false);
+
+	// Temporal results are history of next frame
+	std::vector<uint32_t> temporalHistory(FBD::TemporalFrameBufferCount);
+	std::vector<uint32_t> temporalResult(FBD::TemporalFrameBufferCount);
+	const char* temporalNames[] = { "ShadingResult", "SSRResult", "CombinedResult", "CoC" };
+	for (uint32_t i = 0; i < FBD::TemporalFrameBufferCount; i++)
+	{
+		temporalHistory[i] = AddRenderGraphImage(std::string("TemporalHistory") + temporalNames[i], { FBD::FrameBufferType_TemporalResolve, 0, i, true, 0 }, false);
+		temporalResult[i] = AddRenderGraphImage(std::string("Temporal") + temporalNames[i], { FBD::FrameBufferType_TemporalResolve, 0, i, true, 1 }, false, true);
+	}
+
+	// Postfilter layer shares target with prefilter layer
+	uint32_t dofHalfRes = AddRenderGraphImage("DOFPrefilterPostfilter", { FBD::FrameBufferType_DOF, FBD::PrefilterLayer, 0 }, false);
+	uint32_t dofBlur = AddRenderGraphImage("DOFBokehBlur", { FBD::FrameBufferType_DOF, FBD::BokehBlurLayer, 0 }, false);
+	uint32_t dofCombine = AddRenderGraphImage("DOFCombine", { FBD::FrameBufferType_DOF, FBD::CombineLayer, 0 }, false);
+
+	std::vector<uint32_t> bloom(BLOOM_ITER_COUNT + 1);
+	for (uint32_t i = 0; i < BLOOM_ITER_COUNT + 1; i++)
+		bloom[i] = AddRenderGraphImage("Bloom" + std::to_string(i), { FBD::FrameBufferType_Bloom, i, 0 }, false);
 
+	uint32_t combineResult = AddRenderGraphImage("CombineResult", { FBD::FrameBufferType_CombineResult, 0, 0 }, false);
+	uint32_t backBuffer = AddRenderGraphImage("BackBuffer", { FBD::FrameBufferType_PostProcessing, 0, 0 }, false, true);
+
+	uint32_t pass;
+
+	pass = m_pRenderGraph->AddPass("GBuffer", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(PBRGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(PBRSkinnedGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(PBRPlanetGBuffer)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(BackgroundMotion)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer));
+		GetMaterial(PBRGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
+		GetMaterial(PBRSkinnedGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
+		GetMaterial(PBRPlanetGBuffer)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->NextSubpass(pDrawCmdBuffer);
+		GetMaterial(BackgroundMotion)->DrawScreenQuad(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_GBuffer), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassGBuffer)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(BackgroundMotion)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(PBRPlanetGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(PBRSkinnedGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(PBRGBuffer)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, PBRGBuffer, 0, FBD::FrameBufferType_GBuffer);
+	AddRecordDraw(pass, PBRSkinnedGBuffer, 0, FBD::FrameBufferType_GBuffer);
+	AddRecordDraw(pass, PBRPlanetGBuffer, 0, FBD::FrameBufferType_GBuffer);
+	AddRecordDraw(pass, BackgroundMotion, 0, FBD::FrameBufferType_GBuffer, 0, true);
+	for (uint32_t gbuffer : gbuffers)
+		m_pRenderGraph->Write(pass, gbuffer);
+	m_pRenderGraph->Write(pass, depth, RenderGraph::ResourceUsageDepthAttachment);
+
+	pass = m_pRenderGraph->AddPass("MotionTileMax", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(MotionTileMax)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionTileMax)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionTileMax));
+		GetMaterial(MotionTileMax)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionTileMax), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionTileMax)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(MotionTileMax)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, MotionTileMax, 0, FBD::FrameBufferType_MotionTileMax);
+	m_pRenderGraph->Read(pass, gbuffers[FBD::MotionVector]);
+	m_pRenderGraph->Write(pass, motionTileMax);
+
+	pass = m_pRenderGraph->AddPass("MotionNeighborMax", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(MotionNeighborMax)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionNeighborMax)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionNeighborMax));
+		GetMaterial(MotionNeighborMax)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_MotionNeighborMax), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassMotionNeighborMax)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(MotionNeighborMax)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, MotionNeighborMax, 0, FBD::FrameBufferType_MotionNeighborMax);
+	m_pRenderGraph->Read(pass, motionTileMax);
+	m_pRenderGraph->Write(pass, motionNeighborMax);
+
+	pass = m_pRenderGraph->AddPass("ShadowMap", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(Shadow)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(SkinnedShadow)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShadowMap)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap));
+		GetMaterial(Shadow)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap), pingpong);
+		GetMaterial(SkinnedShadow)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_ShadowMap), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShadowMap)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(SkinnedShadow)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(Shadow)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, Shadow, 0, FBD::FrameBufferType_ShadowMap);
+	AddRecordDraw(pass, SkinnedShadow, 0, FBD::FrameBufferType_ShadowMap);
+	m_pRenderGraph->Write(pass, shadowMap, RenderGraph::ResourceUsageDepthAttachment);
+
+	pass = m_pRenderGraph->AddPass("SSAOSSR", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(SSAO)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOSSR)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOSSR));
+		GetMaterial(SSAO)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOSSR), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOSSR)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(SSAO)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, SSAO, 0, FBD::FrameBufferType_SSAOSSR);
+	m_pRenderGraph->Read(pass, gbuffers[FBD::GBuffer0]);
+	m_pRenderGraph->Read(pass, gbuffers[FBD::GBuffer2]);
+	m_pRenderGraph->Read(pass, depth);
+	m_pRenderGraph->Write(pass, ssao);
+	m_pRenderGraph->Write(pass, ssrInfo);
+
+	pass = m_pRenderGraph->AddPass("SSAOBlurV", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(SSAOBlurV)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurV)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurV));
+		GetMaterial(SSAOBlurV)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurV), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurV)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(SSAOBlurV)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, SSAOBlurV, 0, FBD::FrameBufferType_SSAOBlurV);
+	m_pRenderGraph->Read(pass, ssao);
+	m_pRenderGraph->Write(pass, ssaoBlurV);
+
+	pass = m_pRenderGraph->AddPass("SSAOBlurH", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(SSAOBlurH)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurH)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurH));
+		GetMaterial(SSAOBlurH)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_SSAOBlurH), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassSSAOBlurH)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(SSAOBlurH)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, SSAOBlurH, 0, FBD::FrameBufferType_SSAOBlurH);
+	m_pRenderGraph->Read(pass, ssaoBlurV);
+	m_pRenderGraph->Write(pass, ssaoBlurH);
+
+	pass = m_pRenderGraph->AddPass("Shading", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(DeferredShading)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(SkyBox)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading));
+		GetMaterial(DeferredShading)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->NextSubpass(pDrawCmdBuffer);
+		GetMaterial(SkyBox)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Shading), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassShading)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(SkyBox)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		GetMaterial(DeferredShading)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, DeferredShading, 0, FBD::FrameBufferType_Shading);
+	AddRecordDraw(pass, SkyBox, 0, FBD::FrameBufferType_Shading);
+	for (uint32_t gbuffer : gbuffers)
+		m_pRenderGraph->Read(pass, gbuffer);
+	m_pRenderGraph->Read(pass, depth);
+	m_pRenderGraph->Read(pass, shadowMap);
+	m_pRenderGraph->Read(pass, ssaoBlurH);
+	m_pRenderGraph->Read(pass, ssrInfo);
+	m_pRenderGraph->Write(pass, shadingResult);
+	m_pRenderGraph->Write(pass, ssrResult);
+
+	pass = m_pRenderGraph->AddPass("TemporalResolve", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(TemporalResolve, pingpong)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassTemporalResolve)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(FrameBufferDiction::FrameBufferType_TemporalResolve, (FrameMgr()->FrameIndex() + 1) % GetSwapChain()->GetSwapChainImageCount(), (pingpong + 1) % 2));
+		GetMaterial(TemporalResolve, pingpong)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(FrameBufferDiction::FrameBufferType_TemporalResolve, (FrameMgr()->FrameIndex() + 1) % GetSwapChain()->GetSwapChainImageCount(), (pingpong + 1) % 2), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassTemporalResolve)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(TemporalResolve, pingpong)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	m_pRenderGraph->AddRecordFunc(pass, [this](const std::shared_ptr<PerFrameResource>& pPerFrameRes, uint32_t pingpong)
+	{
+		GetMaterial(TemporalResolve, pingpong)->RecordDraw(pPerFrameRes, FrameBufferDiction::GetInstance()->GetPingPongFrameBuffer(FrameBufferDiction::FrameBufferType_TemporalResolve, (FrameMgr()->FrameIndex() + 1) % GetSwapChain()->GetSwapChainImageCount(), (pingpong + 1) % 2), pingpong);
+	});
+	m_pRenderGraph->Read(pass, gbuffers[FBD::MotionVector]);
+	m_pRenderGraph->Read(pass, gbuffers[FBD::GBuffer1]);
+	m_pRenderGraph->Read(pass, shadingResult);
+	m_pRenderGraph->Read(pass, ssrResult);
+	m_pRenderGraph->Read(pass, motionNeighborMax);
+	for (uint32_t i = 0; i < FBD::TemporalFrameBufferCount; i++)
+	{
+		m_pRenderGraph->Read(pass, temporalHistory[i]);
+		m_pRenderGraph->Write(pass, temporalResult[i]);
+	}
+
+	const char* dofPassNames[] = { "DOFPrefilter", "DOFBokehBlur", "DOFPostfilter", "DOFCombine" };
 	for (uint32_t i = 0; i < DOFMaterial::DOFPass_Count; i++)
 	{
-		std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_DOF, i);
-		Vector2ui size = { pTargetFrameBuffer->GetFramebufferInfo().width, pTargetFrameBuffer->GetFramebufferInfo().height };
-
-		GetMaterial(DepthOfField, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassDOF)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
-		GetMaterial(DepthOfField, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassDOF)->EndRenderPass(pDrawCmdBuffer);
-		GetMaterial(DepthOfField, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		pass = m_pRenderGraph->AddPass(dofPassNames[i], [this, i](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+		{
+			std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_DOF, i);
+
+			GetMaterial(DepthOfField, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassDOF)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
+			GetMaterial(DepthOfField, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassDOF)->EndRenderPass(pDrawCmdBuffer);
+			GetMaterial(DepthOfField, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		});
+
+		AddRecordDraw(pass, DepthOfField, i, FBD::FrameBufferType_DOF, i);
+
+		switch ((DOFMaterial::DOFPass)i)
+		{
+		case DOFMaterial::DOFPass_Prefilter:
+			m_pRenderGraph->Read(pass, temporalResult[FBD::CombinedResult]);
+			m_pRenderGraph->Read(pass, temporalResult[FBD::CoC]);
+			m_pRenderGraph->Write(pass, dofHalfRes);
+			break;
+		case DOFMaterial::DOFPass_Blur:
+			m_pRenderGraph->Read(pass, dofHalfRes);
+			m_pRenderGraph->Write(pass, dofBlur);
+			break;
+		case DOFMaterial::DOFPass_Postfilter:
+			m_pRenderGraph->Read(pass, dofBlur);
+			m_pRenderGraph->Write(pass, dofHalfRes);
+			break;
+		case DOFMaterial::DOFPass_Combine:
+			m_pRenderGraph->Read(pass, dofHalfRes);
+			m_pRenderGraph->Read(pass, temporalResult[FBD::CombinedResult]);
+			m_pRenderGraph->Read(pass, temporalResult[FBD::CoC]);
+			m_pRenderGraph->Write(pass, dofCombine);
+			break;
+		default:
+			ASSERTION(false);
+			break;
+		}
 	}
 
 	// Downsample first
 	for (uint32_t i = 0; i < BLOOM_ITER_COUNT; i++)
 	{
-		std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Bloom, i + 1);
-		Vector2ui size = { pTargetFrameBuffer->GetFramebufferInfo().width, pTargetFrameBuffer->GetFramebufferInfo().height };
-
-		GetMaterial(BloomDownSample, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
-		GetMaterial(BloomDownSample, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->EndRenderPass(pDrawCmdBuffer);
-		GetMaterial(BloomDownSample, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		pass = m_pRenderGraph->AddPass("BloomDownSample" + std::to_string(i), [this, i](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+		{
+			std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Bloom, i + 1);
+
+			GetMaterial(BloomDownSample, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
+			GetMaterial(BloomDownSample, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->EndRenderPass(pDrawCmdBuffer);
+			GetMaterial(BloomDownSample, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		});
+		AddRecordDraw(pass, BloomDownSample, i, FBD::FrameBufferType_Bloom, i + 1);
+		m_pRenderGraph->Read(pass, i == 0 ? dofCombine : bloom[i]);
+		m_pRenderGraph->Write(pass, bloom[i + 1]);
 	}
 
 	// Upsample then
 	for (int32_t i = BLOOM_ITER_COUNT - 1; i >= 0; i--)
 	{
-		std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Bloom, i);
-		Vector2ui size = { pTargetFrameBuffer->GetFramebufferInfo().width, pTargetFrameBuffer->GetFramebufferInfo().height };
-
-		GetMaterial(BloomUpSample, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
-		GetMaterial(BloomUpSample, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
-		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->EndRenderPass(pDrawCmdBuffer);
-		GetMaterial(BloomUpSample, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		pass = m_pRenderGraph->AddPass("BloomUpSample" + std::to_string(i), [this, i](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+		{
+			std::shared_ptr<FrameBuffer> pTargetFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_Bloom, i);
+
+			GetMaterial(BloomUpSample, i)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->BeginRenderPass(pDrawCmdBuffer, pTargetFrameBuffer);
+			GetMaterial(BloomUpSample, i)->Draw(pDrawCmdBuffer, pTargetFrameBuffer, pingpong);
+			RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassBloom)->EndRenderPass(pDrawCmdBuffer);
+			GetMaterial(BloomUpSample, i)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+		});
+		AddRecordDraw(pass, BloomUpSample, i, FBD::FrameBufferType_Bloom, i);
+		m_pRenderGraph->Read(pass, bloom[i + 1]);
+		m_pRenderGraph->Write(pass, bloom[i]);
 	}
 
-	GetMaterial(Combine)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassCombine)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_CombineResult));
-	GetMaterial(Combine)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_CombineResult), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassCombine)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(Combine)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	pass = m_pRenderGraph->AddPass("Combine", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(Combine)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassCombine)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_CombineResult));
+		GetMaterial(Combine)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_CombineResult), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassCombine)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(Combine)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, Combine, 0, FBD::FrameBufferType_CombineResult);
+	m_pRenderGraph->Read(pass, dofCombine);
+	m_pRenderGraph->Read(pass, bloom[0]);
+	m_pRenderGraph->Write(pass, combineResult);
+
+	pass = m_pRenderGraph->AddPass("PostProcess", [this](const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong)
+	{
+		GetMaterial(PostProcess)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassPostProcessing)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_PostProcessing));
+		GetMaterial(PostProcess)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_PostProcessing), pingpong);
+		RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassPostProcessing)->EndRenderPass(pDrawCmdBuffer);
+		GetMaterial(PostProcess)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	});
+	AddRecordDraw(pass, PostProcess, 0, FBD::FrameBufferType_PostProcessing);
+	m_pRenderGraph->Read(pass, combineResult);
+	m_pRenderGraph->Read(pass, motionNeighborMax);
+	m_pRenderGraph->Write(pass, backBuffer);
+
+	m_pRenderGraph->SetBarrierFunc([this](const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<RenderGraph::Barrier>& barriers, uint32_t pingpong)
+	{
+		AttachRenderGraphBarriers(pCmdBuffer, barriers, pingpong);
+	});
+
+	bool ret = m_pRenderGraph->Compile();
+	ASSERTION(ret);
+}
+
+void RenderWorkManager::AddRecordDraw(uint32_t pass, MaterialEnum materialEnum, uint32_t materialIndex, FrameBufferDiction::FrameBufferType frameBufferType, uint32_t layer, bool screenQuad)
+{
+	m_pRenderGraph->AddRecordFunc(pass, [this, materialEnum, materialIndex, frameBufferType, layer, screenQuad](const std::shared_ptr<PerFrameResource>& pPerFrameRes, uint32_t pingpong)
+	{
+		std::shared_ptr<FrameBuffer> pFrameBuffer = FrameBufferDiction::GetInstance()->GetFrameBuffer(frameBufferType, layer);
+
+		if (screenQuad)
+			GetMaterial(materialEnum, materialIndex)->RecordDrawScreenQuad(pPerFrameRes, pFrameBuffer, pingpong);
+		else
+			GetMaterial(materialEnum, materialIndex)->RecordDraw(pPerFrameRes, pFrameBuffer, pingpong);
+	});
+}
+
+void RenderWorkManager::AliasTransientTargets()
+{
+	// Largest resource of a slot owns the memory, others are recreated on top of it
+	std::vector<uint32_t> owners(m_pRenderGraph->GetAliasSlotCount(), RenderGraph::NULL_INDEX);
+	for (uint32_t i = 0; i < m_pRenderGraph->GetAliasSlotCount(); i++)
+	{
+		for (uint32_t resource : m_pRenderGraph->GetAliasSlotResources(i))
+		{
+			if (owners[i] == RenderGraph::NULL_INDEX || m_pRenderGraph->GetResourceDesc(resource).sizeInBytes > m_pRenderGraph->GetResourceDesc(owners[i]).sizeInBytes)
+				owners[i] = resource;
+		}
+	}
 
+	for (uint32_t i = 0; i < m_pRenderGraph->GetAliasSlotCount(); i++)
+	{
+		const RenderGraphImage& ownerImage = m_renderGraphImages[owners[i]];
+
+		for (uint32_t resource : m_pRenderGraph->GetAliasSlotResources(i))
+		{
+			const RenderGraphImage& image = m_renderGraphImages[resource];
+			if (resource == owners[i] || image.temporal || image.layer != 0 || image.colorTarget == DEPTH_STENCIL_TARGET)
+				continue;
+
+			// Recreating a frame buffer replaces all of its targets, so those holding memory of any slot are left alone
+			bool holdsOwner = false;
+			for (uint32_t owner : owners)
+				holdsOwner = holdsOwner || m_renderGraphImages[owner].frameBufferType == image.frameBufferType;
+
+			if (!holdsOwner)
+				FrameBufferDiction::GetInstance()->AliasColorTarget(image.frameBufferType, image.colorTarget, ownerImage.frameBufferType, ownerImage.colorTarget);
+		}
+	}
+}
+
+static VkPipelineStageFlags GetRenderGraphStageFlags(uint32_t usages)
+{
+	VkPipelineStageFlags stages = 0;
+	if (usages & (1 << RenderGraph::ResourceUsageColorAttachment))
+		stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	if (usages & (1 << RenderGraph::ResourceUsageDepthAttachment))
+		stages |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	if (usages & (1 << RenderGraph::ResourceUsageSampled))
+		stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	return stages;
+}
+
+static VkAccessFlags GetRenderGraphAccessFlags(uint32_t usages, bool write)
+{
+	VkAccessFlags access = 0;
+	if (usages & (1 << RenderGraph::ResourceUsageColorAttachment))
+		access |= write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+	if (usages & (1 << RenderGraph::ResourceUsageDepthAttachment))
+		access |= write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	if ((usages & (1 << RenderGraph::ResourceUsageSampled)) && !write)
+		access |= VK_ACCESS_SHADER_READ_BIT;
+	return access;
+}
+
+void RenderWorkManager::AttachRenderGraphBarriers(const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<RenderGraph::Barrier>& barriers, uint32_t pingpong) const
+{
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	std::vector<VkImageMemoryBarrier> imgBarriers;
+
+	for (auto& barrier : barriers)
+	{
+		std::shared_ptr<Image> pImage = AcquireRenderGraphImage(barrier.resource, pingpong);
+		VkFormat format = pImage->GetImageInfo().format;
+
+		VkImageSubresourceRange subresourceRange = {};
+		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		if (m_renderGraphImages[barrier.resource].colorTarget == DEPTH_STENCIL_TARGET)
+		{
+			subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			if (format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT)
+				subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		subresourceRange.baseMipLevel = 0;
+		subresourceRange.levelCount = pImage->GetImageInfo().mipLevels;
+		subresourceRange.layerCount = pImage->GetImageInfo().arrayLayers;
+
+		// Render passes leave their targets shader readable, layout only changes when aliased memory is discarded
+		VkImageMemoryBarrier imgBarrier = {};
+		imgBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imgBarrier.image = pImage->GetDeviceHandle();
+		imgBarrier.subresourceRange = subresourceRange;
+		imgBarrier.oldLayout = barrier.discard ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imgBarrier.srcAccessMask = barrier.srcWrite ? GetRenderGraphAccessFlags(barrier.srcUsages, true) : 0;
+		imgBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imgBarrier.dstAccessMask = GetRenderGraphAccessFlags(barrier.dstUsages, false) | (barrier.dstWrite ? GetRenderGraphAccessFlags(barrier.dstUsages, true) : 0);
+
+		imgBarriers.push_back(imgBarrier);
+
+		srcStages |= GetRenderGraphStageFlags(barrier.srcUsages);
+		dstStages |= GetRenderGraphStageFlags(barrier.dstUsages);
+	}
 
-	GetMaterial(PostProcess)->BeforeRenderPass(pDrawCmdBuffer, pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassPostProcessing)->BeginRenderPass(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_PostProcessing));
-	GetMaterial(PostProcess)->Draw(pDrawCmdBuffer, FrameBufferDiction::GetInstance()->GetFrameBuffer(FrameBufferDiction::FrameBufferType_PostProcessing), pingpong);
-	RenderPassDiction::GetInstance()->GetPipelineRenderPass(RenderPassDiction::PipelineRenderPassPostProcessing)->EndRenderPass(pDrawCmdBuffer);
-	GetMaterial(PostProcess)->AfterRenderPass(pDrawCmdBuffer, pingpong);
+	pCmdBuffer->AttachBarriers
+	(
+		srcStages == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : srcStages,
+		dstStages,
+		{},
+		{},
+		imgBarriers
+	);
 }
 
 void RenderWorkManager::OnFrameBegin()
@@ -3,6 +3,8 @@
 #include "../common/Singleton.h"
 #include "../vulkan/RenderPass.h"
 #include "RenderPassDiction.h"
+#include "FrameBufferDiction.h"
+#include "RenderGraph.h"
 
 class FrameBuffer;
 class Texture2D;
@@ -24,6 +26,7 @@ class CommandBuffer;
 class DOFMaterial;
 class GBufferPlanetMaterial;
 class Material;
+class Image;
 
 class RenderWorkManager : public Singleton<RenderWorkManager>
 {
@@ -85,6 +88,8 @@ public:
 	void SyncMaterialData();
 	void Draw(const std::shared_ptr<CommandBuffer>& pDrawCmdBuffer, uint32_t pingpong);
 
+	std::shared_ptr<RenderGraph> GetRenderGraph() const { return m_pRenderGraph; }
+
 	void OnFrameBegin();
 	void OnFrameEnd();
 
@@ -99,6 +104,30 @@ protected:
 
 	std::shared_ptr<Material>	GetMaterial(MaterialEnum materialEnum, uint32_t index = 0) const { return m_materials[materialEnum].GetMaterial(index); }
 
-	std::vector<MaterialSet>	m_materials;
-	uint32_t					m_renderStateMask;
+	// Frame buffer target a render graph resource refers to, resolved when barriers are attached
+	// as frame buffers are per swapchain image and temporal ones are per pingpong
+	typedef struct _RenderGraphImage
+	{
+		FrameBufferDiction::FrameBufferType	frameBufferType;
+		uint32_t							layer;
+		uint32_t							colorTarget;		// DEPTH_STENCIL_TARGET for depth stencil target
+		bool								temporal;
+		uint32_t							pingpongOffset;		// Temporal only, history is 0, current result is 1
+	}RenderGraphImage;
+
+	static const uint32_t DEPTH_STENCIL_TARGET = 0xffffffff;
+
+	void BuildRenderGraph();
+	uint32_t AddRenderGraphImage(const std::string& name, const RenderGraphImage& image, bool transient, bool output = false);
+	std::shared_ptr<Image> AcquireRenderGraphImage(uint32_t resource, uint32_t pingpong) const;
+	void AliasTransientTargets();
+	// Secondary command buffers of a material draw are recorded ahead of pass function, as a job of its own
+	void AddRecordDraw(uint32_t pass, MaterialEnum materialEnum, uint32_t materialIndex, FrameBufferDiction::FrameBufferType frameBufferType, uint32_t layer = 0, bool screenQuad = false);
+	void AttachRenderGraphBarriers(const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<RenderGraph::Barrier>& barriers, uint32_t pingpong) const;
+
+	std::vector<MaterialSet>		m_materials;
+	uint32_t						m_renderStateMask;
+
+	std::shared_ptr<RenderGraph>	m_pRenderGraph;
+	std::vector<RenderGraphImage>	m_renderGraphImages;
 };
\ No newline at end of file
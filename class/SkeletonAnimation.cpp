@@ -1,22 +1,23 @@
 #include "SkeletonAnimation.h"
 #include "../Maths/AssimpDataConverter.h"
 #include "scene.h"
-#include "UniformData.h"
 #include <codecvt>
 #include <locale>
+#include <algorithm>
+#include <cmath>
 
-bool SkeletonAnimation::Init(const std::shared_ptr<SkeletonAnimation>& pSelf, const aiScene* pAssimpScene)
+bool SkeletonAnimation::Init(const std::shared_ptr<SkeletonAnimation>& pSelf, const aiAnimation* const* ppAssimpAnimations, uint32_t animationCount)
 {
 	if (!SelfRefBase<SkeletonAnimation>::Init(pSelf))
 		return false;
 
-	if (pAssimpScene->mNumAnimations == 0)
+	if (animationCount == 0)
 		return false;
 
-	for (uint32_t i = 0; i < pAssimpScene->mNumAnimations; i++)
+	for (uint32_t i = 0; i < animationCount; i++)
 	{
 		AnimationData animationData = {};
-		AssemblyAnimationData(pAssimpScene->mAnimations[i], animationData);
+		AssemblyAnimationData(ppAssimpAnimations[i], animationData);
 
 		m_animationDataDiction.push_back(animationData);
 		m_animationDataLookupTable[std::hash<std::wstring>()(animationData.animationName)] = (uint32_t)m_animationDataDiction.size() - 1;
@@ -26,9 +27,14 @@ bool SkeletonAnimation::Init(const std::shared_ptr<SkeletonAnimation>& pSelf, co
 }
 
 std::shared_ptr<SkeletonAnimation> SkeletonAnimation::Create(const aiScene* pAssimpScene)
+{
+	return Create(pAssimpScene->mAnimations, pAssimpScene->mNumAnimations);
+}
+
+std::shared_ptr<SkeletonAnimation> SkeletonAnimation::Create(const aiAnimation* const* ppAssimpAnimations, uint32_t animationCount)
 {
 	std::shared_ptr<SkeletonAnimation> pSkeletonAnimation = std::make_shared<SkeletonAnimation>();
-	if (pSkeletonAnimation != nullptr && pSkeletonAnimation->Init(pSkeletonAnimation, pAssimpScene))
+	if (pSkeletonAnimation != nullptr && pSkeletonAnimation->Init(pSkeletonAnimation, ppAssimpAnimations, animationCount))
 		return pSkeletonAnimation;
 
 	return nullptr;
@@ -39,41 +45,398 @@ void SkeletonAnimation::AssemblyAnimationData(const aiAnimation* pAssimpAnimatio
 	animationData.animationName = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(pAssimpAnimation->mName.C_Str());
 	animationData.duration = pAssimpAnimation->mDuration / pAssimpAnimation->mTicksPerSecond;
 
+	// Raw bytes of time array to its offset, only used while assembling
+	std::unordered_map<std::string, uint32_t> timeOffsetTable;
+
 	for (uint32_t i = 0; i < pAssimpAnimation->mNumChannels; i++)
 	{
-		ObjectAnimation objectAnimation = {};
-		AssemblyObjectAnimation(pAssimpAnimation->mChannels[i], pAssimpAnimation->mTicksPerSecond, objectAnimation);
+		AnimationTrack track = {};
+		AssemblyAnimationTrack(pAssimpAnimation->mChannels[i], pAssimpAnimation->mTicksPerSecond, animationData, timeOffsetTable, track);
 
-		animationData.objectAnimationDiction.push_back(objectAnimation);
-		animationData.objectAnimationLookupTable[std::hash<std::wstring>()(objectAnimation.objectName)] = (uint32_t)animationData.objectAnimationDiction.size() - 1;
+		animationData.tracks.push_back(track);
+		animationData.trackLookupTable[track.objectNameHashCode] = (uint32_t)animationData.tracks.size() - 1;
 	}
 }
 
-void SkeletonAnimation::AssemblyObjectAnimation(const aiNodeAnim* pAssimpNodeAnimation, double ticksPerSecond, ObjectAnimation& objectAnimation)
+const double SkeletonAnimation::ROTATION_TOLERANCE = 0.0005;
+const double SkeletonAnimation::TRANSLATION_TOLERANCE = 0.0001;
+const double SkeletonAnimation::SCALE_TOLERANCE = 0.0001;
+
+// Smallest three components of a unit quaternion lie within [-1/sqrt(2), 1/sqrt(2)]
+static const double SQRT_2 = 1.4142135623730951;
+static const double INV_SQRT_2 = 0.7071067811865475;
+static const double ROTATION_QUANTIZE_MAX = 32767.0;
+static const double VECTOR_QUANTIZE_MAX = 65535.0;
+
+void SkeletonAnimation::AssemblyAnimationTrack(const aiNodeAnim* pAssimpNodeAnimation, double ticksPerSecond, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable, AnimationTrack& track)
 {
-	objectAnimation.objectName = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(pAssimpNodeAnimation->mNodeName.C_Str());
+	track.objectName = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(pAssimpNodeAnimation->mNodeName.C_Str());
+	track.objectNameHashCode = std::hash<std::wstring>()(track.objectName);
+
+	animationData.sourceKeyFrameCount += pAssimpNodeAnimation->mNumRotationKeys + pAssimpNodeAnimation->mNumPositionKeys + pAssimpNodeAnimation->mNumScalingKeys;
+	animationData.sourceDataBytes += pAssimpNodeAnimation->mNumRotationKeys * sizeof(aiQuatKey);
+	animationData.sourceDataBytes += (pAssimpNodeAnimation->mNumPositionKeys + pAssimpNodeAnimation->mNumScalingKeys) * sizeof(aiVectorKey);
+
+	std::vector<float> times;
+	std::vector<float> keptTimes;
 
+	std::vector<Quaterniond> rotations;
+	times.resize(pAssimpNodeAnimation->mNumRotationKeys);
+	rotations.resize(pAssimpNodeAnimation->mNumRotationKeys);
 	for (uint32_t i = 0; i < pAssimpNodeAnimation->mNumRotationKeys; i++)
 	{
-		RotationKeyFrame rotationKeyFrame = {};
-		rotationKeyFrame.time = pAssimpNodeAnimation->mRotationKeys[i].mTime / ticksPerSecond;
-		rotationKeyFrame.transform = AssimpDataConverter::AcquireQuaternion(pAssimpNodeAnimation->mRotationKeys[i].mValue);
-		objectAnimation.rotationKeyFrames.push_back(rotationKeyFrame);
+		times[i] = (float)(pAssimpNodeAnimation->mRotationKeys[i].mTime / ticksPerSecond);
+		rotations[i] = AssimpDataConverter::AcquireQuaternion(pAssimpNodeAnimation->mRotationKeys[i].mValue);
 	}
 
+	std::vector<uint32_t> keptKeyFrames = ReduceRotationKeyFrames(times, rotations, ROTATION_TOLERANCE);
+
+	track.rotationChannel.keyOffset = (uint32_t)animationData.rotationStreams[0].size();
+	track.rotationChannel.keyFrameCount = (uint32_t)keptKeyFrames.size();
+	keptTimes.clear();
+	for (uint32_t index : keptKeyFrames)
+	{
+		keptTimes.push_back(times[index]);
+
+		uint16_t s0, s1, s2;
+		EncodeRotation(rotations[index], s0, s1, s2);
+		animationData.rotationStreams[0].push_back(s0);
+		animationData.rotationStreams[1].push_back(s1);
+		animationData.rotationStreams[2].push_back(s2);
+	}
+	track.rotationChannel.timeOffset = AcquireSharedTimeOffset(keptTimes, animationData, timeOffsetTable);
+	animationData.keyFrameCount += track.rotationChannel.keyFrameCount;
+
+	std::vector<Vector3d> values;
+	times.resize(pAssimpNodeAnimation->mNumPositionKeys);
+	values.resize(pAssimpNodeAnimation->mNumPositionKeys);
 	for (uint32_t i = 0; i < pAssimpNodeAnimation->mNumPositionKeys; i++)
 	{
-		TranslationKeyFrame translationKeyFrame = {};
-		translationKeyFrame.time = pAssimpNodeAnimation->mRotationKeys[i].mTime;
-		translationKeyFrame.transform = AssimpDataConverter::AcquireVector3(pAssimpNodeAnimation->mPositionKeys[i].mValue);
-		objectAnimation.translationKeyFrames.push_back(translationKeyFrame);
+		times[i] = (float)(pAssimpNodeAnimation->mPositionKeys[i].mTime / ticksPerSecond);
+		values[i] = AssimpDataConverter::AcquireVector3(pAssimpNodeAnimation->mPositionKeys[i].mValue);
 	}
+	AssemblyVectorChannel(times, values, TRANSLATION_TOLERANCE, animationData.translationStreams, animationData, timeOffsetTable, track.translationChannel);
 
+	times.resize(pAssimpNodeAnimation->mNumScalingKeys);
+	values.resize(pAssimpNodeAnimation->mNumScalingKeys);
 	for (uint32_t i = 0; i < pAssimpNodeAnimation->mNumScalingKeys; i++)
 	{
-		ScaleKeyFrame scaleKeyFrame = {};
-		scaleKeyFrame.time = pAssimpNodeAnimation->mRotationKeys[i].mTime;
-		scaleKeyFrame.transform = AssimpDataConverter::AcquireVector3(pAssimpNodeAnimation->mScalingKeys[i].mValue);
-		objectAnimation.ScaleKeyFrames.push_back(scaleKeyFrame);
+		times[i] = (float)(pAssimpNodeAnimation->mScalingKeys[i].mTime / ticksPerSecond);
+		values[i] = AssimpDataConverter::AcquireVector3(pAssimpNodeAnimation->mScalingKeys[i].mValue);
+	}
+	AssemblyVectorChannel(times, values, SCALE_TOLERANCE, animationData.scaleStreams, animationData, timeOffsetTable, track.scaleChannel);
+}
+
+void SkeletonAnimation::AssemblyVectorChannel(const std::vector<float>& times, const std::vector<Vector3d>& values, double tolerance, std::vector<uint16_t>* pStreams, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable, AnimationChannel& channel)
+{
+	std::vector<uint32_t> keptKeyFrames = ReduceVectorKeyFrames(times, values, tolerance);
+
+	// Quantization range covers kept key frames only
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		float minValue = 0.0f, maxValue = 0.0f;
+		for (uint32_t j = 0; j < keptKeyFrames.size(); j++)
+		{
+			float value = (float)values[keptKeyFrames[j]][i];
+			minValue = (j == 0 || value < minValue) ? value : minValue;
+			maxValue = (j == 0 || value > maxValue) ? value : maxValue;
+		}
+		channel.rangeMin[i] = minValue;
+		channel.rangeExtent[i] = maxValue - minValue;
+	}
+
+	channel.keyOffset = (uint32_t)pStreams[0].size();
+	channel.keyFrameCount = (uint32_t)keptKeyFrames.size();
+
+	std::vector<float> keptTimes;
+	for (uint32_t index : keptKeyFrames)
+	{
+		keptTimes.push_back(times[index]);
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			double normalized = channel.rangeExtent[i] > 0.0f ? ((float)values[index][i] - channel.rangeMin[i]) / channel.rangeExtent[i] : 0.0;
+			normalized = normalized < 0.0 ? 0.0 : (normalized > 1.0 ? 1.0 : normalized);
+			pStreams[i].push_back((uint16_t)(normalized * VECTOR_QUANTIZE_MAX + 0.5));
+		}
+	}
+	channel.timeOffset = AcquireSharedTimeOffset(keptTimes, animationData, timeOffsetTable);
+	animationData.keyFrameCount += channel.keyFrameCount;
+}
+
+void SkeletonAnimation::EncodeRotation(const Quaterniond& rotation, uint16_t& s0, uint16_t& s1, uint16_t& s2)
+{
+	double components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; i++)
+	{
+		if (std::abs(components[i]) > std::abs(components[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation, keep the largest one positive so that it could be rebuilt from the other three
+	double sign = components[largest] < 0 ? -1.0 : 1.0;
+
+	uint16_t quantized[3];
+	for (uint32_t i = 0, j = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		double normalized = (components[i] * sign + INV_SQRT_2) / SQRT_2;
+		normalized = normalized < 0.0 ? 0.0 : (normalized > 1.0 ? 1.0 : normalized);
+		quantized[j++] = (uint16_t)(normalized * ROTATION_QUANTIZE_MAX + 0.5);
+	}
+
+	s0 = quantized[0] | (uint16_t)((largest & 2) << 14);
+	s1 = quantized[1] | (uint16_t)((largest & 1) << 15);
+	s2 = quantized[2];
+}
+
+Quaterniond SkeletonAnimation::DecodeRotation(uint16_t s0, uint16_t s1, uint16_t s2)
+{
+	uint32_t largest = ((s0 >> 14) & 2) | (s1 >> 15);
+
+	double smallest[3] =
+	{
+		(s0 & 0x7fff) / ROTATION_QUANTIZE_MAX * SQRT_2 - INV_SQRT_2,
+		(s1 & 0x7fff) / ROTATION_QUANTIZE_MAX * SQRT_2 - INV_SQRT_2,
+		(s2 & 0x7fff) / ROTATION_QUANTIZE_MAX * SQRT_2 - INV_SQRT_2,
+	};
+
+	double squaredSum = smallest[0] * smallest[0] + smallest[1] * smallest[1] + smallest[2] * smallest[2];
+
+	double components[4];
+	for (uint32_t i = 0, j = 0; i < 4; i++)
+		components[i] = i == largest ? std::sqrt(squaredSum < 1.0 ? 1.0 - squaredSum : 0.0) : smallest[j++];
+
+	return Quaterniond(components[0], components[1], components[2], components[3]);
+}
+
+std::vector<uint32_t> SkeletonAnimation::ReduceRotationKeyFrames(const std::vector<float>& times, const std::vector<Quaterniond>& rotations, double tolerance)
+{
+	std::vector<uint32_t> keptKeyFrames;
+	if (rotations.empty())
+		return keptKeyFrames;
+
+	// Rotation error of an interpolated key, quaternions are aligned to the same hemisphere before comparison
+	auto acquireError = [&](uint32_t anchor, uint32_t candidate, uint32_t index)
+	{
+		double factor = times[candidate] > times[anchor] ? (times[index] - times[anchor]) / (double)(times[candidate] - times[anchor]) : 0.0;
+		Quaterniond interpolated = Quaterniond::SLerp(rotations[anchor], rotations[candidate], factor);
+		double sign = Quaterniond::Dot(interpolated, rotations[index]) < 0 ? -1.0 : 1.0;
+
+		double error = std::abs(interpolated.x * sign - rotations[index].x);
+		error = std::abs(interpolated.y * sign - rotations[index].y) > error ? std::abs(interpolated.y * sign - rotations[index].y) : error;
+		error = std::abs(interpolated.z * sign - rotations[index].z) > error ? std::abs(interpolated.z * sign - rotations[index].z) : error;
+		error = std::abs(interpolated.w * sign - rotations[index].w) > error ? std::abs(interpolated.w * sign - rotations[index].w) : error;
+		return error;
+	};
+
+	// Channel holding still is collapsed into a single key
+	bool isConstant = true;
+	for (uint32_t i = 1; i < rotations.size() && isConstant; i++)
+		isConstant = acquireError(0, 0, i) <= tolerance;
+
+	keptKeyFrames.push_back(0);
+	if (isConstant)
+		return keptKeyFrames;
+
+	// Greedy fitting: extend segment from anchor as long as every key inside it could be reconstructed
+	uint32_t anchor = 0;
+	for (uint32_t candidate = 2; candidate < rotations.size(); candidate++)
+	{
+		for (uint32_t i = anchor + 1; i < candidate; i++)
+		{
+			if (acquireError(anchor, candidate, i) > tolerance)
+			{
+				anchor = candidate - 1;
+				keptKeyFrames.push_back(anchor);
+				break;
+			}
+		}
+	}
+
+	if (rotations.size() > 1)
+		keptKeyFrames.push_back((uint32_t)rotations.size() - 1);
+
+	return keptKeyFrames;
+}
+
+std::vector<uint32_t> SkeletonAnimation::ReduceVectorKeyFrames(const std::vector<float>& times, const std::vector<Vector3d>& values, double tolerance)
+{
+	std::vector<uint32_t> keptKeyFrames;
+	if (values.empty())
+		return keptKeyFrames;
+
+	auto acquireError = [&](uint32_t anchor, uint32_t candidate, uint32_t index)
+	{
+		double factor = times[candidate] > times[anchor] ? (times[index] - times[anchor]) / (double)(times[candidate] - times[anchor]) : 0.0;
+
+		double error = 0.0;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			double componentError = std::abs(values[anchor][i] * (1.0 - factor) + values[candidate][i] * factor - values[index][i]);
+			error = componentError > error ? componentError : error;
+		}
+		return error;
+	};
+
+	bool isConstant = true;
+	for (uint32_t i = 1; i < values.size() && isConstant; i++)
+		isConstant = acquireError(0, 0, i) <= tolerance;
+
+	keptKeyFrames.push_back(0);
+	if (isConstant)
+		return keptKeyFrames;
+
+	uint32_t anchor = 0;
+	for (uint32_t candidate = 2; candidate < values.size(); candidate++)
+	{
+		for (uint32_t i = anchor + 1; i < candidate; i++)
+		{
+			if (acquireError(anchor, candidate, i) > tolerance)
+			{
+				anchor = candidate - 1;
+				keptKeyFrames.push_back(anchor);
+				break;
+			}
+		}
+	}
+
+	if (values.size() > 1)
+		keptKeyFrames.push_back((uint32_t)values.size() - 1);
+
+	return keptKeyFrames;
+}
+
+uint32_t SkeletonAnimation::GetAnimationDataBytes(uint32_t animationIndex) const
+{
+	const AnimationData& animationData = m_animationDataDiction[animationIndex];
+
+	uint32_t bytes = (uint32_t)(animationData.keyFrameTimes.size() * sizeof(float));
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		bytes += (uint32_t)(animationData.rotationStreams[i].size() * sizeof(uint16_t));
+		bytes += (uint32_t)(animationData.translationStreams[i].size() * sizeof(uint16_t));
+		bytes += (uint32_t)(animationData.scaleStreams[i].size() * sizeof(uint16_t));
+	}
+	bytes += (uint32_t)(animationData.tracks.size() * sizeof(AnimationTrack));
+
+	return bytes;
+}
+
+uint32_t SkeletonAnimation::AcquireSharedTimeOffset(const std::vector<float>& times, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable)
+{
+	std::string key((const char*)times.data(), times.size() * sizeof(float));
+
+	auto iter = timeOffsetTable.find(key);
+	if (iter != timeOffsetTable.end())
+		return iter->second;
+
+	uint32_t timeOffset = (uint32_t)animationData.keyFrameTimes.size();
+	animationData.keyFrameTimes.insert(animationData.keyFrameTimes.end(), times.begin(), times.end());
+	timeOffsetTable[key] = timeOffset;
+
+	return timeOffset;
+}
+
+uint32_t SkeletonAnimation::AcquireTrackIndex(uint32_t animationIndex, std::size_t objectNameHashCode) const
+{
+	auto iter = m_animationDataDiction[animationIndex].trackLookupTable.find(objectNameHashCode);
+	if (iter == m_animationDataDiction[animationIndex].trackLookupTable.end())
+		return NULL_TRACK;
+
+	return iter->second;
+}
+
+uint32_t SkeletonAnimation::SeekKeyFrame(const float* pTimes, uint32_t keyFrameCount, float time, uint32_t cursor)
+{
+	cursor = cursor < keyFrameCount ? cursor : 0;
+
+	// Time goes backward, usually animation starts over again, search in front of cursor
+	if (time < pTimes[cursor])
+	{
+		uint32_t index = (uint32_t)(std::upper_bound(pTimes, pTimes + cursor, time) - pTimes);
+		return index > 0 ? index - 1 : 0;
 	}
+
+	// Most of the time key frame is the current one or a few steps ahead
+	for (uint32_t i = 0; i < LINEAR_SEEK_STEPS; i++)
+	{
+		if (cursor + 1 >= keyFrameCount || time < pTimes[cursor + 1])
+			return cursor;
+		cursor++;
+	}
+
+	return (uint32_t)(std::upper_bound(pTimes + cursor, pTimes + keyFrameCount, time) - pTimes) - 1;
+}
+
+float SkeletonAnimation::AcquireKeyFrameFactor(const float* pTimes, uint32_t keyFrameCount, float time, uint32_t currentKeyFrame, uint32_t& nextKeyFrame)
+{
+	nextKeyFrame = currentKeyFrame + 1;
+
+	// To deal with the situation that some object's animation is shorter than the others, therefore it'll keep last key frame until current animation is done
+	if (nextKeyFrame >= keyFrameCount)
+	{
+		nextKeyFrame = currentKeyFrame;
+		return 0.0f;
+	}
+
+	float factor = (time - pTimes[currentKeyFrame]) / (pTimes[nextKeyFrame] - pTimes[currentKeyFrame]);
+	factor = factor > 1.0f ? 1.0f : factor;
+	factor = factor < 0.0f ? 0.0f : factor;
+	return factor;
+}
+
+void SkeletonAnimation::SampleVectorChannel(const AnimationData& animationData, const AnimationChannel& channel, const std::vector<uint16_t>* pStreams, float time, uint32_t& cursor, Vector3d& value)
+{
+	if (channel.keyFrameCount == 0)
+		return;
+
+	const float* pTimes = &animationData.keyFrameTimes[channel.timeOffset];
+	cursor = SeekKeyFrame(pTimes, channel.keyFrameCount, time, cursor);
+
+	uint32_t nextKeyFrame;
+	float factor = AcquireKeyFrameFactor(pTimes, channel.keyFrameCount, time, cursor, nextKeyFrame);
+
+	uint32_t current = channel.keyOffset + cursor;
+	uint32_t next = channel.keyOffset + nextKeyFrame;
+
+	// Interpolate in quantized space, then map back into channel range
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		float quantized = pStreams[i][current] * (1.0f - factor) + pStreams[i][next] * factor;
+		value[i] = channel.rangeMin[i] + quantized * (float)(channel.rangeExtent[i] / VECTOR_QUANTIZE_MAX);
+	}
+}
+
+void SkeletonAnimation::SampleTrack(uint32_t animationIndex, uint32_t trackIndex, float time, AnimationTrackCursor& cursor, Quaterniond& rotation, Vector3d& translation, Vector3d& scale) const
+{
+	const AnimationData& animationData = m_animationDataDiction[animationIndex];
+	const AnimationTrack& track = animationData.tracks[trackIndex];
+
+	if (track.rotationChannel.keyFrameCount > 0)
+	{
+		const float* pTimes = &animationData.keyFrameTimes[track.rotationChannel.timeOffset];
+		uint32_t keyFrameCount = track.rotationChannel.keyFrameCount;
+
+		cursor.rotationKeyFrame = SeekKeyFrame(pTimes, keyFrameCount, time, cursor.rotationKeyFrame);
+
+		uint32_t nextKeyFrame;
+		float factor = AcquireKeyFrameFactor(pTimes, keyFrameCount, time, cursor.rotationKeyFrame, nextKeyFrame);
+
+		uint32_t current = track.rotationChannel.keyOffset + cursor.rotationKeyFrame;
+		uint32_t next = track.rotationChannel.keyOffset + nextKeyFrame;
+
+		Quaterniond currentRotation = DecodeRotation(animationData.rotationStreams[0][current], animationData.rotationStreams[1][current], animationData.rotationStreams[2][current]);
+		if (next == current)
+			rotation = currentRotation;
+		else
+			rotation = Quaterniond::SLerp(currentRotation, DecodeRotation(animationData.rotationStreams[0][next], animationData.rotationStreams[1][next], animationData.rotationStreams[2][next]), factor);
+	}
+
+	SampleVectorChannel(animationData, track.translationChannel, animationData.translationStreams, time, cursor.translationKeyFrame, translation);
+	SampleVectorChannel(animationData, track.scaleChannel, animationData.scaleStreams, time, cursor.scaleKeyFrame, scale);
 }
\ No newline at end of file
@@ -12,56 +12,110 @@ struct aiNodeAnim;
 class SkeletonAnimationInstance;
 class AnimationController;
 
-typedef struct _RotationKeyFrame
+// Key frames of one channel(rotation, translation or scale) of a track
+typedef struct _AnimationChannel
 {
-	double			time;			// When does this key frame start
-	Quaterniond		transform;		// Rotation
-}RotationKeyFrame;
+	uint32_t	timeOffset = 0;		// Start of key frame times in animation's shared time array
+	uint32_t	keyOffset = 0;		// Start of key frame values in animation's streams of this channel
+	uint32_t	keyFrameCount = 0;
+	float		rangeMin[3];		// Quantization range of translation and scale, unused by rotation
+	float		rangeExtent[3];
+}AnimationChannel;
 
-typedef struct _TranslationKeyFrame
+typedef struct _AnimationTrack
 {
-	double			time;			// When does this key frame start
-	Vector3d		transform;		// Translation
-}TranslationKeyFrame;
+	std::wstring		objectName;
+	std::size_t			objectNameHashCode;
+	AnimationChannel	rotationChannel;
+	AnimationChannel	translationChannel;
+	AnimationChannel	scaleChannel;
+}AnimationTrack;
 
-typedef struct _ScaleKeyFrame
+// Last key frames sampled of a track, held by each animation instance so that a sample usually takes a step or two
+typedef struct _AnimationTrackCursor
 {
-	double			time;			// When does this key frame start
-	Vector3d		transform;		// Scale
-}ScaleKeyFrame;
-
-typedef struct _ObjectAnimation
-{
-	std::wstring					objectName;
-	std::vector<RotationKeyFrame>	rotationKeyFrames;		// A list of rotation key frames for this object
-	std::vector<TranslationKeyFrame>translationKeyFrames;	// A list of translation key frames for this object
-	std::vector<ScaleKeyFrame>		ScaleKeyFrames;			// A list of scale key frames for this object
-}ObjectAnimation;
+	uint32_t	rotationKeyFrame = 0;
+	uint32_t	translationKeyFrame = 0;
+	uint32_t	scaleKeyFrame = 0;
+}AnimationTrackCursor;
 
 typedef struct _AnimationData
 {
 	std::wstring					animationName;			// Animation name
 	double							duration;				// Total duration of this animation
-	std::vector<ObjectAnimation>	objectAnimationDiction;
-	std::unordered_map<std::size_t, uint32_t> objectAnimationLookupTable;	// Using this to lookup specific index in object animation dictionary
+	std::vector<AnimationTrack>		tracks;
+	std::unordered_map<std::size_t, uint32_t> trackLookupTable;	// Object name hash to track index, only used when objects are bound to tracks
+
+	// Key frame data stored as separated streams, channels having identical time stamps share the same times
+	// Keys that could be reconstructed by interpolating their neighbors within tolerance are dropped
+	std::vector<float>				keyFrameTimes;
+	std::vector<uint16_t>			rotationStreams[3];		// Smallest three of quaternion, 15 bits each, index of the largest one is in top bits of first two streams
+	std::vector<uint16_t>			translationStreams[3];	// x, y, z quantized within range of its channel
+	std::vector<uint16_t>			scaleStreams[3];		// x, y, z quantized within range of its channel
+
+	uint32_t						sourceKeyFrameCount = 0;	// Key frames of all channels before compression
+	uint32_t						keyFrameCount = 0;			// Key frames of all channels after compression
+	uint32_t						sourceDataBytes = 0;		// Bytes of key frames as loaded from assimp
 }AnimationData;
 
 class SkeletonAnimation : public SelfRefBase<SkeletonAnimation>
 {
+public:
+	static const uint32_t NULL_TRACK = 0xffffffff;
+
 protected:
-	bool Init(const std::shared_ptr<SkeletonAnimation>& pSelf, const aiScene* pAssimpScene);
+	bool Init(const std::shared_ptr<SkeletonAnimation>& pSelf, const aiAnimation* const* ppAssimpAnimations, uint32_t animationCount);
 
 public:
 	static std::shared_ptr<SkeletonAnimation> Create(const aiScene* pAssimpScene);
+	static std::shared_ptr<SkeletonAnimation> Create(const aiAnimation* const* ppAssimpAnimations, uint32_t animationCount);
+
+public:
+	uint32_t GetAnimationCount() const { return (uint32_t)m_animationDataDiction.size(); }
+	const AnimationData& GetAnimationData(uint32_t animationIndex) const { return m_animationDataDiction[animationIndex]; }
+	uint32_t GetTrackCount(uint32_t animationIndex) const { return (uint32_t)m_animationDataDiction[animationIndex].tracks.size(); }
+
+	// Returns NULL_TRACK if object isn't animated
+	uint32_t AcquireTrackIndex(uint32_t animationIndex, std::size_t objectNameHashCode) const;
+
+	// Sample rotation, translation and scale of a track, cursor is moved to key frames of input time
+	// Outputs of channels without key frames are left untouched
+	void SampleTrack(uint32_t animationIndex, uint32_t trackIndex, float time, AnimationTrackCursor& cursor, Quaterniond& rotation, Vector3d& translation, Vector3d& scale) const;
+
+	// Find the last key frame not later than time, starting from cursor
+	static uint32_t SeekKeyFrame(const float* pTimes, uint32_t keyFrameCount, float time, uint32_t cursor);
+
+	// Bytes of compressed key frame data of an animation
+	uint32_t GetAnimationDataBytes(uint32_t animationIndex) const;
+	uint32_t GetSourceAnimationDataBytes(uint32_t animationIndex) const { return m_animationDataDiction[animationIndex].sourceDataBytes; }
+
+	static void EncodeRotation(const Quaterniond& rotation, uint16_t& s0, uint16_t& s1, uint16_t& s2);
+	static Quaterniond DecodeRotation(uint16_t s0, uint16_t s1, uint16_t s2);
 
 protected:
 	static void AssemblyAnimationData(const aiAnimation* pAssimpAnimation, AnimationData& animationData);
-	static void AssemblyObjectAnimation(const aiNodeAnim* pAssimpNodeAnimation, double ticksPerSecond, ObjectAnimation& objectAnimation);
+	static void AssemblyAnimationTrack(const aiNodeAnim* pAssimpNodeAnimation, double ticksPerSecond, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable, AnimationTrack& track);
+	static void AssemblyVectorChannel(const std::vector<float>& times, const std::vector<Vector3d>& values, double tolerance, std::vector<uint16_t>* pStreams, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable, AnimationChannel& channel);
+
+	// Indices of key frames to keep, the others are reconstructed within tolerance by interpolating kept ones
+	static std::vector<uint32_t> ReduceRotationKeyFrames(const std::vector<float>& times, const std::vector<Quaterniond>& rotations, double tolerance);
+	static std::vector<uint32_t> ReduceVectorKeyFrames(const std::vector<float>& times, const std::vector<Vector3d>& values, double tolerance);
+	static uint32_t AcquireSharedTimeOffset(const std::vector<float>& times, AnimationData& animationData, std::unordered_map<std::string, uint32_t>& timeOffsetTable);
+	static float AcquireKeyFrameFactor(const float* pTimes, uint32_t keyFrameCount, float time, uint32_t currentKeyFrame, uint32_t& nextKeyFrame);
+	static void SampleVectorChannel(const AnimationData& animationData, const AnimationChannel& channel, const std::vector<uint16_t>* pStreams, float time, uint32_t& cursor, Vector3d& value);
 
 protected:
 	std::vector<AnimationData>						m_animationDataDiction;			// Entire animation dictionary, containing all the data of current assimp scene's animation
 	std::unordered_map<std::size_t, uint32_t>		m_animationDataLookupTable;		// Using this to lookup specific index in animation dictionary
 
+	// Cursor moves at most these steps linearly, binary search is used if key frame is further than this
+	static const uint32_t LINEAR_SEEK_STEPS = 4;
+
+	// Maximum error allowed when dropping key frames, rotation is per quaternion component
+	static const double ROTATION_TOLERANCE;
+	static const double TRANSLATION_TOLERANCE;
+	static const double SCALE_TOLERANCE;
+
 	friend class SkeletonAnimationInstance;
 	friend class AnimationController;
 };
\ No newline at end of file
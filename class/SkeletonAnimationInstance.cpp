@@ -46,4 +46,14 @@ std::shared_ptr<SkeletonAnimationInstance> SkeletonAnimationInstance::Create(con
 void SkeletonAnimationInstance::SetBoneTransform(std::size_t hashCode, uint32_t boneIndex, const DualQuaterniond& dq)
 {
 	UniformData::GetInstance()->GetPerFrameBoneIndirectUniforms()->SetBoneTransform(m_boneChunkIndexOffset, hashCode, boneIndex, dq);
+}
+
+uint32_t SkeletonAnimationInstance::GetBoneChunkIndex(uint32_t boneIndex) const
+{
+	return UniformData::GetInstance()->GetPerFrameBoneIndirectUniforms()->m_boneChunkIndex[m_boneChunkIndexOffset + boneIndex];
+}
+
+void SkeletonAnimationInstance::SetBoneTransforms(const uint32_t* pBoneChunkIndices, const DualQuaterniond* pBoneDQs, uint32_t count)
+{
+	UniformData::GetInstance()->GetPerFrameBoneUniforms()->SetBoneOffsetTransforms(pBoneChunkIndices, pBoneDQs, count);
 }
\ No newline at end of file
@@ -17,6 +17,10 @@ public:
 	std::shared_ptr<Mesh> GetMesh() const { return m_pMesh; }
 	std::shared_ptr<SkeletonAnimation> GetAnimation() const { return m_pSkeletonAnimation; }
 	void SetBoneTransform(std::size_t hashCode, uint32_t boneIndex, const DualQuaterniond& dq);
+	// Chunk of per frame bone uniforms where data of this bone is located
+	uint32_t GetBoneChunkIndex(uint32_t boneIndex) const;
+	// Write a whole pose straight into per frame bone uniforms, safe to be called from pose jobs
+	void SetBoneTransforms(const uint32_t* pBoneChunkIndices, const DualQuaterniond* pBoneDQs, uint32_t count);
 	uint32_t GetAnimationChunkIndex() const { return m_animationChunk; }
 
 protected:
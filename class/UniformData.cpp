@@ -49,15 +49,9 @@ bool UniformData::Init()
 	}
 
 	BuildDescriptorSets();
+	UpdateCachedFrameOffsets();
 
-	for (uint32_t frameIndex = 0; frameIndex < GetSwapChain()->GetSwapChainImageCount(); frameIndex++)
-	{
-		std::vector<uint32_t> offsets;
-		for (uint32_t i = 0; i < UniformStorageType::PerObjectMaterialVariableBuffer; i++)
-			offsets.push_back(m_uniformStorageBuffers[i]->GetFrameOffset() * frameIndex);
-
-		m_cachedFrameOffsets.push_back(offsets);
-	}
+	m_bufferVersion = AcquireBufferVersion();
 
 	return true;
 }
@@ -66,6 +60,43 @@ void UniformData::SyncDataBuffer()
 {
 	for (auto& var : m_uniformStorageBuffers)
 		var->SyncBufferData();
+
+	// Chunk based storages reallocate buffers when they grow, descriptor sets and frame offsets have to follow
+	uint32_t bufferVersion = AcquireBufferVersion();
+	if (bufferVersion != m_bufferVersion)
+	{
+		// Frames in flight still use current descriptor sets, updating them in place is illegal
+		// So fresh sets are written instead, old ones are released when those frames are done
+		for (auto& pDescriptorSet : m_descriptorSets)
+			FrameMgr()->RetireResource(pDescriptorSet);
+
+		AllocateDescriptorSets();
+		UpdateDescriptorSets();
+		UpdateCachedFrameOffsets();
+		m_bufferVersion = bufferVersion;
+	}
+}
+
+uint32_t UniformData::AcquireBufferVersion() const
+{
+	// Versions only increase, so does their sum
+	uint32_t bufferVersion = 0;
+	for (auto& var : m_uniformStorageBuffers)
+		bufferVersion += var->GetBufferVersion();
+	return bufferVersion;
+}
+
+void UniformData::UpdateCachedFrameOffsets()
+{
+	m_cachedFrameOffsets.clear();
+	for (uint32_t frameIndex = 0; frameIndex < GetSwapChain()->GetSwapChainImageCount(); frameIndex++)
+	{
+		std::vector<uint32_t> offsets;
+		for (uint32_t i = 0; i < UniformStorageType::PerObjectMaterialVariableBuffer; i++)
+			offsets.push_back(m_uniformStorageBuffers[i]->GetFrameOffset() * frameIndex);
+
+		m_cachedFrameOffsets.push_back(offsets);
+	}
 }
 
 std::vector<std::vector<UniformVarList>> UniformData::GenerateUniformVarLayout() const
@@ -198,27 +229,36 @@ void UniformData::BuildDescriptorSets()
 		}
 	}
 
-	std::vector<VkDescriptorPoolSize> descPoolSize;
+	m_descriptorPoolSizes.clear();
 	for (uint32_t i = 0; i < counts.size(); i++)
 	{
 		if (counts[i] != 0)
-			descPoolSize.push_back({ (VkDescriptorType)i, counts[i] });
+			m_descriptorPoolSizes.push_back({ (VkDescriptorType)i, counts[i] });
 	}
 
+	AllocateDescriptorSets();
+	UpdateDescriptorSets();
+}
+
+void UniformData::AllocateDescriptorSets()
+{
 	VkDescriptorPoolCreateInfo descPoolInfo = {};
 	descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descPoolInfo.pPoolSizes = descPoolSize.data();
-	descPoolInfo.poolSizeCount = (uint32_t)descPoolSize.size();
+	descPoolInfo.pPoolSizes = m_descriptorPoolSizes.data();
+	descPoolInfo.poolSizeCount = (uint32_t)m_descriptorPoolSizes.size();
 	descPoolInfo.maxSets = PerObjectMaterialVariableBufferLocation;
 
+	// Each descriptor set holds its pool, so a replaced pool lives as long as its sets
 	m_pDescriptorPool = DescriptorPool::Create(GetDevice(), descPoolInfo);
 
 	// Allocate descriptor sets according to layouts
+	m_descriptorSets.clear();
 	for (auto & layout : m_descriptorSetLayouts)
 		m_descriptorSets.push_back(m_pDescriptorPool->AllocateDescriptorSet(layout));
+}
 
-
-
+void UniformData::UpdateDescriptorSets()
+{
 	// Setup descriptor sets data
 
 	// 1. Global descriptor set
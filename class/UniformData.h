@@ -71,20 +71,28 @@ public:
 	void SyncDataBuffer();
 	std::vector<std::vector<UniformVarList>> GenerateUniformVarLayout() const;
 	std::vector<std::vector<uint32_t>> GetCachedFrameOffsets() const;
+	// Changed whenever any uniform storage reallocates its buffer
+	uint32_t GetBufferVersion() const { return m_bufferVersion; }
 
 	std::vector<std::shared_ptr<DescriptorSetLayout>> GetDescriptorSetLayouts() const { return m_descriptorSetLayouts; }
 	std::vector<std::shared_ptr<DescriptorSet>> GetDescriptorSets() const { return m_descriptorSets; }
 
 protected:
 	void BuildDescriptorSets();
+	void AllocateDescriptorSets();
+	void UpdateDescriptorSets();
+	void UpdateCachedFrameOffsets();
+	uint32_t AcquireBufferVersion() const;
 
 protected:
 	std::vector<std::shared_ptr<UniformDataStorage>>		m_uniformStorageBuffers;
 	std::vector<std::shared_ptr<IMaterialUniformOperator>>	m_uniformTextures;
 
 	std::shared_ptr<DescriptorPool>							m_pDescriptorPool;
+	std::vector<VkDescriptorPoolSize>						m_descriptorPoolSizes;
 	std::vector<std::shared_ptr<DescriptorSetLayout>>		m_descriptorSetLayouts;
 	std::vector<std::shared_ptr<DescriptorSet>>				m_descriptorSets;
 
 	std::vector<std::vector<uint32_t>>						m_cachedFrameOffsets;
+	uint32_t												m_bufferVersion = 0;
 };
\ No newline at end of file
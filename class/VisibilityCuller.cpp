@@ -0,0 +1,189 @@
+#include "VisibilityCuller.h"
+#include "../component/MeshRenderer.h"
+#include "../vulkan/GlobalDeviceObjects.h"
+#include "../vulkan/FrameManager.h"
+#include "../thread/ThreadTaskQueue.hpp"
+#include "../Base/SceneBVH.h"
+#include <mutex>
+
+bool VisibilityCuller::Init()
+{
+	for (uint32_t i = 0; i < RenderWorkManager::RenderStateCount; i++)
+	{
+		m_cullingPlaneCount[i] = 0;
+		m_cullingStatistics[i] = {};
+	}
+
+	return true;
+}
+
+uint32_t VisibilityCuller::AllocateObject(MeshRenderer* pMeshRenderer)
+{
+	uint32_t index;
+	if (!m_freeIndices.empty())
+	{
+		index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)m_meshRenderers.size();
+		m_meshRenderers.push_back(nullptr);
+		m_visibilityMasks.push_back(0);
+	}
+
+	m_meshRenderers[index] = pMeshRenderer;
+
+	// Visible to everything until it's culled
+	m_visibilityMasks[index] = 0xffffffff;
+
+	return index;
+}
+
+void VisibilityCuller::FreeObject(uint32_t index)
+{
+	m_meshRenderers[index] = nullptr;
+	m_freeIndices.push_back(index);
+}
+
+void VisibilityCuller::SetCullingPlanes(RenderWorkManager::RenderState renderState, const Planed* pPlanes, uint32_t planeCount)
+{
+	ASSERTION(planeCount <= MAX_CULLING_PLANE_COUNT);
+
+	for (uint32_t i = 0; i < planeCount; i++)
+		m_cullingPlanes[renderState][i] = pPlanes[i];
+	m_cullingPlaneCount[renderState] = planeCount;
+}
+
+void VisibilityCuller::SetCullingFrustum(RenderWorkManager::RenderState renderState, const PyramidFrustumd& frustum)
+{
+	SetCullingPlanes(renderState, frustum.planes, PyramidFrustumd::FrustumFace_COUNT);
+}
+
+void VisibilityCuller::ClearCullingPlanes(RenderWorkManager::RenderState renderState)
+{
+	m_cullingPlaneCount[renderState] = 0;
+}
+
+BoxStream VisibilityCuller::GetWorldBoxStream() const
+{
+	return { m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_extentX.data(), m_extentY.data(), m_extentZ.data() };
+}
+
+void VisibilityCuller::CullObjects()
+{
+	uint32_t count = (uint32_t)m_meshRenderers.size();
+
+	m_centerX.resize(count);
+	m_centerY.resize(count);
+	m_centerZ.resize(count);
+	m_extentX.resize(count);
+	m_extentY.resize(count);
+	m_extentZ.resize(count);
+	m_cullable.resize(count);
+
+	for (uint32_t i = 0; i < RenderWorkManager::RenderStateCount; i++)
+	{
+		m_cullingStatistics[i] = {};
+		if (m_cullingPlaneCount[i] > 0)
+			m_visible[i].resize(count);
+	}
+
+	if (count == 0)
+		return;
+
+	DispatchRanges(count, [this](uint32_t startIndex, uint32_t endIndex) { UpdateWorldBoxes(startIndex, endIndex); });
+
+	SceneBVH::GetInstance()->Update(GetWorldBoxStream(), m_cullable.data(), count);
+
+	// Large scenes are culled through hierarchy, so that subtrees outside of a plane are skipped as a whole
+	bool hierarchical = count >= HIERARCHICAL_CULLING_THRESHOLD;
+	if (hierarchical)
+	{
+		for (uint32_t i = 0; i < RenderWorkManager::RenderStateCount; i++)
+		{
+			if (m_cullingPlaneCount[i] > 0)
+				SceneBVH::GetInstance()->CullFrustum(m_cullingPlanes[i], m_cullingPlaneCount[i], m_visible[i].data(), count, GlobalThreadTaskQueue()->AcquireParallelRangeFunc(FrameMgr()->FrameIndex()));
+		}
+	}
+
+	DispatchRanges(count, [this, hierarchical](uint32_t startIndex, uint32_t endIndex)
+	{
+		if (!hierarchical)
+			TestWorldBoxes(startIndex, endIndex);
+		UpdateVisibilityMasks(startIndex, endIndex);
+	});
+}
+
+void VisibilityCuller::DispatchRanges(uint32_t count, const std::function<void(uint32_t, uint32_t)>& rangeFunc)
+{
+	if (count <= CULLING_GRAIN_SIZE)
+	{
+		rangeFunc(0, count);
+		return;
+	}
+
+	GlobalThreadTaskQueue()->ParallelFor(count, CULLING_GRAIN_SIZE, [&rangeFunc](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>& pPerFrameRes)
+	{
+		rangeFunc(startIndex, endIndex);
+	}, FrameMgr()->FrameIndex());
+}
+
+void VisibilityCuller::UpdateWorldBoxes(uint32_t startIndex, uint32_t endIndex)
+{
+	// Bounding boxes from local space to world space
+	for (uint32_t i = startIndex; i < endIndex; i++)
+	{
+		Vector3d center, extent;
+		m_cullable[i] = m_meshRenderers[i] != nullptr && m_meshRenderers[i]->AcquireWorldBoundingBox(center, extent) ? 1 : 0;
+
+		m_centerX[i] = center.x;
+		m_centerY[i] = center.y;
+		m_centerZ[i] = center.z;
+		m_extentX[i] = extent.x;
+		m_extentY[i] = extent.y;
+		m_extentZ[i] = extent.z;
+	}
+}
+
+void VisibilityCuller::TestWorldBoxes(uint32_t startIndex, uint32_t endIndex)
+{
+	BoxStream boxes = GetWorldBoxStream();
+	for (uint32_t i = 0; i < RenderWorkManager::RenderStateCount; i++)
+	{
+		if (m_cullingPlaneCount[i] > 0)
+			FrustumTestBoxes(m_cullingPlanes[i], m_cullingPlaneCount[i], boxes, startIndex, endIndex, m_visible[i].data());
+	}
+}
+
+void VisibilityCuller::UpdateVisibilityMasks(uint32_t startIndex, uint32_t endIndex)
+{
+	uint32_t visibleCount[RenderWorkManager::RenderStateCount] = {};
+	uint32_t culledCount[RenderWorkManager::RenderStateCount] = {};
+	for (uint32_t i = startIndex; i < endIndex; i++)
+	{
+		if (m_meshRenderers[i] == nullptr)
+			continue;
+
+		uint32_t mask = 0xffffffff;
+		for (uint32_t j = 0; j < RenderWorkManager::RenderStateCount; j++)
+		{
+			if (m_cullable[i] && m_cullingPlaneCount[j] > 0 && m_visible[j][i] == 0)
+			{
+				mask &= ~(1 << j);
+				culledCount[j]++;
+			}
+			else
+				visibleCount[j]++;
+		}
+		m_visibilityMasks[i] = mask;
+	}
+
+	// Ranges are processed by different workers
+	std::unique_lock<std::mutex> lock(m_statisticsMutex);
+	for (uint32_t i = 0; i < RenderWorkManager::RenderStateCount; i++)
+	{
+		m_cullingStatistics[i].visibleCount += visibleCount[i];
+		m_cullingStatistics[i].culledCount += culledCount[i];
+	}
+}
\ No newline at end of file
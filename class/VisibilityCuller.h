@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../common/Singleton.h"
+#include "../Maths/Matrix.h"
+#include "../Maths/Plane.h"
+#include "../Maths/PyramidFrustum.h"
+#include "../Maths/SIMDCull.h"
+#include "RenderWorkManager.h"
+#include <vector>
+#include <mutex>
+#include <functional>
+
+class MeshRenderer;
+
+// Frustum culling of mesh renderers, run once a frame after pre render and before renderers insert themselves into render queues
+// World bounding boxes are kept in structure of arrays, and tested against culling planes of each render state on worker threads
+// The same boxes feed SceneBVH, which culls large scenes hierarchically and answers spatial queries
+class VisibilityCuller : public Singleton<VisibilityCuller>
+{
+public:
+	static const uint32_t MAX_CULLING_PLANE_COUNT = 6;
+
+	typedef struct _CullingStatistics
+	{
+		uint32_t	visibleCount;
+		uint32_t	culledCount;
+	}CullingStatistics;
+
+public:
+	bool Init();
+
+public:
+	uint32_t AllocateObject(MeshRenderer* pMeshRenderer);
+	void FreeObject(uint32_t index);
+
+	// Planes point inwards, render states without culling planes don't cull anything
+	void SetCullingPlanes(RenderWorkManager::RenderState renderState, const Planed* pPlanes, uint32_t planeCount);
+	void SetCullingFrustum(RenderWorkManager::RenderState renderState, const PyramidFrustumd& frustum);
+	void ClearCullingPlanes(RenderWorkManager::RenderState renderState);
+
+	// Update world bounding boxes and test them against culling planes of every render state
+	void CullObjects();
+
+	// Object is visible if it's visible to any render state within mask
+	bool IsVisible(uint32_t index, uint32_t renderStateMask) const { return (m_visibilityMasks[index] & renderStateMask) != 0; }
+	const CullingStatistics& GetCullingStatistics(RenderWorkManager::RenderState renderState) const { return m_cullingStatistics[renderState]; }
+
+	// World bounding boxes updated by last culling, boxes of objects that can't be culled are invalid
+	BoxStream GetWorldBoxStream() const;
+	uint32_t GetObjectCount() const { return (uint32_t)m_meshRenderers.size(); }
+	bool IsCullable(uint32_t index) const { return m_cullable[index] != 0; }
+
+protected:
+	// Ranges are processed on worker threads if there are enough objects
+	void DispatchRanges(uint32_t count, const std::function<void(uint32_t, uint32_t)>& rangeFunc);
+	void UpdateWorldBoxes(uint32_t startIndex, uint32_t endIndex);
+	void TestWorldBoxes(uint32_t startIndex, uint32_t endIndex);
+	void UpdateVisibilityMasks(uint32_t startIndex, uint32_t endIndex);
+
+protected:
+	std::vector<MeshRenderer*>	m_meshRenderers;
+	std::vector<uint32_t>		m_freeIndices;
+
+	std::vector<double>			m_centerX;
+	std::vector<double>			m_centerY;
+	std::vector<double>			m_centerZ;
+	std::vector<double>			m_extentX;
+	std::vector<double>			m_extentY;
+	std::vector<double>			m_extentZ;
+	std::vector<uint8_t>		m_cullable;
+
+	// Bit of a render state is set if object is visible to it
+	std::vector<uint32_t>		m_visibilityMasks;
+	std::vector<uint8_t>		m_visible[RenderWorkManager::RenderStateCount];
+
+	Planed						m_cullingPlanes[RenderWorkManager::RenderStateCount][MAX_CULLING_PLANE_COUNT];
+	uint32_t					m_cullingPlaneCount[RenderWorkManager::RenderStateCount];
+	CullingStatistics			m_cullingStatistics[RenderWorkManager::RenderStateCount];
+	std::mutex					m_statisticsMutex;
+
+	static const uint32_t CULLING_GRAIN_SIZE = 256;
+	// Fewer objects are tested one by one, which is cheaper than walking hierarchy
+	static const uint32_t HIERARCHICAL_CULLING_THRESHOLD = 4096;
+};
\ No newline at end of file
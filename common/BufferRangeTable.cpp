@@ -0,0 +1,48 @@
+#include "BufferRangeTable.h"
+#include "Macros.h"
+
+BufferRangeTable::BufferRangeTable(uint32_t numBytes) : m_allocator(numBytes)
+{
+}
+
+uint32_t BufferRangeTable::Allocate(uint32_t numBytes)
+{
+	BufferRange range = { 0, numBytes, TLSFAllocator::NULL_BLOCK };
+	range.allocationHandle = m_allocator.Allocate(numBytes, 1, range.offset);
+	if (range.allocationHandle == TLSFAllocator::NULL_BLOCK)
+		return NULL_KEY;
+
+	return AcquireKey(range);
+}
+
+uint32_t BufferRangeTable::AllocateOutside(uint32_t numBytes)
+{
+	return AcquireKey({ 0, numBytes, TLSFAllocator::NULL_BLOCK });
+}
+
+void BufferRangeTable::Free(uint32_t key)
+{
+	ASSERTION(key < m_ranges.size());
+
+	if (m_ranges[key].allocationHandle != TLSFAllocator::NULL_BLOCK)
+		m_allocator.Free(m_ranges[key].allocationHandle);
+	m_ranges[key].allocationHandle = TLSFAllocator::NULL_BLOCK;
+	m_unusedKeys.push_back(key);
+}
+
+uint32_t BufferRangeTable::AcquireKey(const BufferRange& range)
+{
+	uint32_t key;
+	if (m_unusedKeys.empty())
+	{
+		key = (uint32_t)m_ranges.size();
+		m_ranges.push_back(range);
+	}
+	else
+	{
+		key = m_unusedKeys.back();
+		m_unusedKeys.pop_back();
+		m_ranges[key] = range;
+	}
+	return key;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include "TLSFAllocator.h"
+#include <stdint.h>
+#include <vector>
+
+// Key to range table of a shared buffer, it only does bookkeeping, no actual buffer is touched
+// Ranges are sub-allocated by TLSF, and a key indexes table directly and stays valid until it's freed, freed keys are reused
+// Ranges living outside of shared buffer(e.g. dedicated buffers) take keys as well, so that all of them are looked up the same way
+class BufferRangeTable
+{
+	typedef struct _BufferRange
+	{
+		uint32_t	offset;
+		uint32_t	numBytes;
+		uint32_t	allocationHandle;	// Handle from TLSF allocator, NULL_BLOCK if range isn't in shared buffer
+	}BufferRange;
+
+public:
+	static const uint32_t NULL_KEY = 0xffffffff;
+
+public:
+	BufferRangeTable(uint32_t numBytes);
+
+public:
+	// Returns NULL_KEY if shared buffer has no room
+	uint32_t Allocate(uint32_t numBytes);
+	// Range of its own, starting from 0
+	uint32_t AllocateOutside(uint32_t numBytes);
+	void Free(uint32_t key);
+
+	uint32_t GetOffset(uint32_t key) const { return m_ranges[key].offset; }
+	uint32_t GetRange(uint32_t key) const { return m_ranges[key].numBytes; }
+	bool IsOutside(uint32_t key) const { return m_ranges[key].allocationHandle == TLSFAllocator::NULL_BLOCK; }
+
+	uint32_t GetTotalBytes() const { return m_allocator.GetTotalBytes(); }
+	const TLSFAllocator& GetAllocator() const { return m_allocator; }
+
+protected:
+	uint32_t AcquireKey(const BufferRange& range);
+
+protected:
+	// Free ranges of shared buffer, both allocation and free are O(1), adjacent free ranges are coalesced
+	TLSFAllocator				m_allocator;
+
+	// Index: key
+	std::vector<BufferRange>	m_ranges;
+	// Keys of freed ranges, reused by following allocations
+	std::vector<uint32_t>		m_unusedKeys;
+};
\ No newline at end of file
@@ -13,7 +13,9 @@
 #define EXTENSION_VULKAN_DRAW_INDIRECT_COUNT "VK_KHR_draw_indirect_count"
 #define PROJECT_NAME "VulkanLearn"
 
+#if !defined(UINT64_MAX)
 #define UINT64_MAX       0xffffffffffffffffui64
+#endif
 
 #define TO_STRING(x) #x
 
@@ -37,6 +39,10 @@
 #define CHECK_ERROR(vkExpress) vkExpress;
 #define ASSERTION(express)
 #endif
+#else
+// Non-windows builds only compile the platform independent parts, e.g. unit tests
+#include <assert.h>
+#define ASSERTION(express) assert(express);
 #endif
 
 #define GET_INSTANCE_PROC_ADDR(inst, entrypoint)                        \
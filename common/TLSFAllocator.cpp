@@ -0,0 +1,345 @@
+#include "TLSFAllocator.h"
+#include "Macros.h"
+#include <string.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the highest set bit, mask must not be 0
+static uint32_t FindLastSet(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return (uint32_t)index;
+#else
+	return 31 - (uint32_t)__builtin_clz(mask);
+#endif
+}
+
+// Index of the lowest set bit, mask must not be 0
+static uint32_t FindFirstSet(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+TLSFAllocator::TLSFAllocator(uint32_t numBytes)
+{
+	memset(m_slBitmaps, 0, sizeof(m_slBitmaps));
+	memset(m_freeListHeads, 0xff, sizeof(m_freeListHeads));
+
+	m_totalBytes = numBytes;
+
+	uint32_t index = AcquireBlockSlot();
+	m_blocks[index].offset = 0;
+	m_blocks[index].numBytes = numBytes;
+	InsertFreeBlock(index);
+	m_lastPhysical = index;
+}
+
+void TLSFAllocator::MappingInsert(uint32_t numBytes, uint32_t& fl, uint32_t& sl)
+{
+	if (numBytes < SMALL_BLOCK_SIZE)
+	{
+		fl = 0;
+		sl = numBytes;
+	}
+	else
+	{
+		uint32_t log2 = FindLastSet(numBytes);
+		fl = log2 - SL_INDEX_COUNT_LOG2 + 1;
+		sl = (numBytes >> (log2 - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+	}
+}
+
+bool TLSFAllocator::MappingSearch(uint32_t numBytes, uint32_t& fl, uint32_t& sl)
+{
+	// Round up to next bucket, so that any block within that bucket is large enough
+	uint64_t roundedBytes = numBytes;
+	if (numBytes >= SMALL_BLOCK_SIZE)
+		roundedBytes += (1ull << (FindLastSet(numBytes) - SL_INDEX_COUNT_LOG2)) - 1;
+
+	if (roundedBytes > 0xffffffff)
+		return false;
+
+	MappingInsert((uint32_t)roundedBytes, fl, sl);
+	return true;
+}
+
+uint64_t TLSFAllocator::GetRequiredBytes(uint32_t numBytes, uint32_t alignment)
+{
+	if (numBytes == 0)
+		numBytes = 1;
+	if (alignment == 0)
+		alignment = 1;
+
+	uint64_t searchBytes = (uint64_t)numBytes + alignment - 1;
+	// Small sizes have exact buckets, and anything beyond 32 bits can't be served anyway
+	if (searchBytes < SMALL_BLOCK_SIZE || searchBytes > 0xffffffff)
+		return searchBytes;
+
+	// Any block mapped to the searched bucket or above is picked, the smallest one is the lower bound of that bucket
+	uint64_t roundedBytes = searchBytes + (1ull << (FindLastSet((uint32_t)searchBytes) - SL_INDEX_COUNT_LOG2)) - 1;
+	uint32_t log2 = roundedBytes > 0xffffffff ? 32 : FindLastSet((uint32_t)roundedBytes);
+	return roundedBytes & ~((1ull << (log2 - SL_INDEX_COUNT_LOG2)) - 1);
+}
+
+uint32_t TLSFAllocator::FindSuitableBlock(uint32_t& fl, uint32_t& sl) const
+{
+	uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+	if (!slMap)
+	{
+		uint32_t flMap = m_flBitmap & (~0u << (fl + 1));
+		if (!flMap)
+			return NULL_BLOCK;
+
+		fl = FindFirstSet(flMap);
+		slMap = m_slBitmaps[fl];
+	}
+
+	sl = FindFirstSet(slMap);
+	return m_freeListHeads[fl][sl];
+}
+
+uint32_t TLSFAllocator::AcquireBlockSlot()
+{
+	if (m_unusedBlockSlots.empty())
+	{
+		m_blocks.push_back({});
+		return (uint32_t)m_blocks.size() - 1;
+	}
+
+	uint32_t index = m_unusedBlockSlots.back();
+	m_unusedBlockSlots.pop_back();
+	m_blocks[index] = {};
+	return index;
+}
+
+void TLSFAllocator::ReleaseBlockSlot(uint32_t index)
+{
+	m_unusedBlockSlots.push_back(index);
+}
+
+void TLSFAllocator::InsertFreeBlock(uint32_t index)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_blocks[index].numBytes, fl, sl);
+
+	uint32_t head = m_freeListHeads[fl][sl];
+	m_blocks[index].isFree = true;
+	m_blocks[index].prevFree = NULL_BLOCK;
+	m_blocks[index].nextFree = head;
+	if (head != NULL_BLOCK)
+		m_blocks[head].prevFree = index;
+
+	m_freeListHeads[fl][sl] = index;
+	m_flBitmap |= 1u << fl;
+	m_slBitmaps[fl] |= 1u << sl;
+}
+
+void TLSFAllocator::RemoveFreeBlock(uint32_t index)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_blocks[index].numBytes, fl, sl);
+
+	Block& block = m_blocks[index];
+	if (block.prevFree != NULL_BLOCK)
+		m_blocks[block.prevFree].nextFree = block.nextFree;
+	if (block.nextFree != NULL_BLOCK)
+		m_blocks[block.nextFree].prevFree = block.prevFree;
+
+	if (m_freeListHeads[fl][sl] == index)
+	{
+		m_freeListHeads[fl][sl] = block.nextFree;
+		if (block.nextFree == NULL_BLOCK)
+		{
+			m_slBitmaps[fl] &= ~(1u << sl);
+			if (!m_slBitmaps[fl])
+				m_flBitmap &= ~(1u << fl);
+		}
+	}
+
+	block.isFree = false;
+	block.prevFree = NULL_BLOCK;
+	block.nextFree = NULL_BLOCK;
+}
+
+uint32_t TLSFAllocator::SplitBlock(uint32_t index, uint32_t numBytes)
+{
+	uint32_t restIndex = AcquireBlockSlot();
+
+	// Acquiring a slot might reallocate block vector, so fetch references afterwards
+	Block& block = m_blocks[index];
+	Block& rest = m_blocks[restIndex];
+
+	rest.offset = block.offset + numBytes;
+	rest.numBytes = block.numBytes - numBytes;
+	rest.prevPhysical = index;
+	rest.nextPhysical = block.nextPhysical;
+
+	if (block.nextPhysical != NULL_BLOCK)
+		m_blocks[block.nextPhysical].prevPhysical = restIndex;
+	else
+		m_lastPhysical = restIndex;
+
+	block.numBytes = numBytes;
+	block.nextPhysical = restIndex;
+
+	return restIndex;
+}
+
+void TLSFAllocator::MergeWithNext(uint32_t index)
+{
+	Block& block = m_blocks[index];
+	uint32_t nextIndex = block.nextPhysical;
+	Block& next = m_blocks[nextIndex];
+
+	block.numBytes += next.numBytes;
+	block.nextPhysical = next.nextPhysical;
+	if (next.nextPhysical != NULL_BLOCK)
+		m_blocks[next.nextPhysical].prevPhysical = index;
+	else
+		m_lastPhysical = index;
+
+	ReleaseBlockSlot(nextIndex);
+}
+
+uint32_t TLSFAllocator::Allocate(uint32_t numBytes, uint32_t alignment, uint32_t& offset)
+{
+	if (numBytes == 0)
+		numBytes = 1;
+	if (alignment == 0)
+		alignment = 1;
+
+	// Alignment has to be power of 2
+	ASSERTION((alignment & (alignment - 1)) == 0);
+
+	// Search for a block large enough to contain the worst case of alignment padding
+	uint64_t searchBytes = (uint64_t)numBytes + alignment - 1;
+	if (searchBytes > m_totalBytes)
+		return NULL_BLOCK;
+
+	uint32_t fl, sl;
+	if (!MappingSearch((uint32_t)searchBytes, fl, sl))
+		return NULL_BLOCK;
+
+	uint32_t index = FindSuitableBlock(fl, sl);
+	if (index == NULL_BLOCK)
+		return NULL_BLOCK;
+
+	RemoveFreeBlock(index);
+
+	// Leading padding goes back to free lists, its previous physical block must be in use since free blocks are always coalesced
+	uint32_t alignedOffset = (m_blocks[index].offset + alignment - 1) & ~(alignment - 1);
+	uint32_t padding = alignedOffset - m_blocks[index].offset;
+	if (padding > 0)
+	{
+		uint32_t alignedIndex = SplitBlock(index, padding);
+		InsertFreeBlock(index);
+		index = alignedIndex;
+	}
+
+	// Trailing remainder goes back to free lists as well
+	if (m_blocks[index].numBytes > numBytes)
+	{
+		uint32_t restIndex = SplitBlock(index, numBytes);
+		InsertFreeBlock(restIndex);
+	}
+
+	m_allocatedBytes += numBytes;
+	m_allocationCount++;
+
+	offset = m_blocks[index].offset;
+	return index;
+}
+
+void TLSFAllocator::Free(uint32_t handle)
+{
+	ASSERTION(handle < m_blocks.size() && !m_blocks[handle].isFree);
+
+	m_allocatedBytes -= m_blocks[handle].numBytes;
+	m_allocationCount--;
+
+	uint32_t index = handle;
+
+	uint32_t prevIndex = m_blocks[index].prevPhysical;
+	if (prevIndex != NULL_BLOCK && m_blocks[prevIndex].isFree)
+	{
+		RemoveFreeBlock(prevIndex);
+		MergeWithNext(prevIndex);
+		index = prevIndex;
+	}
+
+	uint32_t nextIndex = m_blocks[index].nextPhysical;
+	if (nextIndex != NULL_BLOCK && m_blocks[nextIndex].isFree)
+	{
+		RemoveFreeBlock(nextIndex);
+		MergeWithNext(index);
+	}
+
+	InsertFreeBlock(index);
+}
+
+void TLSFAllocator::Grow(uint32_t numBytes)
+{
+	ASSERTION((uint64_t)m_totalBytes + numBytes <= 0xffffffff);
+
+	if (numBytes == 0)
+		return;
+
+	uint32_t index = m_lastPhysical;
+	if (m_blocks[index].isFree)
+	{
+		// Size changes, so does its bucket
+		RemoveFreeBlock(index);
+		m_blocks[index].numBytes += numBytes;
+	}
+	else
+	{
+		index = AcquireBlockSlot();
+		m_blocks[index].offset = m_totalBytes;
+		m_blocks[index].numBytes = numBytes;
+		m_blocks[index].prevPhysical = m_lastPhysical;
+		m_blocks[m_lastPhysical].nextPhysical = index;
+		m_lastPhysical = index;
+	}
+
+	m_totalBytes += numBytes;
+	InsertFreeBlock(index);
+}
+
+bool TLSFAllocator::Validate() const
+{
+	// Physical chain has to cover the whole range without gaps, and no adjacent blocks are both free
+	uint32_t index = 0;
+	while (m_blocks[index].prevPhysical != NULL_BLOCK)
+		index = m_blocks[index].prevPhysical;
+
+	uint32_t offset = 0;
+	uint32_t allocatedBytes = 0;
+	bool prevFree = false;
+	for (; index != NULL_BLOCK; index = m_blocks[index].nextPhysical)
+	{
+		const Block& block = m_blocks[index];
+		if (block.offset != offset)
+			return false;
+		if (block.isFree && prevFree)
+			return false;
+		if (!block.isFree)
+			allocatedBytes += block.numBytes;
+
+		if (block.nextPhysical == NULL_BLOCK && index != m_lastPhysical)
+			return false;
+
+		prevFree = block.isFree;
+		offset += block.numBytes;
+	}
+
+	return offset == m_totalBytes && allocatedBytes == m_allocatedBytes;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+// Two-Level Segregated Fit allocator, it only does bookkeeping of a linear range [0, size), no actual memory is touched
+// Allocation and free are both O(1):
+// 1. Free blocks are bucketed by (first level: log2 of size, second level: linear subdivision of first level)
+// 2. Bitmaps of non-empty buckets are used to find a suitable bucket with a couple of bit scans
+// 3. Adjacent free blocks are coalesced immediately when freed
+class TLSFAllocator
+{
+	typedef struct _Block
+	{
+		uint32_t	offset = 0;
+		uint32_t	numBytes = 0;
+		uint32_t	prevPhysical = NULL_BLOCK;
+		uint32_t	nextPhysical = NULL_BLOCK;
+		uint32_t	prevFree = NULL_BLOCK;
+		uint32_t	nextFree = NULL_BLOCK;
+		bool		isFree = false;
+	}Block;
+
+public:
+	static const uint32_t NULL_BLOCK = 0xffffffff;
+
+	static const uint32_t SL_INDEX_COUNT_LOG2 = 5;
+	static const uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+	// Sizes smaller than this are all mapped to first level 0
+	static const uint32_t SMALL_BLOCK_SIZE = SL_INDEX_COUNT;
+	static const uint32_t FL_INDEX_COUNT = 32 - SL_INDEX_COUNT_LOG2 + 1;
+
+public:
+	TLSFAllocator(uint32_t numBytes);
+
+public:
+	// Smallest range an empty allocator needs to serve Allocate(numBytes, alignment)
+	// Search rounds up to the next bucket, so a range of exactly numBytes isn't always enough
+	static uint64_t GetRequiredBytes(uint32_t numBytes, uint32_t alignment);
+
+public:
+	// Returns a handle used to free this allocation, NULL_BLOCK if there's no room
+	uint32_t Allocate(uint32_t numBytes, uint32_t alignment, uint32_t& offset);
+	void Free(uint32_t handle);
+	// Extend range to [0, size + numBytes), trailing free block takes the new bytes so it's merged with what's freed at the end
+	void Grow(uint32_t numBytes);
+
+	uint32_t GetOffset(uint32_t handle) const { return m_blocks[handle].offset; }
+	uint32_t GetAllocationSize(uint32_t handle) const { return m_blocks[handle].numBytes; }
+
+	uint32_t GetTotalBytes() const { return m_totalBytes; }
+	uint32_t GetAllocatedBytes() const { return m_allocatedBytes; }
+	uint32_t GetAllocationCount() const { return m_allocationCount; }
+	bool IsEmpty() const { return m_allocationCount == 0; }
+
+	// Walks through all blocks, for debug purpose only
+	bool Validate() const;
+
+protected:
+	static void MappingInsert(uint32_t numBytes, uint32_t& fl, uint32_t& sl);
+	static bool MappingSearch(uint32_t numBytes, uint32_t& fl, uint32_t& sl);
+	uint32_t FindSuitableBlock(uint32_t& fl, uint32_t& sl) const;
+
+	uint32_t AcquireBlockSlot();
+	void ReleaseBlockSlot(uint32_t index);
+
+	void InsertFreeBlock(uint32_t index);
+	void RemoveFreeBlock(uint32_t index);
+
+	// Split block into [offset, offset + numBytes) and the rest, returns index of the rest
+	uint32_t SplitBlock(uint32_t index, uint32_t numBytes);
+	// Merge next physical block into this one
+	void MergeWithNext(uint32_t index);
+
+protected:
+	std::vector<Block>		m_blocks;
+	std::vector<uint32_t>	m_unusedBlockSlots;
+
+	uint32_t				m_flBitmap = 0;
+	uint32_t				m_slBitmaps[FL_INDEX_COUNT];
+	uint32_t				m_freeListHeads[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+	// Block at the end of range
+	uint32_t				m_lastPhysical = NULL_BLOCK;
+
+	uint32_t				m_totalBytes = 0;
+	uint32_t				m_allocatedBytes = 0;
+	uint32_t				m_allocationCount = 0;
+};
\ No newline at end of file
@@ -26,83 +26,170 @@ bool AnimationController::Init(const std::shared_ptr<AnimationController>& pAnim
 		return false;
 
 	m_pAnimationInstance = pAnimationInstance;
+	m_skeleton.trackIndices.resize(m_pAnimationInstance->GetAnimation()->GetAnimationCount());
 
-	m_pCurrentAnimationIndices = new uint32_t[m_pAnimationInstance->GetAnimation()->m_animationDataDiction[0].objectAnimationDiction.size()];
-	memset(m_pCurrentAnimationIndices, 0, sizeof(uint32_t) * m_pAnimationInstance->GetAnimation()->m_animationDataDiction[0].objectAnimationDiction.size());
+	// Base layer plays first clip in loop
+	AddLayer(AnimationBlendOverride, 1.0);
+	Play(0);
 
 	return true;
 }
 
-void AnimationController::Update()
+uint32_t AnimationController::AddLayer(AnimationBlendMode blendMode, double weight)
 {
-	double elapsed = Timer::GetElapsedTime();
-	m_animationPlayedTime += elapsed / 1000.0;
-	m_animationPlayedTime = fmod(m_animationPlayedTime, m_pAnimationInstance->GetAnimation()->m_animationDataDiction[0].duration);
+	AnimationLayer layer = {};
+	layer.blendMode = blendMode;
+	layer.weight = weight;
+	m_layers.push_back(layer);
+
+	return (uint32_t)m_layers.size() - 1;
 }
 
-void AnimationController::UpdateBoneTransform(const std::shared_ptr<BaseObject>& pObject)
+void AnimationController::Play(uint32_t animationIndex, double fadeDuration, uint32_t layerIndex)
 {
-	std::shared_ptr<SkeletonAnimation> pAnimation = m_pAnimationInstance->GetAnimation();
-	auto iter = pAnimation->m_animationDataDiction[0].objectAnimationLookupTable.find(pObject->GetNameHashCode());
+	AnimationLayer& layer = m_layers[layerIndex];
 
-	// If current object contains animation information, it's local transform will be changed accordingly
-	if (iter != pAnimation->m_animationDataDiction[0].objectAnimationLookupTable.end())
+	if (fadeDuration > 0 && layer.currentClip.animationIndex != NULL_INDEX)
 	{
-		uint32_t keyFrameCount = (uint32_t)pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames.size();
-		uint32_t currentKeyFrameIndex = m_pCurrentAnimationIndices[iter->second];
+		layer.fadingClip = layer.currentClip;
+		layer.fadeDuration = fadeDuration;
+		layer.fadeElapsed = 0;
+	}
+	else
+		layer.fadingClip.animationIndex = NULL_INDEX;
 
-		// Check if there is actually a next key frame
-		if (m_pCurrentAnimationIndices[iter->second] + 1 < keyFrameCount
-			// And if current keyframe is done, move to next possible animation
-			&& m_animationPlayedTime > pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[m_pCurrentAnimationIndices[iter->second] + 1].time)
-		{
-			do
-			{
-				currentKeyFrameIndex += 1;
-			} while (currentKeyFrameIndex < keyFrameCount
-				&& m_animationPlayedTime > pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[currentKeyFrameIndex].time);
-
-			currentKeyFrameIndex--;
-			m_pCurrentAnimationIndices[iter->second] = currentKeyFrameIndex;
-		}
-		// If the whole animation is done, then start over again(FIXME: should add animation state and configuration later to configure this)
-		else if (m_animationPlayedTime < pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[m_pCurrentAnimationIndices[iter->second]].time)
-		{
-			currentKeyFrameIndex = 0;
+	layer.currentClip.animationIndex = animationIndex;
+	layer.currentClip.playedTime = 0;
+	layer.currentClip.cursors.assign(m_pAnimationInstance->GetAnimation()->GetTrackCount(animationIndex), {});
 
-			do
-			{
-				currentKeyFrameIndex += 1;
-			} while (m_animationPlayedTime > pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[currentKeyFrameIndex].time);
+	UpdateReferencePose(layer);
+}
 
-			currentKeyFrameIndex--;
-			m_pCurrentAnimationIndices[iter->second] = currentKeyFrameIndex;
-		}
+void AnimationController::UpdateReferencePose(AnimationLayer& layer)
+{
+	// Additive layer is relative to the first frame of its clip
+	if (layer.blendMode != AnimationBlendAdditive || layer.currentClip.animationIndex == NULL_INDEX || m_nodeObjects.empty())
+		return;
+
+	AnimationClipState referenceClip = layer.currentClip;
+	referenceClip.playedTime = 0;
+	AnimationPoseEvaluator::SampleClip(m_pAnimationInstance->GetAnimation().get(), m_skeleton, referenceClip, layer.referencePose);
+}
+
+void AnimationController::AddLayerBoneMask(uint32_t layerIndex, std::size_t boneNameHashCode)
+{
+	m_layers[layerIndex].boneMaskHashCodes.push_back(boneNameHashCode);
+	UpdateLayerBoneMask(m_layers[layerIndex]);
+}
+
+void AnimationController::ClearLayerBoneMask(uint32_t layerIndex)
+{
+	m_layers[layerIndex].boneMaskHashCodes.clear();
+	m_layers[layerIndex].boneMask.clear();
+}
+
+void AnimationController::UpdateLayerBoneMask(AnimationLayer& layer)
+{
+	if (layer.boneMaskHashCodes.empty() || m_nodeObjects.empty())
+		return;
+
+	layer.boneMask.assign(m_nodeObjects.size(), 0);
+
+	// Parents come before children, so a node is masked in if its parent is
+	for (uint32_t i = 0; i < (uint32_t)m_nodeObjects.size(); i++)
+	{
+		std::shared_ptr<BaseObject> pObject = m_nodeObjects[i] != nullptr ? m_nodeObjects[i] : GetBaseObject();
+		uint32_t parentIndex = m_skeleton.parentIndices[i];
+		bool isMasked = parentIndex != NULL_INDEX && layer.boneMask[parentIndex] > 0;
+		for (uint32_t j = 0; j < (uint32_t)layer.boneMaskHashCodes.size() && !isMasked; j++)
+			isMasked = pObject->GetNameHashCode() == layer.boneMaskHashCodes[j];
+		layer.boneMask[i] = isMasked ? 1.0 : 0;
+	}
+}
+
+void AnimationController::Update()
+{
+	double elapsed = Timer::GetElapsedTime() / 1000.0;
+
+	for (auto& layer : m_layers)
+	{
+		AdvanceClip(layer.currentClip, elapsed);
+
+		if (layer.fadingClip.animationIndex == NULL_INDEX)
+			continue;
+
+		AdvanceClip(layer.fadingClip, elapsed);
+		layer.fadeElapsed += elapsed;
+		if (layer.fadeElapsed >= layer.fadeDuration)
+			layer.fadingClip.animationIndex = NULL_INDEX;
+	}
+}
 
-		uint32_t nextKeyFrameIndex = currentKeyFrameIndex + 1;
+void AnimationController::AdvanceClip(AnimationClipState& clip, double elapsed)
+{
+	if (clip.animationIndex == NULL_INDEX)
+		return;
 
-		// To deal with the situation that some object's animation is shorter than the others, therefore it'll keep last key frame until current animation is done
-		if (nextKeyFrameIndex >= keyFrameCount)
-			nextKeyFrameIndex = currentKeyFrameIndex;
+	clip.playedTime += elapsed;
+	clip.playedTime = fmod(clip.playedTime, m_pAnimationInstance->GetAnimation()->GetAnimationData(clip.animationIndex).duration);
+}
 
-		double currentAnimationTime = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[currentKeyFrameIndex].time;
-		double nextAnimationTime = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[nextKeyFrameIndex].time;
-		double factor = (m_animationPlayedTime - currentAnimationTime) / (nextAnimationTime - currentAnimationTime);
+void AnimationController::OnAnimationUpdate()
+{
+	const SkeletonAnimation* pAnimation = m_pAnimationInstance->GetAnimation().get();
 
-		// To deal with the situation that some object's animation is shorter than the others, therefore it'll keep last key frame until current animation is done
-		factor = factor > 1.0f ? 1.0f : factor;
+	// Skeleton objects could be changed by others, nodes not animated follow them
+	for (uint32_t i = 0; i < (uint32_t)m_nodeObjects.size(); i++)
+	{
+		if (m_nodeObjects[i] == nullptr || m_isNodeAnimated[i])
+			continue;
 
-		Quaterniond& currentRotation = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[currentKeyFrameIndex].transform;
-		Vector3d& currentTranslation = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].translationKeyFrames[currentKeyFrameIndex].transform;
+		m_skeleton.bindPose.rotations[i] = m_nodeObjects[i]->GetLocalRotationQ();
+		m_skeleton.bindPose.translations[i] = m_nodeObjects[i]->GetLocalPosition();
+		m_skeleton.bindPose.scales[i] = m_nodeObjects[i]->GetLocalScale();
+	}
 
-		Quaterniond& nextRotation = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].rotationKeyFrames[nextKeyFrameIndex].transform;
-		Vector3d& nextTranslation = pAnimation->m_animationDataDiction[0].objectAnimationDiction[iter->second].translationKeyFrames[nextKeyFrameIndex].transform;
+	m_blendedPose.rotations.assign(m_skeleton.bindPose.rotations.begin(), m_skeleton.bindPose.rotations.end());
+	m_blendedPose.translations.assign(m_skeleton.bindPose.translations.begin(), m_skeleton.bindPose.translations.end());
+	m_blendedPose.scales.assign(m_skeleton.bindPose.scales.begin(), m_skeleton.bindPose.scales.end());
 
-		Quaterniond blendRotation = Quaterniond::SLerp(currentRotation, nextRotation, factor);
-		Vector3d blendTranslation = currentTranslation * (1.0f - factor) + nextTranslation * factor;
+	for (auto& layer : m_layers)
+	{
+		if (layer.weight <= 0 || layer.currentClip.animationIndex == NULL_INDEX)
+			continue;
 
-		pObject->SetRotation(blendRotation);
-		pObject->SetPos(blendTranslation);
+		AnimationPoseEvaluator::SampleClip(pAnimation, m_skeleton, layer.currentClip, m_layerPose);
+		const AnimationPose* pLayerPose = &m_layerPose;
+
+		// Cross fade from previous clip to current one
+		if (layer.fadingClip.animationIndex != NULL_INDEX)
+		{
+			AnimationPoseEvaluator::SampleClip(pAnimation, m_skeleton, layer.fadingClip, m_fadingPose);
+			AnimationPoseEvaluator::BlendPose(m_layerPose, layer.fadeElapsed / layer.fadeDuration, {}, m_fadingPose);
+			pLayerPose = &m_fadingPose;
+		}
+
+		if (layer.blendMode == AnimationBlendAdditive)
+			AnimationPoseEvaluator::AddPose(*pLayerPose, layer.referencePose, layer.weight, layer.boneMask, m_blendedPose);
+		else
+			AnimationPoseEvaluator::BlendPose(*pLayerPose, layer.weight, layer.boneMask, m_blendedPose);
+	}
+
+	AnimationPoseEvaluator::BuildSkinningTransforms(m_skeleton, m_blendedPose, m_modelPoses, m_boneDQs.data());
+	m_pAnimationInstance->SetBoneTransforms(m_boneChunkIndices.data(), m_boneDQs.data(), (uint32_t)m_boneDQs.size());
+}
+
+void AnimationController::LateUpdate()
+{
+	for (uint32_t i = 0; i < (uint32_t)m_nodeObjects.size(); i++)
+	{
+		if (!m_isNodeAnimated[i])
+			continue;
+
+		std::shared_ptr<BaseObject> pObject = m_nodeObjects[i] != nullptr ? m_nodeObjects[i] : GetBaseObject();
+		pObject->SetRotation(m_blendedPose.rotations[i]);
+		pObject->SetPos(m_blendedPose.translations[i]);
+		pObject->SetScale(m_blendedPose.scales[i]);
 	}
 }
 
@@ -115,36 +202,56 @@ void AnimationController::OnPreRender()
 	m_pMeshRenderer->OverrideModelMatrix(GetBaseObject()->GetCachedWorldTransform());
 }
 
-void AnimationController::SyncBoneTransformToUniform(const std::shared_ptr<BaseObject>& pObject, uint32_t boneIndex, const DualQuaterniond& boneOffsetDQ)
+void AnimationController::OnAddedToObjectInternal(const std::shared_ptr<BaseObject>& pObject)
 {
-	Matrix4d transform = GetBaseObject()->GetCachedWorldTransform();
-	transform.Inverse();
-	transform *= pObject->GetCachedWorldTransform();
-	transform *= Matrix4d(boneOffsetDQ.AcquireRotation().Matrix(), boneOffsetDQ.AcquireTranslation());
+	InitBoneObjects(pObject, NULL_INDEX);
 
-	m_pAnimationInstance->SetBoneTransform(pObject->GetNameHashCode(), boneIndex, DualQuaterniond(transform.RotationMatrix(), transform.TranslationVector()));
-}
+	m_blendedPose = m_skeleton.bindPose;
+	m_layerPose = m_skeleton.bindPose;
+	m_fadingPose = m_skeleton.bindPose;
 
-void AnimationController::OnAddedToObjectInternal(const std::shared_ptr<BaseObject>& pObject)
-{
-	InitBoneObjects(GetBaseObject());
+	// Layers could be set up before skeleton is known
+	for (auto& layer : m_layers)
+	{
+		UpdateLayerBoneMask(layer);
+		UpdateReferencePose(layer);
+	}
 }
 
-void AnimationController::InitBoneObjects(std::weak_ptr<BaseObject> pRootObject)
+void AnimationController::InitBoneObjects(const std::shared_ptr<BaseObject>& pObject, uint32_t parentIndex)
 {
-	if (pRootObject.expired())
-		return;
+	uint32_t nodeIndex = (uint32_t)m_nodeObjects.size();
+
+	bool isAnimated = false;
+	for (uint32_t i = 0; i < (uint32_t)m_skeleton.trackIndices.size(); i++)
+	{
+		m_skeleton.trackIndices[i].push_back(m_pAnimationInstance->GetAnimation()->AcquireTrackIndex(i, pObject->GetNameHashCode()));
+		isAnimated |= m_skeleton.trackIndices[i].back() != SkeletonAnimation::NULL_TRACK;
+	}
 
-	std::shared_ptr<BaseObject> pSharedRootObject = pRootObject.lock();
 	DualQuaterniond boneOffsetDQ;
 	uint32_t boneIndex;
 	// Check if current object is a bone
-	if (UniformData::GetInstance()->GetPerBoneIndirectUniforms()->GetBoneInfo(m_pAnimationInstance->GetMesh()->GetMeshBoneChunkIndexOffset(), pSharedRootObject->GetNameHashCode(), boneIndex, boneOffsetDQ))
+	if (UniformData::GetInstance()->GetPerBoneIndirectUniforms()->GetBoneInfo(m_pAnimationInstance->GetMesh()->GetMeshBoneChunkIndexOffset(), pObject->GetNameHashCode(), boneIndex, boneOffsetDQ))
 	{
 		std::shared_ptr<BoneObject> pBoneObject = BoneObject::Create(std::dynamic_pointer_cast<AnimationController>(GetSelfSharedPtr()), boneIndex, boneOffsetDQ);
-		pSharedRootObject->AddComponent(pBoneObject);
+		pObject->AddComponent(pBoneObject);
+
+		m_skeleton.boneNodeIndices.push_back(nodeIndex);
+		m_skeleton.boneOffsets.push_back(Matrix4d(boneOffsetDQ.AcquireRotation().Matrix(), boneOffsetDQ.AcquireTranslation()));
+
+		m_boneChunkIndices.push_back(m_pAnimationInstance->GetBoneChunkIndex(boneIndex));
+		m_boneDQs.push_back(DualQuaterniond());
 	}
 
-	for (uint32_t i = 0; i < pSharedRootObject->GetChildrenCount(); i++)
-		InitBoneObjects(pSharedRootObject->GetChild(i));
+	m_nodeObjects.push_back(parentIndex == NULL_INDEX ? nullptr : pObject);
+	m_isNodeAnimated.push_back(isAnimated);
+	m_skeleton.parentIndices.push_back(parentIndex);
+	m_skeleton.bindPose.rotations.push_back(pObject->GetLocalRotationQ());
+	m_skeleton.bindPose.translations.push_back(pObject->GetLocalPosition());
+	m_skeleton.bindPose.scales.push_back(pObject->GetLocalScale());
+	m_modelPoses.push_back(Matrix4d());
+
+	for (uint32_t i = 0; i < pObject->GetChildrenCount(); i++)
+		InitBoneObjects(pObject->GetChild(i), nodeIndex);
 }
\ No newline at end of file
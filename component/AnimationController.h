@@ -2,41 +2,100 @@
 #include "../Base/BaseComponent.h"
 #include "../Maths/Matrix.h"
 #include "../Maths/DualQuaternion.h"
+#include "../class/SkeletonAnimation.h"
+#include "../class/AnimationPoseEvaluator.h"
 
 class SkeletonAnimationInstance;
 class MeshRenderer;
 
+// Poses are blended through a stack of layers, each layer plays one clip and cross fades to the next one played
+// Layers are applied bottom up on top of bind pose, either overriding or adding to the result, weighted by layer weight and bone mask
 class AnimationController : public BaseComponent
 {
 	DECLARE_CLASS_RTTI(AnimationController);
 
 public:
 	static std::shared_ptr<AnimationController> Create(const std::shared_ptr<SkeletonAnimationInstance>& pAnimationInstance = nullptr);
-	~AnimationController() { delete[] m_pCurrentAnimationIndices; }
+
+	static const uint32_t NULL_INDEX = 0xffffffff;
+
+	enum AnimationBlendMode
+	{
+		AnimationBlendOverride,
+		AnimationBlendAdditive,
+		AnimationBlendModeCount
+	};
+
+	typedef struct _AnimationLayer
+	{
+		AnimationBlendMode		blendMode;
+		double					weight;
+		AnimationClipState		currentClip;
+		AnimationClipState		fadingClip;			// Previous clip, fading out
+		double					fadeDuration = 0;
+		double					fadeElapsed = 0;
+		std::vector<std::size_t>	boneMaskHashCodes;	// Bones added to mask, mask is built from them once skeleton is known
+		std::vector<double>		boneMask;			// Per pose node weight, empty if all nodes are affected
+		AnimationPose			referencePose;		// First frame of current clip, additive layer adds difference to it
+	}AnimationLayer;
 
 public:
-	void UpdateBoneTransform(const std::shared_ptr<BaseObject>& pObject);
-	void SyncBoneTransformToUniform(const std::shared_ptr<BaseObject>& pObject, uint32_t boneIndex, const DualQuaterniond& boneOffsetDQ);
 	std::shared_ptr<SkeletonAnimationInstance> GetAnimationInstance() const { return m_pAnimationInstance; }
-	double GetAnimationPlayedTime() const { return m_animationPlayedTime; }
+	double GetAnimationPlayedTime() const { return m_layers[0].currentClip.playedTime; }
 	void SetMeshRenderer(const std::shared_ptr<MeshRenderer>& pMeshRenderer) { m_pMeshRenderer = pMeshRenderer; }
 
+	// Play a clip on a layer, current clip of that layer fades out within fadeDuration(in seconds)
+	void Play(uint32_t animationIndex, double fadeDuration = 0, uint32_t layerIndex = 0);
+	// Returns layer index, layer 0 is created with controller and plays first clip
+	uint32_t AddLayer(AnimationBlendMode blendMode, double weight);
+	uint32_t GetLayerCount() const { return (uint32_t)m_layers.size(); }
+	void SetLayerWeight(uint32_t layerIndex, double weight) { m_layers[layerIndex].weight = weight; }
+	// Layer only affects the bone with this name and its descendants, could be called multiple times to add more
+	// It could be called before controller is added to an object, mask is built once skeleton is known
+	void AddLayerBoneMask(uint32_t layerIndex, std::size_t boneNameHashCode);
+	void ClearLayerBoneMask(uint32_t layerIndex);
+
 public:
 	void Update() override;
+	// Pose job, controllers are evaluated in parallel, it only reads skeleton objects and writes its own pose
+	void OnAnimationUpdate() override;
+	// Animated local transforms are written back to skeleton objects here, since several controllers could share one skeleton
+	void LateUpdate() override;
 	void OnPreRender() override;
 
+	bool IsParallelPhase(ComponentPhase phase) const override { return phase == ComponentPhaseAnimationUpdate; }
+
 protected:
 	bool Init(const std::shared_ptr<AnimationController>& pAnimationController, const std::shared_ptr<SkeletonAnimationInstance>& pAnimationInstance = nullptr);
 
 protected:
 	void OnAddedToObjectInternal(const std::shared_ptr<BaseObject>& pObject) override;
-	void InitBoneObjects(std::weak_ptr<BaseObject> pRootObject);
+	void InitBoneObjects(const std::shared_ptr<BaseObject>& pObject, uint32_t parentIndex);
+
+	void AdvanceClip(AnimationClipState& clip, double elapsed);
+	// Both need skeleton, they're done again once controller is added to an object
+	void UpdateLayerBoneMask(AnimationLayer& layer);
+	void UpdateReferencePose(AnimationLayer& layer);
 
 protected:
 	std::shared_ptr<SkeletonAnimationInstance>	m_pAnimationInstance;
 	std::shared_ptr<MeshRenderer>				m_pMeshRenderer;
 
-	double		m_animationPlayedTime;
+	std::vector<AnimationLayer>			m_layers;
+
+	// Indexed by pose node index, null for the object this controller is attached to, or else it's a reference cycle
+	std::vector<std::shared_ptr<BaseObject>>	m_nodeObjects;
+	std::vector<Matrix4d>				m_modelPoses;
+	// Whether a node is animated by any clip, only these are written back to skeleton objects
+	std::vector<bool>					m_isNodeAnimated;
+
+	PoseSkeleton						m_skeleton;
+	AnimationPose						m_blendedPose;
+	// Scratch poses of the layer being blended
+	AnimationPose						m_layerPose;
+	AnimationPose						m_fadingPose;
 
-	uint32_t*	m_pCurrentAnimationIndices;
+	// Skinning transforms relative to the object this controller is attached to, written to bone uniforms directly
+	std::vector<uint32_t>				m_boneChunkIndices;
+	std::vector<DualQuaterniond>		m_boneDQs;
 };
\ No newline at end of file
@@ -24,17 +24,4 @@ std::shared_ptr<BoneObject> BoneObject::Create(std::weak_ptr<AnimationController
 	if (pBoneObject.get() && pBoneObject->Init(pBoneObject, pRootBone, boneIndex, boneOffset))
 		return pBoneObject;
 	return nullptr;
-}
-
-void BoneObject::OnAnimationUpdate()
-{
-	if (m_pRootBone.expired())
-		return;
-
-	m_pRootBone.lock()->UpdateBoneTransform(GetBaseObject());
-}
-
-void BoneObject::OnPreRender()
-{
-	m_pRootBone.lock()->SyncBoneTransformToUniform(GetBaseObject(), m_boneIndex, m_boneOffset);
 }
\ No newline at end of file
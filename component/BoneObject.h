@@ -15,13 +15,11 @@ public:
 protected:
 	bool Init(const std::shared_ptr<BoneObject>& pSelf, std::weak_ptr<AnimationController> pRootBone, uint32_t boneIndex, const DualQuaterniond& boneOffset);
 
-public:
-	void OnAnimationUpdate() override;
-	void OnPreRender() override;
-
 public:
 	void SetRootBone(std::weak_ptr<AnimationController> pRootBone) { m_pRootBone = pRootBone; }
 	std::weak_ptr<AnimationController> GetRootBone() const { return m_pRootBone; }
+	uint32_t GetBoneIndex() const { return m_boneIndex; }
+	const DualQuaterniond& GetBoneOffset() const { return m_boneOffset; }
 
 private:
 	std::weak_ptr<AnimationController>	m_pRootBone;
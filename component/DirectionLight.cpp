@@ -6,6 +6,7 @@
 #include "../Maths/Vector.h"
 #include "../Maths/MathUtil.h"
 #include "../class/UniformData.h"
+#include "../class/VisibilityCuller.h"
 
 const double DirectionLight::DEFAULT_SHADOWMAP_SIZE = 512;
 const double DirectionLight::DEFAULT_FRUSTUM_SIZE = 2.56;
@@ -87,6 +88,27 @@ void DirectionLight::OnPreRender()
 	UniformData::GetInstance()->GetPerFrameUniforms()->SetMainLightDir(m_csLightDirection);
 	UniformData::GetInstance()->GetPerFrameUniforms()->SetMainLightVP(m_cs2lsProjMatrix);
 	UniformData::GetInstance()->GetPerFrameUniforms()->SetMainLightColor(m_lightColor);
+
+	UpdateCullingPlanes();
+}
+
+void DirectionLight::UpdateCullingPlanes()
+{
+	// Shadow map covers a box in light space, [-size, size] along each axis
+	Matrix4d ls2ws = GetBaseObject()->GetCachedWorldTransform();
+	Vector3d origin = ls2ws[3].xyz();
+
+	Planed planes[6];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		// Axis isn't normalized, so that box follows scale of light as well
+		Vector3d axis = ls2ws[i].xyz();
+
+		planes[i * 2 + 0] = Planed(axis, origin - axis * m_frustumSize[i]);
+		planes[i * 2 + 1] = Planed(axis * -1.0, origin + axis * m_frustumSize[i]);
+	}
+
+	VisibilityCuller::GetInstance()->SetCullingPlanes(RenderWorkManager::ShadowMapGen, planes, 6);
 }
 
 
@@ -25,6 +25,7 @@ public:
 
 protected:
 	void UpdateData();
+	void UpdateCullingPlanes();
 
 protected:
 	Vector3d	m_lightColor;
@@ -23,6 +23,8 @@
 #include "../vulkan/Framebuffer.h"
 #include "../class/UniformData.h"
 #include "../class/Material.h"
+#include "../class/VisibilityCuller.h"
+#include <cmath>
 
 DEFINITE_CLASS_RTTI(MeshRenderer, BaseComponent);
 
@@ -52,7 +54,10 @@ std::shared_ptr<MeshRenderer> MeshRenderer::Create()
 
 MeshRenderer::~MeshRenderer()
 {
-	UniformData::GetInstance()->GetPerObjectUniforms()->FreePreObjectChunk(m_perObjectBufferIndex);
+	if (m_perObjectBufferIndex != NULL_INDEX)
+		UniformData::GetInstance()->GetPerObjectUniforms()->FreePreObjectChunk(m_perObjectBufferIndex);
+	if (m_cullingIndex != NULL_INDEX)
+		VisibilityCuller::GetInstance()->FreeObject(m_cullingIndex);
 }
 
 bool MeshRenderer::Init(const std::shared_ptr<MeshRenderer>& pSelf, const std::shared_ptr<Mesh> pMesh, const std::vector<std::shared_ptr<MaterialInstance>>& materialInstances)
@@ -73,6 +78,7 @@ bool MeshRenderer::Init(const std::shared_ptr<MeshRenderer>& pSelf, const std::s
 	}
 
 	m_perObjectBufferIndex = UniformData::GetInstance()->GetPerObjectUniforms()->AllocatePerObjectChunk();
+	m_cullingIndex = VisibilityCuller::GetInstance()->AllocateObject(this);
 
 	return true;
 }
@@ -96,9 +102,44 @@ void MeshRenderer::OnRenderObject()
 
 	for (uint32_t i = 0; i < m_materialInstances.size(); i++)
 	{
-		if ((RenderWorkManager::GetInstance()->GetRenderStateMask() & m_materialInstances[i]->GetRenderMask()) == 0)
+		uint32_t renderStateMask = RenderWorkManager::GetInstance()->GetRenderStateMask() & m_materialInstances[i]->GetRenderMask();
+		if (renderStateMask == 0)
+			continue;
+
+		if (!VisibilityCuller::GetInstance()->IsVisible(m_cullingIndex, renderStateMask))
 			continue;
 
 		m_materialInstances[i]->InsertIntoRenderQueue(m_pMesh, m_perObjectBufferIndex, m_pMesh->GetMeshChunkIndex(), m_utilityIndex, m_instanceCount, m_startInstance);
 	}
+}
+
+bool MeshRenderer::AcquireWorldBoundingBox(Vector3d& center, Vector3d& extent) const
+{
+	if (m_pMesh == nullptr || !m_pMesh->HasBoundingBox())
+		return false;
+
+	// Customized instances are placed by shader, and skinned vertices could go beyond bounding box of bind pose
+	if (m_instanceCount > 1 || m_pMesh->GetBoneCount() > 0)
+		return false;
+
+	std::shared_ptr<BaseObject> pObject = GetBaseObject();
+	if (pObject == nullptr)
+		return false;
+
+	Matrix4d world = m_modelMatrixOverride ? m_overrideModelMatrix : pObject->GetCachedWorldTransform();
+
+	Vector3d localCenter = m_pMesh->GetBoundingBoxCenter();
+	Vector3d localExtent = m_pMesh->GetBoundingBoxExtent();
+
+	center = world.TransformAsPoint(localCenter);
+
+	// Extent of transformed box along each world axis
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		extent[i] = std::fabs(world[0][i]) * localExtent.x
+			+ std::fabs(world[1][i]) * localExtent.y
+			+ std::fabs(world[2][i]) * localExtent.z;
+	}
+
+	return true;
 }
\ No newline at end of file
@@ -32,12 +32,18 @@ public:
 	void SetUtilityIndex(uint32_t index) { m_utilityIndex = index; }
 	void OverrideModelMatrix(const Matrix4d& matrix) { m_overrideModelMatrix = matrix; m_modelMatrixOverride = true; }
 
+	// Returns false if renderer can't be culled, e.g. instances are placed by shader, or vertices are skinned
+	bool AcquireWorldBoundingBox(Vector3d& center, Vector3d& extent) const;
+	uint32_t GetCullingIndex() const { return m_cullingIndex; }
+
 protected:
 	bool Init(const std::shared_ptr<MeshRenderer>& pSelf, const std::shared_ptr<Mesh> pMesh, const std::vector<std::shared_ptr<MaterialInstance>>& materialInstances);
 
 protected:
 	std::shared_ptr<Mesh>	m_pMesh;
-	uint32_t				m_perObjectBufferIndex;
+	// Stay NULL_INDEX if Init fails before they're allocated
+	uint32_t				m_perObjectBufferIndex = NULL_INDEX;
+	uint32_t				m_cullingIndex = NULL_INDEX;
 
 	std::vector<std::shared_ptr<MaterialInstance>> m_materialInstances;
 
@@ -58,4 +64,6 @@ protected:
 
 	bool					m_modelMatrixOverride = false;
 	Matrix4d				m_overrideModelMatrix;
+
+	static const uint32_t NULL_INDEX = 0xffffffff;
 };
\ No newline at end of file
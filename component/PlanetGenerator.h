@@ -3,48 +3,28 @@
 #include "../Maths/Matrix.h"
 #include "../Maths/PyramidFrustum.h"
 #include "../class/PerFrameData.h"
+#include "../class/PlanetQuadTree.h"
 
 class MeshRenderer;
 class PhysicalCamera;
+class PlanetHeightTileCache;
 
 // The core idea of this class is based on brilliant https://github.com/Illation/PlanetRenderer
 class PlanetGenerator : public BaseComponent
 {
 	DECLARE_CLASS_RTTI(PlanetGenerator);
 
-	enum class CullState
-	{
-		CULL,			// If a triangle is fully out of a volumn
-		CULL_DIVIDE,	// If a triangle intersects with a volumn
-		DIVIDE			// If a triangle is fully inside a volumn
-	};
-
-	typedef struct _Triangle
-	{
-		// A triangle consists of a vertex, and 2 edge vectors: edge0 and edge1
-		Vector3f	p;
-		Vector3f	edge0;
-		Vector3f	edge1;
-		float		level;	// the sign of this variable gives morphing direction
-	}Triangle;
-
 public:
-	static std::shared_ptr<PlanetGenerator> Create(const std::shared_ptr<PhysicalCamera>& pCamera, float planetRadius);
+	static std::shared_ptr<PlanetGenerator> Create(const std::shared_ptr<PhysicalCamera>& pCamera, float planetRadius, uint32_t terrainSeed = 0);
 
 public:
 	double GetPlanetRadius() const { return m_planetRadius; }
+	std::shared_ptr<PlanetHeightTileCache> GetHeightTileCache() const { return m_pHeightTileCache; }
+	// Available once started
+	std::shared_ptr<PlanetQuadTree> GetQuadTree() const { return m_pQuadTree; }
 
 protected:
-	bool Init(const std::shared_ptr<PlanetGenerator>& pSelf, const std::shared_ptr<PhysicalCamera>& pCamera, float planetRadius);
-
-protected:
-	CullState FrustumCull(const Vector3d& a, const Vector3d& b, const Vector3d& c, double height);
-	CullState FrustumCull(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2, const Vector3d& p3, double height);
-	bool BackFaceCull(const Vector3d& a, const Vector3d& b, const Vector3d& c);
-	// Though we can do it with simply 2 triangle back face cullings, this function could potentially reduce some calculation
-	bool BackFaceCull(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d);
-	void SubDivideTriangle(uint32_t currentLevel, CullState state, const Vector3d& a, const Vector3d& b, const Vector3d& c, bool reversed, Triangle*& pOutputTriangles);
-	void SubDivideQuad(uint32_t currentLevel, CullState state, const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, Triangle*& pOutputTriangles);
+	bool Init(const std::shared_ptr<PlanetGenerator>& pSelf, const std::shared_ptr<PhysicalCamera>& pCamera, float planetRadius, uint32_t terrainSeed);
 
 public:
 	void Start() override;
@@ -56,24 +36,16 @@ public:
 private:
 	double			m_planetRadius = 1;
 
-	// Make a copy here to avoid frequent uniform reading
-	std::vector<double>				m_heightLUT;
-	std::vector<double>				m_distanceLUT;
-	uint32_t						m_maxLODLevel;
-	Vector3d*						m_pVertices;
-	uint32_t*						m_pIndices;
-	bool*							m_pMorphReverse;
-
 	std::shared_ptr<MeshRenderer>	m_pMeshRenderer;
 	std::shared_ptr<PhysicalCamera>	m_pCamera;
 
 	// Utility variables, to avoid frequent construction and destruction every frame
 	Matrix4d		m_utilityTransfrom;
-	Vector3d		m_utilityVector0;
-	Vector3d		m_utilityVector1;
-	Vector3d		m_utilityVector2;
-	Vector3d		m_utilityVector3;
-	Vector3d		m_utilityVector4;
+
+	std::shared_ptr<PlanetHeightTileCache>	m_pHeightTileCache;
+	std::shared_ptr<PlanetQuadTree>			m_pQuadTree;
+	// Patches of quad tree are stored in this region of planet geometry buffer
+	uint32_t						m_patchRegionOffset = 0;
 
 	// Camera infor in planet local space
 	PyramidFrustumd	m_cameraFrustumLocal;
@@ -87,4 +59,9 @@ private:
 
 	uint32_t		m_chunkIndex;
 
+	static const uint32_t PLANET_MAX_PATCH_COUNT = 16384;
+	// Cached tiles are bounds only, a few dozen bytes each, this holds bounds of all patches plus some more for nodes split again
+	static const uint32_t PLANET_HEIGHT_CACHE_BYTES = 1024 * 1024;
+	// Terrain heights relative to planet radius
+	static const float PLANET_TERRAIN_HEIGHT_SCALE;
 };
\ No newline at end of file
@@ -47,7 +47,7 @@ void SceneGenerator::GenerateIrradianceGenScene()
 	pSkyBox->AddComponent(m_pMeshRenderer0);
 	m_pRootObj->AddChild(pSkyBox);
 
-	StagingBufferMgr()->FlushDataMainThread();
+	StagingBufferMgr()->WaitForFlushedData();
 }
 
 void SceneGenerator::GeneratePrefilterEnvGenScene()
@@ -69,7 +69,7 @@ void SceneGenerator::GeneratePrefilterEnvGenScene()
 	pSkyBox->AddComponent(m_pMeshRenderer0);
 	m_pRootObj->AddChild(pSkyBox);
 
-	StagingBufferMgr()->FlushDataMainThread();
+	StagingBufferMgr()->WaitForFlushedData();
 }
 
 void SceneGenerator::GenerateBRDFLUTGenScene()
@@ -90,7 +90,7 @@ void SceneGenerator::GenerateBRDFLUTGenScene()
 	pQuadObj->AddComponent(m_pMeshRenderer0);
 	m_pRootObj->AddChild(pQuadObj);
 
-	StagingBufferMgr()->FlushDataMainThread();
+	StagingBufferMgr()->WaitForFlushedData();
 }
 
 void SceneGenerator::GenerateCube(Vector3d vertices[], uint32_t indices[])
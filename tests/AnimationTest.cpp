@@ -0,0 +1,584 @@
+#include "TestFramework.h"
+#include "../class/AnimationPoseEvaluator.h"
+#include "../Maths/SIMDMatrix.h"
+#include "../Base/ComponentPhaseBatches.h"
+#include "../thread/ThreadTaskQueue.hpp"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <string>
+
+// Character rig like skeleton, a spine with head and 4 limbs, each limb is a chain with fingers or toes at its end
+static const uint32_t SPINE_NODES = 6;
+static const uint32_t LIMB_NODES = 5;
+static const uint32_t DIGITS = 5;
+static const uint32_t DIGIT_NODES = 3;
+static const double CLIP_DURATION = 2.0;
+static const uint32_t KEY_FRAMES = 61;
+
+static std::string AcquireNodeName(uint32_t nodeIndex)
+{
+	return "Node" + std::to_string(nodeIndex);
+}
+
+static std::size_t AcquireNodeHashCode(uint32_t nodeIndex)
+{
+	std::string name = AcquireNodeName(nodeIndex);
+	return std::hash<std::wstring>()(std::wstring(name.begin(), name.end()));
+}
+
+static Quaterniond AcquireSourceRotation(uint32_t animationIndex, uint32_t nodeIndex, double time)
+{
+	double phase = time / CLIP_DURATION * 2.0 * 3.14159265358979;
+	Vector3d axis(std::sin(nodeIndex * 0.7), std::cos(nodeIndex * 1.3), 0.5 + animationIndex);
+	axis.Normalize();
+	return Quaterniond(axis, 0.6 * std::sin(phase + nodeIndex * 0.3));
+}
+
+static Vector3d AcquireSourceTranslation(uint32_t animationIndex, uint32_t nodeIndex, double time)
+{
+	double phase = time / CLIP_DURATION * 2.0 * 3.14159265358979;
+	return Vector3d(0.1 * std::sin(phase * (animationIndex + 1)), 1.0 + 0.05 * std::cos(phase + nodeIndex), 0.02 * nodeIndex);
+}
+
+// Every third node scales, the others hold still at unit scale
+static bool IsNodeScaled(uint32_t nodeIndex)
+{
+	return nodeIndex % 3 == 2;
+}
+
+static Vector3d AcquireSourceScale(uint32_t animationIndex, uint32_t nodeIndex, double time)
+{
+	if (!IsNodeScaled(nodeIndex))
+		return Vector3d(1.0, 1.0, 1.0);
+
+	double phase = time / CLIP_DURATION * 2.0 * 3.14159265358979;
+	return Vector3d(1.0 + 0.2 * std::sin(phase + nodeIndex), 1.0, 1.0 + 0.1 * std::cos(phase * (animationIndex + 1)));
+}
+
+// Root node is the object animation controller is attached to, it has no track
+static void BuildSkeleton(uint32_t animationCount, PoseSkeleton& skeleton)
+{
+	skeleton = {};
+	skeleton.parentIndices.push_back((uint32_t)AnimationPoseEvaluator::NULL_INDEX);
+
+	uint32_t spineEnd = 0;
+	for (uint32_t i = 0; i < SPINE_NODES; i++)
+	{
+		skeleton.parentIndices.push_back(spineEnd);
+		spineEnd = (uint32_t)skeleton.parentIndices.size() - 1;
+	}
+
+	for (uint32_t limb = 0; limb < 4; limb++)
+	{
+		uint32_t limbEnd = limb < 2 ? spineEnd : 1;
+		for (uint32_t i = 0; i < LIMB_NODES; i++)
+		{
+			skeleton.parentIndices.push_back(limbEnd);
+			limbEnd = (uint32_t)skeleton.parentIndices.size() - 1;
+		}
+
+		for (uint32_t digit = 0; digit < DIGITS; digit++)
+		{
+			uint32_t digitEnd = limbEnd;
+			for (uint32_t i = 0; i < DIGIT_NODES; i++)
+			{
+				skeleton.parentIndices.push_back(digitEnd);
+				digitEnd = (uint32_t)skeleton.parentIndices.size() - 1;
+			}
+		}
+	}
+
+	uint32_t nodeCount = (uint32_t)skeleton.parentIndices.size();
+	skeleton.trackIndices.assign(animationCount, std::vector<uint32_t>(nodeCount, (uint32_t)SkeletonAnimation::NULL_TRACK));
+
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		skeleton.bindPose.rotations.push_back(AcquireSourceRotation(0, i, 0));
+		skeleton.bindPose.translations.push_back(AcquireSourceTranslation(0, i, 0));
+		skeleton.bindPose.scales.push_back(AcquireSourceScale(0, i, 0));
+	}
+
+	// Bone offsets invert bind pose, so bind pose gives identity skinning transforms
+	std::vector<Matrix4d> modelPoses;
+	std::vector<DualQuaterniond> boneDQs(nodeCount);
+	skeleton.boneNodeIndices.clear();
+	skeleton.boneOffsets.clear();
+	AnimationPoseEvaluator::BuildSkinningTransforms(skeleton, skeleton.bindPose, modelPoses, boneDQs.data());
+	for (uint32_t i = 1; i < nodeCount; i++)
+	{
+		skeleton.boneNodeIndices.push_back(i);
+		skeleton.boneOffsets.push_back(modelPoses[i]);
+		skeleton.boneOffsets.back().Inverse();
+	}
+}
+
+// Every node but root has a track, key frames are evenly spaced
+// Source animations are handed over to caller if it asks for them, otherwise they're released once compressed
+static std::shared_ptr<SkeletonAnimation> BuildAnimation(uint32_t animationCount, uint32_t nodeCount, std::vector<aiAnimation*>* pSourceAnimations = nullptr)
+{
+	std::vector<aiAnimation*> animations;
+	for (uint32_t animationIndex = 0; animationIndex < animationCount; animationIndex++)
+	{
+		aiAnimation* pAnimation = new aiAnimation();
+		pAnimation->mName.Set("Clip" + std::to_string(animationIndex));
+		pAnimation->mTicksPerSecond = 30.0;
+		pAnimation->mDuration = CLIP_DURATION * pAnimation->mTicksPerSecond;
+		pAnimation->mNumChannels = nodeCount - 1;
+		pAnimation->mChannels = new aiNodeAnim*[nodeCount - 1];
+
+		for (uint32_t nodeIndex = 1; nodeIndex < nodeCount; nodeIndex++)
+		{
+			aiNodeAnim* pChannel = new aiNodeAnim();
+			pChannel->mNodeName.Set(AcquireNodeName(nodeIndex));
+			pChannel->mNumRotationKeys = KEY_FRAMES;
+			pChannel->mRotationKeys = new aiQuatKey[KEY_FRAMES];
+			pChannel->mNumPositionKeys = KEY_FRAMES;
+			pChannel->mPositionKeys = new aiVectorKey[KEY_FRAMES];
+			pChannel->mNumScalingKeys = KEY_FRAMES;
+			pChannel->mScalingKeys = new aiVectorKey[KEY_FRAMES];
+
+			for (uint32_t i = 0; i < KEY_FRAMES; i++)
+			{
+				double time = CLIP_DURATION * i / (KEY_FRAMES - 1);
+				Quaterniond rotation = AcquireSourceRotation(animationIndex, nodeIndex, time);
+				Vector3d translation = AcquireSourceTranslation(animationIndex, nodeIndex, time);
+				Vector3d scale = AcquireSourceScale(animationIndex, nodeIndex, time);
+
+				pChannel->mRotationKeys[i].mTime = time * pAnimation->mTicksPerSecond;
+				pChannel->mRotationKeys[i].mValue.x = (float)rotation.x;
+				pChannel->mRotationKeys[i].mValue.y = (float)rotation.y;
+				pChannel->mRotationKeys[i].mValue.z = (float)rotation.z;
+				pChannel->mRotationKeys[i].mValue.w = (float)rotation.w;
+				pChannel->mPositionKeys[i].mTime = time * pAnimation->mTicksPerSecond;
+				pChannel->mPositionKeys[i].mValue = aiVector3D((float)translation.x, (float)translation.y, (float)translation.z);
+				pChannel->mScalingKeys[i].mTime = time * pAnimation->mTicksPerSecond;
+				pChannel->mScalingKeys[i].mValue = aiVector3D((float)scale.x, (float)scale.y, (float)scale.z);
+			}
+
+			pAnimation->mChannels[nodeIndex - 1] = pChannel;
+		}
+
+		animations.push_back(pAnimation);
+	}
+
+	std::shared_ptr<SkeletonAnimation> pSkeletonAnimation = SkeletonAnimation::Create(animations.data(), animationCount);
+	if (pSourceAnimations != nullptr)
+		*pSourceAnimations = animations;
+	else
+	{
+		for (auto pAnimation : animations)
+			delete pAnimation;
+	}
+
+	return pSkeletonAnimation;
+}
+
+static void BindTracks(const SkeletonAnimation* pAnimation, PoseSkeleton& skeleton)
+{
+	for (uint32_t animationIndex = 0; animationIndex < pAnimation->GetAnimationCount(); animationIndex++)
+	{
+		for (uint32_t i = 0; i < (uint32_t)skeleton.parentIndices.size(); i++)
+			skeleton.trackIndices[animationIndex][i] = pAnimation->AcquireTrackIndex(animationIndex, AcquireNodeHashCode(i));
+	}
+}
+
+static void StartClip(const SkeletonAnimation* pAnimation, uint32_t animationIndex, double time, AnimationClipState& clip)
+{
+	clip.animationIndex = animationIndex;
+	clip.playedTime = time;
+	clip.cursors.assign(pAnimation->GetTrackCount(animationIndex), {});
+}
+
+TEST(AnimationSampleKeyFrames)
+{
+	PoseSkeleton skeleton;
+	BuildSkeleton(2, skeleton);
+	std::shared_ptr<SkeletonAnimation> pAnimation = BuildAnimation(2, (uint32_t)skeleton.parentIndices.size());
+	CHECK(pAnimation != nullptr);
+	BindTracks(pAnimation.get(), skeleton);
+
+	CHECK(skeleton.trackIndices[0][0] == SkeletonAnimation::NULL_TRACK);
+	CHECK(pAnimation->GetAnimationDataBytes(0) < pAnimation->GetSourceAnimationDataBytes(0));
+
+	// Held still scale collapses into a single key
+	const AnimationData& animationData = pAnimation->GetAnimationData(1);
+	CHECK(animationData.tracks[0].scaleChannel.keyFrameCount == 1);
+	CHECK(animationData.tracks[1].scaleChannel.keyFrameCount > 1);
+
+	// Sampled forward, and wrapping around to start, cursors have to follow
+	const double times[] = { 0.0, 0.25, 0.5, 1.0, 1.9, 0.1, 0.75 };
+	AnimationClipState clip;
+	StartClip(pAnimation.get(), 1, 0, clip);
+	AnimationPose pose;
+	for (double time : times)
+	{
+		clip.playedTime = time;
+		AnimationPoseEvaluator::SampleClip(pAnimation.get(), skeleton, clip, pose);
+
+		CHECK(pose.rotations[0].x == skeleton.bindPose.rotations[0].x && pose.translations[0].y == skeleton.bindPose.translations[0].y);
+		for (uint32_t i = 1; i < (uint32_t)skeleton.parentIndices.size(); i++)
+		{
+			Quaterniond rotation = AcquireSourceRotation(1, i, time);
+			CHECK(std::abs(std::abs(Quaterniond::Dot(rotation, pose.rotations[i])) - 1.0) < 0.001);
+			CHECK((AcquireSourceTranslation(1, i, time) - pose.translations[i]).Length() < 0.001);
+			CHECK((AcquireSourceScale(1, i, time) - pose.scales[i]).Length() < 0.001);
+		}
+	}
+}
+
+TEST(AnimationBindPoseSkinning)
+{
+	PoseSkeleton skeleton;
+	BuildSkeleton(1, skeleton);
+
+	std::vector<Matrix4d> modelPoses;
+	std::vector<DualQuaterniond> boneDQs(skeleton.boneNodeIndices.size());
+	AnimationPoseEvaluator::BuildSkinningTransforms(skeleton, skeleton.bindPose, modelPoses, boneDQs.data());
+
+	for (auto& dq : boneDQs)
+	{
+		Quaterniond rotation = dq.AcquireRotation();
+		CHECK(std::abs(std::abs(rotation.w) - 1.0) < 1e-9);
+		CHECK(dq.AcquireTranslation().Length() < 1e-9);
+	}
+}
+
+TEST(AnimationBlendPose)
+{
+	PoseSkeleton skeleton;
+	BuildSkeleton(2, skeleton);
+	std::shared_ptr<SkeletonAnimation> pAnimation = BuildAnimation(2, (uint32_t)skeleton.parentIndices.size());
+	BindTracks(pAnimation.get(), skeleton);
+
+	AnimationClipState clip0, clip1;
+	StartClip(pAnimation.get(), 0, 0.5, clip0);
+	StartClip(pAnimation.get(), 1, 0.5, clip1);
+	AnimationPose pose0, pose1;
+	AnimationPoseEvaluator::SampleClip(pAnimation.get(), skeleton, clip0, pose0);
+	AnimationPoseEvaluator::SampleClip(pAnimation.get(), skeleton, clip1, pose1);
+
+	// Zero weight keeps destination, full weight replaces it, masked out nodes are untouched
+	AnimationPose blended = pose0;
+	AnimationPoseEvaluator::BlendPose(pose1, 0, {}, blended);
+	CHECK(blended.translations[3].x == pose0.translations[3].x);
+
+	std::vector<double> mask(skeleton.parentIndices.size(), 1.0);
+	mask[3] = 0;
+	AnimationPoseEvaluator::BlendPose(pose1, 1.0, mask, blended);
+	CHECK(blended.translations[3].x == pose0.translations[3].x);
+	CHECK((blended.translations[4] - pose1.translations[4]).Length() < 1e-12);
+	CHECK(std::abs(std::abs(Quaterniond::Dot(blended.rotations[4], pose1.rotations[4])) - 1.0) < 1e-12);
+	CHECK((blended.scales[5] - pose1.scales[5]).Length() < 1e-12);
+
+	// Adding a pose relative to itself changes nothing
+	AnimationPose added = pose0;
+	AnimationPoseEvaluator::AddPose(pose1, pose1, 1.0, {}, added);
+	for (uint32_t i = 0; i < (uint32_t)added.rotations.size(); i++)
+	{
+		CHECK((added.translations[i] - pose0.translations[i]).Length() < 1e-12);
+		CHECK((added.scales[i] - pose0.scales[i]).Length() < 1e-12);
+		CHECK(std::abs(std::abs(Quaterniond::Dot(added.rotations[i], pose0.rotations[i])) - 1.0) < 1e-12);
+	}
+
+	// Scale is added as ratio to reference
+	AnimationPose halfScaled = pose1;
+	for (auto& scale : halfScaled.scales)
+		scale *= 2.0;
+	added = pose0;
+	AnimationPoseEvaluator::AddPose(pose1, halfScaled, 1.0, {}, added);
+	for (uint32_t i = 0; i < (uint32_t)added.scales.size(); i++)
+		CHECK((added.scales[i] - pose0.scales[i] * 0.5).Length() < 1e-12);
+}
+
+// Per character state of a pose job, same as what an animation controller holds
+typedef struct _CharacterPose
+{
+	AnimationClipState				currentClip;
+	AnimationClipState				fadingClip;
+	AnimationPose					layerPose;
+	AnimationPose					fadingPose;
+	AnimationPose					blendedPose;
+	std::vector<Matrix4d>			modelPoses;
+	std::vector<DualQuaterniond>	boneDQs;
+}CharacterPose;
+
+static void EvaluateCharacter(const SkeletonAnimation* pAnimation, const PoseSkeleton& skeleton, double elapsed, CharacterPose& character)
+{
+	character.currentClip.playedTime = fmod(character.currentClip.playedTime + elapsed, CLIP_DURATION);
+	character.fadingClip.playedTime = fmod(character.fadingClip.playedTime + elapsed, CLIP_DURATION);
+
+	character.blendedPose = skeleton.bindPose;
+	AnimationPoseEvaluator::SampleClip(pAnimation, skeleton, character.currentClip, character.layerPose);
+	AnimationPoseEvaluator::SampleClip(pAnimation, skeleton, character.fadingClip, character.fadingPose);
+	AnimationPoseEvaluator::BlendPose(character.layerPose, 0.5, {}, character.fadingPose);
+	AnimationPoseEvaluator::BlendPose(character.fadingPose, 1.0, {}, character.blendedPose);
+	AnimationPoseEvaluator::BuildSkinningTransforms(skeleton, character.blendedPose, character.modelPoses, character.boneDQs.data());
+}
+
+// Pose job of a character, parallel in animation update like an animation controller
+class CrowdAnimationController : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(CrowdAnimationController)
+public:
+	void OnAnimationUpdate() override { EvaluateCharacter(m_pAnimation, *m_pSkeleton, 1.0 / 60.0, m_character); }
+	bool IsParallelPhase(ComponentPhase phase) const override { return phase == ComponentPhaseAnimationUpdate; }
+
+	const SkeletonAnimation*	m_pAnimation;
+	const PoseSkeleton*			m_pSkeleton;
+	CharacterPose				m_character;
+};
+
+DEFINITE_CLASS_RTTI(CrowdAnimationController, BaseComponent);
+
+static std::shared_ptr<PerFrameResource> AllocateNullPerFrameResource(uint32_t frameIndex)
+{
+	return nullptr;
+}
+
+static bool IsCrowdAttached(const std::shared_ptr<BaseComponent>& pComp)
+{
+	return true;
+}
+
+// Pose jobs of a crowd, each one cross fading two clips
+// Dispatched the way BaseObject does, a batch of controllers goes through ParallelFor of the job queue
+BENCHMARK(AnimationCrowd)
+{
+	const uint32_t characterCount = 2000;
+	const uint32_t frameCount = 10;
+	const uint32_t structureVersion = 0;
+
+	PoseSkeleton skeleton;
+	BuildSkeleton(2, skeleton);
+	std::shared_ptr<SkeletonAnimation> pAnimation = BuildAnimation(2, (uint32_t)skeleton.parentIndices.size());
+	BindTracks(pAnimation.get(), skeleton);
+
+	// An object per character
+	std::vector<ComponentStorage> storages(characterCount);
+	std::vector<const ComponentStorage*> storagePtrs;
+	std::vector<std::shared_ptr<CrowdAnimationController>> controllers;
+	for (uint32_t i = 0; i < characterCount; i++)
+	{
+		std::shared_ptr<CrowdAnimationController> pController = std::make_shared<CrowdAnimationController>();
+		pController->m_pAnimation = pAnimation.get();
+		pController->m_pSkeleton = &skeleton;
+		StartClip(pAnimation.get(), 0, i * 0.013, pController->m_character.currentClip);
+		StartClip(pAnimation.get(), 1, i * 0.007, pController->m_character.fadingClip);
+		pController->m_character.boneDQs.resize(skeleton.boneNodeIndices.size());
+
+		storages[i].AddComponent(pController);
+		storagePtrs.push_back(&storages[i]);
+		controllers.push_back(pController);
+	}
+
+	ComponentPhaseBatches batches;
+	batches.Build(storagePtrs);
+	CHECK(batches.GetBatches(ComponentPhaseAnimationUpdate).size() == 1);
+
+	std::cout << "    " << characterCount << " characters, " << skeleton.parentIndices.size() << " nodes each, " << frameCount << " frames" << std::endl;
+
+	double serialMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+			batches.Dispatch(ComponentPhaseAnimationUpdate, structureVersion, IsCrowdAttached);
+	}, 3);
+	std::cout << "    serial: " << serialMilliseconds / frameCount << " ms per frame, " << characterCount * frameCount / serialMilliseconds << " characters per ms" << std::endl;
+
+	// Main thread joins in while waiting, so workers plus one threads run pose jobs
+	uint32_t maxWorkerCount = std::thread::hardware_concurrency();
+	maxWorkerCount = maxWorkerCount > 1 ? maxWorkerCount - 1 : 1;
+	for (uint32_t workerCount = 1; workerCount <= maxWorkerCount; workerCount = workerCount * 2 > maxWorkerCount && workerCount < maxWorkerCount ? maxWorkerCount : workerCount * 2)
+	{
+		ThreadTaskQueue jobQueue(1, AllocateNullPerFrameResource, workerCount);
+		ParallelRangeFunc parallelFor = jobQueue.AcquireParallelRangeFunc(0);
+
+		double milliseconds = MeasureMilliseconds([&]()
+		{
+			for (uint32_t frame = 0; frame < frameCount; frame++)
+				batches.Dispatch(ComponentPhaseAnimationUpdate, structureVersion, IsCrowdAttached, parallelFor);
+		}, 3);
+
+		std::cout << "    " << workerCount << " workers: " << milliseconds / frameCount << " ms per frame, " << characterCount * frameCount / milliseconds << " characters per ms, speedup " << serialMilliseconds / milliseconds << std::endl;
+	}
+
+	// Every pose of the crowd is still a proper rigid transform
+	for (auto& pController : controllers)
+	{
+		Quaterniond rotation = pController->m_character.boneDQs[0].AcquireRotation();
+		CHECK(std::abs(Quaterniond::Dot(rotation, rotation) - 1.0) < 1e-6);
+	}
+}
+
+// Samples every track of a crowd per frame, with cursors kept across frames against name hash lookup and cursors starting over each frame like before
+BENCHMARK(AnimationSampleCrowd)
+{
+	const uint32_t characterCount = 1000;
+	const uint32_t frameCount = 30;
+
+	PoseSkeleton skeleton;
+	BuildSkeleton(1, skeleton);
+	std::shared_ptr<SkeletonAnimation> pAnimation = BuildAnimation(1, (uint32_t)skeleton.parentIndices.size());
+	BindTracks(pAnimation.get(), skeleton);
+
+	uint32_t nodeCount = (uint32_t)skeleton.parentIndices.size();
+	std::vector<std::size_t> nodeHashCodes;
+	for (uint32_t i = 0; i < nodeCount; i++)
+		nodeHashCodes.push_back(AcquireNodeHashCode(i));
+
+	std::vector<AnimationClipState> clips(characterCount);
+	std::vector<AnimationPose> poses(characterCount);
+
+	auto startCrowd = [&]()
+	{
+		for (uint32_t i = 0; i < characterCount; i++)
+			StartClip(pAnimation.get(), 0, i * 0.013, clips[i]);
+	};
+
+	startCrowd();
+	double cursorMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t i = 0; i < characterCount; i++)
+			{
+				clips[i].playedTime = fmod(clips[i].playedTime + 1.0 / 60.0, CLIP_DURATION);
+				AnimationPoseEvaluator::SampleClip(pAnimation.get(), skeleton, clips[i], poses[i]);
+			}
+		}
+	}, 3);
+
+	startCrowd();
+	double lookupMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t i = 0; i < characterCount; i++)
+			{
+				clips[i].playedTime = fmod(clips[i].playedTime + 1.0 / 60.0, CLIP_DURATION);
+				poses[i].rotations.resize(nodeCount);
+				poses[i].translations.resize(nodeCount);
+				poses[i].scales.resize(nodeCount);
+				for (uint32_t j = 0; j < nodeCount; j++)
+				{
+					uint32_t trackIndex = pAnimation->AcquireTrackIndex(0, nodeHashCodes[j]);
+					if (trackIndex == SkeletonAnimation::NULL_TRACK)
+						continue;
+
+					AnimationTrackCursor cursor;
+					pAnimation->SampleTrack(0, trackIndex, (float)clips[i].playedTime, cursor, poses[i].rotations[j], poses[i].translations[j], poses[i].scales[j]);
+				}
+			}
+		}
+	}, 3);
+
+	uint32_t sampleCount = characterCount * frameCount * (nodeCount - 1);
+	std::cout << "    " << characterCount << " characters, " << nodeCount - 1 << " tracks each, " << frameCount << " frames" << std::endl;
+	std::cout << "    cursors: " << cursorMilliseconds / frameCount << " ms per frame, " << cursorMilliseconds * 1000000.0 / sampleCount << " ns per track" << std::endl;
+	std::cout << "    lookup, no cursors: " << lookupMilliseconds / frameCount << " ms per frame, " << lookupMilliseconds * 1000000.0 / sampleCount << " ns per track" << std::endl;
+
+	CHECK(std::abs(Quaterniond::Dot(poses[0].rotations[1], poses[0].rotations[1]) - 1.0) < 1e-6);
+}
+
+// Uncompressed sampling as it's done on assimp keys, binary search for key frames and interpolating full precision values
+template <typename Key>
+static uint32_t SeekSourceKey(const Key* pKeys, uint32_t keyCount, double tick, double& factor)
+{
+	uint32_t next = (uint32_t)(std::upper_bound(pKeys, pKeys + keyCount, tick, [](double t, const Key& key) { return t < key.mTime; }) - pKeys);
+	uint32_t current = next > 0 ? next - 1 : 0;
+	next = next < keyCount ? next : keyCount - 1;
+	factor = next > current ? (tick - pKeys[current].mTime) / (pKeys[next].mTime - pKeys[current].mTime) : 0.0;
+	return current;
+}
+
+static void SampleSourceChannel(const aiNodeAnim* pChannel, double tick, Quaterniond& rotation, Vector3d& translation, Vector3d& scale)
+{
+	double factor;
+	uint32_t current = SeekSourceKey(pChannel->mRotationKeys, pChannel->mNumRotationKeys, tick, factor);
+	uint32_t next = current + 1 < pChannel->mNumRotationKeys ? current + 1 : current;
+	const aiQuaternion& q0 = pChannel->mRotationKeys[current].mValue;
+	const aiQuaternion& q1 = pChannel->mRotationKeys[next].mValue;
+	rotation = Quaterniond::SLerp(Quaterniond(q0.x, q0.y, q0.z, q0.w), Quaterniond(q1.x, q1.y, q1.z, q1.w), factor);
+
+	current = SeekSourceKey(pChannel->mPositionKeys, pChannel->mNumPositionKeys, tick, factor);
+	next = current + 1 < pChannel->mNumPositionKeys ? current + 1 : current;
+	aiVector3D value = pChannel->mPositionKeys[current].mValue * (float)(1.0 - factor) + pChannel->mPositionKeys[next].mValue * (float)factor;
+	translation = Vector3d(value.x, value.y, value.z);
+
+	current = SeekSourceKey(pChannel->mScalingKeys, pChannel->mNumScalingKeys, tick, factor);
+	next = current + 1 < pChannel->mNumScalingKeys ? current + 1 : current;
+	value = pChannel->mScalingKeys[current].mValue * (float)(1.0 - factor) + pChannel->mScalingKeys[next].mValue * (float)factor;
+	scale = Vector3d(value.x, value.y, value.z);
+}
+
+// Memory and sampling speed of compressed clips against the key frames they're built from
+BENCHMARK(AnimationCompression)
+{
+	const uint32_t characterCount = 1000;
+	const uint32_t frameCount = 30;
+
+	PoseSkeleton skeleton;
+	BuildSkeleton(1, skeleton);
+	uint32_t nodeCount = (uint32_t)skeleton.parentIndices.size();
+	std::vector<aiAnimation*> sourceAnimations;
+	std::shared_ptr<SkeletonAnimation> pAnimation = BuildAnimation(1, nodeCount, &sourceAnimations);
+	BindTracks(pAnimation.get(), skeleton);
+
+	const AnimationData& animationData = pAnimation->GetAnimationData(0);
+	std::cout << "    " << animationData.sourceKeyFrameCount << " key frames, " << pAnimation->GetSourceAnimationDataBytes(0) << " bytes uncompressed" << std::endl;
+	std::cout << "    " << animationData.keyFrameCount << " key frames, " << pAnimation->GetAnimationDataBytes(0) << " bytes compressed, ratio "
+		<< (double)pAnimation->GetSourceAnimationDataBytes(0) / pAnimation->GetAnimationDataBytes(0) << std::endl;
+
+	std::vector<AnimationClipState> clips(characterCount);
+	for (uint32_t i = 0; i < characterCount; i++)
+		StartClip(pAnimation.get(), 0, i * 0.013, clips[i]);
+	std::vector<AnimationPose> poses(characterCount);
+
+	double compressedMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t i = 0; i < characterCount; i++)
+			{
+				clips[i].playedTime = fmod(clips[i].playedTime + 1.0 / 60.0, CLIP_DURATION);
+				AnimationPoseEvaluator::SampleClip(pAnimation.get(), skeleton, clips[i], poses[i]);
+			}
+		}
+	}, 3);
+
+	const aiAnimation* pSource = sourceAnimations[0];
+	std::vector<double> playedTimes(characterCount);
+	for (uint32_t i = 0; i < characterCount; i++)
+		playedTimes[i] = i * 0.013;
+	AnimationPose sourcePose = skeleton.bindPose;
+
+	double sourceMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t i = 0; i < characterCount; i++)
+			{
+				playedTimes[i] = fmod(playedTimes[i] + 1.0 / 60.0, CLIP_DURATION);
+				for (uint32_t j = 1; j < nodeCount; j++)
+					SampleSourceChannel(pSource->mChannels[j - 1], playedTimes[i] * pSource->mTicksPerSecond, sourcePose.rotations[j], sourcePose.translations[j], sourcePose.scales[j]);
+			}
+		}
+	}, 3);
+
+	uint32_t sampleCount = characterCount * frameCount * (nodeCount - 1);
+	std::cout << "    compressed: " << compressedMilliseconds / frameCount << " ms per frame, " << compressedMilliseconds * 1000000.0 / sampleCount << " ns per track" << std::endl;
+	std::cout << "    uncompressed: " << sourceMilliseconds / frameCount << " ms per frame, " << sourceMilliseconds * 1000000.0 / sampleCount << " ns per track" << std::endl;
+
+	// Both give the same pose within compression tolerance
+	for (uint32_t i = 1; i < nodeCount; i++)
+	{
+		SampleSourceChannel(pSource->mChannels[i - 1], clips[0].playedTime * pSource->mTicksPerSecond, sourcePose.rotations[i], sourcePose.translations[i], sourcePose.scales[i]);
+		CHECK(std::abs(std::abs(Quaterniond::Dot(sourcePose.rotations[i], poses[0].rotations[i])) - 1.0) < 0.001);
+		CHECK((sourcePose.translations[i] - poses[0].translations[i]).Length() < 0.001);
+		CHECK((sourcePose.scales[i] - poses[0].scales[i]).Length() < 0.001);
+	}
+
+	for (auto pSourceAnimation : sourceAnimations)
+		delete pSourceAnimation;
+}
\ No newline at end of file
@@ -0,0 +1,473 @@
+#include "TestFramework.h"
+#include "ThreadParallelRange.h"
+#include "../Base/ComponentStorage.h"
+#include "../Base/ComponentPhaseBatches.h"
+#include <set>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+// Every call of a phase is logged, so that order across components could be checked
+typedef struct _PhaseCall
+{
+	const BaseComponent*	pComp;
+	ComponentPhase			phase;
+}PhaseCall;
+
+static std::mutex				s_callLogMutex;
+static std::vector<PhaseCall>	s_callLog;
+
+static void LogCall(const BaseComponent* pComp, ComponentPhase phase)
+{
+	std::unique_lock<std::mutex> lock(s_callLogMutex);
+	s_callLog.push_back({ pComp, phase });
+}
+
+class TestCompX : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(TestCompX)
+public:
+	void Update() override { LogCall(this, ComponentPhaseUpdate); }
+	void LateUpdate() override { LogCall(this, ComponentPhaseLateUpdate); }
+};
+
+class TestCompY : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(TestCompY)
+public:
+	void Update() override { LogCall(this, ComponentPhaseUpdate); }
+};
+
+// Found by lookup of its base as well, and batched by its own type
+class TestCompDerivedX : public TestCompX
+{
+	DECLARE_CLASS_RTTI(TestCompDerivedX)
+public:
+	void OnPreRender() override { LogCall(this, ComponentPhasePreRender); }
+};
+
+class TestCompParallel : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(TestCompParallel)
+public:
+	void OnAnimationUpdate() override { m_threadId = std::this_thread::get_id(); m_callCount++; }
+	bool IsParallelPhase(ComponentPhase phase) const override { return phase == ComponentPhaseAnimationUpdate; }
+
+	std::thread::id	m_threadId;
+	uint32_t		m_callCount = 0;
+};
+
+// Detaches a victim and attaches a new component when it's called, like a script destroying and spawning things
+class TestCompSpawner : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(TestCompSpawner)
+public:
+	void OnAnimationUpdate() override
+	{
+		m_pAttached->erase(m_pVictim.get());
+		(*m_pStructureVersion)++;
+
+		m_pSpawned = std::make_shared<TestCompParallel>();
+		m_pAttached->insert(m_pSpawned.get());
+		(*m_pStructureVersion)++;
+	}
+
+	std::shared_ptr<BaseComponent>		m_pVictim;
+	std::shared_ptr<TestCompParallel>	m_pSpawned;
+	std::set<const BaseComponent*>*		m_pAttached;
+	uint32_t*							m_pStructureVersion;
+};
+
+DEFINITE_CLASS_RTTI(TestCompX, BaseComponent);
+DEFINITE_CLASS_RTTI(TestCompY, BaseComponent);
+DEFINITE_CLASS_RTTI(TestCompDerivedX, TestCompX);
+DEFINITE_CLASS_RTTI(TestCompParallel, BaseComponent);
+DEFINITE_CLASS_RTTI(TestCompSpawner, BaseComponent);
+
+static std::vector<const ComponentStorage*> AcquireStoragePtrs(const std::vector<ComponentStorage>& storages)
+{
+	std::vector<const ComponentStorage*> storagePtrs;
+	for (auto& storage : storages)
+		storagePtrs.push_back(&storage);
+	return storagePtrs;
+}
+
+static std::vector<const BaseComponent*> AcquireLoggedCalls(ComponentPhase phase)
+{
+	std::vector<const BaseComponent*> calls;
+	for (auto& call : s_callLog)
+	{
+		if (call.phase == phase)
+			calls.push_back(call.pComp);
+	}
+	return calls;
+}
+
+static uint32_t s_unchangedVersion = 0;
+
+static bool IsAlwaysAttached(const std::shared_ptr<BaseComponent>& pComp)
+{
+	return true;
+}
+
+TEST(ComponentStorageLookup)
+{
+	std::shared_ptr<TestCompX> pX0 = std::make_shared<TestCompX>();
+	std::shared_ptr<TestCompY> pY = std::make_shared<TestCompY>();
+	std::shared_ptr<TestCompDerivedX> pDerived = std::make_shared<TestCompDerivedX>();
+	std::shared_ptr<TestCompX> pX1 = std::make_shared<TestCompX>();
+
+	ComponentStorage storage;
+	storage.AddComponent(pX0);
+	storage.AddComponent(pY);
+	storage.AddComponent(pDerived);
+	storage.AddComponent(pX1);
+
+	// Types are distinct and dense
+	CHECK(TestCompX::ClassTypeIndex != TestCompDerivedX::ClassTypeIndex);
+	CHECK(TestCompDerivedX::ClassTypeIndex < BaseComponent::GetClassTypeCount());
+
+	// Added order is kept, both in total and per type
+	CHECK(storage.GetComponents().size() == 4);
+	CHECK(storage.GetComponents()[2] == pDerived);
+
+	auto& xs = storage.GetComponents(TestCompX::ClassTypeIndex);
+	CHECK(xs.size() == 3 && xs[0] == pX0 && xs[1] == pDerived && xs[2] == pX1);
+	CHECK(storage.GetComponents(TestCompDerivedX::ClassTypeIndex).size() == 1);
+	CHECK(storage.GetComponents(TestCompY::ClassTypeIndex).size() == 1);
+	CHECK(storage.GetComponents(BaseComponent::ClassTypeIndex).size() == 4);
+	CHECK(storage.GetComponents(TestCompParallel::ClassTypeIndex).empty());
+	CHECK(storage.GetComponents(BaseComponent::GetClassTypeCount() + 10).empty());
+
+	CHECK(storage.ContainComponent(TestCompX::ClassTypeIndex, pDerived));
+	CHECK(storage.ContainComponent(TestCompDerivedX::ClassTypeIndex, pDerived));
+	CHECK(!storage.ContainComponent(TestCompDerivedX::ClassTypeIndex, pX0));
+	CHECK(!storage.ContainComponent(TestCompY::ClassTypeIndex, pX0));
+
+	// Removal takes it out of every type it's in
+	storage.DelComponent(pDerived);
+	CHECK(storage.GetComponents().size() == 3);
+	CHECK(xs.size() == 2 && xs[0] == pX0 && xs[1] == pX1);
+	CHECK(storage.GetComponents(TestCompDerivedX::ClassTypeIndex).empty());
+	CHECK(storage.GetComponents(BaseComponent::ClassTypeIndex).size() == 3);
+	CHECK(!storage.ContainComponent(TestCompX::ClassTypeIndex, pDerived));
+}
+
+TEST(ComponentPhaseBatching)
+{
+	// Three objects of the same component order
+	std::vector<ComponentStorage> storages(3);
+	std::vector<std::shared_ptr<BaseComponent>> xs, ys;
+	for (auto& storage : storages)
+	{
+		xs.push_back(std::make_shared<TestCompX>());
+		ys.push_back(std::make_shared<TestCompY>());
+		storage.AddComponent(xs.back());
+		storage.AddComponent(ys.back());
+	}
+
+	ComponentPhaseBatches batches;
+	batches.Build(AcquireStoragePtrs(storages));
+
+	// One batch per type, only in phases the type overrides
+	auto& updateBatches = batches.GetBatches(ComponentPhaseUpdate);
+	CHECK(updateBatches.size() == 2);
+	CHECK(updateBatches[0].typeIndex == TestCompX::ClassTypeIndex && updateBatches[0].components == xs);
+	CHECK(updateBatches[1].typeIndex == TestCompY::ClassTypeIndex && updateBatches[1].components == ys);
+	CHECK(batches.GetBatches(ComponentPhaseLateUpdate).size() == 1);
+	CHECK(batches.GetBatches(ComponentPhaseLateUpdate)[0].components == xs);
+	CHECK(batches.GetBatches(ComponentPhaseAnimationUpdate).empty());
+	CHECK(batches.GetBatches(ComponentPhasePreRender).empty());
+
+	s_callLog.clear();
+	batches.Dispatch(ComponentPhaseUpdate, s_unchangedVersion, IsAlwaysAttached);
+	std::vector<const BaseComponent*> calls = AcquireLoggedCalls(ComponentPhaseUpdate);
+	CHECK(calls.size() == 6);
+	for (uint32_t i = 0; i < 3; i++)
+		CHECK(calls[i] == xs[i].get() && calls[3 + i] == ys[i].get());
+	CHECK(AcquireLoggedCalls(ComponentPhaseLateUpdate).empty());
+
+	// Derived type has a batch of its own, and inherits phases of its base
+	storages[1].AddComponent(std::make_shared<TestCompDerivedX>());
+	batches.Build(AcquireStoragePtrs(storages));
+	CHECK(batches.GetBatches(ComponentPhaseUpdate).size() == 3);
+	CHECK(batches.GetBatches(ComponentPhaseUpdate)[2].typeIndex == TestCompDerivedX::ClassTypeIndex);
+	CHECK(batches.GetBatches(ComponentPhasePreRender).size() == 1);
+	CHECK(batches.GetBatches(ComponentPhaseLateUpdate).size() == 2);
+}
+
+TEST(ComponentPhaseBatchOrder)
+{
+	// A: [X, Y], B: [Y, X], X of B can't join batch of A's X, since it has to run after Y of B
+	std::vector<ComponentStorage> storages(3);
+	std::shared_ptr<BaseComponent> pAX = std::make_shared<TestCompX>(), pAY = std::make_shared<TestCompY>();
+	std::shared_ptr<BaseComponent> pBY = std::make_shared<TestCompY>(), pBX = std::make_shared<TestCompX>();
+	std::shared_ptr<BaseComponent> pCX = std::make_shared<TestCompX>(), pCY = std::make_shared<TestCompY>();
+	storages[0].AddComponent(pAX);
+	storages[0].AddComponent(pAY);
+	storages[1].AddComponent(pBY);
+	storages[1].AddComponent(pBX);
+	// C has A's order again, it fits into existing batches
+	storages[2].AddComponent(pCX);
+	storages[2].AddComponent(pCY);
+
+	ComponentPhaseBatches batches;
+	batches.Build(AcquireStoragePtrs(storages));
+
+	auto& updateBatches = batches.GetBatches(ComponentPhaseUpdate);
+	CHECK(updateBatches.size() == 3);
+	CHECK(updateBatches[0].typeIndex == TestCompX::ClassTypeIndex);
+	CHECK(updateBatches[0].components == std::vector<std::shared_ptr<BaseComponent>>({ pAX, pCX }));
+	CHECK(updateBatches[1].typeIndex == TestCompY::ClassTypeIndex);
+	CHECK(updateBatches[1].components == std::vector<std::shared_ptr<BaseComponent>>({ pAY, pBY, pCY }));
+	CHECK(updateBatches[2].typeIndex == TestCompX::ClassTypeIndex);
+	CHECK(updateBatches[2].components == std::vector<std::shared_ptr<BaseComponent>>({ pBX }));
+
+	// Each object's components are called in the order they're added
+	s_callLog.clear();
+	batches.Dispatch(ComponentPhaseUpdate, s_unchangedVersion, IsAlwaysAttached);
+	std::vector<const BaseComponent*> calls = AcquireLoggedCalls(ComponentPhaseUpdate);
+	auto callIndex = [&calls](const std::shared_ptr<BaseComponent>& pComp)
+	{
+		return std::find(calls.begin(), calls.end(), (const BaseComponent*)pComp.get()) - calls.begin();
+	};
+	CHECK(calls.size() == 6);
+	CHECK(callIndex(pAX) < callIndex(pAY));
+	CHECK(callIndex(pBY) < callIndex(pBX));
+	CHECK(callIndex(pCX) < callIndex(pCY));
+
+	// X only overrides late update among these, so order there doesn't split anything
+	CHECK(batches.GetBatches(ComponentPhaseLateUpdate).size() == 1);
+}
+
+TEST(ComponentPhaseParallelDispatch)
+{
+	std::vector<ComponentStorage> storages(64);
+	std::vector<std::shared_ptr<TestCompParallel>> comps;
+	for (auto& storage : storages)
+	{
+		comps.push_back(std::make_shared<TestCompParallel>());
+		storage.AddComponent(comps.back());
+	}
+
+	ComponentPhaseBatches batches;
+	batches.Build(AcquireStoragePtrs(storages));
+
+	uint32_t parallelCallCount = 0;
+	ParallelRangeFunc threadParallelFor = AcquireThreadParallelRangeFunc(4);
+	ParallelRangeFunc parallelFor = [&](uint32_t count, uint32_t grainSize, const RangeFunc& rangeFunc)
+	{
+		parallelCallCount++;
+		threadParallelFor(count, grainSize, rangeFunc);
+	};
+
+	batches.Dispatch(ComponentPhaseAnimationUpdate, s_unchangedVersion, IsAlwaysAttached, parallelFor);
+	CHECK(parallelCallCount == 1);
+	for (auto& pComp : comps)
+		CHECK(pComp->m_callCount == 1);
+
+	// Serial without a parallel for
+	batches.Dispatch(ComponentPhaseAnimationUpdate, s_unchangedVersion, IsAlwaysAttached);
+	CHECK(parallelCallCount == 1);
+	for (auto& pComp : comps)
+		CHECK(pComp->m_callCount == 2 && pComp->m_threadId == std::this_thread::get_id());
+}
+
+TEST(ComponentPhaseStructureChange)
+{
+	uint32_t structureVersion = 0;
+	std::set<const BaseComponent*> attached;
+
+	// Spawner runs first, and detaches one component of the parallel batch after it
+	std::vector<ComponentStorage> storages(5);
+	std::shared_ptr<TestCompSpawner> pSpawner = std::make_shared<TestCompSpawner>();
+	storages[0].AddComponent(pSpawner);
+	std::vector<std::shared_ptr<TestCompParallel>> comps;
+	for (uint32_t i = 1; i < (uint32_t)storages.size(); i++)
+	{
+		comps.push_back(std::make_shared<TestCompParallel>());
+		storages[i].AddComponent(comps.back());
+	}
+	for (auto& storage : storages)
+		attached.insert(storage.GetComponents()[0].get());
+
+	pSpawner->m_pVictim = comps[1];
+	pSpawner->m_pAttached = &attached;
+	pSpawner->m_pStructureVersion = &structureVersion;
+
+	ComponentPhaseBatches batches;
+	batches.Build(AcquireStoragePtrs(storages));
+	CHECK(batches.GetBatches(ComponentPhaseAnimationUpdate).size() == 2);
+
+	uint32_t parallelCallCount = 0;
+	ParallelRangeFunc parallelFor = [&](uint32_t count, uint32_t grainSize, const RangeFunc& rangeFunc)
+	{
+		parallelCallCount++;
+		AcquireThreadParallelRangeFunc(4)(count, grainSize, rangeFunc);
+	};
+
+	batches.Dispatch(ComponentPhaseAnimationUpdate, structureVersion, [&attached](const std::shared_ptr<BaseComponent>& pComp)
+	{
+		return attached.find(pComp.get()) != attached.end();
+	}, parallelFor);
+
+	// Structure changed, so the parallel batch is checked one by one on this thread, and the detached one is skipped
+	CHECK(structureVersion == 2);
+	CHECK(parallelCallCount == 0);
+	for (uint32_t i = 0; i < (uint32_t)comps.size(); i++)
+	{
+		CHECK(comps[i]->m_callCount == (i == 1 ? 0 : 1));
+		CHECK(i == 1 || comps[i]->m_threadId == std::this_thread::get_id());
+	}
+
+	// Spawned component isn't called before batches are rebuilt
+	CHECK(pSpawner->m_pSpawned != nullptr && pSpawner->m_pSpawned->m_callCount == 0);
+
+	storages[2].DelComponent(comps[1]);
+	storages.push_back(ComponentStorage());
+	storages.back().AddComponent(pSpawner->m_pSpawned);
+	std::shared_ptr<TestCompParallel> pSpawned = pSpawner->m_pSpawned;
+	storages[0].DelComponent(pSpawner);
+	batches.Build(AcquireStoragePtrs(storages));
+
+	batches.Dispatch(ComponentPhaseAnimationUpdate, structureVersion, IsAlwaysAttached, parallelFor);
+	CHECK(parallelCallCount == 1);
+	CHECK(pSpawned->m_callCount == 1);
+	CHECK(comps[1]->m_callCount == 0);
+	CHECK(comps[0]->m_callCount == 2 && comps[3]->m_callCount == 2);
+}
+
+// Components of a typical object, a transform like one updating every frame, a renderer, and now and then a script
+class BenchTransform : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(BenchTransform)
+public:
+	void Update() override { m_value += 1; }
+	void LateUpdate() override { m_value *= 3; }
+	uint64_t m_value = 0;
+};
+
+class BenchRenderer : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(BenchRenderer)
+public:
+	void OnPreRender() override { m_value += 2; }
+	void OnRenderObject() override { m_value ^= 5; }
+	uint64_t m_value = 0;
+};
+
+class BenchScript : public BaseComponent
+{
+	DECLARE_CLASS_RTTI(BenchScript)
+public:
+	void Update() override { m_value += 7; }
+	uint64_t m_value = 0;
+};
+
+DEFINITE_CLASS_RTTI(BenchTransform, BaseComponent);
+DEFINITE_CLASS_RTTI(BenchRenderer, BaseComponent);
+DEFINITE_CLASS_RTTI(BenchScript, BaseComponent);
+
+// Object tree as it used to be dispatched, every phase walks the tree and calls every component
+typedef struct _BenchObject
+{
+	ComponentStorage			storage;
+	std::vector<uint32_t>		children;
+}BenchObject;
+
+typedef void(BaseComponent::*PhaseFunc)();
+
+static void DispatchPerObject(const std::vector<BenchObject>& objects, uint32_t objectIndex, PhaseFunc phaseFunc)
+{
+	const BenchObject& object = objects[objectIndex];
+	for (auto& pComp : object.storage.GetComponents())
+		(pComp.get()->*phaseFunc)();
+	for (uint32_t child : object.children)
+		DispatchPerObject(objects, child, phaseFunc);
+}
+
+BENCHMARK(ComponentPhaseDispatch)
+{
+	const uint32_t groupCount = 500;
+	const uint32_t objectsPerGroup = 100;
+	const uint32_t frameCount = 10;
+
+	// Groups hang off one root, each is a shallow tree of objects, like props and characters of a scene
+	std::vector<BenchObject> objects(1);
+	for (uint32_t i = 0; i < groupCount; i++)
+	{
+		uint32_t groupRoot = (uint32_t)objects.size();
+		objects[0].children.push_back(groupRoot);
+		objects.push_back(BenchObject());
+		for (uint32_t j = 1; j < objectsPerGroup; j++)
+		{
+			uint32_t parent = groupRoot + (j - 1) / 4;
+			objects[parent].children.push_back((uint32_t)objects.size());
+			objects.push_back(BenchObject());
+		}
+	}
+
+	uint32_t componentCount = 0;
+	for (uint32_t i = 1; i < (uint32_t)objects.size(); i++)
+	{
+		objects[i].storage.AddComponent(std::make_shared<BenchTransform>());
+		objects[i].storage.AddComponent(std::make_shared<BenchRenderer>());
+		componentCount += 2;
+		if (i % 10 == 0)
+		{
+			objects[i].storage.AddComponent(std::make_shared<BenchScript>());
+			componentCount++;
+		}
+	}
+
+	const PhaseFunc phaseFuncs[ComponentPhaseCount] =
+	{
+		&BaseComponent::Update, &BaseComponent::OnAnimationUpdate, &BaseComponent::LateUpdate,
+		&BaseComponent::OnPreRender, &BaseComponent::OnRenderObject, &BaseComponent::OnPostRender
+	};
+
+	double perObjectMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+				DispatchPerObject(objects, 0, phaseFuncs[phase]);
+		}
+	});
+
+	// Storages in pre-order, same order as the walk above
+	std::vector<const ComponentStorage*> storages;
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		uint32_t objectIndex = stack.back();
+		stack.pop_back();
+		storages.push_back(&objects[objectIndex].storage);
+		for (auto iter = objects[objectIndex].children.rbegin(); iter != objects[objectIndex].children.rend(); iter++)
+			stack.push_back(*iter);
+	}
+
+	ComponentPhaseBatches batches;
+	double buildMilliseconds = MeasureMilliseconds([&]() { batches.Build(storages); });
+
+	double batchedMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+				batches.Dispatch((ComponentPhase)phase, s_unchangedVersion, IsAlwaysAttached);
+		}
+	});
+
+	uint32_t batchCount = 0;
+	for (uint32_t phase = 0; phase < ComponentPhaseCount; phase++)
+		batchCount += (uint32_t)batches.GetBatches((ComponentPhase)phase).size();
+
+	std::cout << "    " << objects.size() << " objects, " << componentCount << " components, " << ComponentPhaseCount << " phases, " << batchCount << " batches in total" << std::endl;
+	std::cout << "    per object virtual dispatch: " << perObjectMilliseconds / frameCount << " ms per frame" << std::endl;
+	std::cout << "    batched dispatch: " << batchedMilliseconds / frameCount << " ms per frame, speedup " << perObjectMilliseconds / batchedMilliseconds << std::endl;
+	std::cout << "    batch rebuild: " << buildMilliseconds << " ms" << std::endl;
+
+	// Transform, renderer and script, each only in the phases they override
+	CHECK(batchCount == 5);
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "TestFramework.h"
+#include "../class/DrawSortKey.h"
+#include <random>
+#include <algorithm>
+
+static std::vector<uint32_t> StableSortOrder(const std::vector<uint64_t>& keys)
+{
+	std::vector<uint32_t> order(keys.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+	return order;
+}
+
+// Synthetic frame: draws spread over passes, pipelines and descriptor sets, a few thousand meshes, depth up to 10km
+static std::vector<uint64_t> BuildDrawKeys(uint32_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> depthDist(-10.0, 10000.0);
+
+	std::vector<uint64_t> keys(count);
+	for (uint32_t i = 0; i < count; i++)
+		keys[i] = DrawSortKey::Encode(rng() % 4, rng() % 64, rng() % 32, DrawSortKey::DepthBucket(depthDist(rng)), rng() % 5000);
+	return keys;
+}
+
+TEST(DrawSortKeyEncode)
+{
+	// Fields are ordered pass first, and each field is masked to its width
+	CHECK(DrawSortKey::Encode(1, 0, 0, 0, 0) > DrawSortKey::Encode(0, 4095, 255, 65535, 0xffffff));
+	CHECK(DrawSortKey::Encode(0, 1, 0, 0, 0) > DrawSortKey::Encode(0, 0, 255, 65535, 0xffffff));
+	CHECK(DrawSortKey::Encode(0, 0, 1, 0, 0) > DrawSortKey::Encode(0, 0, 0, 65535, 0xffffff));
+	CHECK(DrawSortKey::Encode(0, 0, 0, 1, 0) > DrawSortKey::Encode(0, 0, 0, 0, 0xffffff));
+	CHECK(DrawSortKey::Encode(0, 0, 0, 0, 0x1000001) == DrawSortKey::Encode(0, 0, 0, 0, 1));
+	CHECK(DrawSortKey::Encode(15, 4095, 255, 65535, 0xffffff) == 0xffffffffffffffffull);
+
+	// Buckets never go down with distance
+	CHECK(DrawSortKey::DepthBucket(-5.0) == 0);
+	uint32_t lastBucket = 0;
+	for (double depth = 0.0; depth < 1e7; depth = depth * 1.1 + 0.01)
+	{
+		uint32_t bucket = DrawSortKey::DepthBucket(depth);
+		CHECK(bucket >= lastBucket);
+		lastBucket = bucket;
+	}
+	CHECK(DrawSortKey::DepthBucket(1e300) < (1u << DrawSortKey::DEPTH_BITS));
+}
+
+TEST(DrawSortKeyRadixSortMatchesStableSort)
+{
+	std::vector<uint32_t> order, scratch;
+
+	// Empty and single key
+	std::vector<uint64_t> keys;
+	DrawSortKey::RadixSort(keys, order, scratch);
+	CHECK(order.empty());
+	keys.push_back(42);
+	DrawSortKey::RadixSort(keys, order, scratch);
+	CHECK(order.size() == 1 && order[0] == 0);
+
+	// Many duplicates, so stability is what decides the order
+	std::mt19937 rng(17);
+	keys.resize(5000);
+	for (auto& key : keys)
+		key = DrawSortKey::Encode(rng() % 2, rng() % 3, 0, rng() % 4, rng() % 5);
+	DrawSortKey::RadixSort(keys, order, scratch);
+	CHECK(order == StableSortOrder(keys));
+
+	// All keys equal, every pass is skipped
+	keys.assign(1000, 0x0123456789abcdefull);
+	DrawSortKey::RadixSort(keys, order, scratch);
+	CHECK(order == StableSortOrder(keys));
+
+	// Full range keys, every byte differs
+	for (auto& key : keys)
+		key = ((uint64_t)rng() << 32) | rng();
+	DrawSortKey::RadixSort(keys, order, scratch);
+	CHECK(order == StableSortOrder(keys));
+
+	// Realistic frames, including reuse of order and scratch from a larger sort
+	for (uint32_t seed = 0; seed < 8; seed++)
+	{
+		keys = BuildDrawKeys(1000 + seed * 3001, seed);
+		DrawSortKey::RadixSort(keys, order, scratch);
+		CHECK(order == StableSortOrder(keys));
+	}
+}
+
+// Number of multi draw ranges needed, a new range starts wherever pass, pipeline or descriptor set changes
+static uint32_t CountStateRuns(const std::vector<uint64_t>& keys, const std::vector<uint32_t>& order)
+{
+	const uint32_t stateShift = DrawSortKey::DEPTH_BITS + DrawSortKey::MESH_BITS;
+	uint32_t runCount = 0;
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+	{
+		if (i == 0 || (keys[order[i]] >> stateShift) != (keys[order[i - 1]] >> stateShift))
+			runCount++;
+	}
+	return runCount;
+}
+
+// Sort and batch 100k draw packets, radix sort against std::stable_sort
+BENCHMARK(DrawSortKey100kPackets)
+{
+	const uint32_t packetCount = 100000;
+	std::vector<uint64_t> keys = BuildDrawKeys(packetCount, 1);
+
+	std::vector<uint32_t> order, scratch;
+	double radixMilliseconds = MeasureMilliseconds([&]()
+	{
+		DrawSortKey::RadixSort(keys, order, scratch);
+	});
+
+	std::vector<uint32_t> stableOrder;
+	double stableMilliseconds = MeasureMilliseconds([&]()
+	{
+		stableOrder = StableSortOrder(keys);
+	});
+	CHECK(order == stableOrder);
+
+	uint32_t runCount = 0;
+	double batchMilliseconds = MeasureMilliseconds([&]()
+	{
+		runCount = CountStateRuns(keys, order);
+	});
+
+	std::vector<uint32_t> unsortedOrder(packetCount);
+	for (uint32_t i = 0; i < packetCount; i++)
+		unsortedOrder[i] = i;
+
+	std::cout << "    " << packetCount << " packets" << std::endl;
+	std::cout << "    radix sort: " << radixMilliseconds << " ms, std::stable_sort: " << stableMilliseconds << " ms, speedup " << stableMilliseconds / radixMilliseconds << std::endl;
+	std::cout << "    batching: " << batchMilliseconds << " ms, " << runCount << " multi draw ranges, " << CountStateRuns(keys, unsortedOrder) << " state changes unsorted" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include "TestFramework.h"
+#include "../class/IndirectDrawCullReference.h"
+#include <random>
+#include <cmath>
+
+static const double CAMERA_NEAR = 0.1;
+static const uint32_t HIZ_WIDTH = 160;
+static const uint32_t HIZ_HEIGHT = 90;
+
+static_assert(sizeof(IndirectDrawCullReference::DrawIndexedIndirectCommand) == 20, "Layout has to match VkDrawIndexedIndirectCommand");
+
+// Reversed infinite projection of Camera, looking at -z
+static Matrix4d AcquireProjection(double fov, double aspect)
+{
+	double height = 2.0 * std::tan(fov / 2.0) * CAMERA_NEAR;
+	double width = aspect * height;
+
+	Matrix4d proj;
+	proj.x0 = 2.0 * CAMERA_NEAR / width;
+	proj.y1 = -2.0 * CAMERA_NEAR / height;
+	proj.z2 = 0.0;
+	proj.z3 = -1.0;
+	proj.w2 = CAMERA_NEAR;
+	proj.w3 = 0.0;
+	return proj;
+}
+
+typedef struct _CullScene
+{
+	std::vector<PerObjectBoundsVariables>	bounds;
+	std::vector<PerObjectVariablesf>		objectVariables;
+	std::vector<float>						depth;
+	std::vector<std::vector<float>>			hiZLevels;
+}CullScene;
+
+static void AcquireRandomObjects(std::mt19937& rng, uint32_t count, CullScene& scene)
+{
+	std::uniform_real_distribution<double> position(-40.0, 40.0);
+	std::uniform_real_distribution<double> distance(-80.0, 10.0);
+	std::uniform_real_distribution<double> extent(0.05, 6.0);
+	std::uniform_real_distribution<double> angle(-3.14159, 3.14159);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+	Matrix4d proj = AcquireProjection(1.2, (double)HIZ_WIDTH / HIZ_HEIGHT);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		PerObjectBoundsVariables bounds;
+		bounds.center = Vector4f((float)position(rng) * 0.1f, (float)position(rng) * 0.1f, (float)position(rng) * 0.1f, percent(rng) < 10 ? 0.0f : 1.0f);
+		bounds.extent = Vector4f((float)extent(rng), (float)extent(rng), (float)extent(rng), 0.0f);
+		scene.bounds.push_back(bounds);
+
+		Matrix4d model = Matrix4d::EulerAngle(angle(rng), angle(rng), angle(rng));
+		model[3] = Vector4d(position(rng), position(rng) * 0.5, distance(rng), 1.0);
+
+		PerObjectVariablesf variables = {};
+		variables.MVP = (proj * model).SinglePrecision();
+		scene.objectVariables.push_back(variables);
+	}
+}
+
+// Random small rectangles as occluders over far background, then Hi-Z texels take the minimum of every depth texel they touch
+static void AcquireRandomDepth(std::mt19937& rng, uint32_t occluderCount, CullScene& scene)
+{
+	std::uniform_int_distribution<uint32_t> x(0, HIZ_WIDTH - 1), y(0, HIZ_HEIGHT - 1), size(1, 40);
+	std::uniform_real_distribution<double> distance(2.0, 40.0);
+
+	scene.depth.assign(HIZ_WIDTH * HIZ_HEIGHT, 0.0f);
+	for (uint32_t i = 0; i < occluderCount; i++)
+	{
+		uint32_t x0 = x(rng), y0 = y(rng);
+		uint32_t x1 = x0 + size(rng), y1 = y0 + size(rng);
+		x1 = x1 < HIZ_WIDTH ? x1 : HIZ_WIDTH;
+		y1 = y1 < HIZ_HEIGHT ? y1 : HIZ_HEIGHT;
+		float depth = (float)(CAMERA_NEAR / distance(rng));
+		for (uint32_t row = y0; row < y1; row++)
+			for (uint32_t column = x0; column < x1; column++)
+				scene.depth[row * HIZ_WIDTH + column] = depth > scene.depth[row * HIZ_WIDTH + column] ? depth : scene.depth[row * HIZ_WIDTH + column];
+	}
+
+	uint32_t larger = HIZ_WIDTH > HIZ_HEIGHT ? HIZ_WIDTH : HIZ_HEIGHT;
+	uint32_t levelCount = (uint32_t)std::log2(larger) + 1;
+	scene.hiZLevels.clear();
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		uint32_t width = HIZ_WIDTH >> level, height = HIZ_HEIGHT >> level;
+		width = width < 1 ? 1 : width;
+		height = height < 1 ? 1 : height;
+
+		std::vector<float> texels(width * height);
+		for (uint32_t row = 0; row < height; row++)
+		{
+			for (uint32_t column = 0; column < width; column++)
+			{
+				uint32_t minX = column * HIZ_WIDTH / width, maxX = ((column + 1) * HIZ_WIDTH + width - 1) / width;
+				uint32_t minY = row * HIZ_HEIGHT / height, maxY = ((row + 1) * HIZ_HEIGHT + height - 1) / height;
+				float minDepth = 1.0f;
+				for (uint32_t depthY = minY; depthY < maxY; depthY++)
+					for (uint32_t depthX = minX; depthX < maxX; depthX++)
+						minDepth = scene.depth[depthY * HIZ_WIDTH + depthX] < minDepth ? scene.depth[depthY * HIZ_WIDTH + depthX] : minDepth;
+				texels[row * width + column] = minDepth;
+			}
+		}
+		scene.hiZLevels.push_back(texels);
+	}
+}
+
+static IndirectDrawCullReference::CullingInput AcquireCullingInput(const CullScene& scene)
+{
+	IndirectDrawCullReference::CullingInput input = {};
+	input.pObjectBounds = scene.bounds.data();
+	input.pObjectVariables = scene.objectVariables.data();
+	for (auto& level : scene.hiZLevels)
+		input.hiZLevels.push_back(level.data());
+	input.hiZSize = { HIZ_WIDTH, HIZ_HEIGHT };
+	return input;
+}
+
+enum class BruteForceResult
+{
+	VISIBLE,
+	FRUSTUM_CULLED,
+	OCCLUDED,
+	AMBIGUOUS		// Too close to a plane to tell, as reference works in single precision
+};
+
+// Clip space corners in double precision, box is culled if all of them are beyond one plane,
+// and occluded if its nearest depth is behind every depth texel its screen rectangle touches
+static BruteForceResult BruteForceCull(const CullScene& scene, uint32_t index)
+{
+	const PerObjectBoundsVariables& bounds = scene.bounds[index];
+	if (bounds.center.w == 0.0f)
+		return BruteForceResult::VISIBLE;
+
+	Matrix4d MVP = scene.objectVariables[index].MVP.DoublePrecision();
+
+	const double epsilon = 1e-4;
+	uint32_t outsideCounts[6] = {};
+	uint32_t nearCounts[6] = {};
+	bool behindCamera = false;
+	Vector3d ndcMin(1e30, 1e30, 1e30), ndcMax(-1e30, -1e30, -1e30);
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		Vector4d corner((double)bounds.center.x + ((i & 1) != 0 ? 1.0 : -1.0) * bounds.extent.x,
+			(double)bounds.center.y + ((i & 2) != 0 ? 1.0 : -1.0) * bounds.extent.y,
+			(double)bounds.center.z + ((i & 4) != 0 ? 1.0 : -1.0) * bounds.extent.z, 1.0);
+		Vector4d clip = MVP * corner;
+
+		// Signed distances, positive is outside
+		double distances[6] = { -clip.w - clip.x, clip.x - clip.w, -clip.w - clip.y, clip.y - clip.w, -clip.z, clip.z - clip.w };
+		for (uint32_t plane = 0; plane < 6; plane++)
+		{
+			double scale = std::abs(clip.w) > 1.0 ? std::abs(clip.w) : 1.0;
+			outsideCounts[plane] += distances[plane] > 0.0 ? 1 : 0;
+			nearCounts[plane] += std::abs(distances[plane]) < epsilon * scale ? 1 : 0;
+		}
+
+		if (clip.w <= epsilon)
+			behindCamera = true;
+		else
+		{
+			Vector3d ndc(clip.x / clip.w, clip.y / clip.w, clip.z / clip.w);
+			ndcMin = Vector3d(ndc.x < ndcMin.x ? ndc.x : ndcMin.x, ndc.y < ndcMin.y ? ndc.y : ndcMin.y, ndc.z < ndcMin.z ? ndc.z : ndcMin.z);
+			ndcMax = Vector3d(ndc.x > ndcMax.x ? ndc.x : ndcMax.x, ndc.y > ndcMax.y ? ndc.y : ndcMax.y, ndc.z > ndcMax.z ? ndc.z : ndcMax.z);
+		}
+	}
+
+	for (uint32_t plane = 0; plane < 6; plane++)
+	{
+		if (nearCounts[plane] > 0)
+			return BruteForceResult::AMBIGUOUS;
+		if (outsideCounts[plane] == 8)
+			return BruteForceResult::FRUSTUM_CULLED;
+	}
+
+	if (behindCamera)
+		return BruteForceResult::VISIBLE;
+
+	// Screen rectangle shrunk a little, so that it never touches a texel that reference doesn't
+	auto toTexel = [](double ndc, uint32_t size, double bias)
+	{
+		double uv = ndc * 0.5 + 0.5 + bias;
+		uv = uv < 0.0 ? 0.0 : (uv > 1.0 ? 1.0 : uv);
+		uint32_t texel = (uint32_t)(uv * size);
+		return texel < size - 1 ? texel : size - 1;
+	};
+	uint32_t minX = toTexel(ndcMin.x, HIZ_WIDTH, epsilon), maxX = toTexel(ndcMax.x, HIZ_WIDTH, -epsilon);
+	uint32_t minY = toTexel(ndcMin.y, HIZ_HEIGHT, epsilon), maxY = toTexel(ndcMax.y, HIZ_HEIGHT, -epsilon);
+
+	double occluderDepth = 1.0;
+	for (uint32_t y = minY; y <= maxY; y++)
+		for (uint32_t x = minX; x <= maxX; x++)
+			occluderDepth = scene.depth[y * HIZ_WIDTH + x] < occluderDepth ? scene.depth[y * HIZ_WIDTH + x] : occluderDepth;
+
+	if (std::abs(ndcMax.z - occluderDepth) < epsilon * ndcMax.z)
+		return BruteForceResult::AMBIGUOUS;
+	return ndcMax.z < occluderDepth ? BruteForceResult::OCCLUDED : BruteForceResult::VISIBLE;
+}
+
+TEST(IndirectDrawCullReferenceFrustum)
+{
+	std::mt19937 rng(7);
+	CullScene scene;
+	AcquireRandomObjects(rng, 20000, scene);
+	// No occluder at all, only frustum decides
+	AcquireRandomDepth(rng, 0, scene);
+	IndirectDrawCullReference::CullingInput input = AcquireCullingInput(scene);
+
+	uint32_t visibleCount = 0, culledCount = 0;
+	for (uint32_t i = 0; i < (uint32_t)scene.bounds.size(); i++)
+	{
+		BruteForceResult expected = BruteForceCull(scene, i);
+		CHECK(expected != BruteForceResult::OCCLUDED);
+		if (expected == BruteForceResult::AMBIGUOUS)
+			continue;
+
+		bool isVisible = IndirectDrawCullReference::IsVisible(input, i);
+		CHECK(isVisible == (expected == BruteForceResult::VISIBLE));
+		visibleCount += isVisible ? 1 : 0;
+		culledCount += isVisible ? 0 : 1;
+	}
+
+	// Both sides are well covered
+	CHECK(visibleCount > 2000 && culledCount > 2000);
+}
+
+TEST(IndirectDrawCullReferenceHiZ)
+{
+	std::mt19937 rng(11);
+	CullScene scene;
+	AcquireRandomObjects(rng, 20000, scene);
+	AcquireRandomDepth(rng, 60, scene);
+	IndirectDrawCullReference::CullingInput input = AcquireCullingInput(scene);
+
+	uint32_t occludedCount = 0, missedCount = 0, expectedOccludedCount = 0;
+	for (uint32_t i = 0; i < (uint32_t)scene.bounds.size(); i++)
+	{
+		BruteForceResult expected = BruteForceCull(scene, i);
+		if (expected == BruteForceResult::AMBIGUOUS)
+			continue;
+
+		// Hi-Z is conservative, a box is never culled unless every depth texel under it is in front of it
+		bool isVisible = IndirectDrawCullReference::IsVisible(input, i);
+		if (expected == BruteForceResult::VISIBLE)
+			CHECK(isVisible);
+		else if (expected == BruteForceResult::FRUSTUM_CULLED)
+			CHECK(!isVisible);
+		else
+		{
+			expectedOccludedCount++;
+			occludedCount += isVisible ? 0 : 1;
+			missedCount += isVisible ? 1 : 0;
+		}
+	}
+
+	// Coarser levels miss occluded boxes straddling occluder edges, still a good share of them are caught
+	CHECK(expectedOccludedCount > 500);
+	CHECK(occludedCount * 3 > occludedCount + missedCount);
+}
+
+TEST(IndirectDrawCullReferenceOccluderPlane)
+{
+	CullScene scene;
+	Matrix4d proj = AcquireProjection(1.2, (double)HIZ_WIDTH / HIZ_HEIGHT);
+
+	// Unit boxes right ahead at different distances, with a full screen occluder 10 units away
+	double distances[] = { 5.0, 9.0, 11.5, 30.0 };
+	for (double distance : distances)
+	{
+		PerObjectBoundsVariables bounds;
+		bounds.center = Vector4f(0.0f, 0.0f, 0.0f, 1.0f);
+		bounds.extent = Vector4f(1.0f, 1.0f, 1.0f, 0.0f);
+		scene.bounds.push_back(bounds);
+
+		PerObjectVariablesf variables = {};
+		variables.MVP = (proj * Matrix4d(Matrix3d(), Vector3d(0.0, 0.0, -distance))).SinglePrecision();
+		scene.objectVariables.push_back(variables);
+	}
+
+	std::mt19937 rng(0);
+	AcquireRandomDepth(rng, 0, scene);
+	for (auto& level : scene.hiZLevels)
+		level.assign(level.size(), (float)(CAMERA_NEAR / 10.0));
+	IndirectDrawCullReference::CullingInput input = AcquireCullingInput(scene);
+
+	CHECK(IndirectDrawCullReference::IsVisible(input, 0));
+	// Intersecting the occluder
+	CHECK(IndirectDrawCullReference::IsVisible(input, 1));
+	CHECK(!IndirectDrawCullReference::IsVisible(input, 2));
+	CHECK(!IndirectDrawCullReference::IsVisible(input, 3));
+
+	// Non cullable bounds are drawn anyway
+	scene.bounds[3].center.w = 0.0f;
+	CHECK(IndirectDrawCullReference::IsVisible(input, 3));
+}
+
+TEST(IndirectDrawCullReferenceCompaction)
+{
+	std::mt19937 rng(23);
+	CullScene scene;
+	AcquireRandomObjects(rng, 500, scene);
+	AcquireRandomDepth(rng, 6, scene);
+	IndirectDrawCullReference::CullingInput input = AcquireCullingInput(scene);
+
+	std::uniform_int_distribution<uint32_t> objectIndex(0, (uint32_t)scene.bounds.size() - 1);
+	std::uniform_int_distribution<uint32_t> recordCount(0, 12);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+	// Instances of each draw, then room for their compacted copies, as materials lay them out
+	std::vector<IndirectDrawVariables> draws(60);
+	std::vector<PerMaterialIndirectVariables> instances;
+	for (uint32_t i = 0; i < (uint32_t)draws.size(); i++)
+	{
+		draws[i].indexCount = 3 * (i + 1);
+		draws[i].instanceCount = percent(rng) < 20 ? 1 : 0;
+		draws[i].firstIndex = i * 100;
+		draws[i].vertexOffset = -(int32_t)i;
+		draws[i].firstInstance = i;
+		draws[i].instanceRecordCount = recordCount(rng);
+		draws[i].instanceOffset = (uint32_t)instances.size();
+
+		for (uint32_t j = 0; j < draws[i].instanceRecordCount; j++)
+		{
+			PerMaterialIndirectVariables instance;
+			instance.perObjectIndex = objectIndex(rng);
+			instance.perMaterialIndex = i;
+			instance.perMeshIndex = j;
+			instances.push_back(instance);
+		}
+	}
+	for (auto& draw : draws)
+	{
+		draw.cullingOffset = (uint32_t)instances.size();
+		instances.resize(instances.size() + draw.instanceRecordCount);
+	}
+	const std::vector<PerMaterialIndirectVariables> source = instances;
+
+	input.pDraws = draws.data();
+	input.drawCount = (uint32_t)draws.size();
+
+	for (uint32_t maxDrawCount : { 1000u, 20u })
+	{
+		input.maxDrawCount = maxDrawCount;
+		instances = source;
+
+		IndirectDrawCullReference::CullingOutput output;
+		IndirectDrawCullReference::Cull(input, instances.data(), output);
+
+		uint32_t drawCount = 0;
+		for (auto& draw : draws)
+		{
+			// Visible instances keep their order, source instances are left untouched
+			uint32_t visibleCount = 0;
+			for (uint32_t j = 0; j < draw.instanceRecordCount; j++)
+			{
+				const PerMaterialIndirectVariables& instance = source[draw.instanceOffset + j];
+				CHECK(instances[draw.instanceOffset + j].perObjectIndex == instance.perObjectIndex);
+				if (!IndirectDrawCullReference::IsVisible(input, instance.perObjectIndex))
+					continue;
+
+				const PerMaterialIndirectVariables& compacted = instances[draw.cullingOffset + visibleCount++];
+				CHECK(compacted.perObjectIndex == instance.perObjectIndex && compacted.perMeshIndex == instance.perMeshIndex);
+			}
+
+			if (visibleCount == 0)
+				continue;
+
+			uint32_t outDrawID = drawCount++;
+			if (outDrawID >= maxDrawCount)
+				continue;
+
+			const IndirectDrawCullReference::DrawIndexedIndirectCommand& cmd = output.cmds[outDrawID];
+			CHECK(cmd.indexCount == draw.indexCount && cmd.firstIndex == draw.firstIndex);
+			CHECK(cmd.vertexOffset == draw.vertexOffset && cmd.firstInstance == draw.firstInstance);
+			CHECK(cmd.instanceCount == (draw.instanceCount == 0 ? visibleCount : draw.instanceCount));
+			CHECK(output.indirectOffsets[outDrawID].offset == draw.cullingOffset);
+		}
+
+		// Draws beyond max draw count are counted but not written
+		CHECK(output.drawCount == drawCount);
+		CHECK(output.cmds.size() == (drawCount < maxDrawCount ? drawCount : maxDrawCount));
+		CHECK(output.indirectOffsets.size() == output.cmds.size());
+		CHECK(maxDrawCount > drawCount || output.drawCount > (uint32_t)output.cmds.size());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,390 @@
+#include "TestFramework.h"
+#include "../thread/WorkStealingDeque.hpp"
+#include "../thread/ThreadTaskQueue.hpp"
+#include <queue>
+#include <condition_variable>
+
+TEST(WorkStealingDequeOrder)
+{
+	// Small capacity, so that ring buffer has to grow
+	WorkStealingDeque<uint32_t> deque(4);
+	for (uint32_t i = 0; i < 100; i++)
+		deque.Push(i);
+	CHECK(deque.Size() == 100);
+
+	// Owner pops newest first, thieves steal oldest first
+	uint32_t item;
+	CHECK(deque.Pop(item) && item == 99);
+	CHECK(deque.Steal(item) && item == 0);
+	CHECK(deque.Steal(item) && item == 1);
+	CHECK(deque.Pop(item) && item == 98);
+
+	uint32_t count = 0;
+	while (deque.Pop(item))
+		count++;
+	CHECK(count == 96);
+	CHECK(deque.Empty());
+	CHECK(!deque.Pop(item));
+	CHECK(!deque.Steal(item));
+
+	// Usable again after being drained
+	deque.Push(7);
+	CHECK(deque.Steal(item) && item == 7);
+	CHECK(!deque.Pop(item));
+}
+
+TEST(WorkStealingDequeConcurrentSteal)
+{
+	const uint32_t itemCount = 200000;
+	const uint32_t thiefCount = 3;
+
+	WorkStealingDeque<uint32_t> deque(64);
+	std::vector<std::atomic<uint32_t>> consumed(itemCount);
+	for (auto& counter : consumed)
+		counter = 0;
+
+	std::atomic<bool> isPushing = { true };
+	std::vector<std::thread> thieves;
+	for (uint32_t i = 0; i < thiefCount; i++)
+	{
+		thieves.push_back(std::thread([&]()
+		{
+			uint32_t item;
+			while (isPushing || !deque.Empty())
+			{
+				if (deque.Steal(item))
+					consumed[item]++;
+				else
+					std::this_thread::yield();
+			}
+		}));
+	}
+
+	// Owner pushes and pops in bursts, so it races thieves for the last item every now and then
+	uint32_t item;
+	for (uint32_t i = 0; i < itemCount; i++)
+	{
+		deque.Push(i);
+		if (i % 7 == 0 && deque.Pop(item))
+			consumed[item]++;
+	}
+	while (deque.Pop(item))
+		consumed[item]++;
+	isPushing = false;
+
+	for (auto& thief : thieves)
+		thief.join();
+
+	// Every item is taken exactly once
+	for (uint32_t i = 0; i < itemCount; i++)
+		CHECK(consumed[i] == 1);
+}
+
+// Job queue before work stealing: a dispatcher thread probes workers round robin under their mutexes, and each worker holds at most 2 jobs
+class DispatcherJobQueue
+{
+	typedef struct _Worker
+	{
+		std::thread				thread;
+		std::mutex				queueMutex;
+		std::condition_variable	condition;
+		std::queue<ThreadJobFunc>	jobQueue;
+		bool					isDestroying = false;
+	}Worker;
+
+public:
+	DispatcherJobQueue(uint32_t workerCount) : m_workers(workerCount)
+	{
+		for (auto& worker : m_workers)
+			worker.thread = std::thread(&DispatcherJobQueue::WorkerLoop, this, &worker);
+		m_dispatcher = std::thread(&DispatcherJobQueue::DispatcherLoop, this);
+	}
+
+	~DispatcherJobQueue()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_isDestroying = true;
+		}
+		m_condition.notify_all();
+		m_dispatcher.join();
+
+		for (auto& worker : m_workers)
+		{
+			{
+				std::unique_lock<std::mutex> lock(worker.queueMutex);
+				worker.isDestroying = true;
+			}
+			worker.condition.notify_one();
+			worker.thread.join();
+		}
+	}
+
+	void AddJob(ThreadJobFunc jobFunc, uint32_t frameIndex)
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		m_pendingJobCount++;
+		m_taskQueue.push(jobFunc);
+		m_condition.notify_all();
+	}
+
+	void WaitForFree()
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		m_condition.wait(lock, [this]() { return m_pendingJobCount == 0; });
+	}
+
+private:
+	void DispatcherLoop()
+	{
+		uint32_t currentWorker = 0;
+		while (true)
+		{
+			ThreadJobFunc job;
+			{
+				std::unique_lock<std::mutex> lock(m_queueMutex);
+				m_condition.wait(lock, [this]() { return !m_taskQueue.empty() || m_isDestroying; });
+				if (m_isDestroying)
+					break;
+
+				job = m_taskQueue.front();
+				m_taskQueue.pop();
+			}
+
+			while (true)
+			{
+				Worker& worker = m_workers[currentWorker];
+				currentWorker = (currentWorker + 1) % (uint32_t)m_workers.size();
+
+				std::unique_lock<std::mutex> lock(worker.queueMutex);
+				if (worker.jobQueue.size() < JOB_QUEUE_SIZE)
+				{
+					worker.jobQueue.push(job);
+					worker.condition.notify_one();
+					break;
+				}
+			}
+		}
+	}
+
+	void WorkerLoop(Worker* pWorker)
+	{
+		while (true)
+		{
+			ThreadJobFunc job;
+			{
+				std::unique_lock<std::mutex> lock(pWorker->queueMutex);
+				pWorker->condition.wait(lock, [pWorker]() { return !pWorker->jobQueue.empty() || pWorker->isDestroying; });
+				if (pWorker->isDestroying)
+					break;
+
+				job = pWorker->jobQueue.front();
+				pWorker->jobQueue.pop();
+			}
+
+			job(nullptr);
+
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			if (--m_pendingJobCount == 0)
+				m_condition.notify_all();
+		}
+	}
+
+private:
+	std::vector<Worker>			m_workers;
+	std::thread					m_dispatcher;
+	std::mutex					m_queueMutex;
+	std::condition_variable		m_condition;
+	std::queue<ThreadJobFunc>	m_taskQueue;
+	uint32_t					m_pendingJobCount = 0;
+	bool						m_isDestroying = false;
+
+	static const uint32_t JOB_QUEUE_SIZE = 2;
+};
+
+// Jobs run without per frame resources, they're created by device code
+static std::shared_ptr<PerFrameResource> AllocateNullPerFrameResource(uint32_t frameIndex)
+{
+	return nullptr;
+}
+
+TEST(ThreadTaskQueueDependencies)
+{
+	ThreadTaskQueue jobQueue(1, AllocateNullPerFrameResource, 3);
+
+	// Diamond: b and c depend on a, d depends on both, every job stamps when it runs
+	for (uint32_t round = 0; round < 200; round++)
+	{
+		std::atomic<uint32_t> clock = { 0 };
+		std::atomic<uint32_t> stampA = { 0 }, stampB = { 0 }, stampC = { 0 }, stampD = { 0 };
+
+		ThreadJobHandle pA = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&) { std::this_thread::yield(); stampA = ++clock; }, 0);
+		ThreadJobHandle pB = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&) { stampB = ++clock; }, 0, { pA });
+		ThreadJobHandle pC = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&) { stampC = ++clock; }, 0, { pA });
+		ThreadJobHandle pD = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&) { stampD = ++clock; }, 0, { pB, pC });
+
+		jobQueue.WaitForJob(pD);
+		CHECK(pA->isFinished && pB->isFinished && pC->isFinished && pD->isFinished);
+		CHECK(stampA > 0 && stampA < stampB && stampA < stampC);
+		CHECK(stampD > stampB && stampD > stampC);
+
+		// Finished dependencies don't hold a job back
+		ThreadJobHandle pE = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&) { ++clock; }, 0, { pA, pD });
+		jobQueue.WaitForJob(pE);
+		CHECK(clock == 5);
+	}
+
+	// A long chain, each job sees the one before it finished
+	std::vector<ThreadJobHandle> chain;
+	std::atomic<uint32_t> brokenLinks = { 0 };
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		ThreadJobHandle pPrev = chain.empty() ? nullptr : chain.back();
+		std::vector<ThreadJobHandle> dependencies;
+		if (pPrev)
+			dependencies.push_back(pPrev);
+		chain.push_back(jobQueue.AddJob([pPrev, &brokenLinks](const std::shared_ptr<PerFrameResource>&)
+		{
+			if (pPrev && !pPrev->isFinished)
+				brokenLinks++;
+		}, 0, dependencies));
+	}
+	jobQueue.WaitForFree();
+	CHECK(brokenLinks == 0);
+	for (auto& pJob : chain)
+		CHECK(pJob->isFinished);
+	CHECK(jobQueue.GetTaskQueueSize() == 0);
+}
+
+TEST(ThreadTaskQueueParallelFor)
+{
+	ThreadTaskQueue jobQueue(1, AllocateNullPerFrameResource, 3);
+
+	const uint32_t counts[] = { 0, 1, 7, 1000, 4097 };
+	const uint32_t grainSizes[] = { 0, 1, 3, 64, 5000 };
+	for (uint32_t count : counts)
+	{
+		for (uint32_t grainSize : grainSizes)
+		{
+			std::vector<std::atomic<uint32_t>> visits(count);
+			for (auto& visit : visits)
+				visit = 0;
+
+			// A job depending on the returned handle sees every range done
+			ThreadJobHandle pParallelFor = jobQueue.AddParallelForJob(count, grainSize, [&visits](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>&)
+			{
+				for (uint32_t i = startIndex; i < endIndex; i++)
+					visits[i]++;
+			}, 0);
+
+			std::atomic<bool> allVisited = { false };
+			ThreadJobHandle pAfter = jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&)
+			{
+				bool visited = true;
+				for (auto& visit : visits)
+					visited = visited && visit == 1;
+				allVisited = visited;
+			}, 0, { pParallelFor });
+
+			jobQueue.WaitForJob(pAfter);
+			CHECK(allVisited);
+
+			// Synchronous version, from main thread
+			jobQueue.ParallelFor(count, grainSize, [&visits](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>&)
+			{
+				for (uint32_t i = startIndex; i < endIndex; i++)
+					visits[i]++;
+			}, 0);
+			for (auto& visit : visits)
+				CHECK(visit == 2);
+		}
+	}
+
+	// Range function for device free code
+	std::vector<uint32_t> squares(1000);
+	ParallelRangeFunc parallelRange = jobQueue.AcquireParallelRangeFunc(0);
+	parallelRange((uint32_t)squares.size(), 16, [&squares](uint32_t startIndex, uint32_t endIndex)
+	{
+		for (uint32_t i = startIndex; i < endIndex; i++)
+			squares[i] = i * i;
+	});
+	for (uint32_t i = 0; i < (uint32_t)squares.size(); i++)
+		CHECK(squares[i] == i * i);
+}
+
+TEST(ThreadTaskQueueWaitFromWorker)
+{
+	// Every worker waits on nested work here, which only finishes if waiting workers keep running jobs
+	const uint32_t workerCount = 2;
+	ThreadTaskQueue jobQueue(1, AllocateNullPerFrameResource, workerCount);
+
+	std::atomic<uint32_t> innerCount = { 0 };
+	std::atomic<uint32_t> waitedOnWorker = { 0 };
+	std::vector<ThreadJobHandle> outerJobs;
+	for (uint32_t i = 0; i < workerCount * 4; i++)
+	{
+		outerJobs.push_back(jobQueue.AddJob([&](const std::shared_ptr<PerFrameResource>&)
+		{
+			if (ThreadWorker::GetCurrentWorker() != nullptr)
+				waitedOnWorker++;
+
+			// Nested ParallelFor, whose ranges wait on another level of jobs
+			jobQueue.ParallelFor(16, 1, [&](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>&)
+			{
+				ThreadJobHandle pInner = jobQueue.AddJob([&innerCount](const std::shared_ptr<PerFrameResource>&) { innerCount++; }, 0);
+				jobQueue.WaitForJob(pInner);
+			}, 0);
+		}, 0));
+	}
+
+	for (auto& pJob : outerJobs)
+		jobQueue.WaitForJob(pJob);
+
+	CHECK(waitedOnWorker == workerCount * 4);
+	CHECK(innerCount == workerCount * 4 * 16);
+
+	jobQueue.WaitForFree();
+	CHECK(jobQueue.GetTaskQueueSize() == 0);
+}
+
+// Empty jobs submitted from main thread, so that only scheduling is measured
+template <typename JobQueue>
+static double MeasureEmptyJobs(JobQueue& jobQueue, uint32_t jobCount, uint32_t& executedCount)
+{
+	std::atomic<uint32_t> counter = { 0 };
+	double milliseconds = MeasureMilliseconds([&]()
+	{
+		for (uint32_t i = 0; i < jobCount; i++)
+			jobQueue.AddJob([&counter](const std::shared_ptr<PerFrameResource>&) { counter++; }, 0);
+		jobQueue.WaitForFree();
+	}, 3);
+	executedCount = counter;
+	return milliseconds;
+}
+
+BENCHMARK(JobSystemEmptyJobs)
+{
+	const uint32_t jobCount = 20000;
+
+	// Same worker count as ThreadTaskQueue picks by default
+	int workerCount = (int)std::thread::hardware_concurrency() - 1;
+	workerCount = workerCount > 1 ? workerCount : 1;
+
+	uint32_t dispatcherExecuted = 0, stealingExecuted = 0;
+	double dispatcherMilliseconds, stealingMilliseconds;
+	{
+		DispatcherJobQueue jobQueue(workerCount);
+		dispatcherMilliseconds = MeasureEmptyJobs(jobQueue, jobCount, dispatcherExecuted);
+	}
+	{
+		ThreadTaskQueue jobQueue(1, AllocateNullPerFrameResource);
+		CHECK(jobQueue.GetWorkerCount() == (uint32_t)workerCount);
+		stealingMilliseconds = MeasureEmptyJobs(jobQueue, jobCount, stealingExecuted);
+	}
+
+	std::cout << "    " << jobCount << " empty jobs, " << workerCount << " workers" << std::endl;
+	std::cout << "    dispatcher: " << dispatcherMilliseconds << " ms, " << jobCount / dispatcherMilliseconds << " jobs per ms" << std::endl;
+	std::cout << "    ThreadTaskQueue: " << stealingMilliseconds << " ms, " << jobCount / stealingMilliseconds << " jobs per ms, speedup " << dispatcherMilliseconds / stealingMilliseconds << std::endl;
+
+	CHECK(dispatcherExecuted == jobCount * 3 && stealingExecuted == jobCount * 3);
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "TestFramework.h"
+#include "../class/PlanetHeightTileCache.h"
+#include "../Maths/SimplexNoise.h"
+#include <random>
+#include <thread>
+
+TEST(SimplexNoiseMatchesScalar)
+{
+	SimplexNoise noise(42);
+	std::mt19937 rng(31);
+	std::uniform_real_distribution<float> dist(-50.0f, 50.0f);
+
+	// Odd count, so that remainder of batches is covered
+	const uint32_t count = 1023;
+	std::vector<float> x(count), y(count), z(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		x[i] = dist(rng);
+		y[i] = dist(rng);
+		z[i] = dist(rng);
+	}
+
+	std::vector<float> batched(count), scalar(count);
+	noise.Noise(x.data(), y.data(), z.data(), batched.data(), count);
+	noise.NoiseScalar(x.data(), y.data(), z.data(), scalar.data(), count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		CHECK(batched[i] == scalar[i]);
+		CHECK(scalar[i] == noise.Noise(x[i], y[i], z[i]));
+		CHECK(scalar[i] >= -1.0f && scalar[i] <= 1.0f);
+	}
+
+	noise.FBM(x.data(), y.data(), z.data(), batched.data(), count, 10, 2.0f, 0.5f);
+	noise.FBMScalar(x.data(), y.data(), z.data(), scalar.data(), count, 10, 2.0f, 0.5f);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		CHECK(batched[i] == scalar[i]);
+		CHECK(scalar[i] == noise.FBM(x[i], y[i], z[i], 10, 2.0f, 0.5f));
+	}
+}
+
+// Children of one cube face, arranged the same as quad tree nodes
+typedef struct _TileCorners
+{
+	uint64_t	tileKey;
+	Vector3d	a;
+	Vector3d	b;
+	Vector3d	c;
+	Vector3d	d;
+}TileCorners;
+
+static std::vector<TileCorners> AcquireFaceTiles(uint32_t resolution)
+{
+	std::vector<TileCorners> tiles;
+	for (uint32_t row = 0; row < resolution; row++)
+	{
+		for (uint32_t column = 0; column < resolution; column++)
+		{
+			double u0 = column * 2.0 / resolution - 1.0, u1 = (column + 1) * 2.0 / resolution - 1.0;
+			double v0 = row * 2.0 / resolution - 1.0, v1 = (row + 1) * 2.0 / resolution - 1.0;
+			tiles.push_back({ 1000ull + row * resolution + column, Vector3d(u0, v0, 1), Vector3d(u1, v0, 1), Vector3d(u0, v1, 1), Vector3d(u1, v1, 1) });
+		}
+	}
+	return tiles;
+}
+
+// Background threads take a while, give them up to some seconds
+template <typename Func>
+static bool WaitFor(Func isDone)
+{
+	for (uint32_t i = 0; i < 2000 && !isDone(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	return isDone();
+}
+
+TEST(PlanetHeightTileStreaming)
+{
+	const float heightScale = 0.0015f;
+	std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(7, heightScale, 16 * 1024 * 1024);
+	CHECK(pCache != nullptr);
+
+	// Pending requests are capped, the rest are dropped and asked for again later, like quad tree does every frame
+	std::vector<TileCorners> tiles = AcquireFaceTiles(8);
+	for (auto& tile : tiles)
+		pCache->RequestTile(tile.tileKey, tile.a, tile.b, tile.c, tile.d);
+	CHECK(pCache->GetPendingTileCount() <= 32);
+
+	CHECK(WaitFor([&]()
+	{
+		for (auto& tile : tiles)
+			pCache->RequestTile(tile.tileKey, tile.a, tile.b, tile.c, tile.d);
+		return pCache->GetCachedTileCount() == (uint32_t)tiles.size();
+	}));
+	CHECK(pCache->GetPendingTileCount() == 0);
+	// Cached or pending tiles are never generated twice
+	CHECK(pCache->GetGeneratedTileCount() == (uint32_t)tiles.size());
+
+	// Same bounds as generating on this thread, cached tiles don't keep the height grid
+	for (auto& tile : tiles)
+	{
+		std::shared_ptr<PlanetHeightTile> pTile = pCache->AcquireTile(tile.tileKey);
+		CHECK(pTile != nullptr);
+		std::shared_ptr<PlanetHeightTile> pExpected = pCache->GenerateTile(tile.a, tile.b, tile.c, tile.d);
+		CHECK(pTile->heights.empty());
+		CHECK(pExpected->heights.size() == PlanetHeightTileCache::TILE_RESOLUTION * PlanetHeightTileCache::TILE_RESOLUTION);
+		CHECK(pTile->minHeight == pExpected->minHeight && pTile->maxHeight == pExpected->maxHeight);
+		CHECK(pTile->minHeight >= -heightScale && pTile->maxHeight <= heightScale);
+		CHECK(pTile->minHeight < pTile->maxHeight);
+	}
+}
+
+TEST(PlanetHeightTileEviction)
+{
+	// Room for a few tiles only, cached ones are bounds only
+	uint32_t tileBytes = (uint32_t)sizeof(PlanetHeightTile);
+	std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(7, 0.0015f, tileBytes * 4);
+
+	std::vector<TileCorners> tiles = AcquireFaceTiles(4);
+	for (uint32_t i = 0; i < (uint32_t)tiles.size(); i++)
+	{
+		pCache->RequestTile(tiles[i].tileKey, tiles[i].a, tiles[i].b, tiles[i].c, tiles[i].d);
+		CHECK(WaitFor([&]() { return pCache->GetGeneratedTileCount() == i + 1; }));
+
+		// First tile is kept alive by being used all the time
+		CHECK(pCache->AcquireTile(tiles[0].tileKey) != nullptr);
+		CHECK(pCache->GetCachedBytes() <= tileBytes * 4);
+	}
+
+	CHECK(pCache->GetCachedTileCount() == 4);
+	CHECK(pCache->AcquireTile(tiles[1].tileKey) == nullptr);
+	CHECK(pCache->AcquireTile(tiles.back().tileKey) != nullptr);
+}
+
+TEST(PlanetHeightTileCacheReleasedWhilePending)
+{
+	// Destruction drops queued requests and waits for tiles being generated, it must neither hang nor crash
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(i, 0.0015f, 1024 * 1024);
+		for (auto& tile : AcquireFaceTiles(6))
+			pCache->RequestTile(tile.tileKey, tile.a, tile.b, tile.c, tile.d);
+		pCache = nullptr;
+	}
+}
+
+// Tiles streamed through background generator threads of the cache, requested again and again like quad tree does every frame
+BENCHMARK(PlanetHeightTileThroughput)
+{
+	const uint32_t faceResolution = 24;
+	std::vector<TileCorners> tiles = AcquireFaceTiles(faceResolution);
+
+	double singleMilliseconds = MeasureMilliseconds([&]()
+	{
+		std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(7, 0.0015f, 0);
+		for (auto& tile : tiles)
+			pCache->GenerateTile(tile.a, tile.b, tile.c, tile.d);
+	}, 3);
+
+	bool allCached = true;
+	double streamedMilliseconds = MeasureMilliseconds([&]()
+	{
+		std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(7, 0.0015f, 1024 * 1024);
+		uint32_t cachedCount = 0;
+		while (cachedCount < (uint32_t)tiles.size())
+		{
+			for (auto& tile : tiles)
+				pCache->RequestTile(tile.tileKey, tile.a, tile.b, tile.c, tile.d);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			cachedCount = pCache->GetCachedTileCount();
+		}
+		allCached = allCached && pCache->GetGeneratedTileCount() == (uint32_t)tiles.size();
+	}, 3);
+
+	std::cout << "    " << tiles.size() << " tiles, " << PlanetHeightTileCache::TILE_RESOLUTION * PlanetHeightTileCache::TILE_RESOLUTION << " samples each" << std::endl;
+	std::cout << "    calling thread: " << tiles.size() * 1000.0 / singleMilliseconds << " tiles per second" << std::endl;
+	std::cout << "    background threads of cache: " << tiles.size() * 1000.0 / streamedMilliseconds << " tiles per second, speedup " << singleMilliseconds / streamedMilliseconds << std::endl;
+	CHECK(allCached);
+}
\ No newline at end of file
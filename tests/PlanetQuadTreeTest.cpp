@@ -0,0 +1,274 @@
+#include "TestFramework.h"
+#include "ThreadParallelRange.h"
+#include "../class/PlanetQuadTree.h"
+#include "../class/PlanetHeightTileCache.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+static const double PLANET_RADIUS = 6378000.0;
+static const uint32_t MAX_LOD_LEVEL = 32;
+static const uint32_t MAX_PATCH_COUNT = 16384;
+static const float TERRAIN_HEIGHT_SCALE = 0.0015f;
+
+// Same layout as SceneGenerator::GenerateCube
+typedef struct _Cube
+{
+	Vector3d	vertices[8];
+	uint32_t	indices[36];
+}Cube;
+
+static Cube AcquireCube()
+{
+	Cube cube =
+	{
+		{ { -1, -1, 1 }, { 1, -1, 1 }, { -1, -1, -1 }, { 1, -1, -1 }, { -1, 1, 1 }, { 1, 1, 1 }, { -1, 1, -1 }, { 1, 1, -1 } },
+		{
+			1, 0, 3, 3, 0, 2,	// Bottom
+			4, 5, 6, 6, 5, 7,	// Top
+			0, 1, 4, 4, 1, 5,	// Front
+			3, 2, 7, 7, 2, 6,	// Back
+			2, 0, 6, 6, 0, 4,	// Left
+			1, 3, 5, 5, 3, 7,	// Right
+		}
+	};
+	for (auto& vertex : cube.vertices)
+		vertex.Normalize();
+	return cube;
+}
+
+// Distances to divide each level, the same way PerPlanetUniforms derives them from screen size of a triangle
+static std::vector<double> AcquireDistanceLUT(const Cube& cube)
+{
+	double size = (cube.vertices[cube.indices[1]] - cube.vertices[cube.indices[2]]).Length();
+	double frac = std::tan(1.57 * 400.0 / 1920.0);
+
+	std::vector<double> distanceLUT;
+	for (uint32_t i = 0; i < MAX_LOD_LEVEL + 1; i++)
+	{
+		distanceLUT.push_back(size / frac * PLANET_RADIUS);
+		size *= 0.5;
+	}
+	return distanceLUT;
+}
+
+// Quad tree together with its patch buffer, and a copy of it that only receives dirty ranges, like the buffer on device
+typedef struct _TestPlanet
+{
+	std::vector<PlanetQuadTree::Triangle>	patchData;
+	std::vector<PlanetQuadTree::Triangle>	uploadedData;
+	std::shared_ptr<PlanetQuadTree>			pQuadTree;
+}TestPlanet;
+
+static std::shared_ptr<TestPlanet> CreateTestPlanet(const std::shared_ptr<PlanetHeightTileCache>& pHeightTileCache = nullptr)
+{
+	static const Cube cube = AcquireCube();
+
+	std::shared_ptr<TestPlanet> pPlanet = std::make_shared<TestPlanet>();
+	pPlanet->patchData.resize(MAX_PATCH_COUNT * 2);
+	pPlanet->uploadedData.resize(MAX_PATCH_COUNT * 2);
+
+	TestPlanet* pRawPlanet = pPlanet.get();
+	pPlanet->pQuadTree = PlanetQuadTree::Create(PLANET_RADIUS, cube.vertices, cube.indices, AcquireDistanceLUT(cube), MAX_LOD_LEVEL, TERRAIN_HEIGHT_SCALE, pHeightTileCache,
+		pPlanet->patchData.data(), MAX_PATCH_COUNT, [pRawPlanet](uint32_t offset, uint32_t numBytes)
+	{
+		memcpy((uint8_t*)pRawPlanet->uploadedData.data() + offset, (uint8_t*)pRawPlanet->patchData.data() + offset, numBytes);
+	});
+	return pPlanet;
+}
+
+// Patches of a planet in a canonical order, so that planets could be compared regardless of slot order
+static std::vector<std::vector<uint8_t>> AcquireSortedPatches(const TestPlanet& planet, const std::vector<PlanetQuadTree::Triangle>& data)
+{
+	std::vector<std::vector<uint8_t>> patches(planet.pQuadTree->GetPatchCount());
+	for (uint32_t i = 0; i < (uint32_t)patches.size(); i++)
+	{
+		patches[i].resize(PlanetQuadTree::PATCH_BYTES);
+		memcpy(patches[i].data(), data.data() + i * 2, PlanetQuadTree::PATCH_BYTES);
+	}
+	std::sort(patches.begin(), patches.end());
+	return patches;
+}
+
+typedef struct _CameraFrame
+{
+	Vector3d		position;
+	PyramidFrustumd	frustum;
+}CameraFrame;
+
+// Camera flies over surface at a fixed altitude, covering a few times its altitude
+// Close to ground it looks towards horizon, from far away mostly down at planet
+static std::vector<CameraFrame> RecordCameraPath(double altitude, uint32_t frameCount)
+{
+	std::vector<CameraFrame> frames;
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		double angle = 0.3 + i * altitude * 0.05 / PLANET_RADIUS;
+		Vector3d up(std::cos(angle), 0.2, std::sin(angle));
+		up.Normalize();
+		Vector3d forward = up ^ Vector3d(0, 1, 0);
+		forward.Normalize();
+
+		CameraFrame frame;
+		frame.position = up * (PLANET_RADIUS + altitude);
+		Vector3d lookAt = altitude < PLANET_RADIUS * 0.1 ? forward * 2.0 - up : forward * 0.3 - up;
+		lookAt.Normalize();
+
+		// Corners are built from camera basis, since rotation from -z to look direction isn't reliable for every direction
+		Vector3d right = lookAt ^ up;
+		right.Normalize();
+		Vector3d cameraUp = right ^ lookAt;
+		double tangentV = std::tan(0.8), tangentH = tangentV * 16.0 / 9.0;
+		frame.frustum = PyramidFrustumd(frame.position,
+			frame.position + lookAt - right * tangentH - cameraUp * tangentV,
+			frame.position + lookAt + right * tangentH - cameraUp * tangentV,
+			frame.position + lookAt - right * tangentH + cameraUp * tangentV,
+			frame.position + lookAt + right * tangentH + cameraUp * tangentV);
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+static const double ALTITUDES[] = { 100.0, 10000.0, 1000000.0, 20000000.0 };
+
+TEST(PlanetQuadTreeMatchesFreshBuild)
+{
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(4);
+
+	for (double altitude : ALTITUDES)
+	{
+		std::shared_ptr<TestPlanet> pSerial = CreateTestPlanet();
+		std::shared_ptr<TestPlanet> pParallel = CreateTestPlanet();
+		CHECK(pSerial->pQuadTree != nullptr && pParallel->pQuadTree != nullptr);
+
+		for (auto& frame : RecordCameraPath(altitude, 40))
+		{
+			pSerial->pQuadTree->Update(frame.position, frame.position, frame.frustum);
+			pParallel->pQuadTree->Update(frame.position, frame.position, frame.frustum, parallelFor);
+
+			// Same decisions applied in the same order
+			uint32_t patchCount = pSerial->pQuadTree->GetPatchCount();
+			CHECK(patchCount > 0);
+			CHECK(pParallel->pQuadTree->GetPatchCount() == patchCount);
+			CHECK(memcmp(pSerial->patchData.data(), pParallel->patchData.data(), patchCount * PlanetQuadTree::PATCH_BYTES) == 0);
+
+			// Dirty ranges cover every change
+			CHECK(memcmp(pSerial->patchData.data(), pSerial->uploadedData.data(), patchCount * PlanetQuadTree::PATCH_BYTES) == 0);
+
+			// Splitting and merging only where needed ends up with the same patches as evaluating from scratch
+			std::shared_ptr<TestPlanet> pFresh = CreateTestPlanet();
+			pFresh->pQuadTree->Update(frame.position, frame.position, frame.frustum);
+			CHECK(AcquireSortedPatches(*pSerial, pSerial->patchData) == AcquireSortedPatches(*pFresh, pFresh->patchData));
+		}
+	}
+}
+
+TEST(PlanetQuadTreeIncrementalWork)
+{
+	std::vector<CameraFrame> frames = RecordCameraPath(1000.0, 3);
+	std::shared_ptr<TestPlanet> pPlanet = CreateTestPlanet();
+
+	pPlanet->pQuadTree->Update(frames[0].position, frames[0].position, frames[0].frustum);
+	PlanetQuadTree::LODStatistics statistics = pPlanet->pQuadTree->GetLODStatistics();
+	uint32_t patchCount = pPlanet->pQuadTree->GetPatchCount();
+	CHECK(statistics.evaluatedNodeCount > 0 && statistics.splitCount > 0);
+	CHECK(statistics.uploadedBytes == patchCount * PlanetQuadTree::PATCH_BYTES);
+
+	// Still camera does nothing
+	pPlanet->pQuadTree->Update(frames[0].position, frames[0].position, frames[0].frustum);
+	statistics = pPlanet->pQuadTree->GetLODStatistics();
+	CHECK(statistics.evaluatedNodeCount == 0 && statistics.uploadedBytes == 0);
+
+	// Locked camera info keeps the tree, but patches are relative to camera, so they're all rewritten
+	pPlanet->pQuadTree->Update(frames[1].position, frames[0].position, frames[0].frustum);
+	statistics = pPlanet->pQuadTree->GetLODStatistics();
+	CHECK(statistics.evaluatedNodeCount == 0 && statistics.splitCount == 0 && statistics.mergeCount == 0);
+	CHECK(statistics.uploadedBytes == patchCount * PlanetQuadTree::PATCH_BYTES);
+	CHECK(pPlanet->pQuadTree->GetPatchCount() == patchCount);
+	CHECK(memcmp(pPlanet->patchData.data(), pPlanet->uploadedData.data(), patchCount * PlanetQuadTree::PATCH_BYTES) == 0);
+
+	// Going back to orbit merges almost everything
+	std::vector<CameraFrame> orbit = RecordCameraPath(20000000.0, 1);
+	pPlanet->pQuadTree->Update(orbit[0].position, orbit[0].position, orbit[0].frustum);
+	statistics = pPlanet->pQuadTree->GetLODStatistics();
+	CHECK(statistics.mergeCount > 0);
+	CHECK(pPlanet->pQuadTree->GetPatchCount() < patchCount);
+}
+
+TEST(PlanetQuadTreeWithHeightTiles)
+{
+	// Tree keeps being evaluated while tiles are pending, and settles once they're all in
+	std::shared_ptr<PlanetHeightTileCache> pCache = PlanetHeightTileCache::Create(3, TERRAIN_HEIGHT_SCALE, 16 * 1024 * 1024);
+	std::shared_ptr<TestPlanet> pPlanet = CreateTestPlanet(pCache);
+	std::vector<CameraFrame> frames = RecordCameraPath(10000.0, 1);
+
+	bool isSettled = false;
+	for (uint32_t i = 0; i < 2000 && !isSettled; i++)
+	{
+		pPlanet->pQuadTree->Update(frames[0].position, frames[0].position, frames[0].frustum);
+		isSettled = pPlanet->pQuadTree->GetLODStatistics().evaluatedNodeCount == 0;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	CHECK(isSettled);
+	CHECK(pCache->GetGeneratedTileCount() > 0);
+	CHECK(pPlanet->pQuadTree->GetPatchCount() > 0);
+
+	// Tighter bounds never cull more than the whole terrain range would, so a flat bounded tree draws at least as much
+	std::shared_ptr<TestPlanet> pFlat = CreateTestPlanet();
+	pFlat->pQuadTree->Update(frames[0].position, frames[0].position, frames[0].frustum);
+	CHECK(pFlat->pQuadTree->GetPatchCount() >= pPlanet->pQuadTree->GetPatchCount());
+}
+
+// Camera paths at several altitudes, each frame moves camera, so tree is re-evaluated and all patches rewritten
+// Persistent tree against building it from scratch every frame, which is what per frame traversal used to cost
+BENCHMARK(PlanetQuadTreeCameraPaths)
+{
+	const uint32_t frameCount = 120;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(threadCount);
+	std::cout << "    " << threadCount << " threads" << std::endl;
+
+	for (double altitude : ALTITUDES)
+	{
+		std::vector<CameraFrame> frames = RecordCameraPath(altitude, frameCount);
+
+		uint64_t triangleCount = 0;
+		uint64_t evaluatedNodeCount = 0;
+		uint64_t uploadedBytes = 0;
+		std::shared_ptr<TestPlanet> pPlanet;
+		double serial = MeasureMilliseconds([&]()
+		{
+			pPlanet = CreateTestPlanet();
+			triangleCount = evaluatedNodeCount = uploadedBytes = 0;
+			for (auto& frame : frames)
+			{
+				pPlanet->pQuadTree->Update(frame.position, frame.position, frame.frustum);
+				triangleCount += pPlanet->pQuadTree->GetPatchCount() * 2;
+				evaluatedNodeCount += pPlanet->pQuadTree->GetLODStatistics().evaluatedNodeCount;
+				uploadedBytes += pPlanet->pQuadTree->GetLODStatistics().uploadedBytes;
+			}
+		}, 3);
+
+		double parallel = MeasureMilliseconds([&]()
+		{
+			pPlanet = CreateTestPlanet();
+			for (auto& frame : frames)
+				pPlanet->pQuadTree->Update(frame.position, frame.position, frame.frustum, parallelFor);
+		}, 3);
+
+		double fresh = MeasureMilliseconds([&]()
+		{
+			for (auto& frame : frames)
+			{
+				pPlanet = CreateTestPlanet();
+				pPlanet->pQuadTree->Update(frame.position, frame.position, frame.frustum);
+			}
+		}, 3);
+
+		std::cout << "    altitude " << altitude << " m: " << triangleCount / frameCount << " triangles, " << evaluatedNodeCount / frameCount << " nodes evaluated, "
+			<< uploadedBytes / frameCount / 1024 << " KB uploaded per frame" << std::endl;
+		std::cout << "      serial " << serial / frameCount << " ms per frame, " << triangleCount / serial << " triangles per ms" << std::endl;
+		std::cout << "      parallel " << parallel / frameCount << " ms per frame, " << triangleCount / parallel << " triangles per ms" << std::endl;
+		std::cout << "      built from scratch " << fresh / frameCount << " ms per frame, " << triangleCount / fresh << " triangles per ms" << std::endl;
+	}
+}
\ No newline at end of file
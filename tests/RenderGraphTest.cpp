@@ -0,0 +1,301 @@
+#include "TestFramework.h"
+#include "../class/RenderGraph.h"
+#include <random>
+
+static RenderGraph::ResourceDesc AcquireImageDesc(const std::string& name, bool transient, bool output = false, bool depthStencil = false, uint32_t size = 1024)
+{
+	RenderGraph::ResourceDesc desc = {};
+	desc.name = name;
+	desc.width = size;
+	desc.height = size;
+	desc.sizeInBytes = size * size * 4;
+	desc.depthStencil = depthStencil;
+	desc.transient = transient;
+	desc.output = output;
+	return desc;
+}
+
+static bool HasBarrier(const RenderGraph& graph, uint32_t pass, const RenderGraph::Barrier& expected)
+{
+	for (auto& barrier : graph.GetPassBarriers(pass))
+	{
+		if (barrier.resource == expected.resource && barrier.srcUsages == expected.srcUsages && barrier.srcWrite == expected.srcWrite
+			&& barrier.dstUsages == expected.dstUsages && barrier.dstWrite == expected.dstWrite && barrier.discard == expected.discard)
+			return true;
+	}
+	return false;
+}
+
+// Any barrier of a resource before a pass, or only discarding ones
+static bool HasResourceBarrier(const RenderGraph& graph, uint32_t pass, uint32_t resource, bool discard)
+{
+	for (auto& barrier : graph.GetPassBarriers(pass))
+	{
+		if (barrier.resource == resource && (!discard || barrier.discard))
+			return true;
+	}
+	return false;
+}
+
+static const uint32_t COLOR = 1 << RenderGraph::ResourceUsageColorAttachment;
+static const uint32_t DEPTH = 1 << RenderGraph::ResourceUsageDepthAttachment;
+static const uint32_t SAMPLED = 1 << RenderGraph::ResourceUsageSampled;
+
+TEST(RenderGraphCullPasses)
+{
+	std::shared_ptr<RenderGraph> pGraph = RenderGraph::Create();
+	uint32_t scene = pGraph->AddResource(AcquireImageDesc("Scene", true));
+	uint32_t unused = pGraph->AddResource(AcquireImageDesc("Unused", true));
+	uint32_t backBuffer = pGraph->AddResource(AcquireImageDesc("BackBuffer", false, true));
+
+	uint32_t drawScene = pGraph->AddPass("DrawScene");
+	pGraph->Write(drawScene, scene);
+
+	// Nobody reads what it writes
+	uint32_t drawUnused = pGraph->AddPass("DrawUnused");
+	pGraph->Read(drawUnused, scene);
+	pGraph->Write(drawUnused, unused);
+
+	// Fully overwritten by the next plain write before anyone reads it
+	uint32_t clearBackBuffer = pGraph->AddPass("ClearBackBuffer");
+	pGraph->Write(clearBackBuffer, backBuffer);
+
+	uint32_t composite = pGraph->AddPass("Composite");
+	pGraph->Read(composite, scene);
+	pGraph->Write(composite, backBuffer);
+
+	// Loads back buffer, so the composite before it is still needed
+	uint32_t overlay = pGraph->AddPass("Overlay");
+	pGraph->Read(overlay, backBuffer, RenderGraph::ResourceUsageColorAttachment);
+	pGraph->Write(overlay, backBuffer);
+
+	uint32_t capture = pGraph->AddPass("Capture");
+	pGraph->SetSideEffect(capture);
+
+	CHECK(pGraph->Compile());
+	CHECK(!pGraph->IsPassCulled(drawScene));
+	CHECK(pGraph->IsPassCulled(drawUnused));
+	CHECK(pGraph->IsPassCulled(clearBackBuffer));
+	CHECK(!pGraph->IsPassCulled(composite));
+	CHECK(!pGraph->IsPassCulled(overlay));
+	CHECK(!pGraph->IsPassCulled(capture));
+	CHECK(pGraph->GetSchedule() == std::vector<uint32_t>({ drawScene, composite, overlay, capture }));
+
+	// Culled passes take no part in lifetimes
+	uint32_t firstPass, lastPass;
+	pGraph->GetResourceLifetime(scene, firstPass, lastPass);
+	CHECK(firstPass == 0 && lastPass == 1);
+	pGraph->GetResourceLifetime(unused, firstPass, lastPass);
+	CHECK(firstPass == (uint32_t)RenderGraph::NULL_INDEX && lastPass == (uint32_t)RenderGraph::NULL_INDEX);
+	CHECK(pGraph->GetAliasSlot(unused) == (uint32_t)RenderGraph::NULL_INDEX);
+	pGraph->GetResourceLifetime(backBuffer, firstPass, lastPass);
+	CHECK(firstPass == 1 && lastPass == 2);
+	CHECK(pGraph->GetAliasSlot(backBuffer) == (uint32_t)RenderGraph::NULL_INDEX);
+
+	// Without side effect, a pass writing nothing is culled
+	pGraph->SetSideEffect(capture, false);
+	CHECK(!pGraph->IsCompiled());
+	CHECK(pGraph->Compile());
+	CHECK(pGraph->IsPassCulled(capture));
+	CHECK(pGraph->Dump().find("[culled] Capture") != std::string::npos);
+}
+
+TEST(RenderGraphRejectsReadBeforeWrite)
+{
+	std::shared_ptr<RenderGraph> pGraph = RenderGraph::Create();
+	uint32_t transient = pGraph->AddResource(AcquireImageDesc("Transient", true));
+	uint32_t history = pGraph->AddResource(AcquireImageDesc("History", false, true));
+
+	// Non-transient resource carries content from last frame, so it's fine to read first
+	uint32_t pass = pGraph->AddPass("Resolve");
+	pGraph->Read(pass, history);
+	pGraph->Write(pass, history);
+	CHECK(pGraph->Compile());
+
+	pGraph->Read(pass, transient);
+	CHECK(!pGraph->Compile());
+	CHECK(!pGraph->IsCompiled());
+}
+
+// A chain of post processing passes, each one reads previous transient and writes next one
+TEST(RenderGraphBarriersAndAliasing)
+{
+	std::shared_ptr<RenderGraph> pGraph = RenderGraph::Create();
+	uint32_t t0 = pGraph->AddResource(AcquireImageDesc("T0", true));
+	uint32_t t1 = pGraph->AddResource(AcquireImageDesc("T1", true));
+	uint32_t t2 = pGraph->AddResource(AcquireImageDesc("T2", true, false, false, 512));
+	uint32_t depth = pGraph->AddResource(AcquireImageDesc("Depth", true, false, true));
+
+	// Read by last frame, so the first write waits for that read
+	RenderGraph::ResourceDesc outputDesc = AcquireImageDesc("Output", false, true);
+	outputDesc.initialUsage = RenderGraph::ResourceUsageSampled;
+	uint32_t output = pGraph->AddResource(outputDesc);
+
+	uint32_t p0 = pGraph->AddPass("P0");
+	pGraph->Write(p0, t0);
+	pGraph->Write(p0, depth, RenderGraph::ResourceUsageDepthAttachment);
+	uint32_t p1 = pGraph->AddPass("P1");
+	pGraph->Read(p1, t0);
+	pGraph->Read(p1, depth);
+	pGraph->Write(p1, t1);
+	uint32_t p2 = pGraph->AddPass("P2");
+	pGraph->Read(p2, t1);
+	pGraph->Write(p2, t2);
+	uint32_t p3 = pGraph->AddPass("P3");
+	pGraph->Read(p3, t2);
+	pGraph->Read(p3, depth);
+	pGraph->Write(p3, output);
+
+	CHECK(pGraph->Compile());
+	CHECK(pGraph->GetSchedule().size() == 4);
+
+	// T0 is done before T2 starts, so they share memory, T1 overlaps both, depth never shares with color
+	CHECK(pGraph->GetAliasSlotCount() == 3);
+	CHECK(pGraph->GetAliasSlot(t0) == pGraph->GetAliasSlot(t2));
+	CHECK(pGraph->GetAliasSlot(t1) != pGraph->GetAliasSlot(t0));
+	CHECK(pGraph->GetAliasSlot(depth) != pGraph->GetAliasSlot(t0) && pGraph->GetAliasSlot(depth) != pGraph->GetAliasSlot(t1));
+	CHECK(pGraph->GetAliasSlotResources(pGraph->GetAliasSlot(t0)) == std::vector<uint32_t>({ t0, t2 }));
+	CHECK(pGraph->GetAliasSlotSize(pGraph->GetAliasSlot(t0)) == 1024 * 1024 * 4);
+	CHECK(pGraph->GetTransientBytes() == 1024 * 1024 * 4 * 3 + 512 * 512 * 4);
+	CHECK(pGraph->GetAliasedTransientBytes() == 1024 * 1024 * 4 * 3);
+
+	// First use of aliased memory waits for its previous owner and discards content
+	CHECK(HasBarrier(*pGraph, p0, { t0, 0, false, COLOR, true, true }));
+	CHECK(HasBarrier(*pGraph, p2, { t2, SAMPLED, false, COLOR, true, true }));
+	// Read after write
+	CHECK(HasBarrier(*pGraph, p1, { t0, COLOR, true, SAMPLED, false, false }));
+	CHECK(HasBarrier(*pGraph, p1, { depth, DEPTH, true, SAMPLED, false, false }));
+	CHECK(HasBarrier(*pGraph, p2, { t1, COLOR, true, SAMPLED, false, false }));
+	CHECK(HasBarrier(*pGraph, p3, { t2, COLOR, true, SAMPLED, false, false }));
+	// Write after read of last frame
+	CHECK(HasBarrier(*pGraph, p3, { output, SAMPLED, false, COLOR, true, false }));
+	// Depth is already visible to sampling since P1, no barrier for the same read usage again
+	CHECK(!HasBarrier(*pGraph, p3, { depth, DEPTH, true, SAMPLED, false, false }));
+	CHECK(pGraph->GetBarrierCount() == 7);
+}
+
+TEST(RenderGraphWriteAfterWrite)
+{
+	std::shared_ptr<RenderGraph> pGraph = RenderGraph::Create();
+	RenderGraph::ResourceDesc desc = AcquireImageDesc("Target", false, true);
+	desc.initialUsage = RenderGraph::ResourceUsageColorAttachment;
+	desc.initialWrite = true;
+	uint32_t target = pGraph->AddResource(desc);
+
+	uint32_t p0 = pGraph->AddPass("Load");
+	pGraph->Read(p0, target, RenderGraph::ResourceUsageColorAttachment);
+	pGraph->Write(p0, target);
+	uint32_t p1 = pGraph->AddPass("Sample");
+	pGraph->Read(p1, target);
+	uint32_t p2 = pGraph->AddPass("Blend");
+	pGraph->Read(p2, target, RenderGraph::ResourceUsageColorAttachment);
+	pGraph->Write(p2, target);
+	pGraph->SetSideEffect(p1);
+
+	CHECK(pGraph->Compile());
+	// A pass both reading and writing is treated as writing, so it waits for the previous write
+	CHECK(HasBarrier(*pGraph, p0, { target, COLOR, true, COLOR, true, false }));
+	CHECK(HasBarrier(*pGraph, p1, { target, COLOR, true, SAMPLED, false, false }));
+	CHECK(HasBarrier(*pGraph, p2, { target, SAMPLED, false, COLOR, true, false }));
+	CHECK(pGraph->GetBarrierCount() == 3);
+}
+
+// Random graphs: aliased resources never overlap, and every hazard between scheduled passes has a barrier
+TEST(RenderGraphRandomGraphs)
+{
+	std::mt19937 rng(7);
+
+	for (uint32_t graphIndex = 0; graphIndex < 200; graphIndex++)
+	{
+		std::shared_ptr<RenderGraph> pGraph = RenderGraph::Create();
+
+		uint32_t resourceCount = 2 + rng() % 12;
+		for (uint32_t i = 0; i < resourceCount; i++)
+		{
+			bool transient = rng() % 4 != 0;
+			bool output = rng() % 5 == 0;
+			bool depthStencil = rng() % 4 == 0;
+			pGraph->AddResource(AcquireImageDesc("R" + std::to_string(i), transient, output, depthStencil, 64 << (rng() % 4)));
+		}
+
+		// Per pass and resource, declared reads and writes
+		std::vector<std::vector<bool>> reads, writes;
+
+		// Transient resources are only read once written
+		std::vector<bool> written(resourceCount, false);
+		uint32_t passCount = 1 + rng() % 16;
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			uint32_t pass = pGraph->AddPass("P" + std::to_string(i));
+			reads.push_back(std::vector<bool>(resourceCount, false));
+			writes.push_back(std::vector<bool>(resourceCount, false));
+
+			uint32_t readCount = 1 + rng() % 3;
+			for (uint32_t j = 0; j < readCount; j++)
+			{
+				uint32_t resource = rng() % resourceCount;
+				if (pGraph->GetResourceDesc(resource).transient && !written[resource])
+					continue;
+				pGraph->Read(pass, resource);
+				reads[pass][resource] = true;
+			}
+
+			uint32_t resource = rng() % resourceCount;
+			pGraph->Write(pass, resource, pGraph->GetResourceDesc(resource).depthStencil ? RenderGraph::ResourceUsageDepthAttachment : RenderGraph::ResourceUsageColorAttachment);
+			writes[pass][resource] = true;
+			written[resource] = true;
+			if (rng() % 8 == 0)
+				pGraph->SetSideEffect(pass);
+		}
+
+		CHECK(pGraph->Compile());
+
+		for (uint32_t slot = 0; slot < pGraph->GetAliasSlotCount(); slot++)
+		{
+			const std::vector<uint32_t>& resources = pGraph->GetAliasSlotResources(slot);
+			uint32_t previousLastPass = 0;
+			for (uint32_t i = 0; i < (uint32_t)resources.size(); i++)
+			{
+				uint32_t firstPass, lastPass;
+				pGraph->GetResourceLifetime(resources[i], firstPass, lastPass);
+				CHECK(pGraph->GetResourceDesc(resources[i]).transient);
+				CHECK(pGraph->GetResourceDesc(resources[i]).depthStencil == pGraph->GetResourceDesc(resources[0]).depthStencil);
+				CHECK(pGraph->GetResourceDesc(resources[i]).sizeInBytes <= pGraph->GetAliasSlotSize(slot));
+				CHECK(i == 0 || firstPass > previousLastPass);
+				previousLastPass = lastPass;
+			}
+		}
+
+		CHECK(pGraph->GetAliasedTransientBytes() <= pGraph->GetTransientBytes());
+
+		// First access to memory shared with other resources always discards
+		for (uint32_t i = 0; i < resourceCount; i++)
+		{
+			uint32_t slot = pGraph->GetAliasSlot(i);
+			if (slot == (uint32_t)RenderGraph::NULL_INDEX || pGraph->GetAliasSlotResources(slot).size() < 2)
+				continue;
+
+			uint32_t firstPass, lastPass;
+			pGraph->GetResourceLifetime(i, firstPass, lastPass);
+			CHECK(HasResourceBarrier(*pGraph, pGraph->GetSchedule()[firstPass], i, true));
+		}
+
+		// Brute force: a pass accessing a resource written by its previous accessor, or writing one accessed before, waits for it
+		const std::vector<uint32_t>& schedule = pGraph->GetSchedule();
+		for (uint32_t i = 0; i < resourceCount; i++)
+		{
+			bool accessed = false, lastWrite = false;
+			for (uint32_t passIndex : schedule)
+			{
+				if (!reads[passIndex][i] && !writes[passIndex][i])
+					continue;
+
+				if (accessed && (lastWrite || writes[passIndex][i]))
+					CHECK(HasResourceBarrier(*pGraph, passIndex, i, false));
+
+				accessed = true;
+				lastWrite = writes[passIndex][i];
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "TestFramework.h"
+#include "../Maths/SIMDCull.h"
+#include <cmath>
+
+static const double PLANET_RADIUS = 6360000.0;
+static const uint32_t PATCH_LEVEL = 5;
+static const uint32_t CAMERA_PATH_FRAMES = 120;
+
+// Quad cull decisions of PlanetGenerator before SIMD kernels, kept verbatim as ground truth
+static FrustumTestResult LegacyFrustumCull(const PyramidFrustumd& frustum, const Vector3d& p0, const Vector3d& p1, const Vector3d& p2, const Vector3d& p3, double height)
+{
+	FrustumTestResult state = FrustumTestInside;
+	for (uint32_t i = 0; i < frustum.FrustumFace_COUNT; i++)
+	{
+		uint32_t outsideCount = 0;
+		outsideCount += frustum.planes[i].PlaneTest(p0) > 0 ? 0 : 1;
+		outsideCount += frustum.planes[i].PlaneTest(p1) > 0 ? 0 : 1;
+		outsideCount += frustum.planes[i].PlaneTest(p2) > 0 ? 0 : 1;
+		outsideCount += frustum.planes[i].PlaneTest(p3) > 0 ? 0 : 1;
+
+		if (outsideCount == 4)
+		{
+			outsideCount += frustum.planes[i].PlaneTest(p0 * height) > 0 ? 0 : 1;
+			outsideCount += frustum.planes[i].PlaneTest(p1 * height) > 0 ? 0 : 1;
+			outsideCount += frustum.planes[i].PlaneTest(p2 * height) > 0 ? 0 : 1;
+			outsideCount += frustum.planes[i].PlaneTest(p3 * height) > 0 ? 0 : 1;
+
+			if (outsideCount == 8)
+				return FrustumTestOutside;
+			else
+				state = FrustumTestIntersect;
+		}
+		else if (outsideCount > 0)
+			state = FrustumTestIntersect;
+	}
+
+	return state;
+}
+
+static bool LegacyBackFaceCull(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, const Vector3d& cameraPosition)
+{
+	Vector3d normal = c;
+	Vector3d cameraToVertex = a;
+	normal -= b;
+	cameraToVertex -= b;
+	normal = normal ^ cameraToVertex;
+
+	cameraToVertex = a;
+	cameraToVertex -= cameraPosition;
+
+	if (normal * cameraToVertex < 0.0)
+		return false;
+
+	Vector3d cameraToA = a;
+	Vector3d cameraToB = b;
+	Vector3d cameraToC = c;
+
+	cameraToA -= cameraPosition;
+	cameraToB -= cameraPosition;
+	cameraToC -= cameraPosition;
+
+	if (a * cameraToA < 0.0
+		|| b * cameraToB < 0.0
+		|| c * cameraToC < 0.0)
+		return false;
+
+	normal = d;
+	cameraToVertex = c;
+	normal -= b;
+	cameraToVertex -= b;
+	normal = normal ^ cameraToVertex;
+
+	cameraToVertex = d;
+	cameraToVertex -= cameraPosition;
+
+	if (normal * cameraToVertex < 0.0)
+		return false;
+
+	Vector3d cameraToD = d;
+	cameraToD -= cameraPosition;
+
+	if (d * cameraToD < 0.0)
+		return false;
+
+	return true;
+}
+
+// Patch corners on sphere, arranged as HorizonCullPatch expects
+typedef struct _Patch
+{
+	Vector3d corners[4];
+}Patch;
+
+// Cube faces subdivided evenly and projected onto sphere, triangles abc and cbd face outwards
+static std::vector<Patch> BuildPatches()
+{
+	const Vector3d faces[6][3] =
+	{
+		{ {  1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { 0,  1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+		{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, 0,  1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+		{ { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+	};
+
+	uint32_t resolution = 1 << PATCH_LEVEL;
+	auto acquireCorner = [&](uint32_t face, uint32_t u, uint32_t v)
+	{
+		Vector3d p = faces[face][0] + faces[face][1] * (2.0 * u / resolution - 1.0) + faces[face][2] * (2.0 * v / resolution - 1.0);
+		p.Normalize();
+		return p * PLANET_RADIUS;
+	};
+
+	std::vector<Patch> patches;
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		for (uint32_t v = 0; v < resolution; v++)
+		{
+			for (uint32_t u = 0; u < resolution; u++)
+			{
+				Patch patch;
+				patch.corners[0] = acquireCorner(face, u, v);
+				patch.corners[1] = acquireCorner(face, u + 1, v);
+				patch.corners[2] = acquireCorner(face, u, v + 1);
+				patch.corners[3] = acquireCorner(face, u + 1, v + 1);
+				patches.push_back(patch);
+			}
+		}
+	}
+	return patches;
+}
+
+typedef struct _CameraFrame
+{
+	Vector3d		position;
+	PyramidFrustumd	frustum;
+}CameraFrame;
+
+// Camera flies in from orbit down to ground level while circling planet, looking down at first and towards horizon in the end
+static std::vector<CameraFrame> RecordCameraPath()
+{
+	std::vector<CameraFrame> frames;
+	for (uint32_t i = 0; i < CAMERA_PATH_FRAMES; i++)
+	{
+		double t = i / (double)(CAMERA_PATH_FRAMES - 1);
+		double altitude = PLANET_RADIUS * 2.0 * std::pow(1.0 - t, 3.0) + 2.0;
+		double angle = t * 2.5;
+
+		Vector3d up(std::cos(angle), 0.3 * std::sin(angle * 3.0), std::sin(angle));
+		up.Normalize();
+		Vector3d tangent = up ^ Vector3d(0, 1, 0);
+		tangent.Normalize();
+
+		CameraFrame frame;
+		frame.position = up * (PLANET_RADIUS + altitude);
+		Vector3d lookAt = up * -(1.0 - t) + tangent * (t + 0.05);
+		lookAt.Normalize();
+		// Frustum is built at origin and moved to camera, just like camera component does
+		frame.frustum = PyramidFrustumd(Vector3d(), lookAt, 0.5, 16.0 / 9.0);
+		frame.frustum.Transform(Matrix4d(Matrix3d(), frame.position));
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+TEST(SIMDCullMatchesLegacyOnCameraPath)
+{
+	std::vector<Patch> patches = BuildPatches();
+	std::vector<CameraFrame> frames = RecordCameraPath();
+
+	const double heights[] = { 1.0, 1.0005, 1.02 };
+	uint32_t resultCounts[FrustumTestResultCount] = {};
+	uint32_t horizonCulledCount = 0;
+
+	for (auto& frame : frames)
+	{
+		for (auto& patch : patches)
+		{
+			const Vector3d* p = patch.corners;
+			for (double height : heights)
+			{
+				FrustumTestResult result = LegacyFrustumCull(frame.frustum, p[0], p[1], p[2], p[3], height);
+				CHECK(FrustumTestPatch(frame.frustum, p, height) == result);
+				CHECK(FrustumTestPatchScalar(frame.frustum, p, height) == result);
+				resultCounts[result]++;
+			}
+
+			bool culled = LegacyBackFaceCull(p[0], p[1], p[2], p[3], frame.position);
+			CHECK(HorizonCullPatch(p[0], p[1], p[2], p[3], frame.position) == culled);
+			CHECK(HorizonCullPatchScalar(p[0], p[1], p[2], p[3], frame.position) == culled);
+			horizonCulledCount += culled ? 1 : 0;
+		}
+	}
+
+	// Path has to exercise every decision
+	CHECK(resultCounts[FrustumTestInside] > 0 && resultCounts[FrustumTestIntersect] > 0 && resultCounts[FrustumTestOutside] > 0);
+	CHECK(horizonCulledCount > 0 && horizonCulledCount < frames.size() * patches.size());
+}
+
+TEST(SIMDCullBoxesMatchScalar)
+{
+	std::vector<Patch> patches = BuildPatches();
+	std::vector<CameraFrame> frames = RecordCameraPath();
+
+	// Bounds of patches, odd count so that remainder path is covered
+	std::vector<double> boxData[6];
+	for (uint32_t i = 0; i < (uint32_t)patches.size() - 1; i++)
+	{
+		Vector3d minCorner = patches[i].corners[0], maxCorner = patches[i].corners[0];
+		for (uint32_t j = 1; j < 4; j++)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				minCorner[k] = patches[i].corners[j][k] < minCorner[k] ? patches[i].corners[j][k] : minCorner[k];
+				maxCorner[k] = patches[i].corners[j][k] > maxCorner[k] ? patches[i].corners[j][k] : maxCorner[k];
+			}
+		}
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			boxData[k].push_back((minCorner[k] + maxCorner[k]) * 0.5);
+			boxData[k + 3].push_back((maxCorner[k] - minCorner[k]) * 0.5);
+		}
+	}
+	BoxStream boxes = { boxData[0].data(), boxData[1].data(), boxData[2].data(), boxData[3].data(), boxData[4].data(), boxData[5].data() };
+	uint32_t boxCount = (uint32_t)boxData[0].size();
+
+	std::vector<uint8_t> visible(boxCount), expected(boxCount);
+	for (auto& frame : frames)
+	{
+		FrustumTestBoxes(frame.frustum.planes, PyramidFrustumd::FrustumFace_COUNT, boxes, 1, boxCount, visible.data());
+		FrustumTestBoxesScalar(frame.frustum.planes, PyramidFrustumd::FrustumFace_COUNT, boxes, 1, boxCount, expected.data());
+		for (uint32_t i = 1; i < boxCount; i++)
+			CHECK(visible[i] == expected[i]);
+	}
+}
+
+// Frustum and horizon decisions of every patch over the camera path, legacy scalar code against kernels
+BENCHMARK(SIMDCullCameraPath)
+{
+	std::vector<Patch> patches = BuildPatches();
+	std::vector<CameraFrame> frames = RecordCameraPath();
+	const double height = 1.0005;
+
+	uint32_t legacyCulledCount = 0;
+	double legacyMilliseconds = MeasureMilliseconds([&]()
+	{
+		legacyCulledCount = 0;
+		for (auto& frame : frames)
+		{
+			for (auto& patch : patches)
+			{
+				const Vector3d* p = patch.corners;
+				if (LegacyFrustumCull(frame.frustum, p[0], p[1], p[2], p[3], height) == FrustumTestOutside || LegacyBackFaceCull(p[0], p[1], p[2], p[3], frame.position))
+					legacyCulledCount++;
+			}
+		}
+	});
+
+	uint32_t culledCount = 0;
+	double milliseconds = MeasureMilliseconds([&]()
+	{
+		culledCount = 0;
+		for (auto& frame : frames)
+		{
+			for (auto& patch : patches)
+			{
+				const Vector3d* p = patch.corners;
+				if (FrustumTestPatch(frame.frustum, p, height) == FrustumTestOutside || HorizonCullPatch(p[0], p[1], p[2], p[3], frame.position))
+					culledCount++;
+			}
+		}
+	});
+
+	uint32_t testCount = (uint32_t)(frames.size() * patches.size());
+	std::cout << "    " << patches.size() << " patches, " << frames.size() << " frames, " << culledCount * 100.0 / testCount << "% culled" << std::endl;
+	std::cout << "    legacy: " << legacyMilliseconds * 1000000.0 / testCount << " ns per patch" << std::endl;
+	std::cout << "    kernels: " << milliseconds * 1000000.0 / testCount << " ns per patch, speedup " << legacyMilliseconds / milliseconds << std::endl;
+
+	CHECK(culledCount == legacyCulledCount);
+}
\ No newline at end of file
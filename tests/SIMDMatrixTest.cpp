@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+#include "../Maths/SIMDMatrix.h"
+#include <random>
+#include <thread>
+#include <cmath>
+
+static Matrix4d AcquireRandomMatrix(std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> dist(-100.0, 100.0);
+	Matrix4d m;
+	double* pData = &m.c00;
+	for (uint32_t i = 0; i < 16; i++)
+		pData[i] = dist(rng);
+	return m;
+}
+
+static bool IsEqual(const Matrix4d& a, const Matrix4d& b)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if ((&a.c00)[i] != (&b.c00)[i])
+			return false;
+	}
+	return true;
+}
+
+static bool IsEqual(const Matrix4f& a, const Matrix4f& b)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if ((&a.c00)[i] != (&b.c00)[i])
+			return false;
+	}
+	return true;
+}
+
+TEST(SIMDMatrixMatchesScalar)
+{
+	std::mt19937 rng(5);
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		Matrix4d a = AcquireRandomMatrix(rng);
+		Matrix4d b = AcquireRandomMatrix(rng);
+
+		Matrix4d simd, scalar;
+		MultiplyMatrix4x4(a, b, simd);
+		MultiplyMatrix4x4Scalar(a, b, scalar);
+		CHECK(IsEqual(simd, scalar));
+		CHECK(IsEqual(simd, a * b));
+
+		Matrix4f simdSingle, scalarSingle;
+		ConvertMatrix4x4(simd, simdSingle);
+		ConvertMatrix4x4Scalar(simd, scalarSingle);
+		CHECK(IsEqual(simdSingle, scalarSingle));
+	}
+}
+
+TEST(SIMDMatrixAliasing)
+{
+	std::mt19937 rng(9);
+	Matrix4d a = AcquireRandomMatrix(rng);
+	Matrix4d b = AcquireRandomMatrix(rng);
+	Matrix4d expected = a * b;
+
+	Matrix4d out = a;
+	MultiplyMatrix4x4(out, b, out);
+	CHECK(IsEqual(out, expected));
+
+	out = b;
+	MultiplyMatrix4x4(a, out, out);
+	CHECK(IsEqual(out, expected));
+
+	out = a;
+	MultiplyMatrix4x4(out, out, out);
+	CHECK(IsEqual(out, a * a));
+}
+
+// Same work as PerObjectUniforms::UpdatePerObjectVariables
+typedef struct _ObjectMatrices
+{
+	Matrix4d MV;
+	Matrix4d MVP;
+	Matrix4d MV_Rotation_P;
+	Matrix4f singleMV;
+	Matrix4f singleMVP;
+	Matrix4f singleMV_Rotation_P;
+}ObjectMatrices;
+
+template <bool useSIMD>
+static void UpdateObjectMatrices(const Matrix4d& projection, ObjectMatrices& object)
+{
+	Matrix4d temp = object.MV;
+	temp.c30 = temp.c31 = temp.c32 = 0;
+
+	if (useSIMD)
+	{
+		MultiplyMatrix4x4(projection, object.MV, object.MVP);
+		MultiplyMatrix4x4(projection, temp, object.MV_Rotation_P);
+		ConvertMatrix4x4(object.MV, object.singleMV);
+		ConvertMatrix4x4(object.MVP, object.singleMVP);
+		ConvertMatrix4x4(object.MV_Rotation_P, object.singleMV_Rotation_P);
+	}
+	else
+	{
+		MultiplyMatrix4x4Scalar(projection, object.MV, object.MVP);
+		MultiplyMatrix4x4Scalar(projection, temp, object.MV_Rotation_P);
+		ConvertMatrix4x4Scalar(object.MV, object.singleMV);
+		ConvertMatrix4x4Scalar(object.MVP, object.singleMVP);
+		ConvertMatrix4x4Scalar(object.MV_Rotation_P, object.singleMV_Rotation_P);
+	}
+}
+
+// Per object matrices of a large scene, scalar against SIMD kernels, then SIMD split across threads like dirty chunks are
+BENCHMARK(SIMDMatrixPerObjectUpdate)
+{
+	const uint32_t objectCount = 20000;
+
+	std::mt19937 rng(13);
+	Matrix4d projection = AcquireRandomMatrix(rng);
+	std::vector<ObjectMatrices> objects(objectCount);
+	for (auto& object : objects)
+		object.MV = AcquireRandomMatrix(rng);
+
+	double scalarMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (auto& object : objects)
+			UpdateObjectMatrices<false>(projection, object);
+	});
+	Matrix4d scalarMVP = objects.back().MVP;
+
+	double simdMilliseconds = MeasureMilliseconds([&]()
+	{
+		for (auto& object : objects)
+			UpdateObjectMatrices<true>(projection, object);
+	});
+	CHECK(IsEqual(scalarMVP, objects.back().MVP));
+
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	threadCount = threadCount > 0 ? threadCount : 1;
+	double parallelMilliseconds = MeasureMilliseconds([&]()
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < threadCount; t++)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				for (uint32_t i = objectCount * t / threadCount; i < objectCount * (t + 1) / threadCount; i++)
+					UpdateObjectMatrices<true>(projection, objects[i]);
+			}));
+		}
+		for (auto& thread : threads)
+			thread.join();
+	});
+
+	std::cout << "    " << objectCount << " objects" << std::endl;
+	std::cout << "    scalar: " << scalarMilliseconds << " ms" << std::endl;
+	std::cout << "    SIMD: " << simdMilliseconds << " ms, speedup " << scalarMilliseconds / simdMilliseconds << std::endl;
+	std::cout << "    SIMD, " << threadCount << " threads: " << parallelMilliseconds << " ms, speedup " << scalarMilliseconds / parallelMilliseconds << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "TestFramework.h"
+#include "ThreadParallelRange.h"
+#include "../Base/SceneBVH.h"
+#include "../Maths/PyramidFrustum.h"
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <cmath>
+
+// Exposes tree structure for validation
+class TestSceneBVH : public SceneBVH
+{
+public:
+	// Every node box contains its children, leaves match their objects, and each object in tree is reached exactly once
+	bool Validate() const
+	{
+		if (m_root == NULL_INDEX)
+			return m_leafCount == 0;
+
+		std::vector<uint32_t> reachedCounts(m_objectLeaves.size(), 0);
+		std::vector<uint32_t> stack = { m_root };
+		uint32_t leafCount = 0;
+		while (!stack.empty())
+		{
+			uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+			const BVHNode& node = m_nodes[nodeIndex];
+
+			if (IsLeaf(nodeIndex))
+			{
+				if (node.objectIndex >= (uint32_t)m_objectLeaves.size() || m_objectLeaves[node.objectIndex] != nodeIndex)
+					return false;
+				if (node.boxMin != m_objectBoxMin[node.objectIndex] || node.boxMax != m_objectBoxMax[node.objectIndex])
+					return false;
+				reachedCounts[node.objectIndex]++;
+				leafCount++;
+				continue;
+			}
+
+			for (uint32_t child : { node.left, node.right })
+			{
+				if (m_nodes[child].parent != nodeIndex)
+					return false;
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					if (m_nodes[child].boxMin[i] < node.boxMin[i] || m_nodes[child].boxMax[i] > node.boxMax[i])
+						return false;
+				}
+				stack.push_back(child);
+			}
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_objectLeaves.size(); i++)
+		{
+			if (reachedCounts[i] != (Contain(i) ? 1u : 0u))
+				return false;
+		}
+		return leafCount == m_leafCount;
+	}
+};
+
+// World boxes in the same layout VisibilityCuller keeps them
+typedef struct _TestScene
+{
+	std::vector<double>		boxData[6];
+	std::vector<uint8_t>	valid;
+
+	BoxStream AcquireBoxStream() const { return { boxData[0].data(), boxData[1].data(), boxData[2].data(), boxData[3].data(), boxData[4].data(), boxData[5].data() }; }
+	uint32_t GetObjectCount() const { return (uint32_t)valid.size(); }
+	Vector3d AcquireBoxMin(uint32_t i) const { return Vector3d(boxData[0][i], boxData[1][i], boxData[2][i]) - Vector3d(boxData[3][i], boxData[4][i], boxData[5][i]); }
+	Vector3d AcquireBoxMax(uint32_t i) const { return Vector3d(boxData[0][i], boxData[1][i], boxData[2][i]) + Vector3d(boxData[3][i], boxData[4][i], boxData[5][i]); }
+}TestScene;
+
+static const double WORLD_SIZE = 10000.0;
+
+static void BuildScene(TestScene& scene, uint32_t objectCount, double validRatio, std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> positionDist(-WORLD_SIZE * 0.5, WORLD_SIZE * 0.5);
+	std::uniform_real_distribution<double> extentDist(0.5, 5.0);
+	std::uniform_real_distribution<double> unitDist(0.0, 1.0);
+
+	for (uint32_t i = 0; i < 6; i++)
+		scene.boxData[i].resize(objectCount);
+	scene.valid.resize(objectCount);
+
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			scene.boxData[k][i] = positionDist(rng);
+			scene.boxData[k + 3][i] = extentDist(rng);
+		}
+		scene.valid[i] = unitDist(rng) < validRatio ? 1 : 0;
+	}
+}
+
+static void MoveObjects(TestScene& scene, double moveRatio, double distance, std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> stepDist(-distance, distance);
+	std::uniform_real_distribution<double> unitDist(0.0, 1.0);
+	for (uint32_t i = 0; i < scene.GetObjectCount(); i++)
+	{
+		if (unitDist(rng) >= moveRatio)
+			continue;
+		for (uint32_t k = 0; k < 3; k++)
+			scene.boxData[k][i] += stepDist(rng);
+	}
+}
+
+// Side planes of a camera frustum, plus near and far planes
+static std::vector<Planed> AcquireFrustumPlanes(const Vector3d& position, const Vector3d& lookAt, double fovv, double farDistance)
+{
+	PyramidFrustumd frustum(Vector3d(), lookAt, fovv, 16.0 / 9.0);
+	frustum.Transform(Matrix4d(Matrix3d(), position));
+
+	std::vector<Planed> planes(frustum.planes, frustum.planes + PyramidFrustumd::FrustumFace_COUNT);
+	planes.push_back(Planed(lookAt, position + lookAt * 1.0));
+	planes.push_back(Planed(lookAt * -1.0, position + lookAt * farDistance));
+	return planes;
+}
+
+static std::vector<Planed> AcquireRandomFrustumPlanes(std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> positionDist(-WORLD_SIZE * 0.5, WORLD_SIZE * 0.5);
+	std::uniform_real_distribution<double> directionDist(-1.0, 1.0);
+	Vector3d lookAt(directionDist(rng), directionDist(rng) * 0.3, directionDist(rng));
+	lookAt.Normalize();
+	return AcquireFrustumPlanes(Vector3d(positionDist(rng), 0, positionDist(rng)), lookAt, 0.8, 2000.0 + WORLD_SIZE * 0.2 * directionDist(rng));
+}
+
+// Brute force references, box tests use the same arithmetic as tree, so results are expected to be exactly the same
+static bool IsBoxInFrustum(const Vector3d& boxMin, const Vector3d& boxMax, const std::vector<Planed>& planes)
+{
+	Vector3d center = (boxMin + boxMax) * 0.5;
+	Vector3d extent = (boxMax - boxMin) * 0.5;
+	for (auto& plane : planes)
+	{
+		double t = plane.normal.x * center.x + plane.normal.y * center.y + plane.normal.z * center.z - plane.D;
+		double r = std::fabs(plane.normal.x) * extent.x + std::fabs(plane.normal.y) * extent.y + std::fabs(plane.normal.z) * extent.z;
+		if (t + r < 0.0)
+			return false;
+	}
+	return true;
+}
+
+static bool IsBoxInSphere(const Vector3d& boxMin, const Vector3d& boxMax, const Vector3d& center, double radius)
+{
+	double distance = 0.0;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		double d = center[i] < boxMin[i] ? boxMin[i] - center[i] : (center[i] > boxMax[i] ? center[i] - boxMax[i] : 0.0);
+		distance += d * d;
+	}
+	return distance <= radius * radius;
+}
+
+static bool IsBoxOnRay(const Vector3d& boxMin, const Vector3d& boxMax, const Vector3d& origin, const Vector3d& direction, double maxDistance)
+{
+	Vector3d inverseDirection = { 1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z };
+	double tNear = 0.0;
+	double tFar = maxDistance;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		double t0 = (boxMin[i] - origin[i]) * inverseDirection[i];
+		double t1 = (boxMax[i] - origin[i]) * inverseDirection[i];
+		tNear = std::fmax(tNear, std::fmin(t0, t1));
+		tFar = std::fmin(tFar, std::fmax(t0, t1));
+	}
+	return tNear <= tFar;
+}
+
+template <typename Func>
+static std::vector<uint32_t> AcquireBruteForce(const TestScene& scene, Func isIntersected)
+{
+	std::vector<uint32_t> objectIndices;
+	for (uint32_t i = 0; i < scene.GetObjectCount(); i++)
+	{
+		if (scene.valid[i] && isIntersected(scene.AcquireBoxMin(i), scene.AcquireBoxMax(i)))
+			objectIndices.push_back(i);
+	}
+	return objectIndices;
+}
+
+static bool MatchesBruteForce(const TestSceneBVH& bvh, const TestScene& scene, std::mt19937& rng, const ParallelRangeFunc& parallelFor)
+{
+	std::uniform_real_distribution<double> positionDist(-WORLD_SIZE * 0.5, WORLD_SIZE * 0.5);
+	std::uniform_real_distribution<double> directionDist(-1.0, 1.0);
+	uint32_t objectCount = scene.GetObjectCount();
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		std::vector<Planed> planes = AcquireRandomFrustumPlanes(rng);
+		std::vector<uint32_t> expected = AcquireBruteForce(scene, [&](const Vector3d& boxMin, const Vector3d& boxMax) { return IsBoxInFrustum(boxMin, boxMax, planes); });
+
+		std::vector<uint32_t> objectIndices;
+		bvh.QueryFrustum(planes.data(), (uint32_t)planes.size(), objectIndices);
+		std::sort(objectIndices.begin(), objectIndices.end());
+		if (objectIndices != expected)
+			return false;
+
+		// Culling writes flags of every object, serial and parallel alike
+		for (uint32_t j = 0; j < 2; j++)
+		{
+			std::vector<uint8_t> visible(objectCount, 0xcd);
+			bvh.CullFrustum(planes.data(), (uint32_t)planes.size(), visible.data(), objectCount, j == 0 ? nullptr : parallelFor);
+			std::vector<uint32_t> visibleIndices;
+			for (uint32_t k = 0; k < objectCount; k++)
+			{
+				if (visible[k] > 1)
+					return false;
+				if (visible[k])
+					visibleIndices.push_back(k);
+			}
+			if (visibleIndices != expected)
+				return false;
+		}
+
+		Vector3d center(positionDist(rng), positionDist(rng) * 0.1, positionDist(rng));
+		double radius = 50.0 + 500.0 * (directionDist(rng) + 1.0);
+		expected = AcquireBruteForce(scene, [&](const Vector3d& boxMin, const Vector3d& boxMax) { return IsBoxInSphere(boxMin, boxMax, center, radius); });
+		objectIndices.clear();
+		bvh.QuerySphere(center, radius, objectIndices);
+		std::sort(objectIndices.begin(), objectIndices.end());
+		if (objectIndices != expected)
+			return false;
+
+		// Axis aligned rays have zero components
+		Vector3d direction = i == 0 ? Vector3d(1, 0, 0) : Vector3d(directionDist(rng), directionDist(rng) * 0.001, directionDist(rng));
+		Vector3d origin(positionDist(rng), positionDist(rng) * 0.001, positionDist(rng));
+		expected = AcquireBruteForce(scene, [&](const Vector3d& boxMin, const Vector3d& boxMax) { return IsBoxOnRay(boxMin, boxMax, origin, direction, WORLD_SIZE); });
+		objectIndices.clear();
+		bvh.QueryRay(origin, direction, WORLD_SIZE, objectIndices);
+		std::sort(objectIndices.begin(), objectIndices.end());
+		if (objectIndices != expected)
+			return false;
+	}
+	return true;
+}
+
+TEST(SceneBVHMatchesBruteForce)
+{
+	std::mt19937 rng(23);
+	std::shared_ptr<TestSceneBVH> pBVH = std::make_shared<TestSceneBVH>();
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(4);
+
+	// Empty tree answers nothing
+	TestScene scene;
+	BuildScene(scene, 0, 0.0, rng);
+	pBVH->Update(scene.AcquireBoxStream(), scene.valid.data(), 0);
+	CHECK(pBVH->Validate());
+	CHECK(MatchesBruteForce(*pBVH, scene, rng, parallelFor));
+
+	BuildScene(scene, 20000, 0.5, rng);
+	std::uniform_real_distribution<double> unitDist(0.0, 1.0);
+	for (uint32_t frame = 0; frame < 40; frame++)
+	{
+		// Mostly small moves with a few objects appearing and disappearing, a mass change now and then forces a rebuild
+		MoveObjects(scene, 0.05, frame % 8 == 0 ? 1000.0 : 10.0, rng);
+		double toggleRatio = frame % 13 == 5 ? 0.5 : 0.002;
+		for (uint32_t i = 0; i < scene.GetObjectCount(); i++)
+		{
+			if (unitDist(rng) < toggleRatio)
+				scene.valid[i] = !scene.valid[i];
+		}
+
+		// Objects beyond box stream are gone, and come back later
+		uint32_t objectCount = frame >= 20 && frame < 30 ? 15000 : scene.GetObjectCount();
+		TestScene visibleScene = scene;
+		visibleScene.valid.resize(objectCount);
+
+		uint32_t rebuildCount = pBVH->GetRebuildCount();
+		pBVH->Update(scene.AcquireBoxStream(), scene.valid.data(), objectCount);
+		CHECK(toggleRatio < 0.1 || pBVH->GetRebuildCount() > rebuildCount);
+		CHECK(pBVH->Validate());
+
+		uint32_t validCount = 0;
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			CHECK(pBVH->Contain(i) == (scene.valid[i] != 0));
+			validCount += scene.valid[i];
+		}
+		CHECK(pBVH->GetLeafCount() == validCount);
+		CHECK(pBVH->GetNodeCount() == validCount * 2 - 1);
+		// Cost check keeps tree within its bound of a fresh build, with slack for changes since last check
+		CHECK(pBVH->AcquireSAHCost() > 0.0);
+
+		CHECK(MatchesBruteForce(*pBVH, visibleScene, rng, parallelFor));
+	}
+
+	// Incremental calls work the same as stream updates
+	std::shared_ptr<TestSceneBVH> pIncremental = std::make_shared<TestSceneBVH>();
+	for (uint32_t i = 0; i < scene.GetObjectCount(); i++)
+	{
+		if (scene.valid[i])
+			pIncremental->Insert(i, scene.AcquireBoxMin(i), scene.AcquireBoxMax(i));
+	}
+	CHECK(pIncremental->Validate());
+	CHECK(MatchesBruteForce(*pIncremental, scene, rng, parallelFor));
+
+	MoveObjects(scene, 0.2, 100.0, rng);
+	for (uint32_t i = 0; i < scene.GetObjectCount(); i++)
+	{
+		if (!scene.valid[i])
+			continue;
+		if (i % 10 == 0)
+		{
+			pIncremental->Remove(i);
+			scene.valid[i] = 0;
+		}
+		else
+			pIncremental->Move(i, scene.AcquireBoxMin(i), scene.AcquireBoxMax(i));
+	}
+	pIncremental->Refit();
+	CHECK(pIncremental->Validate());
+	CHECK(MatchesBruteForce(*pIncremental, scene, rng, parallelFor));
+
+	double refittedCost = pIncremental->AcquireSAHCost();
+	pIncremental->Rebuild();
+	CHECK(pIncremental->Validate());
+	CHECK(pIncremental->AcquireSAHCost() <= refittedCost);
+	CHECK(MatchesBruteForce(*pIncremental, scene, rng, parallelFor));
+}
+
+// Build from scratch, update with 10% of objects moving a little, culling of a camera frustum against testing every box, and sphere queries
+BENCHMARK(SceneBVHScaling)
+{
+	const uint32_t objectCounts[] = { 10000, 100000, 1000000 };
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(threadCount);
+	std::cout << "    " << threadCount << " threads" << std::endl;
+
+	for (uint32_t objectCount : objectCounts)
+	{
+		std::mt19937 rng(29);
+		TestScene scene;
+		BuildScene(scene, objectCount, 1.0, rng);
+		BoxStream boxes = scene.AcquireBoxStream();
+		uint32_t repeats = objectCount >= 1000000 ? 1 : 5;
+
+		std::shared_ptr<SceneBVH> pBVH;
+		double build = MeasureMilliseconds([&]()
+		{
+			pBVH = std::make_shared<SceneBVH>();
+			pBVH->Update(boxes, scene.valid.data(), objectCount);
+		}, repeats);
+
+		// Each update moves objects again, so that every measured update has work to do
+		double update = MeasureMilliseconds([&]()
+		{
+			MoveObjects(scene, 0.1, 2.0, rng);
+			pBVH->Update(boxes, scene.valid.data(), objectCount);
+		}, repeats);
+
+		std::vector<Planed> planes = AcquireFrustumPlanes(Vector3d(0, 0, 0), Vector3d(0.6, -0.1, 0.8).Normalize(), 0.8, 3000.0);
+		std::vector<uint8_t> visible(objectCount), expected(objectCount);
+
+		double cullSerial = MeasureMilliseconds([&]() { pBVH->CullFrustum(planes.data(), (uint32_t)planes.size(), visible.data(), objectCount); }, repeats);
+		double cullParallel = MeasureMilliseconds([&]() { pBVH->CullFrustum(planes.data(), (uint32_t)planes.size(), visible.data(), objectCount, parallelFor); }, repeats);
+		double linear = MeasureMilliseconds([&]() { FrustumTestBoxes(planes.data(), (uint32_t)planes.size(), boxes, 0, objectCount, expected.data()); }, repeats);
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			CHECK(visible[i] == expected[i]);
+			visibleCount += visible[i];
+		}
+
+		// Proximity queries, like gathering lights or colliders around a point
+		std::vector<uint32_t> objectIndices;
+		double sphereQuery = MeasureMilliseconds([&]()
+		{
+			objectIndices.clear();
+			for (uint32_t i = 0; i < 100; i++)
+				pBVH->QuerySphere(Vector3d(scene.boxData[0][i], scene.boxData[1][i], scene.boxData[2][i]), 100.0, objectIndices);
+		}, repeats);
+		CHECK(objectIndices.size() >= 100);
+
+		std::cout << "    " << objectCount << " objects, " << visibleCount << " visible, SAH cost " << pBVH->AcquireSAHCost() << std::endl;
+		std::cout << "      build " << build << " ms, update " << update << " ms" << std::endl;
+		std::cout << "      cull serial " << cullSerial << " ms, parallel " << cullParallel << " ms, linear box test " << linear << " ms" << std::endl;
+		std::cout << "      100 sphere queries " << sphereQuery << " ms, " << objectIndices.size() << " hits" << std::endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "TestFramework.h"
+#include "../common/BufferRangeTable.h"
+#include <map>
+#include <random>
+#include <algorithm>
+
+// Same sizes as shared vertex and index buffers of GlobalDeviceObjects
+static const uint32_t VERTEX_BUFFER_BYTES = 1024 * 1024 * 64;
+static const uint32_t INDEX_BUFFER_BYTES = 1024 * 1024 * 4;
+static const uint32_t NULL_KEY = 0xffffffff;
+
+typedef struct _BufferRange
+{
+	uint32_t offset;
+	uint32_t range;
+}BufferRange;
+
+// Bookkeeping of SharedBufferManager before TLSF: chunks sorted by offset, first fit by linear scan,
+// and a key to chunk index map that's shifted on every insert and erase
+class LinearBufferTable
+{
+public:
+	LinearBufferTable(uint32_t totalBytes) : m_totalBytes(totalBytes) {}
+
+	uint32_t Allocate(uint32_t numBytes)
+	{
+		BufferRange info = { 0, numBytes };
+		uint32_t offset = 0;
+
+		for (uint32_t i = 0; i < m_bufferTable.size(); i++)
+		{
+			uint32_t endByte = offset + numBytes - 1;
+			if (endByte < m_bufferTable[i].offset)
+			{
+				for (auto& value : m_lookupTable)
+				{
+					if (value.second >= i)
+						value.second++;
+				}
+
+				info.offset = offset;
+				m_bufferTable.insert(m_bufferTable.begin() + i, info);
+				m_lookupTable[m_numAllocatedKeys] = i;
+				return m_numAllocatedKeys++;
+			}
+			else
+				offset = m_bufferTable[i].offset + m_bufferTable[i].range;
+		}
+
+		if (offset + numBytes > m_totalBytes)
+			return NULL_KEY;
+
+		info.offset = offset;
+		m_bufferTable.push_back(info);
+		m_lookupTable[m_numAllocatedKeys] = (uint32_t)m_bufferTable.size() - 1;
+		return m_numAllocatedKeys++;
+	}
+
+	void Free(uint32_t key)
+	{
+		uint32_t bufferChunkIndex = m_lookupTable[key];
+		m_lookupTable.erase(key);
+		m_bufferTable.erase(m_bufferTable.begin() + bufferChunkIndex);
+
+		for (auto& value : m_lookupTable)
+		{
+			if (value.second > bufferChunkIndex)
+				value.second--;
+		}
+	}
+
+	uint32_t GetOffset(uint32_t key) { return m_bufferTable[m_lookupTable[key]].offset; }
+
+private:
+	uint32_t					m_totalBytes;
+	std::vector<BufferRange>	m_bufferTable;
+	std::map<uint32_t, uint32_t>	m_lookupTable;
+	uint32_t					m_numAllocatedKeys = 0;
+};
+
+typedef struct _MeshBuffers
+{
+	uint32_t vertexBytes;
+	uint32_t indexBytes;
+	uint32_t vertexKey;
+	uint32_t indexKey;
+}MeshBuffers;
+
+// Small meshes, 8 to 40 vertices of 32 bytes, and 12 to 36 16 bit indices
+static std::vector<MeshBuffers> BuildMeshes(uint32_t count)
+{
+	std::mt19937 rng(21);
+	std::vector<MeshBuffers> meshes(count);
+	for (auto& mesh : meshes)
+	{
+		mesh.vertexBytes = (8 + rng() % 33) * 32;
+		mesh.indexBytes = (12 + rng() % 25) * 2;
+		mesh.vertexKey = mesh.indexKey = NULL_KEY;
+	}
+	return meshes;
+}
+
+// Loads all meshes, unloads half of them in random order, loads them again, then unloads everything
+// Offsets are checked to never overlap, so both tables are verified while they're timed
+template <typename BufferTable>
+static bool LoadAndUnloadMeshes(std::vector<MeshBuffers>& meshes, uint32_t seed)
+{
+	BufferTable vertexTable(VERTEX_BUFFER_BYTES);
+	BufferTable indexTable(INDEX_BUFFER_BYTES);
+
+	auto load = [&](MeshBuffers& mesh)
+	{
+		mesh.vertexKey = vertexTable.Allocate(mesh.vertexBytes);
+		mesh.indexKey = indexTable.Allocate(mesh.indexBytes);
+		return mesh.vertexKey != NULL_KEY && mesh.indexKey != NULL_KEY;
+	};
+
+	auto unload = [&](MeshBuffers& mesh)
+	{
+		vertexTable.Free(mesh.vertexKey);
+		indexTable.Free(mesh.indexKey);
+		mesh.vertexKey = mesh.indexKey = NULL_KEY;
+	};
+
+	for (auto& mesh : meshes)
+	{
+		if (!load(mesh))
+			return false;
+	}
+
+	std::vector<uint32_t> order(meshes.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+	for (uint32_t i = 0; i < (uint32_t)order.size() / 2; i++)
+		unload(meshes[order[i]]);
+	for (uint32_t i = 0; i < (uint32_t)order.size() / 2; i++)
+	{
+		if (!load(meshes[order[i]]))
+			return false;
+	}
+
+	// No two live ranges overlap
+	std::vector<BufferRange> ranges;
+	for (auto& mesh : meshes)
+		ranges.push_back({ vertexTable.GetOffset(mesh.vertexKey), mesh.vertexBytes });
+	std::sort(ranges.begin(), ranges.end(), [](const BufferRange& a, const BufferRange& b) { return a.offset < b.offset; });
+	for (uint32_t i = 1; i < (uint32_t)ranges.size(); i++)
+	{
+		if (ranges[i - 1].offset + ranges[i - 1].range > ranges[i].offset)
+			return false;
+	}
+
+	std::shuffle(order.begin(), order.end(), std::mt19937(seed + 1));
+	for (uint32_t index : order)
+		unload(meshes[index]);
+
+	return true;
+}
+
+TEST(SharedBufferTableMatchesLinear)
+{
+	// Both tables agree on validity with a few thousand meshes, where the linear one is still fast enough
+	std::vector<MeshBuffers> meshes = BuildMeshes(3000);
+	CHECK(LoadAndUnloadMeshes<LinearBufferTable>(meshes, 3));
+	CHECK(LoadAndUnloadMeshes<BufferRangeTable>(meshes, 3));
+
+	// Freed keys are reused and stay stable for live chunks
+	BufferRangeTable table(1024 * 1024);
+	uint32_t key0 = table.Allocate(100);
+	uint32_t key1 = table.Allocate(200);
+	uint32_t offset1 = table.GetOffset(key1);
+	table.Free(key0);
+	CHECK(table.GetOffset(key1) == offset1);
+	CHECK(table.Allocate(50) == key0);
+	CHECK(table.GetRange(key0) == 50 && !table.IsOutside(key0));
+
+	// No room in shared buffer, range lives outside and takes a key all the same, without touching allocator
+	CHECK(table.Allocate(1024 * 1024) == BufferRangeTable::NULL_KEY);
+	uint32_t outsideKey = table.AllocateOutside(1024 * 1024);
+	CHECK(outsideKey != key0 && outsideKey != key1);
+	CHECK(table.IsOutside(outsideKey) && table.GetOffset(outsideKey) == 0 && table.GetRange(outsideKey) == 1024 * 1024);
+	CHECK(table.GetAllocator().GetAllocationCount() == 2);
+
+	table.Free(outsideKey);
+	table.Free(key0);
+	table.Free(key1);
+	CHECK(table.GetAllocator().IsEmpty());
+	CHECK(table.GetAllocator().Validate());
+
+	// Keys of both kinds are reused
+	uint32_t reused0 = table.Allocate(64), reused1 = table.AllocateOutside(64), reused2 = table.Allocate(64);
+	CHECK(reused0 != reused1 && reused1 != reused2 && reused0 != reused2);
+	CHECK(reused0 <= 2 && reused1 <= 2 && reused2 <= 2);
+}
+
+// 50k small meshes loaded into and unloaded from shared vertex and index buffers
+// Linear table is quadratic and 50k meshes take minutes, so it runs on growing counts to show the trend
+BENCHMARK(SharedBufferMeshLoadUnload)
+{
+	const uint32_t meshCounts[] = { 2500, 5000, 10000, 50000 };
+	const uint32_t maxLinearMeshCount = 10000;
+
+	for (uint32_t meshCount : meshCounts)
+	{
+		std::vector<MeshBuffers> meshes = BuildMeshes(meshCount);
+		// Each mesh is loaded and unloaded 1.5 times, for both vertex and index buffers
+		uint32_t operationCount = meshCount * 3 * 2;
+
+		bool tlsfSucceeded = false;
+		double tlsfMilliseconds = MeasureMilliseconds([&]()
+		{
+			tlsfSucceeded = LoadAndUnloadMeshes<BufferRangeTable>(meshes, 5);
+		});
+		CHECK(tlsfSucceeded);
+
+		std::cout << "    " << meshCount << " meshes, range table: " << tlsfMilliseconds << " ms, " << tlsfMilliseconds * 1000000.0 / operationCount << " ns per operation" << std::endl;
+
+		if (meshCount > maxLinearMeshCount)
+			continue;
+
+		bool linearSucceeded = false;
+		double linearMilliseconds = MeasureMilliseconds([&]()
+		{
+			linearSucceeded = LoadAndUnloadMeshes<LinearBufferTable>(meshes, 5);
+		}, 1);
+		CHECK(linearSucceeded);
+
+		std::cout << "    " << meshCount << " meshes, linear table: " << linearMilliseconds << " ms, " << linearMilliseconds * 1000000.0 / operationCount << " ns per operation, TLSF speedup " << linearMilliseconds / tlsfMilliseconds << std::endl;
+	}
+}
\ No newline at end of file
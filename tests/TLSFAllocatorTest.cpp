@@ -0,0 +1,370 @@
+#include "TestFramework.h"
+#include "../common/TLSFAllocator.h"
+#include <random>
+#include <algorithm>
+#include <memory>
+
+TEST(TLSFAllocateWholeRange)
+{
+	// Search rounds up to the next bucket, so a range of exactly the requested size is not enough unless it's a bucket boundary
+	TLSFAllocator allocator(16588800);
+	uint32_t offset;
+	CHECK(allocator.Allocate(16588800, 1, offset) == TLSFAllocator::NULL_BLOCK);
+
+	uint64_t requiredBytes = TLSFAllocator::GetRequiredBytes(16588800, 1);
+	CHECK(requiredBytes >= 16588800 && requiredBytes <= 0xffffffff);
+
+	TLSFAllocator sizedAllocator((uint32_t)requiredBytes);
+	CHECK(sizedAllocator.Allocate(16588800, 1, offset) != TLSFAllocator::NULL_BLOCK);
+	CHECK(offset == 0);
+	CHECK(sizedAllocator.Validate());
+}
+
+TEST(TLSFRequiredBytes)
+{
+	// Required bytes have to be both sufficient and minimal for a fresh allocator
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<uint32_t> sizeDist(1, 1024 * 1024 * 700);
+	const uint32_t alignments[] = { 1, 4, 16, 256, 4096, 65536 };
+
+	for (uint32_t i = 0; i < 2000; i++)
+	{
+		uint32_t numBytes = i < 256 ? i + 1 : sizeDist(rng);
+		uint32_t alignment = alignments[i % 6];
+
+		uint64_t requiredBytes = TLSFAllocator::GetRequiredBytes(numBytes, alignment);
+		CHECK(requiredBytes >= (uint64_t)numBytes + alignment - 1);
+		CHECK(requiredBytes <= 0xffffffff);
+
+		uint32_t offset;
+		TLSFAllocator allocator((uint32_t)requiredBytes);
+		CHECK(allocator.Allocate(numBytes, alignment, offset) != TLSFAllocator::NULL_BLOCK);
+		CHECK(offset % alignment == 0);
+		CHECK(allocator.Validate());
+
+		TLSFAllocator smallerAllocator((uint32_t)requiredBytes - 1);
+		CHECK(smallerAllocator.Allocate(numBytes, alignment, offset) == TLSFAllocator::NULL_BLOCK);
+	}
+}
+
+TEST(TLSFLargeAlignedAllocation)
+{
+	// 600MB with alignment of 256 doesn't fit a node of exactly 600MB, nor one of 512MB default increment
+	uint32_t numBytes = 1024 * 1024 * 600;
+	uint64_t requiredBytes = TLSFAllocator::GetRequiredBytes(numBytes, 256);
+	CHECK(requiredBytes > numBytes);
+
+	uint32_t offset;
+	TLSFAllocator exactAllocator(numBytes);
+	CHECK(exactAllocator.Allocate(numBytes, 256, offset) == TLSFAllocator::NULL_BLOCK);
+
+	TLSFAllocator allocator((uint32_t)requiredBytes);
+	CHECK(allocator.Allocate(numBytes, 256, offset) != TLSFAllocator::NULL_BLOCK);
+	CHECK(offset % 256 == 0);
+}
+
+TEST(TLSFAlignment)
+{
+	TLSFAllocator allocator(1024 * 1024);
+	uint32_t offset;
+
+	// Make the free range start at an odd offset
+	CHECK(allocator.Allocate(3, 1, offset) != TLSFAllocator::NULL_BLOCK);
+	CHECK(offset == 0);
+
+	const uint32_t alignments[] = { 2, 16, 256, 4096 };
+	for (uint32_t alignment : alignments)
+	{
+		CHECK(allocator.Allocate(100, alignment, offset) != TLSFAllocator::NULL_BLOCK);
+		CHECK(offset % alignment == 0);
+		CHECK(allocator.Validate());
+	}
+}
+
+TEST(TLSFCoalesce)
+{
+	const uint32_t totalBytes = 1024 * 1024;
+	TLSFAllocator allocator(totalBytes);
+
+	std::vector<uint32_t> handles;
+	uint32_t offset;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		uint32_t handle = allocator.Allocate(totalBytes / 64, 1, offset);
+		CHECK(handle != TLSFAllocator::NULL_BLOCK);
+		CHECK(offset == i * (totalBytes / 64));
+		handles.push_back(handle);
+	}
+
+	CHECK(allocator.Allocate(1, 1, offset) == TLSFAllocator::NULL_BLOCK);
+
+	// Free every other one first, then the rest, so that merges happen on both sides
+	for (uint32_t i = 0; i < 64; i += 2)
+		allocator.Free(handles[i]);
+	CHECK(allocator.Validate());
+	CHECK(allocator.Allocate(totalBytes / 32, 1, offset) == TLSFAllocator::NULL_BLOCK);
+
+	for (uint32_t i = 1; i < 64; i += 2)
+		allocator.Free(handles[i]);
+	CHECK(allocator.Validate());
+	CHECK(allocator.IsEmpty());
+	CHECK(allocator.GetAllocatedBytes() == 0);
+
+	// Whole range is a single free block again, and it's a bucket boundary
+	CHECK(allocator.Allocate(totalBytes, 1, offset) != TLSFAllocator::NULL_BLOCK);
+	CHECK(offset == 0);
+}
+
+TEST(TLSFRandomAllocateFree)
+{
+	TLSFAllocator allocator(1024 * 1024 * 64);
+
+	std::mt19937 rng(11);
+	std::uniform_int_distribution<uint32_t> sizeDist(1, 1024 * 256);
+
+	typedef struct _Allocation
+	{
+		uint32_t handle;
+		uint32_t offset;
+		uint32_t numBytes;
+	}Allocation;
+	std::vector<Allocation> allocations;
+
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		if (allocations.empty() || rng() % 3 != 0)
+		{
+			Allocation allocation;
+			allocation.numBytes = sizeDist(rng);
+			uint32_t alignment = 1 << (rng() % 9);
+			allocation.handle = allocator.Allocate(allocation.numBytes, alignment, allocation.offset);
+			if (allocation.handle == TLSFAllocator::NULL_BLOCK)
+				continue;
+
+			CHECK(allocation.offset % alignment == 0);
+			CHECK(allocation.offset + allocation.numBytes <= allocator.GetTotalBytes());
+			CHECK(allocator.GetAllocationSize(allocation.handle) == allocation.numBytes);
+			allocations.push_back(allocation);
+		}
+		else
+		{
+			uint32_t index = rng() % (uint32_t)allocations.size();
+			allocator.Free(allocations[index].handle);
+			allocations[index] = allocations.back();
+			allocations.pop_back();
+		}
+
+		if (i % 1000 == 0)
+			CHECK(allocator.Validate());
+	}
+
+	CHECK(allocator.GetAllocationCount() == (uint32_t)allocations.size());
+
+	// Live allocations never overlap
+	std::sort(allocations.begin(), allocations.end(), [](const Allocation& a, const Allocation& b) { return a.offset < b.offset; });
+	for (uint32_t i = 1; i < (uint32_t)allocations.size(); i++)
+		CHECK(allocations[i - 1].offset + allocations[i - 1].numBytes <= allocations[i].offset);
+
+	for (auto& allocation : allocations)
+		allocator.Free(allocation.handle);
+	CHECK(allocator.IsEmpty());
+	CHECK(allocator.Validate());
+}
+
+TEST(TLSFGrow)
+{
+	TLSFAllocator allocator(64);
+	uint32_t offset;
+	uint32_t first = allocator.Allocate(48, 1, offset);
+	CHECK(allocator.Allocate(60, 1, offset) == TLSFAllocator::NULL_BLOCK);
+
+	// Free tail takes grown bytes, so a range across old end fits
+	allocator.Grow(64);
+	CHECK(allocator.Validate());
+	uint32_t second = allocator.Allocate(60, 1, offset);
+	CHECK(second != TLSFAllocator::NULL_BLOCK && offset == 48);
+	uint32_t third = allocator.Allocate(20, 1, offset);
+	CHECK(third != TLSFAllocator::NULL_BLOCK && offset == 108);
+
+	// Tail is in use, grown bytes become a new block after it
+	allocator.Grow(32);
+	CHECK(allocator.Validate());
+	CHECK(allocator.GetTotalBytes() == 160);
+	uint32_t fourth = allocator.Allocate(32, 1, offset);
+	CHECK(fourth != TLSFAllocator::NULL_BLOCK && offset == 128);
+	CHECK(allocator.Validate());
+
+	allocator.Free(second);
+	allocator.Free(fourth);
+	allocator.Free(first);
+	allocator.Free(third);
+	CHECK(allocator.IsEmpty() && allocator.Validate());
+	CHECK(allocator.Allocate(128, 1, offset) != TLSFAllocator::NULL_BLOCK);
+}
+
+// Chunk ranges the way ChunkBasedUniforms hands them out: capacity doubles whenever a range doesn't fit
+// Instance ranges of draws double and move like Material::GrowDrawInstanceCapacity, bone ranges come and go with variable sizes
+TEST(TLSFGrowChunkRanges)
+{
+	TLSFAllocator allocator(256);
+
+	auto allocateChunks = [&](uint32_t chunkCount, uint32_t& offset)
+	{
+		uint32_t handle = allocator.Allocate(chunkCount, 1, offset);
+		while (handle == TLSFAllocator::NULL_BLOCK)
+		{
+			allocator.Grow(allocator.GetTotalBytes());
+			handle = allocator.Allocate(chunkCount, 1, offset);
+		}
+		return handle;
+	};
+
+	std::mt19937 rng(5);
+	std::uniform_int_distribution<uint32_t> boneCount(1, 80);
+
+	typedef struct _Range
+	{
+		uint32_t handle;
+		uint32_t offset;
+		uint32_t chunkCount;
+	}Range;
+	std::vector<Range> drawRanges(64), boneRanges;
+	for (auto& range : drawRanges)
+	{
+		range.chunkCount = 1;
+		range.handle = allocateChunks(range.chunkCount, range.offset);
+	}
+
+	uint32_t peakLiveChunks = 0;
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		// Instance capacities double until 256, then shrink back to 1 as instances are removed
+		Range& draw = drawRanges[rng() % drawRanges.size()];
+		Range grown;
+		grown.chunkCount = draw.chunkCount >= 256 ? 1 : draw.chunkCount * 2;
+		grown.handle = allocateChunks(grown.chunkCount, grown.offset);
+		allocator.Free(draw.handle);
+		draw = grown;
+
+		if (boneRanges.size() < 64 && rng() % 2 == 0)
+		{
+			Range bones;
+			bones.chunkCount = boneCount(rng);
+			bones.handle = allocateChunks(bones.chunkCount, bones.offset);
+			boneRanges.push_back(bones);
+		}
+		else if (!boneRanges.empty())
+		{
+			uint32_t index = rng() % (uint32_t)boneRanges.size();
+			allocator.Free(boneRanges[index].handle);
+			boneRanges[index] = boneRanges.back();
+			boneRanges.pop_back();
+		}
+
+		peakLiveChunks = allocator.GetAllocatedBytes() > peakLiveChunks ? allocator.GetAllocatedBytes() : peakLiveChunks;
+		if (i % 1000 == 0)
+			CHECK(allocator.Validate());
+	}
+
+	// Freed ranges are split and merged for reuse, so capacity stays within a small multiple of what's alive at peak
+	CHECK(allocator.GetTotalBytes() <= peakLiveChunks * 4);
+}
+
+// Streams resources of mixed sizes through memory nodes the same way DeviceMemoryManager does:
+// first node with room wins, a new node is added when none has room, and empty nodes except the last are released
+BENCHMARK(TLSFFragmentation)
+{
+	const uint32_t nodeBytes = 1024 * 1024 * 256;
+	const uint32_t operationCount = 200000;
+
+	std::mt19937 rng(3);
+	// Mostly small buffers, with a tail of large textures
+	std::uniform_int_distribution<uint32_t> smallDist(256, 1024 * 64);
+	std::uniform_int_distribution<uint32_t> largeDist(1024 * 1024, 1024 * 1024 * 16);
+
+	typedef struct _Allocation
+	{
+		uint32_t nodeIndex;
+		uint32_t handle;
+		uint32_t numBytes;
+	}Allocation;
+
+	uint32_t peakNodeCount = 0;
+	uint64_t peakLiveBytes = 0;
+	uint32_t failedCount = 0;
+
+	double milliseconds = MeasureMilliseconds([&]()
+	{
+		std::vector<std::shared_ptr<TLSFAllocator>> nodes;
+		std::vector<Allocation> allocations;
+		uint64_t liveBytes = 0;
+		rng.seed(3);
+
+		for (uint32_t i = 0; i < operationCount; i++)
+		{
+			// Live set grows until 700MB, then churns with equal odds of allocating and freeing
+			bool allocate = allocations.empty() || (liveBytes < 1024ull * 1024 * 700 ? rng() % 4 != 0 : rng() % 2 == 0);
+			if (allocate)
+			{
+				Allocation allocation = {};
+				allocation.numBytes = rng() % 16 == 0 ? largeDist(rng) : smallDist(rng);
+				uint32_t alignment = 256;
+				uint32_t offset;
+
+				allocation.handle = TLSFAllocator::NULL_BLOCK;
+				for (uint32_t j = 0; j < (uint32_t)nodes.size() && allocation.handle == TLSFAllocator::NULL_BLOCK; j++)
+				{
+					if (!nodes[j])
+						continue;
+					allocation.nodeIndex = j;
+					allocation.handle = nodes[j]->Allocate(allocation.numBytes, alignment, offset);
+				}
+
+				if (allocation.handle == TLSFAllocator::NULL_BLOCK)
+				{
+					auto iter = std::find(nodes.begin(), nodes.end(), nullptr);
+					allocation.nodeIndex = (uint32_t)(iter - nodes.begin());
+					if (iter == nodes.end())
+						nodes.push_back(nullptr);
+					nodes[allocation.nodeIndex] = std::make_shared<TLSFAllocator>(nodeBytes);
+					allocation.handle = nodes[allocation.nodeIndex]->Allocate(allocation.numBytes, alignment, offset);
+				}
+
+				if (allocation.handle == TLSFAllocator::NULL_BLOCK)
+				{
+					failedCount++;
+					continue;
+				}
+
+				allocations.push_back(allocation);
+				liveBytes += allocation.numBytes;
+			}
+			else
+			{
+				uint32_t index = rng() % (uint32_t)allocations.size();
+				Allocation allocation = allocations[index];
+				allocations[index] = allocations.back();
+				allocations.pop_back();
+
+				nodes[allocation.nodeIndex]->Free(allocation.handle);
+				liveBytes -= allocation.numBytes;
+
+				uint32_t liveNodeCount = (uint32_t)std::count_if(nodes.begin(), nodes.end(), [](const std::shared_ptr<TLSFAllocator>& pNode) { return pNode != nullptr; });
+				if (nodes[allocation.nodeIndex]->IsEmpty() && liveNodeCount > 1)
+					nodes[allocation.nodeIndex] = nullptr;
+			}
+
+			uint32_t nodeCount = (uint32_t)std::count_if(nodes.begin(), nodes.end(), [](const std::shared_ptr<TLSFAllocator>& pNode) { return pNode != nullptr; });
+			peakNodeCount = nodeCount > peakNodeCount ? nodeCount : peakNodeCount;
+			peakLiveBytes = liveBytes > peakLiveBytes ? liveBytes : peakLiveBytes;
+		}
+	}, 3);
+
+	uint32_t idealNodeCount = (uint32_t)((peakLiveBytes + nodeBytes - 1) / nodeBytes);
+	std::cout << "    " << operationCount << " operations in " << milliseconds << " ms, " << milliseconds * 1000000.0 / operationCount << " ns per operation" << std::endl;
+	std::cout << "    peak live " << peakLiveBytes / (1024 * 1024) << " MB, peak nodes " << peakNodeCount << ", ideal nodes " << idealNodeCount << ", failed " << failedCount << std::endl;
+
+	CHECK(failedCount == 0);
+	// Fragmentation may cost a node, but never more
+	CHECK(peakNodeCount <= idealNodeCount + 1);
+}
\ No newline at end of file
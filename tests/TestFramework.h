@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+// Minimal test harness for platform independent code, tests and benchmarks register themselves during static initialization
+// Tests run by default, benchmarks only with "--benchmark", and an extra argument filters cases by name
+class TestRegistry
+{
+	typedef struct _TestCase
+	{
+		const char*	name;
+		void		(*pFunc)();
+		bool		isBenchmark;
+	}TestCase;
+
+public:
+	static TestRegistry& Get()
+	{
+		static TestRegistry registry;
+		return registry;
+	}
+
+	bool Register(const char* name, void(*pFunc)(), bool isBenchmark)
+	{
+		m_testCases.push_back({ name, pFunc, isBenchmark });
+		return true;
+	}
+
+	void ReportFailure(const char* file, int line, const char* express)
+	{
+		std::cout << "    " << file << "(" << line << "): CHECK(" << express << ") failed" << std::endl;
+		m_currentFailed = true;
+	}
+
+	int Run(int argc, char** argv);
+
+protected:
+	std::vector<TestCase>	m_testCases;
+	bool					m_currentFailed = false;
+};
+
+// Best of "repeats" runs, in milliseconds
+template <typename Func>
+double MeasureMilliseconds(Func func, uint32_t repeats = 5)
+{
+	double best = 0;
+	for (uint32_t i = 0; i < repeats; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		func();
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		best = (i == 0 || elapsed < best) ? elapsed : best;
+	}
+	return best;
+}
+
+#define TEST_CASE_INTERNAL(name, isBenchmark) \
+	static void name(); \
+	static bool name##Registered = TestRegistry::Get().Register(#name, name, isBenchmark); \
+	static void name()
+
+#define TEST(name) TEST_CASE_INTERNAL(name, false)
+#define BENCHMARK(name) TEST_CASE_INTERNAL(name, true)
+
+// Failed check ends current test case
+#define CHECK(express) do { if (!(express)) { TestRegistry::Get().ReportFailure(__FILE__, __LINE__, #express); return; } } while (0)
\ No newline at end of file
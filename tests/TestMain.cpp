@@ -0,0 +1,43 @@
+#include "TestFramework.h"
+#include <string.h>
+
+int TestRegistry::Run(int argc, char** argv)
+{
+	bool runBenchmarks = false;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--benchmark") == 0)
+			runBenchmarks = true;
+		else
+			filter = argv[i];
+	}
+
+	uint32_t runCount = 0;
+	uint32_t failedCount = 0;
+	for (auto& testCase : m_testCases)
+	{
+		if (testCase.isBenchmark != runBenchmarks)
+			continue;
+		if (filter && strstr(testCase.name, filter) == nullptr)
+			continue;
+
+		std::cout << "[ RUN  ] " << testCase.name << std::endl;
+
+		m_currentFailed = false;
+		testCase.pFunc();
+
+		std::cout << (m_currentFailed ? "[ FAIL ] " : "[  OK  ] ") << testCase.name << std::endl;
+
+		runCount++;
+		failedCount += m_currentFailed ? 1 : 0;
+	}
+
+	std::cout << runCount - failedCount << " of " << runCount << (runBenchmarks ? " benchmarks" : " tests") << " passed" << std::endl;
+	return failedCount == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	return TestRegistry::Get().Run(argc, argv);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../thread/ParallelRange.hpp"
+#include <thread>
+#include <atomic>
+
+// ParallelRangeFunc for tests, a thread per core takes ranges off a shared counter, calling thread joins in
+// Threads are started per call, that costs some microseconds, which is in the same league as queuing jobs
+inline ParallelRangeFunc AcquireThreadParallelRangeFunc(uint32_t threadCount = std::thread::hardware_concurrency())
+{
+	threadCount = threadCount == 0 ? 1 : threadCount;
+	return [threadCount](uint32_t count, uint32_t grainSize, const RangeFunc& rangeFunc)
+	{
+		std::atomic<uint32_t> nextIndex = { 0 };
+		auto worker = [&]()
+		{
+			for (uint32_t start = nextIndex.fetch_add(grainSize); start < count; start = nextIndex.fetch_add(grainSize))
+				rangeFunc(start, start + grainSize < count ? start + grainSize : count);
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(worker));
+		worker();
+		for (auto& thread : threads)
+			thread.join();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "TestFramework.h"
+#include "ThreadParallelRange.h"
+#include "../Base/TransformHierarchy.h"
+#include <random>
+#include <memory>
+#include <cmath>
+
+// Node as test sees it, parent always has a smaller index, so that reparenting never makes a cycle
+typedef struct _TestNode
+{
+	uint32_t	handle;
+	uint32_t	parent;
+	Matrix4d	localTransform;
+	Matrix3d	localRotation;
+	bool		isAlive;
+}TestNode;
+
+static const uint32_t NULL_NODE = 0xffffffff;
+
+static Matrix3d AcquireRandomRotation(std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> dist(-3.14, 3.14);
+	return Matrix3d::EulerAngle(dist(rng), dist(rng), dist(rng));
+}
+
+static void SetRandomLocal(TransformHierarchy& hierarchy, TestNode& node, std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> dist(-1.0, 1.0);
+	node.localRotation = AcquireRandomRotation(rng);
+	node.localTransform = Matrix4d(node.localRotation * Matrix3d(Vector3d(0.5 + (dist(rng) + 1.0) * 0.5)), Vector3d(dist(rng), dist(rng), dist(rng)));
+	hierarchy.SetLocalTransform(node.handle, node.localTransform, node.localRotation);
+}
+
+static uint32_t AddNode(TransformHierarchy& hierarchy, std::vector<TestNode>& nodes, uint32_t parent, std::mt19937& rng)
+{
+	TestNode node = {};
+	node.handle = hierarchy.AllocateNode();
+	node.parent = parent;
+	node.isAlive = true;
+	if (parent != NULL_NODE)
+		hierarchy.SetParent(node.handle, nodes[parent].handle);
+	SetRandomLocal(hierarchy, node, rng);
+	nodes.push_back(node);
+	return (uint32_t)nodes.size() - 1;
+}
+
+// Rigs hang off one scene root, bones mostly continue a chain and now and then branch from an earlier bone, like limbs and fingers
+static void AddRigs(TransformHierarchy& hierarchy, std::vector<TestNode>& nodes, uint32_t rigCount, uint32_t boneCount, std::mt19937& rng)
+{
+	uint32_t sceneRoot = AddNode(hierarchy, nodes, NULL_NODE, rng);
+	for (uint32_t i = 0; i < rigCount; i++)
+	{
+		uint32_t rigRoot = AddNode(hierarchy, nodes, sceneRoot, rng);
+		for (uint32_t j = 0; j < boneCount; j++)
+		{
+			uint32_t parent = (j == 0 || rng() % 2 == 0) ? rigRoot + (j == 0 ? 0 : rng() % j) : (uint32_t)nodes.size() - 1;
+			AddNode(hierarchy, nodes, parent, rng);
+		}
+	}
+}
+
+// Same multiplication order as hierarchy, so that results are expected to be bit equal
+static void AcquireNaiveWorld(const std::vector<TestNode>& nodes, std::vector<Matrix4d>& worldTransforms, std::vector<Matrix3d>& worldRotations)
+{
+	worldTransforms.resize(nodes.size());
+	worldRotations.resize(nodes.size());
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	{
+		if (!nodes[i].isAlive)
+			continue;
+
+		if (nodes[i].parent == NULL_NODE)
+		{
+			worldTransforms[i] = nodes[i].localTransform;
+			worldRotations[i] = nodes[i].localRotation;
+		}
+		else
+		{
+			worldTransforms[i] = worldTransforms[nodes[i].parent] * nodes[i].localTransform;
+			worldRotations[i] = worldRotations[nodes[i].parent] * nodes[i].localRotation;
+		}
+	}
+}
+
+static bool IsEqual(const Matrix4d& a, const Matrix4d& b)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if ((&a.c00)[i] != (&b.c00)[i])
+			return false;
+	}
+	return true;
+}
+
+static bool IsEqual(const Matrix3d& a, const Matrix3d& b)
+{
+	for (uint32_t i = 0; i < 9; i++)
+	{
+		if ((&a.c00)[i] != (&b.c00)[i])
+			return false;
+	}
+	return true;
+}
+
+static bool IsNear(const Matrix4d& a, const Matrix4d& b)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if (std::abs((&a.c00)[i] - (&b.c00)[i]) > 1e-9 * (1.0 + std::abs((&b.c00)[i])))
+			return false;
+	}
+	return true;
+}
+
+static bool MatchesNaive(const TransformHierarchy& hierarchy, const std::vector<TestNode>& nodes)
+{
+	std::vector<Matrix4d> worldTransforms;
+	std::vector<Matrix3d> worldRotations;
+	AcquireNaiveWorld(nodes, worldTransforms, worldRotations);
+
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	{
+		if (!nodes[i].isAlive)
+			continue;
+		if (!IsEqual(hierarchy.GetCachedWorldTransform(nodes[i].handle), worldTransforms[i]))
+			return false;
+		if (!IsEqual(hierarchy.GetCachedWorldRotationM(nodes[i].handle), worldRotations[i]))
+			return false;
+	}
+	return true;
+}
+
+TEST(TransformHierarchyMatchesNaive)
+{
+	std::mt19937 rng(13);
+	std::shared_ptr<TransformHierarchy> pHierarchy = std::make_shared<TransformHierarchy>();
+	std::vector<TestNode> nodes;
+	AddRigs(*pHierarchy, nodes, 30, 100, rng);
+
+	pHierarchy->Update();
+	CHECK(pHierarchy->GetNodeCount() == (uint32_t)nodes.size());
+	CHECK(MatchesNaive(*pHierarchy, nodes));
+	for (auto& node : nodes)
+		CHECK(pHierarchy->IsWorldTransformChanged(node.handle));
+
+	for (uint32_t round = 0; round < 20; round++)
+	{
+		// Expected change flags, a node changes if it's touched or any ancestor changes
+		std::vector<uint8_t> touched(nodes.size(), 0);
+
+		for (uint32_t i = 0; i < 50; i++)
+		{
+			uint32_t index = rng() % (uint32_t)nodes.size();
+			if (!nodes[index].isAlive)
+				continue;
+			SetRandomLocal(*pHierarchy, nodes[index], rng);
+			touched[index] = 1;
+		}
+
+		// Reparent to any earlier live node, or make it a root
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			uint32_t index = 1 + rng() % ((uint32_t)nodes.size() - 1);
+			uint32_t parent = rng() % index;
+			if (!nodes[index].isAlive || !nodes[parent].isAlive)
+				continue;
+			nodes[index].parent = rng() % 8 == 0 ? NULL_NODE : parent;
+			pHierarchy->SetParent(nodes[index].handle, nodes[index].parent == NULL_NODE ? TransformHierarchy::NULL_HANDLE : nodes[parent].handle);
+			touched[index] = 1;
+		}
+
+		// Free some leaves, their handles get reused by nodes added right after
+		std::vector<uint32_t> childCounts(nodes.size(), 0);
+		for (auto& node : nodes)
+		{
+			if (node.isAlive && node.parent != NULL_NODE)
+				childCounts[node.parent]++;
+		}
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			uint32_t index = rng() % (uint32_t)nodes.size();
+			if (!nodes[index].isAlive || childCounts[index] != 0)
+				continue;
+			pHierarchy->FreeNode(nodes[index].handle);
+			nodes[index].isAlive = false;
+		}
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			uint32_t parent = rng() % (uint32_t)nodes.size();
+			AddNode(*pHierarchy, nodes, nodes[parent].isAlive ? parent : NULL_NODE, rng);
+			touched.push_back(1);
+		}
+
+		// Up to date results are available before update, multiplication order differs so they're only close
+		std::vector<Matrix4d> worldTransforms;
+		std::vector<Matrix3d> worldRotations;
+		AcquireNaiveWorld(nodes, worldTransforms, worldRotations);
+		for (uint32_t i = 0; i < (uint32_t)nodes.size(); i += 7)
+		{
+			if (nodes[i].isAlive)
+				CHECK(IsNear(pHierarchy->GetWorldTransform(nodes[i].handle), worldTransforms[i]));
+		}
+
+		pHierarchy->Update();
+		CHECK(MatchesNaive(*pHierarchy, nodes));
+
+		uint32_t liveCount = 0;
+		for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+		{
+			if (!nodes[i].isAlive)
+				continue;
+			liveCount++;
+
+			bool changed = touched[i] != 0;
+			for (uint32_t parent = nodes[i].parent; parent != NULL_NODE && !changed; parent = nodes[parent].parent)
+				changed = touched[parent] != 0;
+			CHECK(pHierarchy->IsWorldTransformChanged(nodes[i].handle) == changed);
+		}
+		CHECK(pHierarchy->GetNodeCount() == liveCount);
+	}
+
+	// Nothing changed since, so change flags are all cleared
+	pHierarchy->Update();
+	for (auto& node : nodes)
+	{
+		if (node.isAlive)
+			CHECK(!pHierarchy->IsWorldTransformChanged(node.handle));
+	}
+	CHECK(MatchesNaive(*pHierarchy, nodes));
+}
+
+TEST(TransformHierarchyParallelMatchesSerial)
+{
+	// Wide enough that levels get split into ranges
+	std::mt19937 serialRng(17), parallelRng(17);
+	std::shared_ptr<TransformHierarchy> pSerial = std::make_shared<TransformHierarchy>();
+	std::shared_ptr<TransformHierarchy> pParallel = std::make_shared<TransformHierarchy>();
+	std::vector<TestNode> serialNodes, parallelNodes;
+	AddRigs(*pSerial, serialNodes, 3000, 10, serialRng);
+	AddRigs(*pParallel, parallelNodes, 3000, 10, parallelRng);
+
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(4);
+	for (uint32_t round = 0; round < 3; round++)
+	{
+		for (uint32_t i = 0; i < (uint32_t)serialNodes.size(); i += 3)
+		{
+			SetRandomLocal(*pSerial, serialNodes[i], serialRng);
+			SetRandomLocal(*pParallel, parallelNodes[i], parallelRng);
+		}
+
+		pSerial->Update();
+		pParallel->Update(parallelFor);
+		CHECK(MatchesNaive(*pSerial, serialNodes));
+		CHECK(MatchesNaive(*pParallel, parallelNodes));
+	}
+}
+
+// Object transforms as they were before the flat hierarchy, each node recalculated recursively from its parent every frame
+typedef struct _RecursiveNode
+{
+	Matrix4d								localTransform;
+	Vector3d								localPosition;
+	Matrix4d								cachedWorldTransform;
+	Vector3d								cachedWorldPosition;
+	std::weak_ptr<struct _RecursiveNode>	pParent;
+	std::vector<std::shared_ptr<struct _RecursiveNode>>	children;
+}RecursiveNode;
+
+static void UpdateRecursive(const std::shared_ptr<RecursiveNode>& pNode)
+{
+	Matrix4d cachedParentWorldTransform;
+	if (!pNode->pParent.expired())
+		cachedParentWorldTransform = pNode->pParent.lock()->cachedWorldTransform;
+
+	pNode->cachedWorldTransform = cachedParentWorldTransform * pNode->localTransform;
+	pNode->cachedWorldPosition = (cachedParentWorldTransform * Vector4d(pNode->localPosition, 1.0)).xyz();
+
+	for (auto& pChild : pNode->children)
+		UpdateRecursive(pChild);
+}
+
+// 100k nodes as 1000 rigs of 100 bones
+// Full update is every bone animated, partial is 1% of rigs moved at their root, static is nothing moved
+BENCHMARK(TransformHierarchy100kNodes)
+{
+	const uint32_t rigCount = 1000;
+	const uint32_t boneCount = 100;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+
+	std::mt19937 rng(19);
+	std::shared_ptr<TransformHierarchy> pHierarchy = std::make_shared<TransformHierarchy>();
+	std::vector<TestNode> nodes;
+	AddRigs(*pHierarchy, nodes, rigCount, boneCount, rng);
+	pHierarchy->Update();
+
+	uint32_t maxDepth = 0;
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	{
+		uint32_t depth = 0;
+		for (uint32_t parent = nodes[i].parent; parent != NULL_NODE; parent = nodes[parent].parent)
+			depth++;
+		maxDepth = depth > maxDepth ? depth : maxDepth;
+	}
+
+	auto touchAll = [&]()
+	{
+		for (auto& node : nodes)
+			pHierarchy->SetLocalTransform(node.handle, node.localTransform, node.localRotation);
+	};
+	auto touchRigRoots = [&]()
+	{
+		for (uint32_t i = 0; i < rigCount; i += 100)
+		{
+			TestNode& rigRoot = nodes[1 + i * (boneCount + 1)];
+			pHierarchy->SetLocalTransform(rigRoot.handle, rigRoot.localTransform, rigRoot.localRotation);
+		}
+	};
+
+	ParallelRangeFunc parallelFor = AcquireThreadParallelRangeFunc(threadCount);
+	double fullSerial = MeasureMilliseconds([&]() { touchAll(); pHierarchy->Update(); });
+	double fullParallel = MeasureMilliseconds([&]() { touchAll(); pHierarchy->Update(parallelFor); });
+	double partial = MeasureMilliseconds([&]() { touchRigRoots(); pHierarchy->Update(); });
+	double still = MeasureMilliseconds([&]() { pHierarchy->Update(); });
+	CHECK(MatchesNaive(*pHierarchy, nodes));
+
+	// Same tree, one heap object per node
+	std::vector<std::shared_ptr<RecursiveNode>> recursiveNodes(nodes.size());
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	{
+		recursiveNodes[i] = std::make_shared<RecursiveNode>();
+		recursiveNodes[i]->localTransform = nodes[i].localTransform;
+		recursiveNodes[i]->localPosition = nodes[i].localTransform[3].xyz();
+		if (nodes[i].parent != NULL_NODE)
+		{
+			recursiveNodes[i]->pParent = recursiveNodes[nodes[i].parent];
+			recursiveNodes[nodes[i].parent]->children.push_back(recursiveNodes[i]);
+		}
+	}
+	double recursive = MeasureMilliseconds([&]() { UpdateRecursive(recursiveNodes[0]); });
+	CHECK(IsEqual(recursiveNodes.back()->cachedWorldTransform, pHierarchy->GetCachedWorldTransform(nodes.back().handle)));
+
+	std::cout << "    " << nodes.size() << " nodes, max depth " << maxDepth << ", " << threadCount << " threads" << std::endl;
+	std::cout << "    full update: serial " << fullSerial << " ms, parallel " << fullParallel << " ms, recursive objects " << recursive << " ms" << std::endl;
+	std::cout << "    partial update " << partial << " ms, static frame " << still << " ms" << std::endl;
+}
\ No newline at end of file
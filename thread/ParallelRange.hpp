@@ -0,0 +1,10 @@
+#pragma once
+#include <functional>
+#include <stdint.h>
+
+// Job of a range, [startIndex, endIndex)
+typedef std::function<void(uint32_t startIndex, uint32_t endIndex)> RangeFunc;
+
+// Runs rangeFunc over [0, count) in ranges of grainSize, possibly in parallel, and returns once all of them are done
+// Platform independent code takes one of these instead of going to job system directly, so that it builds without a device
+typedef std::function<void(uint32_t count, uint32_t grainSize, const RangeFunc& rangeFunc)> ParallelRangeFunc;
\ No newline at end of file
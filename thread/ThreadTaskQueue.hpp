@@ -1,149 +1,274 @@
 #pragma once
 #include <thread>
 #include <functional>
-#include <queue>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
-#include "../vulkan/FrameManager.h"
 #include "ThreadWorker.hpp"
+#include "ParallelRange.hpp"
 
-class Device;
-class CommandBuffer;
+typedef std::shared_ptr<ThreadWorker::ThreadJob> ThreadJobHandle;
+typedef std::function<void(uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>& pPerFrameRes)> ThreadRangeJobFunc;
 
+// Work stealing job system
+// Each worker owns a lock free deque, jobs spawned from a worker go to its own deque, and idle workers steal from others
+// Jobs submitted from non-worker threads(e.g. main thread) go to a submission deque, which is stolen by workers as well
+// A job could depend on other jobs, it's scheduled only after all its dependencies are finished
 class ThreadTaskQueue
 {
 public:
-	ThreadTaskQueue(const std::shared_ptr<Device>& pDevice, uint32_t frameRoundBinCount, const std::shared_ptr<FrameManager>& pFrameMgr)
+	// Worker count of 0 means one worker per core, except the one of main thread
+	ThreadTaskQueue(uint32_t frameRoundBinCount, const PerFrameResourceAllocFunc& allocPerFrameRes, uint32_t workerCount = 0)
 	{
-		m_worker = std::thread(&ThreadTaskQueue::Loop, this);
+		if (workerCount == 0)
+		{
+			int numThreads = (int)std::thread::hardware_concurrency() - 1;
+			workerCount = numThreads > 1 ? (uint32_t)numThreads : 1;
+		}
 
-		int numThreads = std::thread::hardware_concurrency();
-		for (int i = 0; i < numThreads - 1; i++)
+		for (uint32_t i = 0; i < workerCount; i++)
 		{
-			m_threadWorkers.push_back(std::make_shared<ThreadWorker>(pDevice, frameRoundBinCount, pFrameMgr));
+			m_threadWorkers.push_back(std::make_shared<ThreadWorker>(frameRoundBinCount, allocPerFrameRes, this, i));
 		}
 
-		m_currentWorker = 0;
+		// Workers steal from each other, so start them after all of them are created
+		for (auto& pWorker : m_threadWorkers)
+			pWorker->Start();
 	}
 
 	~ThreadTaskQueue()
 	{
-		if (m_worker.joinable())
+		WaitForFree();
+
+		m_isDestroying = true;
 		{
-			WaitForEmptyQueue();
-			std::unique_lock<std::mutex> lock(m_queueMutex);
-			m_isDestroying = true;
-			lock.unlock();
-			m_condition.notify_one();
-			m_worker.join();
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.notify_all();
 		}
+
+		for (auto& pWorker : m_threadWorkers)
+			pWorker->Join();
 	}
 
 public:
-	void AddJob(ThreadJobFunc jobFunc, uint32_t frameIndex)
+	ThreadJobHandle AddJob(ThreadJobFunc jobFunc, uint32_t frameIndex)
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		ThreadWorker::ThreadJob job;
-		job.job = jobFunc;
-		job.frameIndex = frameIndex;
-		job.pThreadTaskQueue = this;
-		m_taskQueue.push(job);
-		m_condition.notify_all();
+		return AddJob(jobFunc, frameIndex, {});
 	}
 
-	void WaitForFree()
+	ThreadJobHandle AddJob(ThreadJobFunc jobFunc, uint32_t frameIndex, const std::vector<ThreadJobHandle>& dependencies)
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		m_condition.wait(lock, [this]() { return m_taskQueue.empty() && !m_isSearchingThread; });
-		for (uint32_t i = 0; i < m_threadWorkers.size(); i++)
+		ThreadJobHandle pJob = CreateJob(jobFunc, frameIndex);
+		SubmitJob(pJob, dependencies);
+		return pJob;
+	}
+
+	// Split [0, count) into ranges of grainSize and run them in parallel
+	// Returned handle is finished once all ranges are finished, it could be used as dependency of other jobs
+	ThreadJobHandle AddParallelForJob(uint32_t count, uint32_t grainSize, ThreadRangeJobFunc rangeFunc, uint32_t frameIndex, const std::vector<ThreadJobHandle>& dependencies = {})
+	{
+		if (grainSize == 0)
+			grainSize = count / ((uint32_t)m_threadWorkers.size() * PARALLEL_FOR_RANGES_PER_WORKER);
+		grainSize = grainSize > 0 ? grainSize : 1;
+
+		std::shared_ptr<ThreadRangeJobFunc> pRangeFunc = std::make_shared<ThreadRangeJobFunc>(rangeFunc);
+
+		std::vector<ThreadJobHandle> rangeJobs;
+		for (uint32_t startIndex = 0; startIndex < count; startIndex += grainSize)
 		{
-			m_threadWorkers[i]->WaitForFree();
+			uint32_t endIndex = startIndex + grainSize < count ? startIndex + grainSize : count;
+			rangeJobs.push_back(AddJob([pRangeFunc, startIndex, endIndex](const std::shared_ptr<PerFrameResource>& pPerFrameRes)
+			{
+				(*pRangeFunc)(startIndex, endIndex, pPerFrameRes);
+			}, frameIndex, dependencies));
 		}
+
+		// Join job, does nothing but waits for all ranges
+		return AddJob([](const std::shared_ptr<PerFrameResource>& pPerFrameRes) {}, frameIndex, rangeJobs);
 	}
 
-	void WaitForEmptyQueue()
+	void ParallelFor(uint32_t count, uint32_t grainSize, ThreadRangeJobFunc rangeFunc, uint32_t frameIndex)
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		m_condition.wait(lock, [this]() { return m_taskQueue.empty() && !m_isSearchingThread; });
+		WaitForJob(AddParallelForJob(count, grainSize, rangeFunc, frameIndex));
 	}
 
-	void WaitForWorkersAllFree()
+	// ParallelFor for code that doesn't know about job system, see ParallelRange.hpp
+	ParallelRangeFunc AcquireParallelRangeFunc(uint32_t frameIndex)
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		for (uint32_t i = 0; i < m_threadWorkers.size(); i++)
+		return [this, frameIndex](uint32_t count, uint32_t grainSize, const RangeFunc& rangeFunc)
 		{
-			m_threadWorkers[i]->WaitForFree();
+			ParallelFor(count, grainSize, [&rangeFunc](uint32_t startIndex, uint32_t endIndex, const std::shared_ptr<PerFrameResource>& pPerFrameRes)
+			{
+				rangeFunc(startIndex, endIndex);
+			}, frameIndex);
+		};
+	}
+
+	void WaitForJob(const ThreadJobHandle& pJob)
+	{
+		// A worker waiting for a job should keep working, or else it might deadlock when all workers are waiting
+		ThreadWorker* pWorker = ThreadWorker::GetCurrentWorker();
+		if (pWorker && pWorker->GetThreadTaskQueue() == this)
+		{
+			while (!pJob->isFinished)
+			{
+				ThreadWorker::ThreadJob* pReadyJob = nullptr;
+				if (AcquireJob(pWorker, pReadyJob))
+					pWorker->ExecuteJob(pReadyJob);
+				else
+					std::this_thread::yield();
+			}
+			return;
 		}
+
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		m_waitingThreadCount++;
+		m_waitCondition.wait(lock, [&pJob]() { return pJob->isFinished.load(); });
+		m_waitingThreadCount--;
+	}
+
+	// Wait until all submitted jobs are finished
+	void WaitForFree()
+	{
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		m_waitingThreadCount++;
+		m_waitCondition.wait(lock, [this]() { return m_unfinishedJobCount == 0; });
+		m_waitingThreadCount--;
 	}
 
 	uint32_t GetTaskQueueSize()
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		return (uint32_t)m_taskQueue.size();
+		int64_t readyJobCount = m_readyJobCount;
+		return readyJobCount > 0 ? (uint32_t)readyJobCount : 0;
+	}
+
+	uint32_t GetWorkerCount() const { return (uint32_t)m_threadWorkers.size(); }
+
+	bool IsDestroying() const { return m_isDestroying; }
+
+public:
+	// Worker side functions
+	bool AcquireJob(ThreadWorker* pWorker, ThreadWorker::ThreadJob*& pJob)
+	{
+		bool acquired = pWorker->PopJob(pJob) || m_submissionDeque.Steal(pJob);
+
+		for (uint32_t i = 1; !acquired && i < m_threadWorkers.size(); i++)
+			acquired = m_threadWorkers[(pWorker->GetWorkerIndex() + i) % m_threadWorkers.size()]->StealJob(pJob);
+
+		if (acquired)
+			m_readyJobCount--;
+
+		return acquired;
+	}
+
+	void WaitForReadyJob()
+	{
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingWorkerCount++;
+		m_sleepCondition.wait(lock, [this]() { return m_readyJobCount > 0 || m_isDestroying; });
+		m_sleepingWorkerCount--;
+	}
+
+	void FinishJob(ThreadWorker::ThreadJob* pJob)
+	{
+		// Hold job until this function ends
+		ThreadJobHandle pSelf = std::move(pJob->pSelf);
+
+		std::vector<ThreadJobHandle> successors;
+		{
+			std::unique_lock<std::mutex> lock(pJob->successorMutex);
+			pJob->isFinished = true;
+			successors.swap(pJob->successors);
+		}
+
+		for (auto& pSuccessor : successors)
+			ReleaseDependency(pSuccessor.get());
+
+		m_unfinishedJobCount--;
+
+		if (m_waitingThreadCount > 0)
+		{
+			std::unique_lock<std::mutex> lock(m_waitMutex);
+			m_waitCondition.notify_all();
+		}
 	}
 
 private:
-	void Loop()
+	ThreadJobHandle CreateJob(ThreadJobFunc jobFunc, uint32_t frameIndex)
 	{
-		while (true)
+		ThreadJobHandle pJob = std::make_shared<ThreadWorker::ThreadJob>();
+		pJob->job = jobFunc;
+		pJob->frameIndex = frameIndex;
+		pJob->pThreadTaskQueue = this;
+		pJob->pSelf = pJob;
+
+		m_unfinishedJobCount++;
+		return pJob;
+	}
+
+	void SubmitJob(const ThreadJobHandle& pJob, const std::vector<ThreadJobHandle>& dependencies)
+	{
+		for (auto& pDependency : dependencies)
 		{
-			ThreadWorker::ThreadJob job;
-			job.pThreadTaskQueue = this;
-			{
-				std::unique_lock<std::mutex> lock(m_queueMutex);
-				m_condition.wait(lock, [this]() { return !m_taskQueue.empty() || m_isDestroying; });
+			std::unique_lock<std::mutex> lock(pDependency->successorMutex);
+			if (pDependency->isFinished)
+				continue;
 
-				if (m_isDestroying)
-				{
-					break;
-				}
+			pJob->pendingDependencies++;
+			pDependency->successors.push_back(pJob);
+		}
 
-				job = m_taskQueue.front();
-				m_taskQueue.pop();
+		// Release the one held by creator
+		ReleaseDependency(pJob.get());
+	}
 
-				m_isSearchingThread = true;
+	void ReleaseDependency(ThreadWorker::ThreadJob* pJob)
+	{
+		if (pJob->pendingDependencies.fetch_sub(1) == 1)
+			ScheduleJob(pJob);
+	}
 
-				m_condition.notify_all();
-			}
+	void ScheduleJob(ThreadWorker::ThreadJob* pJob)
+	{
+		ThreadWorker* pWorker = ThreadWorker::GetCurrentWorker();
+		if (pWorker && pWorker->GetThreadTaskQueue() == this)
+		{
+			pWorker->PushJob(pJob);
+		}
+		else
+		{
+			// Submission deque has only one owner at a time
+			std::unique_lock<std::mutex> lock(m_submissionMutex);
+			m_submissionDeque.Push(pJob);
+		}
 
-			bool shouldExit = false;
-			while (!shouldExit)
-			{
-				std::shared_ptr<ThreadWorker> pTWroker = m_threadWorkers[m_currentWorker];
-				m_currentWorker = (m_currentWorker + 1) % m_threadWorkers.size();
-
-				bool isFree = pTWroker->IsTaskQueueFree();
-				if (isFree)
-				{
-					std::unique_lock<std::mutex> lock(m_queueMutex);
-
-					//********************************************************************************************
-					//** Important: I have to set states here before sending job to thread worker
-					//** Or else, thread worker is busy, while states are still indicating current queue is free
-					//** Then thread which is waiting for queue free will be fired, which is very very very wrong
-					//** Damn this introduced a crash when frame rate is high, and this is really difficult to find
-					//********************************************************************************************
-					m_isSearchingThread = false;
-
-					pTWroker->AppendJob(job);
-					m_condition.notify_all();
-
-					shouldExit = true;
-				}
-			}
+		m_readyJobCount++;
+
+		if (m_sleepingWorkerCount > 0)
+		{
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.notify_one();
 		}
 	}
 
 private:
-	std::mutex									m_queueMutex;
-	std::thread									m_worker;
-	std::condition_variable						m_condition;
-	std::queue<ThreadWorker::ThreadJob>			m_taskQueue;
 	std::vector<std::shared_ptr<ThreadWorker>>	m_threadWorkers;
-	uint32_t									m_currentWorker;
 
-	bool m_isSearchingThread =		false;
-	bool m_isDestroying =			false;
-	static bool m_isWorkerReady;
-	uint32_t m_currentWorkerIndex = 0;
+	std::mutex									m_submissionMutex;
+	WorkStealingDeque<ThreadWorker::ThreadJob*>	m_submissionDeque;
+
+	std::atomic<int64_t>						m_readyJobCount = { 0 };
+	std::atomic<uint32_t>						m_unfinishedJobCount = { 0 };
+
+	std::mutex									m_sleepMutex;
+	std::condition_variable						m_sleepCondition;
+	std::atomic<uint32_t>						m_sleepingWorkerCount = { 0 };
+
+	std::mutex									m_waitMutex;
+	std::condition_variable						m_waitCondition;
+	std::atomic<uint32_t>						m_waitingThreadCount = { 0 };
+
+	std::atomic<bool>							m_isDestroying = { false };
+
+	static const uint32_t PARALLEL_FOR_RANGES_PER_WORKER = 4;
 };
\ No newline at end of file
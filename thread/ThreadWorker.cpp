@@ -1,86 +1,71 @@
-#pragma once
 #include "ThreadWorker.hpp"
 #include "ThreadTaskQueue.hpp"
-#include "../vulkan/GlobalDeviceObjects.h"
-#include "../vulkan/SwapChain.h"
-#include "../vulkan/FrameManager.h"
 
-ThreadWorker::ThreadWorker(const std::shared_ptr<Device>& pDevice, uint32_t frameRoundBinCount, const std::shared_ptr<FrameManager>& pFrameMgr) : m_isWorking(false)
+static thread_local ThreadWorker* s_pCurrentWorker = nullptr;
+
+ThreadWorker::ThreadWorker(uint32_t frameRoundBinCount, const PerFrameResourceAllocFunc& allocPerFrameRes, ThreadTaskQueue* pThreadTaskQueue, uint32_t workerIndex)
+	: m_pThreadTaskQueue(pThreadTaskQueue), m_workerIndex(workerIndex)
 {
 	for (uint32_t i = 0; i < frameRoundBinCount; i++)
-		m_frameRes.push_back(pFrameMgr->AllocatePerFrameResource(i));
-	m_worker = std::thread(&ThreadWorker::Loop, this);
+		m_frameRes.push_back(allocPerFrameRes(i));
 }
 
 ThreadWorker::~ThreadWorker()
 {
-	if (m_worker.joinable())
-	{
-		WaitForFree();
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		m_isDestroying = true;
-		lock.unlock();
-		m_condition.notify_one();
-		m_worker.join();
-	}
+	Join();
 }
 
-void ThreadWorker::Loop()
+void ThreadWorker::Start()
 {
-	while (true)
-	{
-		ThreadJob job;
-		{
-			std::unique_lock<std::mutex> lock(m_queueMutex);
-			m_condition.wait(lock, [this] { return !m_jobQueue.empty() || m_isDestroying; });
-
-			if (m_isDestroying)
-			{
-				break;
-			}
-
-			job = m_jobQueue.front();
-			m_jobQueue.pop();
-			m_isWorking = true;
-		}
-		job.job(m_frameRes[job.frameIndex]);
-		{
-			std::unique_lock<std::mutex> lock(m_queueMutex);
-			m_isWorking = false;
-			m_condition.notify_one();
-		}
-	}
+	m_worker = std::thread(&ThreadWorker::Loop, this);
 }
 
-void ThreadWorker::AppendJob(ThreadJob job)
+void ThreadWorker::Join()
 {
-	std::unique_lock<std::mutex> lock(m_queueMutex);
-	m_jobQueue.push(job);
-	m_condition.notify_one();
+	if (m_worker.joinable())
+		m_worker.join();
 }
 
-bool ThreadWorker::IsTaskQueueFree()
+ThreadWorker* ThreadWorker::GetCurrentWorker()
 {
-	bool ret = false;
-	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		ret = m_jobQueue.size() < m_jobQueueSize;
-	}
-	return ret;
+	return s_pCurrentWorker;
 }
 
-bool ThreadWorker::IsWorking()
+void ThreadWorker::Loop()
 {
-	bool ret = false;
+	s_pCurrentWorker = this;
+
+	uint32_t spinCount = 0;
+	while (!m_pThreadTaskQueue->IsDestroying())
 	{
-		std::unique_lock<std::mutex> lock(m_queueMutex);
-		ret = m_isWorking;
+		ThreadJob* pJob = nullptr;
+		if (m_pThreadTaskQueue->AcquireJob(this, pJob))
+		{
+			ExecuteJob(pJob);
+			spinCount = 0;
+			continue;
+		}
+
+		// Nothing to steal, spin a while before going to sleep, since jobs usually come in bursts within a frame
+		if (++spinCount < SPIN_COUNT_BEFORE_SLEEP)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		spinCount = 0;
+		m_pThreadTaskQueue->WaitForReadyJob();
 	}
-	return ret;
+
+	s_pCurrentWorker = nullptr;
 }
 
-void ThreadWorker::WaitForFree()
+void ThreadWorker::ExecuteJob(ThreadJob* pJob)
 {
-	std::unique_lock<std::mutex> lock(m_queueMutex);
-	m_condition.wait(lock, [this] { return m_jobQueue.empty() && !m_isWorking; });
-}
+	bool wasWorking = m_isWorking;
+	m_isWorking = true;
+	pJob->job(m_frameRes[pJob->frameIndex]);
+	m_isWorking = wasWorking;
+
+	m_pThreadTaskQueue->FinishJob(pJob);
+}
\ No newline at end of file
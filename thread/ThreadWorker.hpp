@@ -2,17 +2,17 @@
 #include <thread>
 #include <functional>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include "WorkStealingDeque.hpp"
 
-class Device;
 class ThreadTaskQueue;
-class FrameManager;
-class SwapChain;
-class GlobalDeviceObjects;
 class PerFrameResource;
 
 typedef std::function<void(const std::shared_ptr<PerFrameResource>& pPerFrameRes)> ThreadJobFunc;
+// Creates a worker's per frame resource of a frame, job system itself doesn't know about devices
+typedef std::function<std::shared_ptr<PerFrameResource>(uint32_t frameIndex)> PerFrameResourceAllocFunc;
 
 class ThreadWorker
 {
@@ -22,27 +22,54 @@ public:
 		ThreadJobFunc	job;
 		uint32_t		frameIndex;
 		ThreadTaskQueue* pThreadTaskQueue = nullptr;
+
+		// Dependency counter, job is pushed to a deque only if it reaches 0
+		// It starts from 1, which is held by job creator until all dependencies are attached
+		std::atomic<uint32_t>	pendingDependencies = { 1 };
+
+		// Jobs that depend on this one
+		std::mutex									successorMutex;
+		std::vector<std::shared_ptr<_ThreadJob>>	successors;
+		std::atomic<bool>							isFinished = { false };
+
+		// Job keeps itself alive while it's in flight, since deques only store raw pointers
+		std::shared_ptr<_ThreadJob>					pSelf;
 	}ThreadJob;
 
 public:
-	ThreadWorker(const std::shared_ptr<Device>& pDevice, uint32_t frameRoundBinCount, const std::shared_ptr<FrameManager>& pFrameMgr);
+	ThreadWorker(uint32_t frameRoundBinCount, const PerFrameResourceAllocFunc& allocPerFrameRes, ThreadTaskQueue* pThreadTaskQueue, uint32_t workerIndex);
 	~ThreadWorker();
 
 public:
-	void AppendJob(ThreadJob job);
-	bool IsTaskQueueFree();
-	bool IsWorking();
+	void Start();
 	void Loop();
-	void WaitForFree();
+	void Join();
+
+	// Owner thread only
+	void PushJob(ThreadJob* pJob) { m_jobDeque.Push(pJob); }
+	bool PopJob(ThreadJob*& pJob) { return m_jobDeque.Pop(pJob); }
+	// Any thread
+	bool StealJob(ThreadJob*& pJob) { return m_jobDeque.Steal(pJob); }
+
+	void ExecuteJob(ThreadJob* pJob);
+
+	uint32_t GetWorkerIndex() const { return m_workerIndex; }
+	ThreadTaskQueue* GetThreadTaskQueue() const { return m_pThreadTaskQueue; }
+	const std::shared_ptr<PerFrameResource>& GetPerFrameResource(uint32_t frameIndex) const { return m_frameRes[frameIndex]; }
+	bool IsWorking() const { return m_isWorking; }
+
+	// Worker that current thread belongs to, nullptr if it's not a worker thread
+	static ThreadWorker* GetCurrentWorker();
 
 private:
-	std::thread					m_worker;
-	std::mutex					m_queueMutex;
-	std::condition_variable		m_condition;
-	std::queue<ThreadJob>		m_jobQueue;
+	std::thread									m_worker;
+	WorkStealingDeque<ThreadJob*>				m_jobDeque;
 	std::vector<std::shared_ptr<PerFrameResource>>	m_frameRes;
+	ThreadTaskQueue*							m_pThreadTaskQueue;
+	uint32_t									m_workerIndex;
+
+	std::atomic<bool> m_isWorking = { false };
 
-	bool m_isWorking = false;
-	bool m_isDestroying = false;
-	const int32_t m_jobQueueSize = 2;
+	// Times a worker tries stealing before it goes to sleep
+	static const uint32_t SPIN_COUNT_BEFORE_SLEEP = 64;
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+// Lock free work stealing deque (Chase-Lev, with memory orders from "Correct and Efficient Work-Stealing for Weak Memory Models")
+// Push() and Pop() are only allowed to be called from the owner thread, they operate on bottom in LIFO manner
+// Steal() could be called from any thread, it operates on top in FIFO manner
+// Ring buffer grows when it's full, retired buffers are kept until destruction since a thief might still be reading from them
+template <typename T>
+class WorkStealingDeque
+{
+	class RingBuffer
+	{
+	public:
+		RingBuffer(int64_t capacity) : m_capacity(capacity), m_mask(capacity - 1), m_pData(new std::atomic<T>[capacity]) {}
+		~RingBuffer() { delete[] m_pData; }
+
+		int64_t Capacity() const { return m_capacity; }
+		void Store(int64_t index, T item) { m_pData[index & m_mask].store(item, std::memory_order_relaxed); }
+		T Load(int64_t index) const { return m_pData[index & m_mask].load(std::memory_order_relaxed); }
+
+		RingBuffer* Grow(int64_t bottom, int64_t top) const
+		{
+			RingBuffer* pNewBuffer = new RingBuffer(m_capacity * 2);
+			for (int64_t i = top; i < bottom; i++)
+				pNewBuffer->Store(i, Load(i));
+			return pNewBuffer;
+		}
+
+	private:
+		int64_t				m_capacity;
+		int64_t				m_mask;
+		std::atomic<T>*		m_pData;
+	};
+
+public:
+	// Capacity has to be power of 2
+	WorkStealingDeque(int64_t capacity = 1024) : m_top(0), m_bottom(0), m_pBuffer(new RingBuffer(capacity)) {}
+
+	~WorkStealingDeque()
+	{
+		delete m_pBuffer.load(std::memory_order_relaxed);
+		for (auto pBuffer : m_retiredBuffers)
+			delete pBuffer;
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+public:
+	void Push(T item)
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		RingBuffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+
+		if (bottom - top > pBuffer->Capacity() - 1)
+		{
+			m_retiredBuffers.push_back(pBuffer);
+			pBuffer = pBuffer->Grow(bottom, top);
+			m_pBuffer.store(pBuffer, std::memory_order_release);
+		}
+
+		pBuffer->Store(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	bool Pop(T& item)
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		RingBuffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		// Empty, restore bottom
+		if (top > bottom)
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = pBuffer->Load(bottom);
+
+		// More than one item left, no competition with thieves
+		if (top < bottom)
+			return true;
+
+		// The last item, race against thieves for it
+		bool succeeded = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return succeeded;
+	}
+
+	bool Steal(T& item)
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+			return false;
+
+		RingBuffer* pBuffer = m_pBuffer.load(std::memory_order_acquire);
+		item = pBuffer->Load(top);
+
+		// Lost the race against owner or another thief
+		return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	// Only an estimation when other threads are working on this deque
+	int64_t Size() const
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+		return bottom > top ? bottom - top : 0;
+	}
+
+	bool Empty() const { return Size() == 0; }
+
+private:
+	std::atomic<int64_t>		m_top;
+	std::atomic<int64_t>		m_bottom;
+	std::atomic<RingBuffer*>	m_pBuffer;
+	std::vector<RingBuffer*>	m_retiredBuffers;
+};
@@ -16,6 +16,8 @@ bool Buffer::Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<
 	
 	CHECK_VK_ERROR(vkCreateBuffer(GetDevice()->GetDeviceHandle(), &info, nullptr, &m_buffer));
 	m_pMemKey = DeviceMemMgr()->AllocateBufferMemChunk(pSelf, memoryPropertyFlag);
+	if (m_pMemKey == nullptr)
+		return false;
 
 	m_isHostVisible = memoryPropertyFlag & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 
@@ -188,6 +188,9 @@ void DescriptorSet::UpdateTexBuffer(uint32_t binding, const VkBufferView& texBuf
 	writeData[0].pTexelBufferView = &texBufferView;
 
 	vkUpdateDescriptorSets(GetDevice()->GetDeviceHandle(), (uint32_t)writeData.size(), writeData.data(), 0, nullptr);
+
+	// Buffer view isn't an object here, only mark binding written
+	m_resourceTable[binding];
 }
 
 void DescriptorSet::UpdateShaderStorageBufferDynamic(uint32_t binding, const std::shared_ptr<ShaderStorageBuffer>& pBuffer)
@@ -204,7 +207,8 @@ void DescriptorSet::UpdateShaderStorageBufferDynamic(uint32_t binding, const std
 
 	vkUpdateDescriptorSets(GetDevice()->GetDeviceHandle(), (uint32_t)writeData.size(), writeData.data(), 0, nullptr);
 
-	m_resourceTable[binding].push_back(pBuffer);
+	// Replace rather than append, so that a reallocated storage buffer releases the old one when rebound
+	m_resourceTable[binding] = { pBuffer };
 }
 
 void DescriptorSet::UpdateShaderStorageBuffer(uint32_t binding, const std::shared_ptr<ShaderStorageBuffer>& pBuffer)
@@ -222,4 +226,31 @@ void DescriptorSet::UpdateShaderStorageBuffer(uint32_t binding, const std::share
 	vkUpdateDescriptorSets(GetDevice()->GetDeviceHandle(), (uint32_t)writeData.size(), writeData.data(), 0, nullptr);
 
 	m_resourceTable[binding].push_back(pBuffer);
+}
+
+void DescriptorSet::CopyDescriptors(const std::shared_ptr<DescriptorSet>& pSrcDescriptorSet)
+{
+	ASSERTION(pSrcDescriptorSet->GetDescriptorSetLayout() == m_pDescriptorSetLayout);
+
+	std::vector<VkCopyDescriptorSet> copyData;
+	for (auto& binding : m_pDescriptorSetLayout->GetDescriptorSetLayoutBinding())
+	{
+		if (pSrcDescriptorSet->m_resourceTable.find(binding.binding) == pSrcDescriptorSet->m_resourceTable.end())
+			continue;
+
+		VkCopyDescriptorSet copy = {};
+		copy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+		copy.srcSet = pSrcDescriptorSet->GetDeviceHandle();
+		copy.srcBinding = binding.binding;
+		copy.dstSet = GetDeviceHandle();
+		copy.dstBinding = binding.binding;
+		copy.descriptorCount = binding.descriptorCount;
+		copyData.push_back(copy);
+	}
+
+	if (copyData.size() > 0)
+		vkUpdateDescriptorSets(GetDevice()->GetDeviceHandle(), 0, nullptr, (uint32_t)copyData.size(), copyData.data());
+
+	// Copied descriptors reference the same resources
+	m_resourceTable = pSrcDescriptorSet->m_resourceTable;
 }
\ No newline at end of file
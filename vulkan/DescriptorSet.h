@@ -45,6 +45,9 @@ public:
 	// FIXME: Refactor this when I create texture buffer object class
 	void UpdateTexBuffer(uint32_t binding, const VkBufferView& texBufferView);
 
+	// Copy every binding written in source set, source must share the same layout
+	void CopyDescriptors(const std::shared_ptr<DescriptorSet>& pSrcDescriptorSet);
+
 public:
 	static std::shared_ptr<DescriptorSet> Create(const std::shared_ptr<Device>& pDevice,
 		const std::shared_ptr<DescriptorPool>& pDescriptorPool,
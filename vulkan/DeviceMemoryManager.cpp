@@ -42,7 +42,8 @@ bool DeviceMemoryManager::Init(const std::shared_ptr<Device>& pDevice, const std
 	if (!DeviceObjectBase::Init(pDevice, pSelf))
 		return false;
 
-	m_bufferMemPool.resize(sizeof(uint32_t) * 8, {});	// Same size as bit count of uint32_t, i.e. type index count
+	m_bufferMemPools.resize(sizeof(uint32_t) * 8);	// Same size as bit count of uint32_t, i.e. type index count
+	m_imageMemPools.resize(sizeof(uint32_t) * 8);
 
 	return true;
 }
@@ -61,56 +62,70 @@ std::shared_ptr<MemoryKey> DeviceMemoryManager::AllocateBufferMemChunk(const std
 
 	VkMemoryRequirements reqs = pBuffer->GetMemoryReqirments();
 
-	uint32_t typeIndex;
-	uint32_t offset;
-	AllocateBufferMemory(pMemKey->m_key, (uint32_t)reqs.size, reqs.memoryTypeBits, memoryPropertyBits, typeIndex, offset);
+	// If key exceeds binding table size, increase it
+	if (pMemKey->m_key >= m_bufferBindingTable.size())
+		m_bufferBindingTable.resize((pMemKey->m_key / LOOKUP_TABLE_SIZE_INC + 1) * LOOKUP_TABLE_SIZE_INC, { {}, true });
 
-	// If key exceeds lookup table size, increase it
-	if (pMemKey->m_key >= m_bufferBindingLookupTable.size())
-	{
-		std::vector<std::pair<uint32_t, bool>> newLookupTable(m_bufferBindingLookupTable.size() + LOOKUP_TABLE_SIZE_INC);
-		std::swap_ranges(m_bufferBindingLookupTable.begin(), m_bufferBindingLookupTable.end(), newLookupTable.begin());
-		m_bufferBindingLookupTable = std::move(newLookupTable);
-	}
+	// Binding table entry stays freed on failure, so releasing this key does nothing
+	if (!AllocateBufferMemory(pMemKey->m_key, (uint32_t)reqs.size, (uint32_t)reqs.alignment, reqs.memoryTypeBits, memoryPropertyBits))
+		return nullptr;
 
-	pBuffer->BindMemory(m_bufferMemPool[typeIndex].memory, offset);
+	auto& bindingInfo = m_bufferBindingTable[pMemKey->m_key].first;
+	pBuffer->BindMemory(m_bufferMemPools[bindingInfo.typeIndex][bindingInfo.nodeIndex].memory, bindingInfo.startByte);
 
-	uint32_t bindingTableIndex = (uint32_t)m_bufferBindingTable.size();
-	m_bufferBindingTable.push_back
-		(
-			{
-				{
-					typeIndex,
-					offset,
-					(uint32_t)reqs.size,
-					nullptr
-				},
-				{
-					false
-				}
-			}
-		);
+	UpdateBufferMemChunk(pMemKey, pData, 0, (uint32_t)reqs.size);
+
+	return pMemKey;
+}
+
+std::shared_ptr<MemoryKey> DeviceMemoryManager::AllocateImageMemChunk(const std::shared_ptr<Image>& pImage, uint32_t memoryPropertyBits, const void* pData)
+{
+	std::shared_ptr<MemoryKey> pMemKey = MemoryKey::Create(GetSelfSharedPtr(), false);
+
+	VkMemoryRequirements reqs = pImage->GetMemoryReqirments();
 
-	if (m_bufferMemPool[typeIndex].pData)
-		m_bufferBindingTable[bindingTableIndex].first.pData = (char*)m_bufferMemPool[typeIndex].pData + offset;
+	if (pMemKey->m_key >= m_imageBindingTable.size())
+		m_imageBindingTable.resize((pMemKey->m_key / LOOKUP_TABLE_SIZE_INC + 1) * LOOKUP_TABLE_SIZE_INC, { {}, true });
 
-	m_bufferBindingLookupTable[pMemKey->m_key] = { bindingTableIndex, false };
+	if (!AllocateImageMemory(pMemKey->m_key, pImage->GetImageInfo(), reqs, memoryPropertyBits))
+		return nullptr;
 
-	UpdateBufferMemChunk(pMemKey, pData, offset, (uint32_t)reqs.size);
+	auto& bindingInfo = m_imageBindingTable[pMemKey->m_key].first.bindingInfo;
+	pImage->BindMemory(m_imageMemPools[bindingInfo.typeIndex][bindingInfo.nodeIndex].memory, bindingInfo.startByte);
 
 	return pMemKey;
 }
 
-std::shared_ptr<MemoryKey> DeviceMemoryManager::AllocateImageMemChunk(const std::shared_ptr<Image>& pImage, uint32_t memoryPropertyBits, const void* pData)
+std::shared_ptr<MemoryKey> DeviceMemoryManager::AllocateAliasedImageMemChunk(const std::shared_ptr<Image>& pImage, const std::shared_ptr<MemoryKey>& pAliasedMemKey)
 {
-	std::shared_ptr<MemoryKey> pMemKey = MemoryKey::Create(GetSelfSharedPtr(), false);
+	ASSERTION(!pAliasedMemKey->m_bufferOrImage);
+
+	uint32_t ownerKey = m_imageBindingTable[pAliasedMemKey->m_key].first.ownerKey;
+	BindingInfo ownerBindingInfo = m_imageBindingTable[ownerKey].first.bindingInfo;
+	const MemoryNode& ownerNode = m_imageMemPools[ownerBindingInfo.typeIndex][ownerBindingInfo.nodeIndex];
 
 	VkMemoryRequirements reqs = pImage->GetMemoryReqirments();
 
-	uint32_t typeIndex;
-	uint32_t offset;
-	AllocateImageMemory(pMemKey->m_key, (uint32_t)reqs.size, reqs.memoryTypeBits, memoryPropertyBits, typeIndex, offset);
-	pImage->BindMemory(m_imageMemPool[m_imageMemPoolLookupTable[pMemKey->m_key].first].memory, offset);
+	bool fits = (reqs.memoryTypeBits & (1 << ownerBindingInfo.typeIndex))
+		&& reqs.size <= ownerBindingInfo.numBytes
+		&& ownerBindingInfo.startByte % reqs.alignment == 0;
+
+	if (!fits)
+		return AllocateImageMemChunk(pImage, ownerNode.memProperty);
+
+	std::shared_ptr<MemoryKey> pMemKey = MemoryKey::Create(GetSelfSharedPtr(), false);
+
+	if (pMemKey->m_key >= m_imageBindingTable.size())
+		m_imageBindingTable.resize((pMemKey->m_key / LOOKUP_TABLE_SIZE_INC + 1) * LOOKUP_TABLE_SIZE_INC, { {}, true });
+
+	ImageBindingInfo imageBindingInfo = {};
+	imageBindingInfo.bindingInfo = ownerBindingInfo;
+	imageBindingInfo.ownerKey = ownerKey;
+	m_imageBindingTable[pMemKey->m_key] = { imageBindingInfo, false };
+	m_imageBindingTable[ownerKey].first.refCount++;
+	m_aliasedImageCount++;
+
+	pImage->BindMemory(ownerNode.memory, ownerBindingInfo.startByte);
 
 	return pMemKey;
 }
@@ -118,14 +133,14 @@ std::shared_ptr<MemoryKey> DeviceMemoryManager::AllocateImageMemChunk(const std:
 bool DeviceMemoryManager::UpdateBufferMemChunk(const std::shared_ptr<MemoryKey>& pMemKey, const void* pData, uint32_t offset, uint32_t numBytes)
 {
 	// Early return if it's been freed
-	if (m_bufferBindingLookupTable[pMemKey->m_key].second)
+	if (m_bufferBindingTable[pMemKey->m_key].second)
 		return false;
 
 	if (pData == nullptr)
 		return false;
 
-	auto& bindingInfo = m_bufferBindingTable[m_bufferBindingLookupTable[pMemKey->m_key].first].first;
-	auto& memoryNode = m_bufferMemPool[bindingInfo.typeIndex];
+	auto& bindingInfo = m_bufferBindingTable[pMemKey->m_key].first;
+	auto& memoryNode = m_bufferMemPools[bindingInfo.typeIndex][bindingInfo.nodeIndex];
 
 	if ((memoryNode.memProperty & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
 		return false;
@@ -139,18 +154,23 @@ bool DeviceMemoryManager::UpdateBufferMemChunk(const std::shared_ptr<MemoryKey>&
 
 bool DeviceMemoryManager::UpdateImageMemChunk(const std::shared_ptr<MemoryKey>& pMemKey, const void* pData, uint32_t offset, uint32_t numBytes)
 {
+	// Early return if it's been freed
+	if (m_imageBindingTable[pMemKey->m_key].second)
+		return false;
+
 	if (pData == nullptr)
 		return false;
 
-	auto& memoryNode = m_imageMemPool[m_imageMemPoolLookupTable[pMemKey->m_key].first];
+	auto& bindingInfo = m_imageBindingTable[pMemKey->m_key].first.bindingInfo;
+	auto& memoryNode = m_imageMemPools[bindingInfo.typeIndex][bindingInfo.nodeIndex];
 
 	if ((memoryNode.memProperty & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
 		return false;
 
-	// If numbytes is larger than buffer's bytes, use buffer bytes
-	uint32_t updateNumBytes = numBytes > memoryNode.numBytes ? memoryNode.numBytes : numBytes;
+	// If numbytes is larger than image's bytes, use image bytes
+	uint32_t updateNumBytes = numBytes > bindingInfo.numBytes ? bindingInfo.numBytes : numBytes;
 
-	UpdateMemoryChunk(memoryNode.memory, 0, updateNumBytes, memoryNode.pData, pData);
+	UpdateMemoryChunk(memoryNode.memory, offset, updateNumBytes, bindingInfo.pData, pData);
 	return true;
 }
 
@@ -159,9 +179,9 @@ void DeviceMemoryManager::UpdateMemoryChunk(VkDeviceMemory memory, uint32_t offs
 	memcpy_s((char*)pDst + offset, numBytes, pData, numBytes);
 }
 
-void DeviceMemoryManager::AllocateBufferMemory(uint32_t key, uint32_t numBytes, uint32_t memoryTypeBits, uint32_t memoryPropertyBits, uint32_t& typeIndex, uint32_t& offset)
+uint32_t DeviceMemoryManager::FindMemoryTypeIndex(uint32_t memoryTypeBits, uint32_t memoryPropertyBits) const
 {
-	typeIndex = 0;
+	uint32_t typeIndex = 0;
 	uint32_t typeBits = memoryTypeBits;
 	while (typeBits)
 	{
@@ -176,150 +196,234 @@ void DeviceMemoryManager::AllocateBufferMemory(uint32_t key, uint32_t numBytes,
 		typeBits >>= 1;
 		typeIndex++;
 	}
-
-	if (m_bufferMemPool[typeIndex].memory == 0)
-	{
-		MemoryNode node;
-		node.numBytes = (memoryPropertyBits & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? STAGING_MEMORY_ALLOCATE_INC : DEVICE_MEMORY_ALLOCATE_INC;
-		node.memProperty = memoryPropertyBits;
-
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = node.numBytes;
-		allocInfo.memoryTypeIndex = typeIndex;
-		CHECK_VK_ERROR(vkAllocateMemory(GetDevice()->GetDeviceHandle(), &allocInfo, nullptr, &node.memory));
-
-		if (memoryPropertyBits & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
-			CHECK_VK_ERROR(vkMapMemory(GetDevice()->GetDeviceHandle(), node.memory, 0, numBytes, 0, &node.pData));
-
-		m_bufferMemPool[typeIndex] = node;
-	}
-
-	if (!FindFreeBufferMemoryChunk(key, typeIndex, numBytes, offset))
-	{ 
-		// Should create a larger chunck of memory, do it later
-		assert(false);
-	}
+	return typeIndex;
 }
 
-void DeviceMemoryManager::AllocateImageMemory(uint32_t key, uint32_t numBytes, uint32_t memoryTypeBits, uint32_t memoryPropertyBits, uint32_t& typeIndex, uint32_t& offset)
+uint32_t DeviceMemoryManager::AllocateMemoryNode(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t numBytes, bool isDedicated)
 {
-	typeIndex = 0;
-	uint32_t typeBits = memoryTypeBits;
-	while (typeBits)
-	{
-		if (typeBits & 1)
-		{
-			if (GetDevice()->GetPhysicalDevice()->GetPhysicalDeviceMemoryProperties().memoryTypes[typeIndex].propertyFlags & memoryPropertyBits)
-			{
-				break;
-			}
-		}
-		typeBits >>= 1;
-		typeIndex++;
-	}
-
 	MemoryNode node;
 	node.numBytes = numBytes;
 	node.memProperty = memoryPropertyBits;
+	node.isDedicated = isDedicated;
 
 	VkMemoryAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = numBytes;
+	allocInfo.allocationSize = node.numBytes;
 	allocInfo.memoryTypeIndex = typeIndex;
 	CHECK_VK_ERROR(vkAllocateMemory(GetDevice()->GetDeviceHandle(), &allocInfo, nullptr, &node.memory));
 
-	offset = 0;
+	if (memoryPropertyBits & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		CHECK_VK_ERROR(vkMapMemory(GetDevice()->GetDeviceHandle(), node.memory, 0, VK_WHOLE_SIZE, 0, &node.pData));
+
+	// Dedicated node is bound as a whole, no need to keep track of its range
+	if (!isDedicated)
+		node.pAllocator = std::make_shared<TLSFAllocator>(node.numBytes);
 
-	uint32_t imageMemPoolIndex = (uint32_t)m_imageMemPool.size();
-	m_imageMemPool.push_back(node);
+	m_deviceMemoryAllocationCount++;
+	if (m_deviceMemoryAllocationCount > m_peakDeviceMemoryAllocationCount)
+		m_peakDeviceMemoryAllocationCount = m_deviceMemoryAllocationCount;
+	if (isDedicated)
+		m_dedicatedAllocationCount++;
+
+	// Reuse slot of a node that's been returned to driver, to keep node indices stable
+	auto iter = std::find_if(pool.begin(), pool.end(), [](const MemoryNode& existingNode) { return existingNode.memory == 0; });
+	uint32_t nodeIndex = (uint32_t)(iter - pool.begin());
+	if (iter == pool.end())
+		pool.push_back(node);
+	else
+		*iter = node;
+
+	return nodeIndex;
+}
 
-	if (key >= m_imageMemPoolLookupTable.size())
+void DeviceMemoryManager::FreeMemoryNode(MemoryNode& node)
+{
+	vkFreeMemory(GetDevice()->GetDeviceHandle(), node.memory, nullptr);
+
+	m_deviceMemoryAllocationCount--;
+	if (node.isDedicated)
+		m_dedicatedAllocationCount--;
+
+	node = {};
+}
+
+bool DeviceMemoryManager::SubAllocate(MemoryPool& pool, uint32_t nodeIndex, uint32_t numBytes, uint32_t alignment, BindingInfo& bindingInfo)
+{
+	MemoryNode& node = pool[nodeIndex];
+	uint32_t handle = node.pAllocator->Allocate(numBytes, alignment, bindingInfo.startByte);
+	if (handle == TLSFAllocator::NULL_BLOCK)
+		return false;
+
+	bindingInfo.nodeIndex = nodeIndex;
+	bindingInfo.allocationHandle = handle;
+	bindingInfo.pData = node.pData ? (char*)node.pData + bindingInfo.startByte : nullptr;
+	return true;
+}
+
+bool DeviceMemoryManager::AllocateFromPool(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t nodeBytes, uint32_t numBytes, uint32_t alignment, bool isLinear, BindingInfo& bindingInfo)
+{
+	// Linear and non-linear resources within the same page might alias each other
+	// Make non-linear ones occupy whole pages, so that linear ones never get in
+	if (!isLinear)
 	{
-		std::vector<std::pair<uint32_t, bool>> newLookupTable(m_imageMemPoolLookupTable.size() + LOOKUP_TABLE_SIZE_INC);
-		std::swap_ranges(m_imageMemPoolLookupTable.begin(), m_imageMemPoolLookupTable.end(), newLookupTable.begin());
-		m_imageMemPoolLookupTable = std::move(newLookupTable);
+		uint32_t granularity = (uint32_t)GetDevice()->GetPhysicalDevice()->GetPhysicalDeviceProperties().limits.bufferImageGranularity;
+		alignment = alignment > granularity ? alignment : granularity;
+		numBytes = (numBytes + granularity - 1) / granularity * granularity;
 	}
 
-	m_imageMemPoolLookupTable[key] = { imageMemPoolIndex, false };
+	bindingInfo.typeIndex = typeIndex;
+	bindingInfo.numBytes = numBytes;
+
+	for (uint32_t i = 0; i < (uint32_t)pool.size(); i++)
+	{
+		if (!pool[i].pAllocator || pool[i].isDedicated)
+			continue;
+
+		if (SubAllocate(pool, i, numBytes, alignment, bindingInfo))
+			return true;
+	}
+
+	// No room for this allocation, add a new memory node, which is large enough for it including alignment and bucket rounding of allocator
+	uint64_t requiredBytes = TLSFAllocator::GetRequiredBytes(numBytes, alignment);
+	if (requiredBytes > 0xffffffff)
+		return false;
+
+	uint32_t nodeIndex = AllocateMemoryNode(pool, typeIndex, memoryPropertyBits, nodeBytes > requiredBytes ? nodeBytes : (uint32_t)requiredBytes, false);
+	if (SubAllocate(pool, nodeIndex, numBytes, alignment, bindingInfo))
+		return true;
+
+	FreeMemoryNode(pool[nodeIndex]);
+	return false;
 }
 
-void DeviceMemoryManager::FreeBufferMemChunk(uint32_t key)
+void DeviceMemoryManager::AllocateDedicated(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t numBytes, BindingInfo& bindingInfo)
 {
-	// Early return if it's freed
-	if (m_bufferBindingLookupTable[key].second)
-		return;
+	// Resource takes the whole node from its beginning, which satisfies any alignment, so it's an exact fit without going through allocator
+	uint32_t nodeIndex = AllocateMemoryNode(pool, typeIndex, memoryPropertyBits, numBytes, true);
+
+	bindingInfo.typeIndex = typeIndex;
+	bindingInfo.nodeIndex = nodeIndex;
+	bindingInfo.allocationHandle = TLSFAllocator::NULL_BLOCK;
+	bindingInfo.startByte = 0;
+	bindingInfo.numBytes = numBytes;
+	bindingInfo.pData = pool[nodeIndex].pData;
+}
 
-	auto& bindingInfo = m_bufferBindingTable[m_bufferBindingLookupTable[key].first];
-	
-	MemoryNode& node = m_bufferMemPool[bindingInfo.first.typeIndex];
-	auto memIter = std::find_if(node.bindingList.begin(), node.bindingList.end(), [key](uint32_t poolKey)
+void DeviceMemoryManager::FreeFromPool(MemoryPool& pool, const BindingInfo& bindingInfo)
+{
+	MemoryNode& node = pool[bindingInfo.nodeIndex];
+	if (node.isDedicated)
 	{
-		return poolKey == key;
-	});
-	if (memIter == node.bindingList.end())
+		FreeMemoryNode(node);
 		return;
+	}
 
-	m_bufferBindingLookupTable[key].second = true;
-	m_bufferBindingTable[m_bufferBindingLookupTable[key].first].second = true;
+	node.pAllocator->Free(bindingInfo.allocationHandle);
+	if (!node.pAllocator->IsEmpty())
+		return;
 
-	node.bindingList.erase(memIter);
+	// Keep the last one, or else we'll keep allocating and freeing device memory if a single resource is created and destroyed repeatedly
+	uint32_t liveNodeCount = (uint32_t)std::count_if(pool.begin(), pool.end(), [](const MemoryNode& existingNode) { return existingNode.memory != 0 && !existingNode.isDedicated; });
+	if (liveNodeCount <= 1)
+		return;
 
-	// Need to add some sort of logics to make buffer tables more compact
+	FreeMemoryNode(node);
 }
 
-void DeviceMemoryManager::FreeImageMemChunk(uint32_t key)
+bool DeviceMemoryManager::AllocateBufferMemory(uint32_t key, uint32_t numBytes, uint32_t alignment, uint32_t memoryTypeBits, uint32_t memoryPropertyBits)
 {
-	auto index = m_imageMemPoolLookupTable[key];
+	uint32_t typeIndex = FindMemoryTypeIndex(memoryTypeBits, memoryPropertyBits);
+	uint32_t nodeBytes = (memoryPropertyBits & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? STAGING_MEMORY_ALLOCATE_INC : DEVICE_MEMORY_ALLOCATE_INC;
 
-	vkFreeMemory(GetDevice()->GetDeviceHandle(), m_imageMemPool[index.first].memory, nullptr);
+	BindingInfo bindingInfo = {};
+	if (!AllocateFromPool(m_bufferMemPools[typeIndex], typeIndex, memoryPropertyBits, nodeBytes, numBytes, alignment, true, bindingInfo))
+		return false;
 
-	//m_imageMemPool.erase(m_imageMemPool.begin() + index.first);
-	m_imageMemPoolLookupTable[key].second = true;
+	m_bufferSubAllocationCount++;
 
-	// Need to add some sort of logics to make buffer tables more compact
+	m_bufferBindingTable[key] = { bindingInfo, false };
+	return true;
 }
 
-bool DeviceMemoryManager::FindFreeBufferMemoryChunk(uint32_t key, uint32_t typeIndex, uint32_t numBytes, uint32_t& offset)
+bool DeviceMemoryManager::AllocateImageMemory(uint32_t key, const VkImageCreateInfo& info, const VkMemoryRequirements& reqs, uint32_t memoryPropertyBits)
 {
- 	offset = 0;
-	uint32_t endByte = 0;
-	for (uint32_t i = 0; i < m_bufferMemPool[typeIndex].bindingList.size(); i++)
-	{
-		auto& bindingInfo = m_bufferBindingTable[m_bufferBindingLookupTable[m_bufferMemPool[typeIndex].bindingList[i]].first];
+	uint32_t typeIndex = FindMemoryTypeIndex(reqs.memoryTypeBits, memoryPropertyBits);
 
-		// Skip if it's freed
-		if (bindingInfo.second)
-			continue;
+	// Large render targets are better off with their own allocation, as drivers may place them somewhere special(e.g. compression metadata)
+	// Anything taking half of a node would mostly waste the rest of it anyway
+	bool isRenderTarget = (info.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+	bool isDedicated = reqs.size >= (isRenderTarget ? DEDICATED_RENDER_TARGET_THRESHOLD : IMAGE_MEMORY_ALLOCATE_INC / 2);
 
-		endByte = offset + numBytes - 1;
-		if (endByte < bindingInfo.first.startByte)
-		{
-			m_bufferMemPool[typeIndex].bindingList.insert(m_bufferMemPool[typeIndex].bindingList.begin() + i, key);
-			return true;
-		}
-		else
-		{
-			offset = bindingInfo.first.startByte + bindingInfo.first.numBytes;
-		}
+	ImageBindingInfo imageBindingInfo = {};
+	if (isDedicated)
+		AllocateDedicated(m_imageMemPools[typeIndex], typeIndex, memoryPropertyBits, (uint32_t)reqs.size, imageBindingInfo.bindingInfo);
+	else
+	{
+		if (!AllocateFromPool(m_imageMemPools[typeIndex], typeIndex, memoryPropertyBits, IMAGE_MEMORY_ALLOCATE_INC, (uint32_t)reqs.size, (uint32_t)reqs.alignment, info.tiling == VK_IMAGE_TILING_LINEAR, imageBindingInfo.bindingInfo))
+			return false;
+		m_imageSubAllocationCount++;
 	}
 
-	if (offset + numBytes > m_bufferMemPool[typeIndex].numBytes)
-		return false;
-
-	m_bufferMemPool[typeIndex].bindingList.push_back(key);
+	imageBindingInfo.ownerKey = key;
+	imageBindingInfo.refCount = 1;
+	m_imageBindingTable[key] = { imageBindingInfo, false };
 	return true;
 }
 
+void DeviceMemoryManager::FreeBufferMemChunk(uint32_t key)
+{
+	// Early return if it's freed
+	if (m_bufferBindingTable[key].second)
+		return;
+
+	auto& bindingInfo = m_bufferBindingTable[key].first;
+	FreeFromPool(m_bufferMemPools[bindingInfo.typeIndex], bindingInfo);
+	m_bufferSubAllocationCount--;
+
+	m_bufferBindingTable[key].second = true;
+}
+
+void DeviceMemoryManager::FreeImageMemChunk(uint32_t key)
+{
+	// Early return if it's freed
+	if (m_imageBindingTable[key].second)
+		return;
+
+	m_imageBindingTable[key].second = true;
+
+	uint32_t ownerKey = m_imageBindingTable[key].first.ownerKey;
+	if (ownerKey != key)
+		m_aliasedImageCount--;
+
+	// Memory is shared by aliased images, release it with the last one
+	auto& owner = m_imageBindingTable[ownerKey].first;
+	if (--owner.refCount > 0)
+		return;
+
+	auto& bindingInfo = owner.bindingInfo;
+	auto& node = m_imageMemPools[bindingInfo.typeIndex][bindingInfo.nodeIndex];
+	if (!node.isDedicated)
+		m_imageSubAllocationCount--;
+
+	FreeFromPool(m_imageMemPools[bindingInfo.typeIndex], bindingInfo);
+}
+
 void DeviceMemoryManager::ReleaseMemory()
 {
-	std::for_each(m_bufferMemPool.begin(), m_bufferMemPool.end(), [this](MemoryNode& node)
+	auto releasePool = [this](MemoryPool& pool)
 	{
-		vkFreeMemory(GetDevice()->GetDeviceHandle(), node.memory, nullptr);
-	});
+		for (auto& node : pool)
+		{
+			if (node.memory != 0)
+				vkFreeMemory(GetDevice()->GetDeviceHandle(), node.memory, nullptr);
+		}
+	};
+
+	std::for_each(m_bufferMemPools.begin(), m_bufferMemPools.end(), releasePool);
+	std::for_each(m_imageMemPools.begin(), m_imageMemPools.end(), releasePool);
 }
 
 void* DeviceMemoryManager::GetDataPtr(const std::shared_ptr<MemoryKey>& pMemKey, uint32_t offset, uint32_t numBytes)
 {
-	return m_bufferBindingTable[m_bufferBindingLookupTable[pMemKey->m_key].first].first.pData;
+	return m_bufferBindingTable[pMemKey->m_key].first.pData;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "DeviceObjectBase.h"
 #include <map>
 #include <unordered_map>
+#include "../common/TLSFAllocator.h"
 
 class Buffer;
 class Image;
@@ -30,24 +31,40 @@ class DeviceMemoryManager : public DeviceObjectBase<DeviceMemoryManager>
 {
 	typedef struct _MemoryNode
 	{
-		uint32_t				numBytes = 0;
-		VkDeviceMemory			memory;
-		void*					pData = nullptr;
-		std::vector<uint32_t>	bindingList;
-		uint32_t				memProperty = 0;
+		uint32_t						numBytes = 0;
+		VkDeviceMemory					memory = 0;
+		void*							pData = nullptr;
+		uint32_t						memProperty = 0;
+		bool							isDedicated = false;	// Dedicated node holds exactly one resource, it's never shared
+		std::shared_ptr<TLSFAllocator>	pAllocator;
 	}MemoryNode;
 
 	typedef struct _BindingInfo
 	{
 		uint32_t	typeIndex;
+		uint32_t	nodeIndex;				// Index of memory node within pool of type index
+		uint32_t	allocationHandle;		// Handle from TLSF allocator of memory node, NULL_BLOCK for dedicated ones
 		uint32_t	startByte = 0;
 		uint32_t	numBytes = 0;
 		void*		pData = nullptr;
 	}BindingInfo;
 
+	typedef struct _ImageBindingInfo
+	{
+		BindingInfo	bindingInfo;
+		uint32_t	ownerKey = 0;			// Key that owns the allocation, aliased images refer to their owner's allocation
+		uint32_t	refCount = 0;			// Number of keys referring to this allocation, only valid for owner
+	}ImageBindingInfo;
+
+	// Memory nodes of a certain memory type, a new node is allocated when existing ones are full
+	typedef std::vector<MemoryNode> MemoryPool;
+
 public:
 	static const uint32_t DEVICE_MEMORY_ALLOCATE_INC = 1024 * 1024 * 512;
 	static const uint32_t STAGING_MEMORY_ALLOCATE_INC = 1024 * 1024 * 256;
+	static const uint32_t IMAGE_MEMORY_ALLOCATE_INC = 1024 * 1024 * 256;
+	// Render targets at least this large get a dedicated memory node, other images only if they'd take half of an image node
+	static const uint32_t DEDICATED_RENDER_TARGET_THRESHOLD = 1024 * 1024 * 16;
 
 public:
 	~DeviceMemoryManager();
@@ -58,35 +75,66 @@ public:
 	static std::shared_ptr<DeviceMemoryManager> Create(const std::shared_ptr<Device>& pDevice);
 	std::shared_ptr<MemoryKey> AllocateBufferMemChunk(const std::shared_ptr<Buffer>& pBuffer, uint32_t memoryPropertyBits, const void* pData = nullptr);
 	std::shared_ptr<MemoryKey> AllocateImageMemChunk(const std::shared_ptr<Image>& pImage, uint32_t memoryPropertyBits, const void* pData = nullptr);
+	// Bind image to the same memory as pAliasedMemKey, used by transient images whose lifetimes within a frame never overlap
+	// Falls back to a separate allocation if image doesn't fit into the aliased one
+	std::shared_ptr<MemoryKey> AllocateAliasedImageMemChunk(const std::shared_ptr<Image>& pImage, const std::shared_ptr<MemoryKey>& pAliasedMemKey);
 	bool UpdateBufferMemChunk(const std::shared_ptr<MemoryKey>& pMemKey, const void* pData, uint32_t offset, uint32_t numBytes);
 	bool UpdateImageMemChunk(const std::shared_ptr<MemoryKey>& pMemKey, const void* pData, uint32_t offset, uint32_t numBytes);
 	void* GetDataPtr(const std::shared_ptr<MemoryKey>& pMemKey, uint32_t offset, uint32_t numBytes);
 
+	// Statistics
+	uint32_t GetDeviceMemoryAllocationCount() const { return m_deviceMemoryAllocationCount; }
+	uint32_t GetPeakDeviceMemoryAllocationCount() const { return m_peakDeviceMemoryAllocationCount; }
+	uint32_t GetDedicatedAllocationCount() const { return m_dedicatedAllocationCount; }
+	uint32_t GetBufferSubAllocationCount() const { return m_bufferSubAllocationCount; }
+	uint32_t GetImageSubAllocationCount() const { return m_imageSubAllocationCount; }
+	uint32_t GetAliasedImageCount() const { return m_aliasedImageCount; }
+
 protected:
-	void AllocateBufferMemory(uint32_t key, uint32_t numBytes, uint32_t memoryTypeBits, uint32_t memoryPropertyBits, uint32_t& typeIndex, uint32_t& offset);
-	bool FindFreeBufferMemoryChunk(uint32_t key, uint32_t typeIndex, uint32_t numBytes, uint32_t& offset);
+	uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, uint32_t memoryPropertyBits) const;
+
+	// Sub-allocate from memory pool of type index, pool grows if there's no room
+	// Non-linear resources(optimal tiling images) are padded to bufferImageGranularity, so that they never share a page with linear ones
+	// Returns false if neither existing nodes nor a new one is able to hold it
+	bool AllocateFromPool(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t nodeBytes, uint32_t numBytes, uint32_t alignment, bool isLinear, BindingInfo& bindingInfo);
+	// Allocate a memory node holding only this resource, it's sized exactly and has no allocator
+	void AllocateDedicated(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t numBytes, BindingInfo& bindingInfo);
+	// Memory node is returned to driver once it's empty, unless it's the last shared one of this pool
+	void FreeFromPool(MemoryPool& pool, const BindingInfo& bindingInfo);
+
+	uint32_t AllocateMemoryNode(MemoryPool& pool, uint32_t typeIndex, uint32_t memoryPropertyBits, uint32_t numBytes, bool isDedicated);
+	void FreeMemoryNode(MemoryNode& node);
+	bool SubAllocate(MemoryPool& pool, uint32_t nodeIndex, uint32_t numBytes, uint32_t alignment, BindingInfo& bindingInfo);
+
+	bool AllocateBufferMemory(uint32_t key, uint32_t numBytes, uint32_t alignment, uint32_t memoryTypeBits, uint32_t memoryPropertyBits);
 	void FreeBufferMemChunk(uint32_t key);
 
-	void AllocateImageMemory(uint32_t key, uint32_t numBytes, uint32_t memoryTypeBits, uint32_t memoryPropertyBits, uint32_t& typeIndex, uint32_t& offset);
+	bool AllocateImageMemory(uint32_t key, const VkImageCreateInfo& info, const VkMemoryRequirements& reqs, uint32_t memoryPropertyBits);
 	void FreeImageMemChunk(uint32_t key);
 
 	void UpdateMemoryChunk(VkDeviceMemory memory, uint32_t offset, uint32_t numBytes, void* pDst, const void* pData);
 	void ReleaseMemory();
 
 protected:
-	std::vector<MemoryNode>						m_bufferMemPool;
-	std::vector<MemoryNode>						m_imageMemPool;
-	std::vector<std::pair<BindingInfo, bool>>	m_bufferBindingTable;	// bool stands for whether it's freed
+	// Index: memory type index
+	std::vector<MemoryPool>						m_bufferMemPools;
+	std::vector<MemoryPool>						m_imageMemPools;
 
-	// uint32_t stands for actual image mem pool index
+	// Index: memory key
 	// bool stands for whether it's freed
-	std::vector<std::pair<uint32_t, bool>>		m_imageMemPoolLookupTable;
+	std::vector<std::pair<BindingInfo, bool>>	m_bufferBindingTable;
 
-	// uint32_t stands for actual buffer binding table index
 	// bool stands for whether it's freed
-	std::vector<std::pair<uint32_t, bool>>		m_bufferBindingLookupTable;
+	std::vector<std::pair<ImageBindingInfo, bool>>	m_imageBindingTable;
 
 	static const uint32_t						LOOKUP_TABLE_SIZE_INC = 256;
 
+	uint32_t									m_deviceMemoryAllocationCount = 0;
+	uint32_t									m_peakDeviceMemoryAllocationCount = 0;
+	uint32_t									m_dedicatedAllocationCount = 0;
+	uint32_t									m_bufferSubAllocationCount = 0;
+	uint32_t									m_imageSubAllocationCount = 0;
+	uint32_t									m_aliasedImageCount = 0;
+
 	friend class MemoryKey;
 };
\ No newline at end of file
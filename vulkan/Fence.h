@@ -14,6 +14,8 @@ public:
 public:
 	VkFence GetDeviceHandle() const { return m_fence; }
 	bool Signaled() const { return m_signaled; }
+	// Query fence status without blocking
+	bool CheckSignaled();
 	void Reset();
 	void Wait();
 
@@ -12,6 +12,7 @@
 #include "CommandBuffer.h"
 #include "Queue.h"
 #include "../thread/ThreadTaskQueue.hpp"
+#include "StagingBufferManager.h"
 #include <algorithm>
 #include "Semaphore.h"
 #include <stack>
@@ -92,6 +93,9 @@ void FrameManager::AfterAcquire(uint32_t index)
 	std::unique_lock<std::mutex> lock(m_mutex);
 	WaitForGPUWork(index);
 	m_currentFrameIndex = index;
+
+	// Staging ranges used by this frame last time are free now
+	StagingBufferMgr()->OnFrameGPUWorkDone(index);
 }
 
 void FrameManager::CacheSubmissioninfo(
@@ -141,7 +145,8 @@ void FrameManager::CacheSubmissioninfoInternal(
 	std::vector<std::shared_ptr<Semaphore>> _waitSemaphores = waitSemaphores;
 	_waitSemaphores.push_back(GetAcqurieDoneSemaphore());
 
-	std::vector<VkPipelineStageFlags> _waitStages;
+	std::vector<VkPipelineStageFlags> _waitStages = waitStages;
+	_waitStages.resize(waitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
 	_waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 
 	// Attach render done semaphores to signal list
@@ -196,6 +201,28 @@ void FrameManager::WaitForGPUWork(uint32_t frameIndex)
 {
 	WaitForFence(frameIndex);
 	m_submissionInfoTable[frameIndex].clear();
+
+	// Release retired resources once none of frames could use them
+	// They're destroyed after lock is released, as their destructors might retire other resources
+	std::vector<RetiredResource> releasedResources;
+	{
+		std::unique_lock<std::mutex> lock(m_retiredResourceMutex);
+		for (auto& retired : m_retiredResources)
+			retired.pendingFrameMask &= ~(1u << frameIndex);
+
+		auto iter = std::partition(m_retiredResources.begin(), m_retiredResources.end(), [](const RetiredResource& retired)
+		{
+			return retired.pendingFrameMask != 0;
+		});
+		releasedResources.assign(std::make_move_iterator(iter), std::make_move_iterator(m_retiredResources.end()));
+		m_retiredResources.erase(iter, m_retiredResources.end());
+	}
+}
+
+void FrameManager::RetireResource(const std::shared_ptr<void>& pResource)
+{
+	std::unique_lock<std::mutex> lock(m_retiredResourceMutex);
+	m_retiredResources.push_back({ pResource, (1u << m_maxFrameCount) - 1 });
 }
 
 // End work submission, which means that current frame's work has been submitted completely
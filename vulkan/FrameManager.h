@@ -29,6 +29,12 @@ class FrameManager : public DeviceObjectBase<FrameManager>
 		bool										submitted;
 	}SubmissionInfo;
 
+	typedef struct _RetiredResource
+	{
+		std::shared_ptr<void>						pResource;
+		uint32_t									pendingFrameMask;	// Bits of frames that might still use it on GPU
+	}RetiredResource;
+
 	typedef std::map<uint32_t, std::vector<std::shared_ptr<PerFrameResource>>> FrameResourceTable;
 	typedef std::map<uint32_t, std::vector<SubmissionInfo>> SubmissionInfoTable;
 
@@ -58,6 +64,9 @@ public:
 
 	void WaitForAllJobsDone();
 
+	// Keep a resource replaced in the middle of rendering alive until every frame in flight, including current one, is done on GPU
+	void RetireResource(const std::shared_ptr<void>& pResource);
+
 protected:
 	bool Init(const std::shared_ptr<Device>& pDevice, uint32_t maxFrameCount, const std::shared_ptr<FrameManager>& pSelf);
 	static std::shared_ptr<FrameManager> Create(const std::shared_ptr<Device>& pDevice, uint32_t maxFrameCount);
@@ -99,11 +108,15 @@ private:
 
 	SubmissionInfoTable						m_pendingSubmissionInfoTable;
 	SubmissionInfoTable						m_submissionInfoTable;
+	std::vector<RetiredResource>			m_retiredResources;
 
 	uint32_t m_maxFrameCount;
 
 	std::mutex										m_mutex;
+	// Resources are retired from any thread, while frame mutex is already held when retired ones are released
+	std::mutex										m_retiredResourceMutex;
 
 	friend class SwapChain;
 	friend class Queue;
+	friend class StagingBufferManager;
 };
\ No newline at end of file
@@ -39,12 +39,14 @@ bool GlobalDeviceObjects::InitObjects(const std::shared_ptr<Device>& pDevice)
 	m_pUniformBufferMgr = SharedBufferManager::Create(pDevice, 
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
 		(VkMemoryPropertyFlagBits)(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), 
-		UNIFORM_BUFFER_SIZE);
+		UNIFORM_BUFFER_SIZE,
+		true);
 
 	m_pShaderStorageBufferMgr = SharedBufferManager::Create(pDevice, 
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
 		(VkMemoryPropertyFlagBits)(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), 
-		SHADER_STORAGE_BUFFER_SIZE);
+		SHADER_STORAGE_BUFFER_SIZE,
+		true);
 
 	m_pIndirectBufferMgr = SharedBufferManager::Create(pDevice, 
 		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 
@@ -54,11 +56,15 @@ bool GlobalDeviceObjects::InitObjects(const std::shared_ptr<Device>& pDevice)
 	m_pStreamingBufferMgr = SharedBufferManager::Create(pDevice, 
 		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
 		(VkMemoryPropertyFlagBits)(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), 
-		ATTRIBUTE_BUFFER_SIZE);
+		ATTRIBUTE_BUFFER_SIZE,
+		true);
 
 	m_pSwapChain = SwapChain::Create(pDevice);
 
-	m_pThreadTaskQueue = std::make_shared<ThreadTaskQueue>(pDevice, FrameMgr()->MaxFrameCount(), FrameMgr());
+	m_pThreadTaskQueue = std::make_shared<ThreadTaskQueue>(FrameMgr()->MaxFrameCount(), [](uint32_t frameIndex)
+	{
+		return FrameMgr()->AllocatePerFrameResource(frameIndex);
+	});
 
 	m_pGlobalVulkanStates = GlobalVulkanStates::Create(pDevice);
 
@@ -17,6 +17,11 @@ Image::~Image()
 }
 
 bool Image::Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, const VkImageCreateInfo& info, uint32_t memoryPropertyFlag)
+{
+	return Init(pDevice, pSelf, info, memoryPropertyFlag, nullptr);
+}
+
+bool Image::Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, const VkImageCreateInfo& info, uint32_t memoryPropertyFlag, const std::shared_ptr<Image>& pAliasedImage)
 {
 	if (!DeviceObjectBase::Init(pDevice, pSelf))
 		return false;
@@ -38,7 +43,12 @@ bool Image::Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<I
 	m_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
 	CHECK_VK_ERROR(vkCreateImage(GetDevice()->GetDeviceHandle(), &m_info, nullptr, &m_image));
-	m_pMemKey = DeviceMemMgr()->AllocateImageMemChunk(GetSelfSharedPtr(), memoryPropertyFlag);
+	if (pAliasedImage != nullptr)
+		m_pMemKey = DeviceMemMgr()->AllocateAliasedImageMemChunk(GetSelfSharedPtr(), pAliasedImage->m_pMemKey);
+	else
+		m_pMemKey = DeviceMemMgr()->AllocateImageMemChunk(GetSelfSharedPtr(), memoryPropertyFlag);
+	if (m_pMemKey == nullptr)
+		return false;
 
 	m_info.initialLayout = layout;
 	m_memProperty = memoryPropertyFlag;
@@ -438,7 +448,8 @@ std::shared_ptr<Image> Image::CreateEmptyTexture
 	VkImageUsageFlags usage,
 	VkPipelineStageFlags stageFlag,
 	VkAccessFlags accessFlag,
-	VkImageViewCreateFlags createFlag
+	VkImageViewCreateFlags createFlag,
+	const std::shared_ptr<Image>& pAliasedImage
 )
 {
 	std::shared_ptr<Image> pTexture = std::make_shared<Image>();
@@ -465,7 +476,7 @@ std::shared_ptr<Image> Image::CreateEmptyTexture
 	textureCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	textureCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	if (pTexture.get() && pTexture->Init(pDevice, pTexture, textureCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+	if (pTexture.get() && pTexture->Init(pDevice, pTexture, textureCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pAliasedImage))
 		return pTexture;
 	return nullptr;
 }
@@ -600,6 +611,24 @@ std::shared_ptr<Image> Image::CreateOffscreenTexture2D(const std::shared_ptr<Dev
 	);
 }
 
+std::shared_ptr<Image> Image::CreateAliasedOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pAliasedImage, const Vector2ui& size, VkFormat format)
+{
+	return CreateEmptyTexture
+	(
+		pDevice,
+		{ size.x, size.y, 1 },
+		1,
+		1,
+		format,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+		0,
+		pAliasedImage
+	);
+}
+
 std::shared_ptr<Image> Image::CreateMipmapOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const Vector2ui& size, VkFormat format, VkImageLayout layout)
 {
 	uint32_t smaller = size.y < size.x ? size.y : size.x;
@@ -49,6 +49,7 @@ protected:
 
 	bool Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, VkImage img);
 	bool Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, const VkImageCreateInfo& info, uint32_t memoryPropertyFlag);
+	bool Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, const VkImageCreateInfo& info, uint32_t memoryPropertyFlag, const std::shared_ptr<Image>& pAliasedImage);
 	bool Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pSelf, const GliImageWrapper& gliTex, const VkImageCreateInfo& info, uint32_t memoryPropertyFlag);
 
 	virtual std::shared_ptr<StagingBuffer> PrepareStagingBuffer(const GliImageWrapper& gliTex, const std::shared_ptr<CommandBuffer>& pCmdBuffer);
@@ -67,7 +68,8 @@ public:
 		VkImageUsageFlags usage,
 		VkPipelineStageFlags stageFlag,
 		VkAccessFlags accessFlag,
-		VkImageViewCreateFlags createFlag = 0
+		VkImageViewCreateFlags createFlag = 0,
+		const std::shared_ptr<Image>& pAliasedImage = nullptr	// Share memory with this image if it fits, their lifetimes within a frame must not overlap
 	);
 
 	static std::shared_ptr<Image> CreateTextureWithGLIImage
@@ -90,6 +92,7 @@ public:
 	static std::shared_ptr<Image> CreateEmptyTexture2DForCompute(const std::shared_ptr<Device>& pDevice, const Vector2ui& size, VkFormat format);
 	static std::shared_ptr<Image> CreateOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const Vector2ui& size, VkFormat format);
 	static std::shared_ptr<Image> CreateOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const Vector2ui& size, VkFormat format, VkImageLayout layout);
+	static std::shared_ptr<Image> CreateAliasedOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<Image>& pAliasedImage, const Vector2ui& size, VkFormat format);
 	static std::shared_ptr<Image> CreateMipmapOffscreenTexture2D(const std::shared_ptr<Device>& pDevice, const Vector2ui& size, VkFormat format, VkImageLayout layout);
 
 	// Texture2D Array:
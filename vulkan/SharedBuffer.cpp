@@ -24,7 +24,7 @@ bool SharedBuffer::IsHostVisible() const
 
 VkBuffer SharedBuffer::GetDeviceHandle() const
 {
-	return m_pBufferKey->GetSharedBufferMgr()->GetDeviceHandle();
+	return m_pBufferKey->GetSharedBufferMgr()->GetBufferDesc(m_pBufferKey).buffer;
 }
 
 void SharedBuffer::UpdateByteStream(const void* pData, uint32_t offset, uint32_t numBytes)
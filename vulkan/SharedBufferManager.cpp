@@ -3,8 +3,6 @@
 #include "StagingBufferManager.h"
 #include "SharedBuffer.h"
 
-uint32_t SharedBufferManager::m_numAllocatedKeys = 0;
-
 std::shared_ptr<BufferKey> BufferKey::Create(const std::shared_ptr<SharedBufferManager>& pSharedBufMgr, uint32_t key)
 {
 	std::shared_ptr<BufferKey> pBufKey = std::make_shared<BufferKey>();
@@ -29,16 +27,22 @@ bool SharedBufferManager::Init(const std::shared_ptr<Device>& pDevice,
 	const std::shared_ptr<SharedBufferManager>& pSelf,
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlagBits memFlag,
-	uint32_t numBytes)
+	uint32_t numBytes,
+	bool allowDedicated)
 {
 	if (!DeviceObjectBase::Init(pDevice, pSelf))
 		return false;
 
+	m_usage = usage;
+	m_memFlag = memFlag;
+	m_allowDedicated = allowDedicated;
+
 	VkBufferCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	info.usage = usage;
 	info.size = numBytes;
 	m_pBuffer = Buffer::Create(pDevice, info, memFlag);
+	m_pRangeTable = std::make_shared<BufferRangeTable>(numBytes);
 
 	return true;
 }
@@ -46,104 +50,88 @@ bool SharedBufferManager::Init(const std::shared_ptr<Device>& pDevice,
 std::shared_ptr<SharedBufferManager> SharedBufferManager::Create(const std::shared_ptr<Device>& pDevice,
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlagBits memFlag,
-	uint32_t numBytes)
+	uint32_t numBytes,
+	bool allowDedicated)
 {
 	std::shared_ptr<SharedBufferManager> pSharedBufferManager = std::make_shared<SharedBufferManager>();
-	if (pSharedBufferManager.get() && pSharedBufferManager->Init(pDevice, pSharedBufferManager, usage, memFlag, numBytes))
+	if (pSharedBufferManager.get() && pSharedBufferManager->Init(pDevice, pSharedBufferManager, usage, memFlag, numBytes, allowDedicated))
 		return pSharedBufferManager;
 	return nullptr;
 }
 
 void SharedBufferManager::FreeBuffer(uint32_t index)
 {
-	uint32_t bufferChunkIndex = m_lookupTable[index];
-	m_lookupTable.erase(index);
-	m_bufferTable.erase(m_bufferTable.begin() + bufferChunkIndex);
-
-	// Update lookup table since one record is removed, all records after it must be decreased
-	for (auto& value : m_lookupTable)
-	{
-		if (value.second > bufferChunkIndex)
-			value.second--;
-	}
+	m_dedicatedBuffers[index] = nullptr;
+	m_pRangeTable->Free(index);
 }
 
 std::shared_ptr<BufferKey> SharedBufferManager::AllocateBuffer(uint32_t numBytes)
 {
-	VkDescriptorBufferInfo info = {};
-	info.buffer = GetBuffer()->GetDeviceHandle();
-	uint32_t offset = 0;
-	uint32_t endByte = 0;
+	// A chunk taking a large part of shared buffer would soon exhaust it, so it gets a buffer of its own
+	uint32_t key = BufferRangeTable::NULL_KEY;
+	if (!m_allowDedicated || numBytes < m_pRangeTable->GetTotalBytes() / 4)
+		key = m_pRangeTable->Allocate(numBytes);
 
-	for (uint32_t i = 0; i < m_bufferTable.size(); i++)
+	std::shared_ptr<Buffer> pDedicatedBuffer;
+	if (key == BufferRangeTable::NULL_KEY)
 	{
-		endByte = offset + numBytes - 1;
-		if (endByte < m_bufferTable[i].offset)
-		{
-			// Update lookup table since one record is inserted, all records after it must be increased
-			for (auto& value : m_lookupTable)
-			{
-				if (value.second >= i)
-					value.second++;
-			}
-
-			// Insert buffer chunk
-			info.offset = offset;
-			info.range = numBytes;
-			m_bufferTable.insert(m_bufferTable.begin() + i, info);
-
-			// Update lookup table
-			m_lookupTable[m_numAllocatedKeys] = i;
-
-			// Generate BufferKey
-			return BufferKey::Create(GetSelfSharedPtr(), m_numAllocatedKeys++);
-		}
-		else
-		{
-			offset = (uint32_t)m_bufferTable[i].offset + (uint32_t)m_bufferTable[i].range;
-		}
+		if (!m_allowDedicated)
+			return nullptr;
+
+		VkBufferCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		info.usage = m_usage;
+		info.size = numBytes;
+		pDedicatedBuffer = Buffer::Create(GetDevice(), info, m_memFlag);
+		if (pDedicatedBuffer == nullptr)
+			return nullptr;
+
+		key = m_pRangeTable->AllocateOutside(numBytes);
 	}
 
-	if (offset + numBytes > m_pBuffer->GetBufferInfo().size)
-		return nullptr;
-
-	// Insert buffer chunk
-	info.offset = offset;
-	info.range = numBytes;
-	m_bufferTable.insert(m_bufferTable.end(), info);
-
-	// Update lookup table
-	m_lookupTable[m_numAllocatedKeys] = (uint32_t)m_bufferTable.size() - 1;
+	if (key >= m_dedicatedBuffers.size())
+		m_dedicatedBuffers.resize(key + 1);
+	m_dedicatedBuffers[key] = pDedicatedBuffer;
 
 	// Generate BufferKey
-	return BufferKey::Create(GetSelfSharedPtr(), m_numAllocatedKeys++);
+	return BufferKey::Create(GetSelfSharedPtr(), key);
 }
 
 void SharedBufferManager::UpdateByteStream(const void* pData, const std::shared_ptr<Buffer>& pWrapperBuffer, const std::shared_ptr<BufferKey>& pBufKey, uint32_t offset, uint32_t numBytes)
 {
 	if (m_pBuffer->IsHostVisible())
-		m_pBuffer->UpdateByteStream(pData, offset + (uint32_t)m_bufferTable[m_lookupTable[pBufKey->m_key]].offset, numBytes);
+		GetBuffer(pBufKey)->UpdateByteStream(pData, offset + m_pRangeTable->GetOffset(pBufKey->m_key), numBytes);
 	// Since shared buffer manager holds a buffer shared by different shared buffers, with various usage and access flags, we can't simply let buffer do its update
 	// Without specific buffer's information
 	// So here we do a little hack to override, by directly call staging buffer to update wrapper buffer with its information
 	else
-		StagingBufferMgr()->UpdateByteStream(pWrapperBuffer, pData, offset + (uint32_t)m_bufferTable[m_lookupTable[pBufKey->m_key]].offset, numBytes);
+		StagingBufferMgr()->UpdateByteStream(pWrapperBuffer, pData, offset + m_pRangeTable->GetOffset(pBufKey->m_key), numBytes);
 }
 
 void SharedBufferManager::UpdateByteStream(const void* pData, const std::shared_ptr<SharedBuffer>& pWrapperBuffer, const std::shared_ptr<BufferKey>& pBufKey, uint32_t offset, uint32_t numBytes)
 {
 	if (m_pBuffer->IsHostVisible())
-		m_pBuffer->UpdateByteStream(pData, offset + (uint32_t)m_bufferTable[m_lookupTable[pBufKey->m_key]].offset, numBytes);
+		GetBuffer(pBufKey)->UpdateByteStream(pData, offset + m_pRangeTable->GetOffset(pBufKey->m_key), numBytes);
 	else
-		StagingBufferMgr()->UpdateByteStream(pWrapperBuffer, pData, offset + (uint32_t)m_bufferTable[m_lookupTable[pBufKey->m_key]].offset, numBytes);
+		StagingBufferMgr()->UpdateByteStream(pWrapperBuffer, pData, offset + m_pRangeTable->GetOffset(pBufKey->m_key), numBytes);
 }
 
 uint32_t SharedBufferManager::GetOffset(const std::shared_ptr<BufferKey>& pBufKey)
 { 
-	return (uint32_t)m_bufferTable[m_lookupTable[pBufKey->m_key]].offset;
+	return m_pRangeTable->GetOffset(pBufKey->m_key);
 }
 
 VkDescriptorBufferInfo SharedBufferManager::GetBufferDesc(const std::shared_ptr<BufferKey>& pBufKey)
 { 
-	return m_bufferTable[m_lookupTable[pBufKey->m_key]]; 
+	VkDescriptorBufferInfo info = {};
+	info.buffer = GetBuffer(pBufKey)->GetDeviceHandle();
+	info.offset = m_pRangeTable->GetOffset(pBufKey->m_key);
+	info.range = m_pRangeTable->GetRange(pBufKey->m_key);
+	return info;
+}
+
+std::shared_ptr<Buffer> SharedBufferManager::GetBuffer(const std::shared_ptr<BufferKey>& pBufKey) const
+{
+	const std::shared_ptr<Buffer>& pDedicatedBuffer = m_dedicatedBuffers[pBufKey->m_key];
+	return pDedicatedBuffer != nullptr ? pDedicatedBuffer : m_pBuffer;
 }
\ No newline at end of file
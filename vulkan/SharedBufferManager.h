@@ -2,6 +2,7 @@
 
 #include "Buffer.h"
 #include "GlobalDeviceObjects.h"
+#include "../common/BufferRangeTable.h"
 
 class SharedBufferManager;
 class SharedBuffer;
@@ -31,7 +32,8 @@ protected:
 		const std::shared_ptr<SharedBufferManager>& pSelf,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlagBits memFlag,
-		uint32_t numBytes);
+		uint32_t numBytes,
+		bool allowDedicated);
 
 	void FreeBuffer(uint32_t index);
 
@@ -39,7 +41,8 @@ public:
 	static std::shared_ptr<SharedBufferManager> Create(const std::shared_ptr<Device>& pDevice,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlagBits memFlag,
-		uint32_t numBytes);
+		uint32_t numBytes,
+		bool allowDedicated = false);
 
 public:
 	std::shared_ptr<Buffer> GetBuffer() const { return m_pBuffer; }
@@ -47,6 +50,8 @@ public:
 	std::shared_ptr<BufferKey> AllocateBuffer(uint32_t numBytes);
 	uint32_t GetOffset(const std::shared_ptr<BufferKey>& pBufKey);
 	VkDescriptorBufferInfo GetBufferDesc(const std::shared_ptr<BufferKey>& pBufKey);
+	// Buffer holding this key's range, either shared buffer or a dedicated one
+	std::shared_ptr<Buffer> GetBuffer(const std::shared_ptr<BufferKey>& pBufKey) const;
 
 	// Since m_pBuffer is used as internal buffer for shared buffers, we cannot directly use it, as many buffer specific member variables are missing
 	// So I add one more input parameter "pWrapperBuffer", which wrappers "m_pBuffer" and behave exactly like a shared buffer with its member variable inited properly
@@ -56,15 +61,17 @@ public:
 
 protected:
 	std::shared_ptr<Buffer>					m_pBuffer;
+	VkBufferUsageFlags						m_usage;
+	VkMemoryPropertyFlagBits				m_memFlag;
 
-	// Where buffer chunks located, one after another
-	std::vector<VkDescriptorBufferInfo>		m_bufferTable;
+	// Large allocations get dedicated buffers instead of failing or eating up shared buffer
+	// Only for managers whose buffers are referenced per chunk, e.g. through descriptors, not bound as a whole
+	bool									m_allowDedicated;
 
-	// Key is BufferKey's m_key, and value is m_bufferTable's index
-	std::map<uint32_t, uint32_t>			m_lookupTable;
-
-	// After allocating a buffer key, this static variable is increased by one
-	static uint32_t m_numAllocatedKeys;
+	// Ranges of m_pBuffer, indexed by BufferKey's m_key, a key stays valid until its BufferKey is destroyed
+	std::shared_ptr<BufferRangeTable>		m_pRangeTable;
+	// Index: BufferKey's m_key, buffer of its own for chunks too large for shared buffer, nullptr for others
+	std::vector<std::shared_ptr<Buffer>>	m_dedicatedBuffers;
 
 	friend class BufferKey;
 };
\ No newline at end of file
@@ -34,6 +34,11 @@ void SharedIndirectBuffer::SetIndirectCmd(uint32_t index, const VkDrawIndexedInd
 	UpdateByteStream(&cmd, index * sizeof(VkDrawIndexedIndirectCommand), sizeof(VkDrawIndexedIndirectCommand));
 }
 
+void SharedIndirectBuffer::SetIndirectCmds(uint32_t index, const VkDrawIndexedIndirectCommand* pCmds, uint32_t count)
+{
+	UpdateByteStream(pCmds, index * sizeof(VkDrawIndexedIndirectCommand), count * sizeof(VkDrawIndexedIndirectCommand));
+}
+
 void SharedIndirectBuffer::SetIndirectCmdCount(uint32_t count)
 {
 	UpdateByteStream(&count, 0, sizeof(uint32_t));
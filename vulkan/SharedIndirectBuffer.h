@@ -12,6 +12,8 @@ public:
 
 public:
 	void SetIndirectCmd(uint32_t index, const VkDrawIndexedIndirectCommand& cmd);
+	// Upload "count" consecutive commands with one staging copy
+	void SetIndirectCmds(uint32_t index, const VkDrawIndexedIndirectCommand* pCmds, uint32_t count);
 	void SetIndirectCmdCount(uint32_t count);
 
 protected:
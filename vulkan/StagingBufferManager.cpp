@@ -6,6 +6,8 @@
 #include "CommandBuffer.h"
 #include "PerFrameResource.h"
 #include "FrameManager.h"
+#include "Fence.h"
+#include "Semaphore.h"
 
 bool StagingBufferManager::Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<StagingBufferManager>& pSelf)
 {
@@ -27,57 +29,235 @@ std::shared_ptr<StagingBufferManager> StagingBufferManager::Create(const std::sh
 
 void StagingBufferManager::FlushDataMainThread()
 {
+	if (m_pendingUpdateBuffer.empty())
+		return;
+
 	std::shared_ptr<CommandBuffer> pCmdBuffer = MainThreadGraphicPool()->AllocatePrimaryCommandBuffer();
 
 	pCmdBuffer->StartPrimaryRecording();
+	RecordCopies(pCmdBuffer, m_pendingUpdateBuffer);
+	pCmdBuffer->EndPrimaryRecording();
 
-	// Copy each chunk to dst buffer
-	std::for_each(m_pendingUpdateBuffer.begin(), m_pendingUpdateBuffer.end(), [&](const PendingBufferInfo& info)
+	std::shared_ptr<Fence> pFence;
+	if (m_freeFences.empty())
+		pFence = Fence::Create(GetDevice());
+	else
 	{
-		VkBufferCopy copy = {};
-		copy.dstOffset = info.dstOffset;
-		copy.srcOffset = info.srcOffset;
-		copy.size = info.numBytes;
-		pCmdBuffer->CopyBuffer(m_pStagingBufferPool, info.pBuffer, { copy });
-	});
+		pFence = m_freeFences.back();
+		m_freeFences.pop_back();
+	}
 
-	pCmdBuffer->EndPrimaryRecording();
+	std::shared_ptr<Semaphore> pSemaphore;
+	if (m_freeSemaphores.empty())
+		pSemaphore = Semaphore::Create(GetDevice());
+	else
+	{
+		pSemaphore = m_freeSemaphores.back();
+		m_freeSemaphores.pop_back();
+	}
+	m_signaledSemaphores.push_back(pSemaphore);
 
-	GlobalGraphicQueue()->SubmitCommandBuffer(pCmdBuffer, nullptr, true);
+	// No need to wait for queue idle, ring range is recycled once fence signals, and frame submission waits on semaphore
+	pFence->Reset();
+	GlobalGraphicQueue()->SubmitCommandBuffer(pCmdBuffer, {}, {}, { pSemaphore }, pFence);
 
+	m_inFlightBatches.push_back({ m_ringHead, pFence, false, pCmdBuffer, std::move(m_pendingUpdateBuffer) });
 	m_pendingUpdateBuffer.clear();
-	m_usedNumBytes = 0;
 }
 
-void StagingBufferManager::RecordDataFlush(const std::shared_ptr<CommandBuffer>& pCmdBuffer)
+void StagingBufferManager::WaitForFlushedData()
+{
+	FlushDataMainThread();
+
+	for (auto& batch : m_inFlightBatches)
+		WaitForBatch(batch);
+
+	RetireCompletedBatches();
+}
+
+std::vector<std::shared_ptr<Semaphore>> StagingBufferManager::AcquireFlushSemaphores()
+{
+	uint32_t frameIndex = FrameMgr()->FrameIndex();
+	if (frameIndex >= (uint32_t)m_frameWaitSemaphores.size())
+		m_frameWaitSemaphores.resize(frameIndex + 1);
+
+	std::vector<std::shared_ptr<Semaphore>> semaphores = std::move(m_signaledSemaphores);
+	m_signaledSemaphores.clear();
+
+	m_frameWaitSemaphores[frameIndex].insert(m_frameWaitSemaphores[frameIndex].end(), semaphores.begin(), semaphores.end());
+	return semaphores;
+}
+
+void StagingBufferManager::OnFrameGPUWorkDone(uint32_t frameIndex)
+{
+	if (frameIndex < (uint32_t)m_frameWaitSemaphores.size())
+	{
+		m_freeSemaphores.insert(m_freeSemaphores.end(), m_frameWaitSemaphores[frameIndex].begin(), m_frameWaitSemaphores[frameIndex].end());
+		m_frameWaitSemaphores[frameIndex].clear();
+	}
+
+	RetireCompletedBatches();
+}
+
+void StagingBufferManager::RecordCopies(const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<PendingBufferInfo>& copies)
 {
-	// Copy each chunk to dst buffer
-	std::for_each(m_pendingUpdateBuffer.begin(), m_pendingUpdateBuffer.end(), [&](const PendingBufferInfo& info)
+	// Sort copies by destination and source buffer, stable sort keeps submission order of copies to the same offset
+	std::vector<uint32_t> sortedIndices(copies.size());
+	for (uint32_t i = 0; i < (uint32_t)copies.size(); i++)
+		sortedIndices[i] = i;
+
+	std::stable_sort(sortedIndices.begin(), sortedIndices.end(), [&copies](uint32_t left, uint32_t right)
 	{
-		VkBufferCopy copy = {};
-		copy.dstOffset = info.dstOffset;
-		copy.srcOffset = info.srcOffset;
-		copy.size = info.numBytes;
-		pCmdBuffer->CopyBuffer(m_pStagingBufferPool, info.pBuffer, { copy });
+		const PendingBufferInfo& l = copies[left];
+		const PendingBufferInfo& r = copies[right];
+		if (l.pBuffer->GetDeviceHandle() != r.pBuffer->GetDeviceHandle())
+			return l.pBuffer->GetDeviceHandle() < r.pBuffer->GetDeviceHandle();
+		if (l.pStagingBuffer != r.pStagingBuffer)
+			return l.pStagingBuffer < r.pStagingBuffer;
+		return l.dstOffset < r.dstOffset;
 	});
 
-	m_pendingUpdateBuffer.clear();
-	m_usedNumBytes = 0;
+	uint32_t groupStart = 0;
+	while (groupStart < (uint32_t)sortedIndices.size())
+	{
+		const PendingBufferInfo& first = copies[sortedIndices[groupStart]];
+
+		uint32_t groupEnd = groupStart + 1;
+		while (groupEnd < (uint32_t)sortedIndices.size()
+			&& copies[sortedIndices[groupEnd]].pBuffer->GetDeviceHandle() == first.pBuffer->GetDeviceHandle()
+			&& copies[sortedIndices[groupEnd]].pStagingBuffer == first.pStagingBuffer)
+			groupEnd++;
+
+		// Regions of a single copy command must not overlap, adjacent ones are merged into one region
+		std::vector<VkBufferCopy> regions;
+		bool overlapped = false;
+		for (uint32_t i = groupStart; i < groupEnd; i++)
+		{
+			const PendingBufferInfo& info = copies[sortedIndices[i]];
+			if (!regions.empty())
+			{
+				VkBufferCopy& last = regions.back();
+				if (info.dstOffset < last.dstOffset + last.size)
+				{
+					overlapped = true;
+					break;
+				}
+
+				if (info.dstOffset == last.dstOffset + last.size && info.srcOffset == last.srcOffset + last.size)
+				{
+					last.size += info.numBytes;
+					continue;
+				}
+			}
+
+			regions.push_back({ info.srcOffset, info.dstOffset, info.numBytes });
+		}
+
+		if (!overlapped)
+			pCmdBuffer->CopyBuffer(first.pStagingBuffer, first.pBuffer, regions);
+		else
+		{
+			// Same range is updated more than once, copy them one by one in submission order, so the latest one wins
+			std::sort(sortedIndices.begin() + groupStart, sortedIndices.begin() + groupEnd);
+			for (uint32_t i = groupStart; i < groupEnd; i++)
+			{
+				const PendingBufferInfo& info = copies[sortedIndices[i]];
+				pCmdBuffer->CopyBuffer(info.pStagingBuffer, info.pBuffer, { { info.srcOffset, info.dstOffset, info.numBytes } });
+			}
+		}
+
+		groupStart = groupEnd;
+	}
 }
 
 void StagingBufferManager::UpdateByteStream(const std::shared_ptr<BufferBase>& pBuffer, const void* pData, uint32_t offset, uint32_t numBytes)
 {
-	uint32_t currentOffset = m_usedNumBytes;
-	m_pendingUpdateBuffer.push_back({ pBuffer, offset, currentOffset, numBytes });
-	m_usedNumBytes += numBytes;
+	// Large uploads are split into chunks, so that ring only needs to hold a part of them at a time
+	uint32_t uploadedBytes = 0;
+	while (uploadedBytes < numBytes)
+	{
+		uint32_t chunkBytes = numBytes - uploadedBytes;
+		chunkBytes = chunkBytes > MAX_UPLOAD_CHUNK_SIZE ? MAX_UPLOAD_CHUNK_SIZE : chunkBytes;
+
+		std::shared_ptr<StagingBuffer> pStagingBuffer;
+		uint32_t srcOffset;
+		AcquireStagingSpace(chunkBytes, pStagingBuffer, srcOffset);
+
+		pStagingBuffer->UpdateByteStream((const char*)pData + uploadedBytes, srcOffset, chunkBytes);
+		m_pendingUpdateBuffer.push_back({ pBuffer, pStagingBuffer, offset + uploadedBytes, srcOffset, chunkBytes });
+
+		uploadedBytes += chunkBytes;
+	}
+}
+
+void StagingBufferManager::AcquireStagingSpace(uint32_t numBytes, std::shared_ptr<StagingBuffer>& pStagingBuffer, uint32_t& offset)
+{
+	RetireCompletedBatches();
 
-	if (m_usedNumBytes > m_pStagingBufferPool->GetBufferInfo().size)
+	// Chunks are much smaller than ring, so it always fits once everything in flight is recycled
+	while (!AllocateFromRing(numBytes, offset))
 	{
-		// Acquire a bigger chunck of memory for staging buffer
-		// Copy data into new staging buffer
-		// Delete old staging buffer
-		assert(false);
+		// Pending copies hold ring space as well, submit them so that they could be recycled
+		if (!m_pendingUpdateBuffer.empty())
+		{
+			FlushDataMainThread();
+			continue;
+		}
+
+		ASSERTION(!m_inFlightBatches.empty());
+		WaitForBatch(m_inFlightBatches.front());
+		RetireCompletedBatches();
 	}
 
-	m_pStagingBufferPool->UpdateByteStream(pData, currentOffset, numBytes);
+	pStagingBuffer = m_pStagingBufferPool;
+}
+
+bool StagingBufferManager::AllocateFromRing(uint32_t numBytes, uint32_t& offset)
+{
+	uint64_t ringSize = m_pStagingBufferPool->GetBufferInfo().size;
+	uint64_t alignedBytes = (numBytes + STAGING_OFFSET_ALIGNMENT - 1) / STAGING_OFFSET_ALIGNMENT * STAGING_OFFSET_ALIGNMENT;
+
+	// Allocation has to be contiguous, skip the rest of ring if it doesn't fit
+	uint64_t position = m_ringHead % ringSize;
+	uint64_t padding = position + alignedBytes > ringSize ? ringSize - position : 0;
+
+	if (m_ringHead + padding + alignedBytes - m_ringTail > ringSize)
+		return false;
+
+	m_ringHead += padding;
+	offset = (uint32_t)(m_ringHead % ringSize);
+	m_ringHead += alignedBytes;
+	return true;
+}
+
+void StagingBufferManager::RetireCompletedBatches()
+{
+	// Batches are recycled in order, as ring space is freed from tail
+	while (!m_inFlightBatches.empty())
+	{
+		InFlightBatch& batch = m_inFlightBatches.front();
+		if (!batch.isDone)
+			batch.isDone = batch.pFence->CheckSignaled();
+
+		if (!batch.isDone)
+			break;
+
+		m_freeFences.push_back(batch.pFence);
+
+		m_ringTail = batch.ringEnd;
+		m_inFlightBatches.pop_front();
+	}
+
+	// Nothing in flight or pending, restart from the beginning of ring to reduce wrapping
+	if (m_inFlightBatches.empty() && m_pendingUpdateBuffer.empty())
+		m_ringHead = m_ringTail = 0;
+}
+
+void StagingBufferManager::WaitForBatch(InFlightBatch& batch)
+{
+	if (batch.isDone)
+		return;
+
+	batch.pFence->Wait();
+	batch.isDone = true;
 }
\ No newline at end of file
@@ -1,38 +1,84 @@
 #pragma once
 
 #include "StagingBuffer.h"
+#include <deque>
 
 class PerFrameResource;
 class CommandBuffer;
 class BufferBase;
+class Fence;
+class Semaphore;
 
+// Uploads go through a ring of host visible memory
+// A flushed range of ring is recycled once the fence of its submission signals
+// Each flush signals a semaphore as well, which the next frame submission waits on, so that frames never read half uploaded data
 class StagingBufferManager : public DeviceObjectBase<StagingBufferManager>
 {
 	typedef struct _PendingBufferInfo
 	{
 		std::shared_ptr<BufferBase> pBuffer;
+		std::shared_ptr<StagingBuffer> pStagingBuffer;
 		uint32_t dstOffset;
 		uint32_t srcOffset;
 		uint32_t numBytes;
 	}PendingBufferInfo;
 
+	typedef struct _InFlightBatch
+	{
+		uint64_t						ringEnd;		// Ring position right after this batch
+		std::shared_ptr<Fence>			pFence;
+		bool							isDone;
+		std::shared_ptr<CommandBuffer>	pCmdBuffer;
+		std::vector<PendingBufferInfo>	copies;			// Keep buffers alive until copies are done
+	}InFlightBatch;
+
 public:
 	bool Init(const std::shared_ptr<Device>& pDevice, const std::shared_ptr<StagingBufferManager>& pSelf);
 
 	static std::shared_ptr<StagingBufferManager> Create(const std::shared_ptr<Device>& pDevice);
 
 public:
+	// Submit pending copies to graphic queue, it doesn't wait for them to finish
 	void FlushDataMainThread();
-	void RecordDataFlush(const std::shared_ptr<CommandBuffer>& pCmdBuffer);
+	// Block until all flushed copies are done, used by setup code whose submissions don't go through frame manager
+	void WaitForFlushedData();
+	// Semaphores signaled by flushes since last call, current frame submission has to wait on them
+	std::vector<std::shared_ptr<Semaphore>> AcquireFlushSemaphores();
+
+	// Called by frame manager once GPU work of a frame is done
+	void OnFrameGPUWorkDone(uint32_t frameIndex);
 
 protected:
 	void UpdateByteStream(const std::shared_ptr<BufferBase>& pBuffer, const void* pData, uint32_t offset, uint32_t numBytes);
 
+	void AcquireStagingSpace(uint32_t numBytes, std::shared_ptr<StagingBuffer>& pStagingBuffer, uint32_t& offset);
+	bool AllocateFromRing(uint32_t numBytes, uint32_t& offset);
+	void RetireCompletedBatches();
+	void WaitForBatch(InFlightBatch& batch);
+
+	// Copies to the same destination buffer are merged into one copy command with multiple regions
+	void RecordCopies(const std::shared_ptr<CommandBuffer>& pCmdBuffer, const std::vector<PendingBufferInfo>& copies);
+
 protected:
 	std::shared_ptr<StagingBuffer>	m_pStagingBufferPool;
 	std::vector<PendingBufferInfo>	m_pendingUpdateBuffer;
-	uint32_t						m_usedNumBytes = 0;
+
+	// Ring positions keep increasing, actual offset is position modulo ring size
+	uint64_t						m_ringHead = 0;
+	uint64_t						m_ringTail = 0;
+	std::deque<InFlightBatch>		m_inFlightBatches;
+	std::vector<std::shared_ptr<Fence>>	m_freeFences;
+
+	// Semaphores are recycled once the frame waiting on them is done on GPU
+	std::vector<std::shared_ptr<Semaphore>>					m_signaledSemaphores;
+	std::vector<std::vector<std::shared_ptr<Semaphore>>>	m_frameWaitSemaphores;
+	std::vector<std::shared_ptr<Semaphore>>					m_freeSemaphores;
+
 	const static uint32_t STAGING_BUFFER_INC = 1024 * 1024 * 64;
+	// Uploads larger than this are split into chunks
+	const static uint32_t MAX_UPLOAD_CHUNK_SIZE = STAGING_BUFFER_INC / 4;
+	const static uint32_t STAGING_OFFSET_ALIGNMENT = 16;
+
 	friend class Buffer;
 	friend class Image;
 	friend class SharedBufferManager;
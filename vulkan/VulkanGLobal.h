@@ -199,6 +199,7 @@ public:
 	std::shared_ptr<BaseObject>			m_pSceneRootObject;
 
 	std::vector<std::shared_ptr<CommandBuffer>> m_commandBufferList;
+	std::vector<uint32_t> m_commandBufferReallocationCounts;
 
 #if defined(_WIN32)
 	HINSTANCE							m_hPlatformInst;
@@ -14,6 +14,7 @@
 #include "StagingBuffer.h"
 #include "Queue.h"
 #include "StagingBufferManager.h"
+#include "DeviceMemoryManager.h"
 #include "FrameManager.h"
 #include "../thread/ThreadWorker.hpp"
 #include <gli\gli.hpp>
@@ -40,6 +41,7 @@
 #include "../component/AnimationController.h"
 #include "../class/PerFrameData.h"
 #include "../class/FrameEventManager.h"
+#include "../class/VisibilityCuller.h"
 
 bool PREBAKE_CB = true;
 
@@ -319,7 +321,9 @@ void VulkanGlobal::Update()
 		if (fpsTimer > 1000.0)
 		{
 			std::stringstream ss;
-			ss << "Elapsed Time:" << 1000.0 / frameCount;
+			ss << "Elapsed Time:" << 1000.0 / frameCount << " Uniform Upload Bytes:" << PerFrameDataStorage::GetUploadedBytes()
+				<< " Record Time:" << RenderWorkManager::GetInstance()->GetRenderGraph()->GetRecordTime()
+				<< "ms Serial Record Time:" << RenderWorkManager::GetInstance()->GetRenderGraph()->GetSerialRecordTime() << "ms";
 			SetWindowText(m_hWindow, ss.str().c_str());
 			fpsTimer = 0.0;
 			frameCount = 0;
@@ -898,12 +902,23 @@ std::shared_ptr<VariableChanger> c;
 
 void VulkanGlobal::EndSetup()
 {
-	GlobalDeviceObjects::GetInstance()->GetStagingBufferMgr()->FlushDataMainThread();
+	// Scene data has to be on GPU before the first frame
+	GlobalDeviceObjects::GetInstance()->GetStagingBufferMgr()->WaitForFlushedData();
 	m_commandBufferList.resize(GetSwapChain()->GetSwapChainImageCount() * 2);
+	m_commandBufferReallocationCounts.resize(GetSwapChain()->GetSwapChainImageCount() * 2);
 
 	m_pRootObject->Awake();
 	m_pRootObject->Start();
 
+	// Report how device memory ends up being allocated after scene setup
+	std::cout << "Device memory allocations: " << DeviceMemMgr()->GetDeviceMemoryAllocationCount()
+		<< " (peak " << DeviceMemMgr()->GetPeakDeviceMemoryAllocationCount()
+		<< ", dedicated " << DeviceMemMgr()->GetDedicatedAllocationCount() << ")"
+		<< ", buffer sub-allocations: " << DeviceMemMgr()->GetBufferSubAllocationCount()
+		<< ", image sub-allocations: " << DeviceMemMgr()->GetImageSubAllocationCount()
+		<< ", aliased images: " << DeviceMemMgr()->GetAliasedImageCount() << "\n";
+	std::cout << RenderWorkManager::GetInstance()->GetRenderGraph()->Dump();
+
 	c = std::make_shared<VariableChanger>();
 	InputHub::GetInstance()->Register(c);
 }
@@ -941,9 +956,17 @@ void VulkanGlobal::Draw()
 	m_pRootObject->LateUpdate();
 	m_pRootObject->UpdateCachedData();
 	m_pRootObject->OnPreRender();
+
+	// Cull renderers before they're inserted into render queues, shadow map culling planes are set by light
+	PyramidFrustumd cameraFrustum = m_pCameraComp->GetCameraFrustum();
+	cameraFrustum.Transform(m_pCameraObj->GetCachedWorldTransform());
+	VisibilityCuller::GetInstance()->SetCullingFrustum(RenderWorkManager::Scene, cameraFrustum);
+	VisibilityCuller::GetInstance()->CullObjects();
+
 	m_pRootObject->OnRenderObject();
 
 	// Sync data for current frame before rendering
+	PerFrameDataStorage::ResetUploadedBytes();
 	UniformData::GetInstance()->SyncDataBuffer();
 	RenderWorkManager::GetInstance()->SyncMaterialData();
 	PerFrameData::GetInstance()->SyncDataBuffer();
@@ -956,8 +979,10 @@ void VulkanGlobal::Draw()
 		m_commandBufferList[cbIndex] = m_perFrameRes[FrameMgr()->FrameIndex()]->AllocateTransientPrimaryCommandBuffer();
 		newCBCreated = true;
 	}
-	else if (m_commandBufferList[cbIndex] == nullptr)
+	// Prebaked command buffer references descriptor sets and buffers replaced by reallocation since it was recorded
+	else if (m_commandBufferList[cbIndex] == nullptr || m_commandBufferReallocationCounts[cbIndex] != PerFrameDataStorage::GetReallocationCount())
 	{
+		m_commandBufferReallocationCounts[cbIndex] = PerFrameDataStorage::GetReallocationCount();
 		m_commandBufferList[cbIndex] = m_perFrameRes[FrameMgr()->FrameIndex()]->AllocatePersistantPrimaryCommandBuffer();
 		newCBCreated = true;
 	}
@@ -977,7 +1002,11 @@ void VulkanGlobal::Draw()
 
 	RenderWorkManager::GetInstance()->OnFrameEnd();
 
-	FrameMgr()->CacheSubmissioninfo(GlobalGraphicQueue(), { m_commandBufferList[cbIndex] }, {}, false);
+	// Uploads issued during this frame are submitted ahead of it, and the frame waits on them
+	StagingBufferMgr()->FlushDataMainThread();
+	std::vector<std::shared_ptr<Semaphore>> uploadSemaphores = StagingBufferMgr()->AcquireFlushSemaphores();
+	std::vector<VkPipelineStageFlags> uploadWaitStages(uploadSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	FrameMgr()->CacheSubmissioninfo(GlobalGraphicQueue(), { m_commandBufferList[cbIndex] }, uploadSemaphores, uploadWaitStages, {}, false);
 	
 	GetSwapChain()->QueuePresentImage(GlobalObjects()->GetPresentQueue());
 